@@ -51,6 +51,7 @@ class MockDemandLoader : public demandLoading::DemandLoader
                  ( unsigned int deviceIndex, CUstream stream, const demandLoading::DeviceContext& deviceContext ) );
     MOCK_METHOD( void, abort, () );
     MOCK_METHOD( demandLoading::Statistics, getStatistics, (), ( const ) );
+    MOCK_METHOD( demandLoading::LatencyStatistics, getLatencyStatistics, ( bool ), ( override ) );
     MOCK_METHOD( std::vector<unsigned int>, getDevices, (), ( const ) );
     MOCK_METHOD( const demandLoading::Options&, getOptions, () );
     MOCK_METHOD( void, enableEviction, ( bool evictionActive ) );
@@ -63,6 +64,8 @@ class MockDemandLoader : public demandLoading::DemandLoader
     MOCK_METHOD( bool, pageResident, (unsigned int), ( override ) );
     MOCK_METHOD( bool, launchPrepare, (CUstream, demandLoading::DeviceContext&), ( override ) );
     MOCK_METHOD( demandLoading::Ticket, processRequests, (CUstream, const demandLoading::DeviceContext&), ( override ) );
+    MOCK_METHOD( void, setStreamWeight, (CUstream, unsigned int), ( override ) );
+    MOCK_METHOD( void, cancelRequests, (CUstream), ( override ) );
 };
 
 }  // namespace testing
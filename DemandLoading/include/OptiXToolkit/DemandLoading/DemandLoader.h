@@ -33,6 +33,7 @@
 
 #include <OptiXToolkit/DemandLoading/DemandTexture.h>
 #include <OptiXToolkit/DemandLoading/DeviceContext.h>
+#include <OptiXToolkit/DemandLoading/LatencyStatistics.h>
 #include <OptiXToolkit/DemandLoading/Options.h>
 #include <OptiXToolkit/DemandLoading/Resource.h>
 #include <OptiXToolkit/DemandLoading/Statistics.h>
@@ -119,6 +120,18 @@ class DemandLoader
     /// filled on the host side.
     virtual Ticket processRequests( CUstream stream, const DeviceContext& deviceContext ) = 0;
 
+    /// Set the scheduling weight (1 to 8) of page requests from the given stream.  Requests from
+    /// streams with different weights are queued separately, and the worker threads divide their
+    /// time between them in proportion to their weights.  For example, giving an interactive
+    /// stream a higher weight than a background stream bounds its request latency even while the
+    /// background stream floods the request queue.  The default weight is 1.
+    virtual void setStreamWeight( CUstream stream, unsigned int weight ) = 0;
+
+    /// Cancel the outstanding page requests from the given stream, e.g. after a camera cut makes
+    /// them obsolete.  Cancelled requests that have not yet been filled are skipped without doing
+    /// any I/O, and their tickets are notified as if they had been filled.
+    virtual void cancelRequests( CUstream stream ) = 0;
+
     /// Abort demand loading, with minimal cleanup and no CUDA calls.  Halts asynchronous request
     /// processing.  Useful in case of catastrophic CUDA error or corruption.
     virtual void abort() = 0;
@@ -126,6 +139,12 @@ class DemandLoader
     /// Get current statistics.
     virtual Statistics getStatistics() const = 0;
 
+    /// Get histograms of the host-side latencies of each phase of the demand loading pipeline
+    /// (pulling requests, queue wait, reading tiles, etc.), keyed by request handler type.  The
+    /// histograms cover the period since the DemandLoader was created or since the last call with
+    /// reset=true, so calling this once per frame with reset=true yields per-frame latencies.
+    virtual LatencyStatistics getLatencyStatistics( bool reset ) = 0;
+
     /// Get the ordinals of the devices that can be employed by the DemandLoader (i.e. those that support sparse textures).
     virtual std::vector<unsigned int> getDevices() const = 0;
 
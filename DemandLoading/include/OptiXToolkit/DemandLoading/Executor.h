@@ -0,0 +1,58 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+/// \file Executor.h
+/// Interface for running request processing on an application-supplied thread pool.
+
+#include <functional>
+
+namespace demandLoading {
+
+/// An Executor runs the DemandLoader's request processing tasks.  By default the DemandLoader
+/// processes requests on a private pool of threads.  An application that already owns a thread
+/// pool (e.g. TBB or a work-stealing scheduler) can instead supply an Executor via
+/// Options::executor, so that request processing shares its threads rather than oversubscribing
+/// the cores.  \see Options
+class Executor
+{
+  public:
+    /// The destructor is virtual.
+    virtual ~Executor() = default;
+
+    /// Submit a task for asynchronous execution on any thread.  Tasks never block waiting for
+    /// requests: each one processes the requests that are available when it runs, then returns.
+    virtual void submit( std::function<void()> task ) = 0;
+
+    /// Get the maximum number of tasks that should run concurrently.  The DemandLoader never has
+    /// more than this many tasks submitted at once.
+    virtual unsigned int getMaxConcurrency() const = 0;
+};
+
+}  // namespace demandLoading
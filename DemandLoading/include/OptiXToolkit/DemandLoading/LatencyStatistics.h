@@ -0,0 +1,155 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+/// \file LatencyStatistics.h
+/// Latency histograms for the phases of the demand loading pipeline.
+
+namespace demandLoading {
+
+/// Phases of the demand loading pipeline whose latencies are recorded.  \see LatencyStatistics
+enum LatencyPhase
+{
+    LATENCY_PULL_REQUESTS = 0,         ///< From pulling requests from the device until they are processed on the host.
+    LATENCY_QUEUE_WAIT,                ///< Time each request waits in the request queue.
+    LATENCY_FILL_REQUEST,              ///< Time to fill each request, by request handler type.
+    LATENCY_READ_TILE,                 ///< Time to read (and decode) each tile or mip tail from its ImageSource.
+    LATENCY_ALLOCATE_TRANSFER_BUFFER,  ///< Time to allocate each pinned or device transfer buffer.
+    LATENCY_FILL_TILE,                 ///< Time to copy each tile or mip tail to the device and map it.
+    LATENCY_PUSH_MAPPINGS,             ///< Host time to push page mappings to the device (see launchPrepare).
+    NUM_LATENCY_PHASES
+};
+
+/// Types of request handler, by which latencies are keyed.  Phases that are not specific to a
+/// request handler are recorded as REQUEST_HANDLER_OTHER.
+enum RequestHandlerType
+{
+    REQUEST_HANDLER_OTHER = 0,
+    REQUEST_HANDLER_SAMPLER,     ///< Texture samplers.
+    REQUEST_HANDLER_TEXTURE,     ///< Texture tiles and mip tails.
+    REQUEST_HANDLER_BASE_COLOR,  ///< Texture base colors.
+    REQUEST_HANDLER_RESOURCE,    ///< Arbitrary resources.  \see DemandLoader::createResource
+    NUM_REQUEST_HANDLER_TYPES
+};
+
+/// Histogram of latencies in microseconds, with logarithmic buckets in the style of an HDR
+/// histogram: the first NUM_SUB_BUCKETS buckets count latencies of 0, 1, 2, ... microseconds, and
+/// each subsequent power of two is divided into NUM_SUB_BUCKETS linear buckets, so the relative
+/// error is at most 1/NUM_SUB_BUCKETS.  Latencies beyond the last bucket are counted in it.
+struct LatencyHistogram
+{
+    enum
+    {
+        SUB_BUCKET_BITS = 3,
+        NUM_SUB_BUCKETS = 1 << SUB_BUCKET_BITS,
+        NUM_OCTAVES     = 23,  // Up to 2^25 microseconds (about 33 seconds).
+        NUM_BUCKETS     = NUM_OCTAVES * NUM_SUB_BUCKETS
+    };
+
+    /// Number of latencies in each bucket.
+    unsigned long long counts[NUM_BUCKETS];
+
+    /// Total number of latencies recorded.
+    unsigned long long numSamples;
+
+    /// Sum of the latencies in seconds.
+    double totalTime;
+
+    /// Maximum latency in seconds.
+    double maxTime;
+
+    /// Get the index of the bucket that counts the given latency in microseconds.
+    static unsigned int getBucketIndex( unsigned long long microseconds )
+    {
+        if( microseconds < NUM_SUB_BUCKETS )
+            return static_cast<unsigned int>( microseconds );
+        unsigned int exponent = 0;
+        while( ( microseconds >> exponent ) >= 2 * NUM_SUB_BUCKETS )
+            ++exponent;
+        const unsigned int index = ( exponent + 1 ) * NUM_SUB_BUCKETS + static_cast<unsigned int>( ( microseconds >> exponent ) - NUM_SUB_BUCKETS );
+        return index < NUM_BUCKETS ? index : NUM_BUCKETS - 1;
+    }
+
+    /// Get the smallest latency in microseconds counted by the specified bucket.
+    static unsigned long long getBucketLowerBound( unsigned int index )
+    {
+        if( index < NUM_SUB_BUCKETS )
+            return index;
+        const unsigned int exponent = index / NUM_SUB_BUCKETS - 1;
+        return static_cast<unsigned long long>( NUM_SUB_BUCKETS + index % NUM_SUB_BUCKETS ) << exponent;
+    }
+
+    /// Get the mean latency in seconds.
+    double getMean() const { return numSamples > 0 ? totalTime / numSamples : 0.0; }
+
+    /// Get the latency in seconds below which the given fraction (e.g. 0.99) of the latencies fall,
+    /// which is the upper bound of the bucket containing that percentile (clamped to maxTime).
+    double getPercentile( double fraction ) const
+    {
+        if( numSamples == 0 )
+            return 0.0;
+        const double       target = fraction * static_cast<double>( numSamples );
+        unsigned long long count  = 0;
+        for( unsigned int i = 0; i < NUM_BUCKETS; ++i )
+        {
+            count += counts[i];
+            if( count > 0 && static_cast<double>( count ) >= target )
+            {
+                const double upperBound = ( i + 1 < NUM_BUCKETS ) ? getBucketLowerBound( i + 1 ) * 1.0e-6 : maxTime;
+                return upperBound < maxTime ? upperBound : maxTime;
+            }
+        }
+        return maxTime;
+    }
+};
+
+/// Latency histograms for each phase of the demand loading pipeline, keyed by request handler
+/// type.  \see DemandLoader::getLatencyStatistics
+struct LatencyStatistics
+{
+    LatencyHistogram histograms[NUM_LATENCY_PHASES][NUM_REQUEST_HANDLER_TYPES];
+
+    /// Get the histogram for the given phase, merged across request handler types.
+    LatencyHistogram getPhase( LatencyPhase phase ) const
+    {
+        LatencyHistogram result{};
+        for( unsigned int type = 0; type < NUM_REQUEST_HANDLER_TYPES; ++type )
+        {
+            const LatencyHistogram& histogram = histograms[phase][type];
+            for( unsigned int i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i )
+                result.counts[i] += histogram.counts[i];
+            result.numSamples += histogram.numSamples;
+            result.totalTime += histogram.totalTime;
+            result.maxTime = histogram.maxTime > result.maxTime ? histogram.maxTime : result.maxTime;
+        }
+        return result;
+    }
+};
+
+}  // namespace demandLoading
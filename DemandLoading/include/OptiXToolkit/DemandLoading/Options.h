@@ -31,8 +31,11 @@
 /// \file Options.h
 /// Demand loading configuration options.
 
+#include <OptiXToolkit/DemandLoading/Executor.h>
+
 #include <cstddef>
 #include <limits>
+#include <memory>
 #include <string>
 
 namespace demandLoading {
@@ -60,13 +63,15 @@ struct Options
     unsigned int maxEvictablePages   = 0;     ///< not used
     unsigned int maxInvalidatedPages = 8192;  ///< max slots to push invalidated pages back to device in processRequests
     unsigned int maxStagedPages      = 8192;  ///< num staged pages (pages flagged as non-resident, ready to be evicted) to maintain.
-    unsigned int maxRequestQueueSize = 32768; ///< max size for host-side request queue (filled over multiple processRequests cycles)
+    unsigned int maxRequestQueueSize = 32768; ///< max size for host-side request queue per stream weight (filled over multiple processRequests cycles)
+    unsigned int maxRequestAge       = 0;     ///< cancel queued requests older than this many processRequests calls (0 is unlimited)
     bool useLruTable                 = true;  ///< Whether to use LRU table, or randomized eviction
     bool evictionActive              = true;  ///< whether eviction is active. (turning it off speeds up texture ops)
 
     // Concurrency
     unsigned int maxThreads = 0;  ///< max threads for processing requests. (0 means std::thread::hardware_concurrency)
     unsigned int maxActiveStreams = 4;  ///< number of active CUDA streams across all devices.
+    std::shared_ptr<Executor> executor;  ///< executor for request processing tasks (if null, maxThreads threads are created).
 
     // Trace file
     std::string traceFile = "";  ///< trace filename (disabled if empty).
@@ -37,7 +37,7 @@ namespace demandLoading {
 
 #ifndef DOXYGEN_SKIP
 
-__device__ __forceinline__ unsigned char lruInc( unsigned int count, unsigned int launchNum )
+__host__ __device__ __forceinline__ unsigned char lruInc( unsigned int count, unsigned int launchNum )
 {
     // Logarithmic increment. Slows down as count increases, assuming launchNum increases by 1 each time.
     // If 0 is always passed in for launchNum, the count will increment every launch.
@@ -90,7 +90,7 @@ __device__ inline void atomicClearHalfByte( int index, unsigned int* words )
     atomicAnd( &words[wordIndex], wordMask );
 }
 
-__device__ inline unsigned int getHalfByte( unsigned int index, unsigned int* words )
+__host__ __device__ inline unsigned int getHalfByte( unsigned int index, unsigned int* words )
 {
     unsigned int wordIndex = index >> 3;
     unsigned int shiftVal  = 4 * ( index & 0x7 );
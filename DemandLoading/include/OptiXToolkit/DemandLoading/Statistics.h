@@ -74,6 +74,23 @@ struct Statistics
     /// the cumulative time and does not take into account simultaneous reads, e.g. by multiple threads.
     double readTime;
 
+    /// Number of tile reads satisfied from the tile cache by CachingImageSources.
+    size_t numTileCacheHits;
+
+    /// Number of tile reads by CachingImageSources that were not in the tile cache.
+    size_t numTileCacheMisses;
+
+    /// Number of bytes copied from the tile cache by CachingImageSources.
+    size_t numTileCacheBytesHit;
+
+    /// Number of page requests dropped without being filled because the request queue was full,
+    /// including queued requests that were evicted to make room for more urgent ones.
+    size_t numRequestsDropped;
+
+    /// Number of page requests that were cancelled before being filled, either explicitly (see
+    /// DemandLoader::cancelRequests) or because they exceeded Options::maxRequestAge.
+    size_t numRequestsCancelled;
+
     /// Statistics per device.
     DeviceStatistics perDevice[NUM_DEVICES];
 };
@@ -0,0 +1,198 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "CompletionQueue.h"
+#include "Util/ContextSaver.h"
+#include "Util/Exception.h"
+
+#include <algorithm>
+#include <iostream>
+
+namespace demandLoading {
+
+CompletionQueue::CompletionQueue( unsigned int numThreads )
+{
+    numThreads = std::max( 1u, numThreads );
+    m_threads.reserve( numThreads );
+    for( unsigned int i = 0; i < numThreads; ++i )
+    {
+        m_threads.emplace_back( &CompletionQueue::worker, this );
+    }
+}
+
+CompletionQueue::~CompletionQueue()
+{
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_isShutDown = true;
+    }
+    m_cond.notify_all();
+    for( std::thread& thread : m_threads )
+    {
+        thread.join();
+    }
+}
+
+void CompletionQueue::enqueue( CUstream stream, CUevent event, std::function<void( CUresult )> callback )
+{
+    CUcontext context;
+    DEMAND_CUDA_CHECK( cuStreamGetCtx( stream, &context ) );
+    DEMAND_CUDA_CHECK( cuEventRecord( event, stream ) );
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        DEMAND_ASSERT( !m_isShutDown );
+        m_pending.push_back( Entry{stream, context, event, CUDA_SUCCESS, std::move( callback )} );
+    }
+    m_cond.notify_one();
+}
+
+size_t CompletionQueue::size() const
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    return m_pending.size() + m_ready.size() + m_runningStreams.size();
+}
+
+bool CompletionQueue::findUnwatched( Entry** entry )
+{
+    // Mutex acquired in caller (worker).
+
+    // Events on a stream complete in order, so only the oldest pending entry of each stream is
+    // waited on.  The pending list is in enqueue order.
+    std::vector<CUstream> seenStreams;
+    for( Entry& pending : m_pending )
+    {
+        if( std::find( seenStreams.begin(), seenStreams.end(), pending.stream ) != seenStreams.end() )
+            continue;
+        if( std::find( m_watchedStreams.begin(), m_watchedStreams.end(), pending.stream ) == m_watchedStreams.end() )
+        {
+            *entry = &pending;
+            return true;
+        }
+        seenStreams.push_back( pending.stream );
+    }
+    return false;
+}
+
+void CompletionQueue::waitForEvent( std::unique_lock<std::mutex>& lock, const Entry& entry )
+{
+    // Mutex acquired in caller (worker).
+
+    // Block until the event completes, without holding the mutex.  Only this thread moves the
+    // stream's pending entries while the stream is watched, so the entry is still the stream's
+    // oldest one afterwards.
+    const CUstream stream = entry.stream;
+    m_watchedStreams.push_back( stream );
+    const CUcontext context = entry.context;
+    const CUevent   event   = entry.event;
+    lock.unlock();
+    CUresult status;
+    {
+        ContextSaver contextSaver;
+        status = cuCtxSetCurrent( context );
+        if( status == CUDA_SUCCESS )
+            status = cuEventSynchronize( event );
+    }
+    lock.lock();
+
+    auto it = std::find_if( m_pending.begin(), m_pending.end(), [stream]( const Entry& e ) { return e.stream == stream; } );
+    it->status = status;
+    m_ready.push_back( std::move( *it ) );
+    m_pending.erase( it );
+    m_watchedStreams.erase( std::find( m_watchedStreams.begin(), m_watchedStreams.end(), stream ) );
+}
+
+bool CompletionQueue::popReady( Entry* entry )
+{
+    // Mutex acquired in caller (worker).
+
+    // Skip entries whose stream is running a callback, which keeps the callbacks for each stream in order.
+    for( auto it = m_ready.begin(); it != m_ready.end(); ++it )
+    {
+        if( std::find( m_runningStreams.begin(), m_runningStreams.end(), it->stream ) == m_runningStreams.end() )
+        {
+            *entry = std::move( *it );
+            m_ready.erase( it );
+            return true;
+        }
+    }
+    return false;
+}
+
+void CompletionQueue::worker()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    while( true )
+    {
+        // Run a ready callback, if any.
+        Entry entry;
+        if( popReady( &entry ) )
+        {
+            m_runningStreams.push_back( entry.stream );
+            lock.unlock();
+            try
+            {
+                // The completion queue's threads have no current CUDA context, so the stream's
+                // context is made current while the callback runs.
+                ContextSaver contextSaver;
+                DEMAND_CUDA_CHECK( cuCtxSetCurrent( entry.context ) );
+                entry.callback( entry.status );
+            }
+            catch( const std::exception& e )
+            {
+                std::cerr << "Error: " << e.what() << std::endl;
+#ifndef NDEBUG
+                std::terminate();
+#endif
+            }
+            entry.callback = nullptr;
+            lock.lock();
+            m_runningStreams.erase( std::find( m_runningStreams.begin(), m_runningStreams.end(), entry.stream ) );
+
+            // Other threads might be waiting for this stream's next callback.
+            m_cond.notify_all();
+            continue;
+        }
+
+        // Exit when shut down once all the callbacks have been run.
+        if( m_isShutDown && m_pending.empty() && m_ready.empty() )
+            return;
+
+        // Wait for the oldest event of a stream that no other thread is waiting on, or for more
+        // work if there is none.  Once the event completes, wake another thread to run its callback.
+        Entry* pending;
+        if( !findUnwatched( &pending ) )
+        {
+            m_cond.wait( lock );
+            continue;
+        }
+        waitForEvent( lock, *pending );
+        m_cond.notify_all();
+    }
+}
+
+}  // namespace demandLoading
@@ -0,0 +1,106 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <cuda.h>
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace demandLoading {
+
+/// CompletionQueue runs host functions once the preceding work on a CUDA stream has completed,
+/// like cuLaunchHostFunc, but on its own threads rather than the driver's callback thread.  Host
+/// functions enqueued with cuLaunchHostFunc are run serially on a single thread, blocking every
+/// other callback (and the streams behind them) until each one returns.  Instead, the
+/// CompletionQueue records an event on the stream, and its threads wait on the outstanding events
+/// of different streams, running the callbacks for different streams in parallel.  Callbacks for the same stream are run
+/// in the order they were enqueued, one at a time.  Unlike host functions, callbacks may make CUDA
+/// calls; the CUDA context of the stream is current while a callback runs.
+class CompletionQueue
+{
+  public:
+    /// Construct completion queue, starting the specified number of threads (at least one).
+    explicit CompletionQueue( unsigned int numThreads );
+
+    /// The destructor runs any outstanding callbacks (waiting for their events) before
+    /// terminating the threads.
+    ~CompletionQueue();
+
+    /// Record the given event on the stream and run the callback once it has completed.  The callback
+    /// is passed the result of synchronizing with the event, which is not CUDA_SUCCESS if the
+    /// preceding work failed.  The event is owned by the caller, and it must not be re-recorded until
+    /// the callback has been invoked.  It should be created with CU_EVENT_BLOCKING_SYNC, so that the
+    /// thread waiting on it sleeps rather than spins.  The stream's CUDA context is determined here,
+    /// so if the stream is the null stream, the desired context must be current.
+    void enqueue( CUstream stream, CUevent event, std::function<void( CUresult )> callback );
+
+    /// Get the number of callbacks that have been enqueued but not yet run.
+    size_t size() const;
+
+  private:
+    struct Entry
+    {
+        CUstream                        stream;
+        CUcontext                       context;
+        CUevent                         event;
+        CUresult                        status;  // Result of synchronizing with the event.
+        std::function<void( CUresult )> callback;
+    };
+
+    std::vector<std::thread> m_threads;
+    mutable std::mutex       m_mutex;
+    std::condition_variable  m_cond;
+    std::deque<Entry>        m_pending;         // Callbacks whose events have not completed.
+    std::deque<Entry>        m_ready;           // Callbacks whose events have completed.
+    std::vector<CUstream>    m_runningStreams;  // Streams with a callback that is currently running.
+    std::vector<CUstream>    m_watchedStreams;  // Streams with an event that a thread is waiting on.
+    bool                     m_isShutDown = false;
+
+    // Per-thread worker function.
+    void worker();
+
+    // Find the oldest pending entry of a stream that no thread is waiting on, returning false if
+    // there is none.  The caller must hold m_mutex.
+    bool findUnwatched( Entry** entry );
+
+    // Wait for the given pending entry's event, releasing the given lock on m_mutex meanwhile,
+    // and then move the entry to the ready list.
+    void waitForEvent( std::unique_lock<std::mutex>& lock, const Entry& entry );
+
+    // Remove the first ready entry whose stream is not already running a callback, returning
+    // false if there is none.  The caller must hold m_mutex.
+    bool popReady( Entry* entry );
+};
+
+}  // namespace demandLoading
@@ -43,6 +43,7 @@
 #include <cuda.h>
 
 #include <algorithm>
+#include <iostream>
 #include <memory>
 #include <set>
 
@@ -88,19 +89,21 @@ class TextureSamplerReturnPredicate : public PageInvalidatorPredicate
 
 DemandLoaderImpl::DemandLoaderImpl( const Options& options )
     : m_pageTableManager( std::make_shared<PageTableManager>( options.numPages, options.numPageTableEntries ) )
-    , m_requestProcessor( m_pageTableManager, options )
-    , m_pageLoader( new DemandPageLoaderImpl( m_pageTableManager, &m_requestProcessor, options ) )
+    , m_requestProcessor( m_pageTableManager, options, &m_latencyRecorder )
+    , m_pageLoader( new DemandPageLoaderImpl( m_pageTableManager, &m_requestProcessor, options, &m_latencyRecorder ) )
     , m_samplerRequestHandler( this )
 {
     // Reserve bits in the sampler request handler for all possible textures.
     m_samplerRequestHandler.setPageRange( 0, options.numPageTableEntries );
 
     m_requestProcessor.start( options.maxThreads );
+    m_reclaimThread = std::thread( &DemandLoaderImpl::reclaimWorker, this );
 }
 
 DemandLoaderImpl::~DemandLoaderImpl()
 {
     m_requestProcessor.stop();
+    stopReclaimer();
 }
 
 // Create a demand-loaded texture.  The image is not opened until the texture sampler is requested
@@ -272,7 +275,12 @@ bool DemandLoaderImpl::pageResident( unsigned int pageId )
 // Returns false if the device doesn't support sparse textures.
 bool DemandLoaderImpl::launchPrepare( CUstream stream, DeviceContext& context )
 {
-    return m_pageLoader->pushMappings( stream, context );
+    const bool result = m_pageLoader->pushMappings( stream, context );
+
+    // Tiles staged before previous pushes become reclaimable as the pushes complete.
+    if( result )
+        requestTileReclamation();
+    return result;
 }
 
 // Process page requests.
@@ -307,9 +315,20 @@ Ticket DemandLoaderImpl::replayRequests( CUstream stream, unsigned int* requeste
     return ticket;
 }
 
+void DemandLoaderImpl::setStreamWeight( CUstream stream, unsigned int weight )
+{
+    m_requestProcessor.setStreamWeight( stream, weight );
+}
+
+void DemandLoaderImpl::cancelRequests( CUstream stream )
+{
+    m_requestProcessor.cancelRequests( stream );
+}
+
 void DemandLoaderImpl::abort()
 {
     m_requestProcessor.stop();
+    stopReclaimer();
 }
 
 void DemandLoaderImpl::unmapTileResource( CUstream stream, unsigned int pageId )
@@ -359,30 +378,120 @@ PageTableManager* DemandLoaderImpl::getPageTableManager()
     return m_pageTableManager.get();
 }
 
-void DemandLoaderImpl::freeStagedTiles( CUstream stream )
+void DemandLoaderImpl::freeStagedTiles( CUstream stream, bool restoreReserve )
+{
+    PagingSystem*        pagingSystem        = getPagingSystem();
+    DeviceMemoryManager* deviceMemoryManager = getDeviceMemoryManager();
+    PageMapping          mapping;
+
+    while( tileBlocksNeeded( restoreReserve ) )
+    {
+        pagingSystem->activateEviction( true );
+        if( !pagingSystem->freeStagedPage( &mapping ) )
+            break;
+
+        // The mutex is not held while unmapping, which locks the page, since fills lock the page
+        // before taking the mutex.
+        unmapTileResource( stream, mapping.id );
+
+        // Record the unmapping before the block can be reallocated, so that the fill that reuses it
+        // can wait for it (see waitForUnmappedTiles).
+        std::unique_lock<std::mutex> lock( m_mutex );
+        ReclaimStream* reclaimStream = getReclaimStream();
+        DEMAND_CUDA_CHECK( cuEventRecord( reclaimStream->unmapped, stream ) );
+        reclaimStream->unmappedRecorded = true;
+        deviceMemoryManager->freeTileBlock( mapping.page );
+    }
+}
+
+bool DemandLoaderImpl::tileBlocksNeeded( bool restoreReserve )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    DeviceMemoryManager*         deviceMemoryManager = getDeviceMemoryManager();
+    return restoreReserve ? deviceMemoryManager->tileBlockReserveIsLow() : deviceMemoryManager->needTileBlocksFreed();
+}
+
+void DemandLoaderImpl::waitForUnmappedTiles( CUstream stream )
 {
     std::unique_lock<std::mutex> lock( m_mutex );
+    const ReclaimStream*         reclaimStream = m_reclaimStreams.find();
+    if( reclaimStream && reclaimStream->unmappedRecorded )
+        DEMAND_CUDA_CHECK( cuStreamWaitEvent( stream, reclaimStream->unmapped, 0U ) );
+}
+
+DemandLoaderImpl::ReclaimStream* DemandLoaderImpl::getReclaimStream()
+{
+    return m_reclaimStreams.findOrCreate( [] { return std::unique_ptr<ReclaimStream>( new ReclaimStream ); } );
+}
 
-    PagingSystem* pagingSystem = getPagingSystem();
-    PageMapping   mapping;
+void DemandLoaderImpl::requestTileReclamation()
+{
+    if( !tileBlocksNeeded( true ) )
+        return;
 
-    while( getDeviceMemoryManager()->needTileBlocksFreed() )
+    CUcontext context;
+    DEMAND_CUDA_CHECK( cuCtxGetCurrent( &context ) );
     {
-        pagingSystem->activateEviction( true );
-        if( pagingSystem->freeStagedPage( &mapping ) )
-        {
-            unmapTileResource( stream, mapping.id );
-            getDeviceMemoryManager()->freeTileBlock( mapping.page );
-        }
-        else 
+        std::unique_lock<std::mutex> lock( m_reclaimMutex );
+        m_reclaimContexts.insert( context );
+    }
+    m_reclaimRequested.notify_one();
+}
+
+void DemandLoaderImpl::reclaimWorker()
+{
+    std::unique_lock<std::mutex> lock( m_reclaimMutex );
+    while( true )
+    {
+        m_reclaimRequested.wait( lock, [this] { return m_reclaimShutDown || !m_reclaimContexts.empty(); } );
+        if( m_reclaimShutDown )
+            return;
+
+        // Take the pending requests, and free staged tiles in each context without holding the lock.
+        std::set<CUcontext> contexts;
+        contexts.swap( m_reclaimContexts );
+        lock.unlock();
+        for( CUcontext context : contexts )
         {
-            break;
+            // An error in one context does not stop the reclaimer.  Fills that find the tile pool
+            // exhausted free staged tiles themselves in the meantime.
+            try
+            {
+                DEMAND_CUDA_CHECK( cuCtxSetCurrent( context ) );
+                CUstream stream;
+                {
+                    std::unique_lock<std::mutex> loaderLock( m_mutex );
+                    stream = getReclaimStream()->stream;
+                }
+                freeStagedTiles( stream, true );
+            }
+            catch( const std::exception& e )
+            {
+                std::cerr << "Error: " << e.what() << std::endl;
+#ifndef NDEBUG
+                std::terminate();
+#endif
+            }
         }
+        lock.lock();
+    }
+}
+
+void DemandLoaderImpl::stopReclaimer()
+{
+    {
+        std::unique_lock<std::mutex> lock( m_reclaimMutex );
+        m_reclaimShutDown = true;
     }
+    m_reclaimRequested.notify_all();
+    if( m_reclaimThread.joinable() )
+        m_reclaimThread.join();
 }
 
 const TransferBufferDesc DemandLoaderImpl::allocateTransferBuffer( CUmemorytype memoryType, size_t size, CUstream /*stream*/ )
 {
+    // The latency includes waiting for the mutex.
+    Stopwatch                    stopwatch;
     std::unique_lock<std::mutex> lock( m_mutex );
     const unsigned int alignment = 4096;
     
@@ -391,6 +500,9 @@ const TransferBufferDesc DemandLoaderImpl::allocateTransferBuffer( CUmemorytype
         memoryBlock = m_pageLoader->getPinnedMemoryPool()->alloc( size, alignment );
     else if( memoryType == CU_MEMORYTYPE_DEVICE )
         memoryBlock = getDeviceTransferPool()->alloc( size, alignment );
+    lock.unlock();
+
+    m_latencyRecorder.record( LATENCY_ALLOCATE_TRANSFER_BUFFER, REQUEST_HANDLER_OTHER, stopwatch.elapsed() );
     return TransferBufferDesc{ memoryType, memoryBlock };
 }
 
@@ -429,10 +541,16 @@ Statistics DemandLoaderImpl::getStatistics() const
     }
 
     m_pageLoader->accumulateStatistics( stats );
+    m_requestProcessor.accumulateStatistics( stats );
 
     return stats;
 }
 
+LatencyStatistics DemandLoaderImpl::getLatencyStatistics( bool reset )
+{
+    return m_latencyRecorder.getStatistics( reset );
+}
+
 const Options& DemandLoaderImpl::getOptions() const
 {
     return m_pageLoader->getOptions();
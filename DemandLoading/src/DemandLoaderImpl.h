@@ -41,12 +41,16 @@
 #include "Textures/DemandTextureImpl.h"
 #include "Textures/SamplerRequestHandler.h"
 #include "TransferBufferDesc.h"
+#include "Util/LatencyRecorder.h"
 
 #include <cuda.h>
 
+#include <condition_variable>
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <set>
+#include <thread>
 #include <vector>
 
 namespace imageSource {
@@ -132,6 +136,12 @@ class DemandLoaderImpl : public DemandLoader
     /// the given stream.  Returns a ticket that is notified when the requests have been filled.
     Ticket replayRequests( CUstream stream, unsigned int* requestedPages, unsigned int numRequestedPages );
 
+    /// Set the scheduling weight of page requests from the given stream.
+    void setStreamWeight( CUstream stream, unsigned int weight ) override;
+
+    /// Cancel the outstanding page requests from the given stream.
+    void cancelRequests( CUstream stream ) override;
+
     /// Abort demand loading, with minimal cleanup and no CUDA calls.  Halts asynchronous request
     /// processing.  Useful in case of catastrophic CUDA error or corruption.
     void abort() override;
@@ -139,6 +149,9 @@ class DemandLoaderImpl : public DemandLoader
     /// Get current statistics.
     Statistics getStatistics() const override;
 
+    /// Get latency histograms for the phases of the demand loading pipeline, optionally resetting them.
+    LatencyStatistics getLatencyStatistics( bool reset ) override;
+
     /// Get the demand loading configuration options.
     const Options& getOptions() const override;
 
@@ -166,8 +179,19 @@ class DemandLoaderImpl : public DemandLoader
     /// Get the PageTableManager.
     PageTableManager* getPageTableManager();
 
-    /// Free some staged tiles if there are some that are ready
-    void freeStagedTiles( CUstream stream );
+    /// Free some staged tiles if there are some that are ready, until a tile block can be allocated,
+    /// or, if restoreReserve is true, until the tile pool's reserve of free space is restored.  Fills
+    /// call this when allocation fails; the background reclaimer restores the reserve ahead of demand.
+    void freeStagedTiles( CUstream stream, bool restoreReserve = false );
+
+    /// Make the given stream wait until the tiles freed by freeStagedTiles in the current CUDA
+    /// context are unmapped.  Called before filling a newly allocated tile block, which might
+    /// have been unmapped on another stream.
+    void waitForUnmappedTiles( CUstream stream );
+
+    /// Wake the background reclaimer if the tile pool for the current CUDA context is running
+    /// low, so that staged tiles are freed ahead of demand.  Does not block.
+    void requestTileReclamation();
 
     /// Allocate a temporary buffer of the given memory type, used as a staging point for an asset such as a texture tile.
     const TransferBufferDesc allocateTransferBuffer( CUmemorytype memoryType, size_t size, CUstream stream );
@@ -177,8 +201,21 @@ class DemandLoaderImpl : public DemandLoader
 
     void setPageTableEntry( unsigned int pageId, bool evictable, void* pageTableEntry );
 
+    /// Get the recorder for pipeline latencies.
+    LatencyRecorder* getLatencyRecorder() { return &m_latencyRecorder; }
+
+    /// Get the number of page requests waiting to be processed.  Used when replaying trace files.
+    unsigned int getRequestQueueSize() const { return m_requestProcessor.getQueueSize(); }
+
+    /// Record the tile pages reserved for a sparse texture in the trace file (if any).
+    void recordTexturePages( unsigned int textureId, const TextureSampler& sampler )
+    {
+        m_requestProcessor.recordTexturePages( textureId, sampler );
+    }
+
   private:
     mutable std::mutex        m_mutex;
+    LatencyRecorder           m_latencyRecorder;  // Declared before the components that record into it.
 
     std::shared_ptr<PageTableManager>     m_pageTableManager;  // Allocates ranges of virtual pages.
     ThreadPoolRequestProcessor            m_requestProcessor;  // Asynchronously processes page requests.
@@ -200,6 +237,47 @@ class DemandLoaderImpl : public DemandLoader
 
     unsigned int m_ticketId{};
 
+    // Staged tiles are freed by a background thread, which unmaps them on a stream of its own
+    // in each CUDA context.  The event is recorded after each unmapping, whichever stream it was
+    // issued on.
+    struct ReclaimStream
+    {
+        ReclaimStream()
+        {
+            DEMAND_CUDA_CHECK( cuStreamCreate( &stream, CU_STREAM_NON_BLOCKING ) );
+            DEMAND_CUDA_CHECK( cuEventCreate( &unmapped, CU_EVENT_DISABLE_TIMING ) );
+        }
+        ~ReclaimStream()
+        {
+            DEMAND_CUDA_CHECK_NOTHROW( cuEventDestroy( unmapped ) );
+            DEMAND_CUDA_CHECK_NOTHROW( cuStreamDestroy( stream ) );
+        }
+
+        CUstream stream{};
+        CUevent  unmapped{};
+        bool     unmappedRecorded = false;
+    };
+    std::thread                   m_reclaimThread;
+    std::mutex                    m_reclaimMutex;
+    std::condition_variable       m_reclaimRequested;
+    std::set<CUcontext>           m_reclaimContexts;  // Contexts whose tile pools are running low.
+    bool                          m_reclaimShutDown = false;
+    PerContextData<ReclaimStream> m_reclaimStreams;   // Guarded by m_mutex.
+
+    // Reclaim thread function, which frees staged tiles in the requested contexts.
+    void reclaimWorker();
+
+    // Stop the reclaim thread.
+    void stopReclaimer();
+
+    // Returns true if staged tiles should be freed so that a tile block can be allocated, or, if
+    // restoreReserve is true, so that the tile pool's reserve is restored.  Locks the mutex.
+    bool tileBlocksNeeded( bool restoreReserve );
+
+    // Get the ReclaimStream for the current CUDA context, creating it if necessary.  The caller
+    // must hold the mutex.
+    ReclaimStream* getReclaimStream();
+
     // Unmap the backing storage associated with a texture tile or mip tail
     void unmapTileResource( CUstream stream, unsigned int pageId );
 
@@ -99,12 +99,15 @@ const static unsigned long long PINNED_ALLOC_SIZE = 2 * 1024 * 1024;
 
 DemandPageLoaderImpl::DemandPageLoaderImpl( std::shared_ptr<PageTableManager> pageTableManager,
                                             RequestProcessor*                 requestProcessor,
-                                            const Options&                    options )
+                                            const Options&                    options,
+                                            LatencyRecorder*                  latencyRecorder )
     : m_options( configure( options ) )
     , m_numDevices( getCudaDeviceCount() )
     , m_pageTableManager( std::move( pageTableManager ) )
     , m_requestProcessor( requestProcessor )
+    , m_latencyRecorder( latencyRecorder )
     , m_pinnedMemoryPool( new PinnedAllocator(), new RingSuballocator( PINNED_ALLOC_SIZE ), PINNED_ALLOC_SIZE, options.maxPinnedMemory )
+    , m_completionQueue( new CompletionQueue( m_options.maxActiveStreams ) )
 {
     // Determine which devices to use.  Look for devices supporting sparse textures first
     for( unsigned int deviceIndex = 0; deviceIndex < m_numDevices; ++deviceIndex )
@@ -138,7 +141,8 @@ PagingSystem* DemandPageLoaderImpl::getPagingSystem() const
     std::unique_lock<std::mutex> lock( m_pagingSystemsMutex );
     return m_pagingSystems.findOrCreate( [this]() {
         return std::unique_ptr<PagingSystem>(
-            new PagingSystem( m_options, getDeviceMemoryManager(), &m_pinnedMemoryPool, m_requestProcessor ) );
+            new PagingSystem( m_options, getDeviceMemoryManager(), &m_pinnedMemoryPool, m_requestProcessor,
+                              m_completionQueue.get(), m_latencyRecorder ) );
     } );
 }
 
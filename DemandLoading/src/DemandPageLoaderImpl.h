@@ -34,6 +34,7 @@
 #include "Memory/DeviceMemoryManager.h"
 #include <OptiXToolkit/Memory/MemoryPool.h>
 #include <OptiXToolkit/Memory/RingSuballocator.h>
+#include "CompletionQueue.h"
 #include "PageTableManager.h"
 #include "PagingSystem.h"
 #include "ResourceRequestHandler.h"
@@ -58,6 +59,7 @@ namespace demandLoading {
 
 struct DeviceContext;
 class DemandTexture;
+class LatencyRecorder;
 class RequestProcessor;
 struct TextureDescriptor;
 class TraceFileWriter;
@@ -69,7 +71,12 @@ class DemandPageLoaderImpl : public DemandPageLoader
     /// Construct demand loading sytem.
     DemandPageLoaderImpl( RequestProcessor* requestProcessor, const Options& options );
 
-    DemandPageLoaderImpl( std::shared_ptr<PageTableManager> pageTableManager, RequestProcessor *requestProcessor, const Options& options );
+    /// Construct demand loading system with the given PageTableManager.  If a LatencyRecorder is
+    /// provided, the paging systems record the latencies of pulling requests and pushing mappings.
+    DemandPageLoaderImpl( std::shared_ptr<PageTableManager> pageTableManager,
+                          RequestProcessor*                 requestProcessor,
+                          const Options&                    options,
+                          LatencyRecorder*                  latencyRecorder = nullptr );
 
     /// Destroy demand loading system.
     ~DemandPageLoaderImpl() override = default;
@@ -149,6 +156,7 @@ class DemandPageLoaderImpl : public DemandPageLoader
 
     std::shared_ptr<PageTableManager> m_pageTableManager;  // Allocates ranges of virtual pages.
     RequestProcessor*   m_requestProcessor;  // Processes page requests.
+    LatencyRecorder*    m_latencyRecorder;   // Records paging latencies (optional).
 
     mutable otk::MemoryPool<otk::PinnedAllocator, otk::RingSuballocator> m_pinnedMemoryPool;
 
@@ -160,6 +168,11 @@ class DemandPageLoaderImpl : public DemandPageLoader
     void invalidatePages( CUstream stream, DeviceContext& context );
 
     std::vector<InvalidationRange>* getPagesToInvalidate();
+
+    // Processes pulled page requests once they have been copied from the device, with a thread per
+    // active stream.  Declared last, so that outstanding requests are processed before the paging
+    // systems are destroyed.
+    std::unique_ptr<CompletionQueue> m_completionQueue;
 };
 
 }  // namespace demandLoading
@@ -0,0 +1,181 @@
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include "Util/Exception.h"
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace demandLoading {
+
+/// Host-side state of a page table entry, used for eviction.
+struct HostPageTableEntry
+{
+    unsigned long long entry;
+    bool               resident;      // Whether a page is considered resident on the GPU
+    bool               staged;        // Pages that are currently staged (and not restored by second chance).
+    bool               inStagedList;  // All pages that are in the staged list, whether restored or not.
+};
+
+/// HostPageTable is a sparse flat array of HostPageTableEntry, indexed by page id.  Entries are
+/// stored in fixed-size chunks that are allocated on first use, with the entry values and packed
+/// state bits in separate arrays.  Each chunk is guarded by one of a fixed number of mutexes
+/// (selected by chunk index), so operations on pages in different chunks do not serialize.
+/// Each method is atomic with respect to the others, but sequences of calls are not.
+class HostPageTable
+{
+  public:
+    /// Construct a page table for page ids in [0, numPages).
+    explicit HostPageTable( unsigned int numPages )
+        : m_numPages( numPages )
+        , m_chunks( ( numPages + CHUNK_SIZE - 1 ) / CHUNK_SIZE )
+    {
+    }
+
+    /// Return the number of pages in the page table.
+    unsigned int getNumPages() const { return m_numPages; }
+
+    /// Find the entry for the specified page.  Returns false if there is no entry.
+    bool find( unsigned int pageId, HostPageTableEntry* result ) const
+    {
+        if( pageId >= m_numPages )
+            return false;
+        std::unique_lock<std::mutex> lock( getMutex( pageId ) );
+
+        const Chunk* chunk = m_chunks[pageId / CHUNK_SIZE].get();
+        if( !chunk )
+            return false;
+        const unsigned int  index = pageId % CHUNK_SIZE;
+        const unsigned char flags = chunk->flags[index];
+        if( !( flags & PRESENT ) )
+            return false;
+        *result = HostPageTableEntry{chunk->entries[index], ( flags & RESIDENT ) != 0, ( flags & STAGED ) != 0,
+                                     ( flags & IN_STAGED_LIST ) != 0};
+        return true;
+    }
+
+    /// Check whether the specified page is resident, returning its entry if so.
+    bool isResident( unsigned int pageId, unsigned long long* entry ) const
+    {
+        if( pageId >= m_numPages )
+            return false;
+        std::unique_lock<std::mutex> lock( getMutex( pageId ) );
+
+        const Chunk* chunk = m_chunks[pageId / CHUNK_SIZE].get();
+        const unsigned int index = pageId % CHUNK_SIZE;
+        if( !chunk || !( chunk->flags[index] & RESIDENT ) )
+            return false;
+        if( entry )
+            *entry = chunk->entries[index];
+        return true;
+    }
+
+    /// Set the entry for the specified page, adding it if necessary.
+    void set( unsigned int pageId, const HostPageTableEntry& value )
+    {
+        DEMAND_ASSERT( pageId < m_numPages );
+        std::unique_lock<std::mutex> lock( getMutex( pageId ) );
+
+        std::unique_ptr<Chunk>& chunk = m_chunks[pageId / CHUNK_SIZE];
+        if( !chunk )
+            chunk.reset( new Chunk() );
+        const unsigned int index = pageId % CHUNK_SIZE;
+        chunk->entries[index]    = value.entry;
+        chunk->flags[index] = PRESENT | ( value.resident ? RESIDENT : 0 ) | ( value.staged ? STAGED : 0 )
+                              | ( value.inStagedList ? IN_STAGED_LIST : 0 );
+    }
+
+    /// Remove the entry for the specified page.  Returns false if there was no entry.
+    bool erase( unsigned int pageId )
+    {
+        if( pageId >= m_numPages )
+            return false;
+        std::unique_lock<std::mutex> lock( getMutex( pageId ) );
+
+        Chunk* chunk = m_chunks[pageId / CHUNK_SIZE].get();
+        if( !chunk )
+            return false;
+        const unsigned int index   = pageId % CHUNK_SIZE;
+        const bool         present = ( chunk->flags[index] & PRESENT ) != 0;
+        chunk->flags[index]        = 0;
+        return present;
+    }
+
+    /// Return the id of the first page in [pageId, endPage) that has an entry, or endPage if there
+    /// is none.  Unallocated chunks are skipped without being scanned.
+    unsigned int findNext( unsigned int pageId, unsigned int endPage ) const
+    {
+        endPage = endPage < m_numPages ? endPage : m_numPages;
+        while( pageId < endPage )
+        {
+            const unsigned int chunkIndex = pageId / CHUNK_SIZE;
+            const unsigned int chunkEnd   = ( chunkIndex + 1 ) * CHUNK_SIZE;
+            const unsigned int scanEnd    = chunkEnd < endPage ? chunkEnd : endPage;
+            {
+                std::unique_lock<std::mutex> lock( m_mutexes[chunkIndex % NUM_MUTEXES] );
+                const Chunk*                 chunk = m_chunks[chunkIndex].get();
+                for( ; chunk && pageId < scanEnd; ++pageId )
+                {
+                    if( chunk->flags[pageId % CHUNK_SIZE] & PRESENT )
+                        return pageId;
+                }
+            }
+            pageId = scanEnd;
+        }
+        return endPage;
+    }
+
+  private:
+    static const unsigned int CHUNK_SIZE  = 4096;
+    static const unsigned int NUM_MUTEXES = 64;
+
+    enum Flags : unsigned char
+    {
+        PRESENT        = 1,
+        RESIDENT       = 2,
+        STAGED         = 4,
+        IN_STAGED_LIST = 8
+    };
+
+    struct Chunk
+    {
+        unsigned long long entries[CHUNK_SIZE];
+        unsigned char      flags[CHUNK_SIZE]{};
+    };
+
+    unsigned int                        m_numPages;
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    mutable std::mutex                  m_mutexes[NUM_MUTEXES];  // m_mutexes[i] guards chunks i, i + NUM_MUTEXES, ...
+
+    std::mutex& getMutex( unsigned int pageId ) const { return m_mutexes[( pageId / CHUNK_SIZE ) % NUM_MUTEXES]; }
+};
+
+}  // namespace demandLoading
@@ -71,6 +71,12 @@ class DeviceMemoryManager
 
     /// Returns true if TileBlocks need to be freed.
     bool needTileBlocksFreed() const { return m_tilePool.allocatableSpace() < m_tilePool.allocationGranularity(); };
+    /// Returns true if the free space in the tile pool is below the reserve that is kept ready by
+    /// reclaiming staged tiles in the background.
+    bool tileBlockReserveIsLow() const
+    {
+        return m_tilePool.allocatableSpace() < TILE_BLOCK_RESERVE_ARENAS * m_tilePool.allocationGranularity();
+    }
     /// Returns the arena size for m_tilePool.
     size_t getTilePoolArenaSize() const { return static_cast<size_t>( m_tilePool.allocationGranularity() ); }
     /// Set the max texture memory
@@ -85,6 +91,9 @@ class DeviceMemoryManager
     void accumulateStatistics( DeviceStatistics& stats ) const { stats.memoryUsed += getTotalDeviceMemory(); }
 
   private:
+    // Number of arenas' worth of free space kept ready in the tile pool (see tileBlockReserveIsLow).
+    static const unsigned int TILE_BLOCK_RESERVE_ARENAS = 2;
+
     Options      m_options;
 
     otk::MemoryPool<otk::DeviceAllocator, otk::FixedSuballocator>     m_samplerPool;
@@ -32,7 +32,9 @@
 #include "Util/Exception.h"
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -42,7 +44,7 @@ class RequestHandler;
 
 /// The PageTableManager is used to reserve a contiguous range of page table entries.  It keeps a
 /// mapping that allows the request handler corresponding to a page table entry to be determined in
-/// log(N) time.
+/// log(N) time without locking.
 class PageTableManager
 {
   public:
@@ -50,6 +52,8 @@ class PageTableManager
         : m_totalPages( totalPages )
         , m_backedPages( backedPages )
         , m_nextUnbackedPage( backedPages )
+        , m_backedMappings( backedPages )
+        , m_unbackedMappings( totalPages - backedPages )
     {
     }
 
@@ -80,7 +84,7 @@ class PageTableManager
         DEMAND_ASSERT_MSG( m_nextBackedPage + numPages <= m_backedPages,
                            "Insufficient backed pages in demand loading page table" );
 
-        return insertPageMapping( m_nextBackedPage, numPages, handler );
+        return insertPageMapping( m_backedMappings, m_nextBackedPage, numPages, handler );
     }
 
     /// Reserve unbacked pages (pages with no backing storage on the device).
@@ -89,20 +93,15 @@ class PageTableManager
         std::unique_lock<std::mutex> lock( m_mutex );
         DEMAND_ASSERT_MSG( m_nextUnbackedPage + numPages <= m_totalPages, "Insufficient unbacked pages in demand loading page table" );
 
-        return insertPageMapping( m_nextUnbackedPage, numPages, handler );
+        return insertPageMapping( m_unbackedMappings, m_nextUnbackedPage, numPages, handler );
     }
 
     /// Find the request handler associated with the specified page.  Returns nullptr if not found.
+    /// This is called for every request, so it does not lock: it is wait-free and may run
+    /// concurrently with page reservation.
     RequestHandler* getRequestHandler( unsigned int pageId ) const
     {
-        std::unique_lock<std::mutex> lock( m_mutex );
-
-        // Pages are allocated in increasing order, so the array of mappings is sorted, allowing us
-        // to use binary search to find the the given page id.
-        const auto least =
-            std::lower_bound( m_mappings.cbegin(), m_mappings.cend(), pageId,
-                              []( const PageMapping& entry, unsigned int id ) { return id > entry.lastPage; } );
-        return least != m_mappings.cend() ? least->handler : nullptr;
+        return pageId < m_backedPages ? m_backedMappings.find( pageId ) : m_unbackedMappings.find( pageId );
     }
 
   private:
@@ -113,19 +112,76 @@ class PageTableManager
         RequestHandler* handler;
     };
 
-    unsigned int insertPageMapping( unsigned int& nextPage, unsigned int numPages, RequestHandler* handler )
+    // Page mappings for one region of the page table (backed or unbacked).  Pages within a region
+    // are allocated in increasing order, so mappings are only ever appended, and the list stays
+    // sorted.  Mappings are stored in fixed-size chunks that never move once allocated.  A writer
+    // fills in an entry before publishing the new size with release semantics, so readers that
+    // load the size with acquire semantics can binary search the published entries without locking.
+    class PageMappingList
+    {
+      public:
+        // Construct a list with capacity for the given number of single-page mappings.
+        explicit PageMappingList( unsigned int maxMappings )
+            : m_chunks( maxMappings / CHUNK_SIZE + 1 )
+        {
+        }
+
+        // Append a mapping.  Writers must be serialized by the caller.
+        void append( const PageMapping& mapping )
+        {
+            const unsigned int index = m_size.load( std::memory_order_relaxed );
+            DEMAND_ASSERT( index / CHUNK_SIZE < m_chunks.size() );
+            std::unique_ptr<PageMapping[]>& chunk = m_chunks[index / CHUNK_SIZE];
+            if( !chunk )
+                chunk.reset( new PageMapping[CHUNK_SIZE] );
+            chunk[index % CHUNK_SIZE] = mapping;
+            m_size.store( index + 1, std::memory_order_release );
+        }
+
+        // Find the request handler for the given page.  Returns nullptr if not found.
+        RequestHandler* find( unsigned int pageId ) const
+        {
+            // Binary search for the first mapping whose last page is not less than the page id.
+            const unsigned int size  = m_size.load( std::memory_order_acquire );
+            unsigned int       first = 0;
+            unsigned int       count = size;
+            while( count > 0 )
+            {
+                const unsigned int step = count / 2;
+                if( get( first + step ).lastPage < pageId )
+                {
+                    first += step + 1;
+                    count -= step + 1;
+                }
+                else
+                {
+                    count = step;
+                }
+            }
+            if( first == size )
+                return nullptr;
+            const PageMapping& mapping = get( first );
+            return mapping.firstPage <= pageId ? mapping.handler : nullptr;
+        }
+
+      private:
+        static const unsigned int CHUNK_SIZE = 4096;
+
+        std::vector<std::unique_ptr<PageMapping[]>> m_chunks;
+        std::atomic<unsigned int>                   m_size{0};
+
+        const PageMapping& get( unsigned int index ) const { return m_chunks[index / CHUNK_SIZE][index % CHUNK_SIZE]; }
+    };
+
+    unsigned int insertPageMapping( PageMappingList& mappings, unsigned int& nextPage, unsigned int numPages, RequestHandler* handler )
     {
         const unsigned int firstPage = nextPage;
         const unsigned int lastPage = firstPage + numPages - 1;
         if( handler )
             handler->setPageRange( firstPage, numPages );
 
-        const PageMapping mapping{ firstPage, lastPage, handler };
-
-        const auto least =
-            std::lower_bound( m_mappings.begin(), m_mappings.end(), firstPage,
-                              []( const PageMapping& entry, unsigned int id ) { return id > entry.lastPage; } );
-        m_mappings.insert( least, mapping );
+        if( numPages > 0 )
+            mappings.append( PageMapping{ firstPage, lastPage, handler } );
 
         nextPage += numPages;
         return firstPage;
@@ -137,8 +193,9 @@ class PageTableManager
     unsigned int             m_nextBackedPage{};
     unsigned int             m_nextUnbackedPage{};
 
-    std::vector<PageMapping> m_mappings;
-    mutable std::mutex       m_mutex;
+    PageMappingList          m_backedMappings;    // Mappings for pages in [0, m_backedPages)
+    PageMappingList          m_unbackedMappings;  // Mappings for pages in [m_backedPages, m_totalPages)
+    mutable std::mutex       m_mutex;             // Serializes page reservation.
 };
 
 }  // namespace demandLoading
@@ -28,19 +28,23 @@
 
 #include "PagingSystem.h"
 
+#include "CompletionQueue.h"
 #include "DemandLoaderImpl.h"
 #include "DemandLoadingKernelsPTX.h"
 #include "Memory/DeviceMemoryManager.h"
 #include "PageMappingsContext.h"
+#include "PagingSystemHostKernels.h"
 #include "PagingSystemKernels.h"
 #include "RequestContext.h"
-#include "Util/CudaCallback.h"
+#include "Util/LatencyRecorder.h"
 #include "Util/Math.h"
+#include "Util/Stopwatch.h"
 
 #include <OptiXToolkit/DemandLoading/RequestProcessor.h>
 
 #include <algorithm>
 #include <set>
+#include <thread>
 
 using namespace otk;
 
@@ -49,11 +53,16 @@ namespace demandLoading {
 PagingSystem::PagingSystem( const Options&       options,
                             DeviceMemoryManager* deviceMemoryManager,
                             MemoryPool<PinnedAllocator, RingSuballocator>* pinnedMemoryPool,
-                            RequestProcessor*    requestProcessor )
+                            RequestProcessor*    requestProcessor,
+                            CompletionQueue*     completionQueue,
+                            LatencyRecorder*     latencyRecorder )
     : m_options( options )
     , m_deviceMemoryManager( deviceMemoryManager )
     , m_requestProcessor( requestProcessor )
+    , m_completionQueue( completionQueue )
+    , m_latencyRecorder( latencyRecorder )
     , m_pinnedMemoryPool( pinnedMemoryPool )
+    , m_pageTable( options.numPages )
 {
     DEMAND_ASSERT( m_options.maxFilledPages >= m_options.maxRequestedPages );
 
@@ -66,6 +75,7 @@ PagingSystem::PagingSystem( const Options&       options,
         m_pinnedMemoryPool->alloc( PageMappingsContext::getAllocationSize( m_options ), alignof( PageMappingsContext ) );
     m_pageMappingsContext = reinterpret_cast<PageMappingsContext*>( m_pageMappingsContextBlock.ptr );
     m_pageMappingsContext->init( m_options );
+    m_fillContexts[0] = m_pageMappingsContext;
 
     DEMAND_CUDA_CHECK( cuModuleLoadData( &m_pagingKernels, PagingSystemKernels_ptx_text() ) );
 }
@@ -77,47 +87,16 @@ PagingSystem::~PagingSystem()
     for( RequestContext* requestContext : m_pinnedRequestContextPool )
         DEMAND_CUDA_CHECK_NOTHROW( cuMemFreeHost( requestContext ) );
     m_pinnedRequestContextPool.clear();
+    for( CUevent event : m_requestEventPool )
+        DEMAND_CUDA_CHECK_NOTHROW( cuEventDestroy( event ) );
+    m_requestEventPool.clear();
 }
 
 void PagingSystem::updateLruThreshold( unsigned int returnedStalePages, unsigned int requestedStalePages, unsigned int medianLruVal )
 {
-    // Don't change the value if no stale pages were requested
-    if( requestedStalePages == 0 )
-        return;
-
-    // Heuristic to update the lruThreshold. The basic idea is to aggressively reduce the threshold
-    // if not enough stale pages are returned, but only gradually increase the threshold if it is too low.
-    if( returnedStalePages < requestedStalePages / 2 )
-        m_lruThreshold -= std::min( m_lruThreshold - MIN_LRU_THRESHOLD, 4u );
-    else if( returnedStalePages < requestedStalePages )
-        m_lruThreshold -= std::min( m_lruThreshold - MIN_LRU_THRESHOLD, 2u );
-    else if( medianLruVal > m_lruThreshold )
-        m_lruThreshold++;
+    m_lruThreshold = nextLruThreshold( m_lruThreshold, returnedStalePages, requestedStalePages, medianLruVal );
 }
 
-// This callback invokes processRequests() after the asynchronous copies in pullRequests have completed.
-class ProcessRequestsCallback : public CudaCallback
-{
-  public:
-    ProcessRequestsCallback( PagingSystem* pagingSystem, DeviceContext context, RequestContext* pinnedRequestContext, CUstream stream, unsigned int id )
-        : m_pagingSystem( pagingSystem )
-        , m_context( context )
-        , m_pinnedRequestContext( pinnedRequestContext )
-        , m_stream( stream )
-        , m_id( id )
-    {
-    }
-
-    void callback() override { m_pagingSystem->processRequests( m_context, m_pinnedRequestContext, m_stream, m_id ); }
-
-  private:
-    PagingSystem*   m_pagingSystem;
-    DeviceContext   m_context;
-    RequestContext* m_pinnedRequestContext;
-    CUstream        m_stream;
-    unsigned int    m_id;
-};
-
 void PagingSystem::pullRequests( const DeviceContext& context, CUstream stream, unsigned int id, unsigned int startPage, unsigned int endPage )
 {
     std::unique_lock<std::mutex> lock( m_mutex );
@@ -162,15 +141,76 @@ void PagingSystem::pullRequests( const DeviceContext& context, CUstream stream,
                                       reinterpret_cast<CUdeviceptr>( context.arrayLengths.data ),
                                       pinnedRequestContext->numArrayLengths * sizeof( unsigned int ), stream ) );
 
-    // Enqueue host function call to process the page requests once the kernel launch and copies have completed.
-    CudaCallback::enqueue( stream, new ProcessRequestsCallback( this, context, pinnedRequestContext, stream, id ) );
+    // Get an event from the pool, which signals the completion of the kernel launch and copies.
+    CUevent event{};
+    if( !m_requestEventPool.empty() )
+    {
+        event = m_requestEventPool.back();
+        m_requestEventPool.pop_back();
+    }
+    else
+    {
+        DEMAND_CUDA_CHECK( cuEventCreate( &event, CU_EVENT_DISABLE_TIMING | CU_EVENT_BLOCKING_SYNC ) );
+    }
+
+    // Process the page requests once the kernel launch and copies have completed.  This is done by
+    // the completion queue's threads rather than a host function (see cuLaunchHostFunc), which
+    // would block the driver's callback thread, and the streams waiting on it, until it returns.
+    // The pull latency spans the kernel launch, the copies, and the wait for a completion queue thread.
+    DeviceContext contextCopy = context;
+    Stopwatch     stopwatch;
+    m_completionQueue->enqueue( stream, event, [this, contextCopy, pinnedRequestContext, stream, id, event, stopwatch]( CUresult status ) {
+        if( status != CUDA_SUCCESS )
+        {
+            discardRequests( contextCopy, stream, id );
+            DEMAND_CUDA_CHECK( status );
+        }
+        if( m_latencyRecorder )
+            m_latencyRecorder->record( LATENCY_PULL_REQUESTS, REQUEST_HANDLER_OTHER, stopwatch.elapsed() );
+        processRequests( contextCopy, pinnedRequestContext, stream, id, event );
+    } );
+}
+
+void PagingSystem::processRequests( const DeviceContext& context, RequestContext* pinnedRequestContext, CUstream stream, unsigned int id, CUevent event )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    bool                         requestsAdded = false;
+    try
+    {
+        processRequestsImpl( context, pinnedRequestContext, stream, id, requestsAdded );
+    }
+    catch( ... )
+    {
+        // Return the RequestContext and event to their pools, and release any threads waiting on
+        // the ticket if the requests were not queued.  The requested pages will be requested again
+        // by subsequent launches.
+        m_pinnedRequestContextPool.push_back( pinnedRequestContext );
+        m_requestEventPool.push_back( event );
+        if( !requestsAdded )
+            m_requestProcessor->addRequests( stream, id, nullptr, 0 );
+        throw;
+    }
+
+    // Return the RequestContext and event to their pools.
+    m_pinnedRequestContextPool.push_back( pinnedRequestContext );
+    m_requestEventPool.push_back( event );
 }
 
-// Note: this method must not make any CUDA API calls, because it's invoked via cuLaunchHostFunc.
-void PagingSystem::processRequests( const DeviceContext& context, RequestContext* pinnedRequestContext, CUstream stream, unsigned int id )
+void PagingSystem::discardRequests( const DeviceContext& context, CUstream stream, unsigned int id )
 {
     std::unique_lock<std::mutex> lock( m_mutex );
 
+    // The RequestContext and event are not returned to their pools, since the failed work might
+    // still refer to them.  The device context is returned, and threads waiting on the ticket are
+    // released.
+    m_deviceMemoryManager->freeDeviceContext( const_cast<DeviceContext*>( &context ) );
+    m_requestProcessor->addRequests( stream, id, nullptr, 0 );
+}
+
+void PagingSystem::processRequestsImpl( const DeviceContext& context, RequestContext* pinnedRequestContext, CUstream stream, unsigned int id, bool& requestsAdded )
+{
+    // Mutex acquired in caller (processRequests).
+
     // Return device context to pool.  The DeviceContext has been copied, but DeviceContextPool is designed to permit that.
     m_deviceMemoryManager->freeDeviceContext( const_cast<DeviceContext*>( &context ) );
 
@@ -191,6 +231,7 @@ void PagingSystem::processRequests( const DeviceContext& context, RequestContext
 
     // Enqueue the requests for processing.
     // Must do this even when zero pages are requested to get proper end-to-end asynchronous communication via the Ticket mechanism.
+    requestsAdded = true;
     m_requestProcessor->addRequests( stream, id, pinnedRequestContext->requestedPages, numRequestedPages );
 
     // Sort and stage stale pages, and update the LRU threshold
@@ -215,34 +256,43 @@ void PagingSystem::processRequests( const DeviceContext& context, RequestContext
         }
     }
     updateLruThreshold( numStalePages, pinnedRequestContext->maxStalePages, medianLruVal );
-
-    // Return the RequestContext to its pool.
-    m_pinnedRequestContextPool.push_back(pinnedRequestContext);
 }
 
 void PagingSystem::addMapping( unsigned int pageId, unsigned int lruVal, unsigned long long entry )
 {
-    std::unique_lock<std::mutex> lock( m_mutex );
-    addMappingBody( pageId, lruVal, entry );
+    DEMAND_ASSERT_MSG( pageId < m_options.numPages, "pageId outside of page table range." );
+
+    // The page table entry is set under the paging system mutex, since staging, restoring, freeing and
+    // invalidating pages read and then update entries.
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_pageTable.set( pageId, HostPageTableEntry{entry, true, false, false} );
+    }
+
+    // The mapping is appended without the mutex, so that filling pages does not wait for pushMappings
+    // to copy the filled page list (see appendFilledPage).
+
+    // If the filled page list is full, the mapping is spilled to the next pushMappings cycle.
+    const PageMapping mapping{pageId, lruVal, entry};
+    if( !appendFilledPage( mapping ) )
+    {
+        std::unique_lock<std::mutex> lock( m_spilledPagesMutex );
+        m_spilledPages.push_back( mapping );
+    }
 }
 
 bool PagingSystem::isResident( unsigned int pageId, unsigned long long* entry )
 {
-    std::unique_lock<std::mutex> lock( m_mutex );
-    const auto&                  p = m_pageTable.find( pageId );
-
-    bool resident = ( p != m_pageTable.end() ) ? p->second.resident : false;
-    if( resident && entry )
-        *entry = p->second.entry;
-    return resident;
+    // The page table is internally synchronized, so the paging system mutex is not required.
+    return m_pageTable.isResident( pageId, entry );
 }
 
 unsigned int PagingSystem::pushMappings( const DeviceContext& context, CUstream stream )
 {
+    Stopwatch                    stopwatch;
     std::unique_lock<std::mutex> lock( m_mutex );
 
-    const unsigned int numFilledPages = m_pageMappingsContext->numFilledPages;
-    pushMappingsAndInvalidations( context, stream );
+    const unsigned int numFilledPages = pushMappingsAndInvalidations( context, stream );
 
     // Zero out the reference bits
     unsigned int referenceBitsSizeInBytes = idivCeil( context.maxNumPages, 8 );
@@ -255,15 +305,8 @@ unsigned int PagingSystem::pushMappings( const DeviceContext& context, CUstream
     // Make a new event for the next time pushMappings is called
     m_pushMappingsEvent = std::make_shared<FutureEvent>();
 
-    // Free the current PageMappingsContext when the preceding operations on the stream are done.
-    m_pinnedMemoryPool->freeAsync( m_pageMappingsContextBlock, stream);
-
-    // Allocate a new PageMappingsContext for the next pushMappings cycle.
-    m_pageMappingsContextBlock =
-        m_pinnedMemoryPool->alloc( PageMappingsContext::getAllocationSize( m_options ), alignof( PageMappingsContext ) );
-    m_pageMappingsContext = reinterpret_cast<PageMappingsContext*>( m_pageMappingsContextBlock.ptr );
-    m_pageMappingsContext->init( m_options );
-
+    if( m_latencyRecorder )
+        m_latencyRecorder->record( LATENCY_PUSH_MAPPINGS, REQUEST_HANDLER_OTHER, stopwatch.elapsed() );
     return numFilledPages;
 }
 
@@ -281,14 +324,12 @@ void PagingSystem::stageStalePages( RequestContext* requestContext, std::deque<P
         if( numStaged >= m_options.maxStagedPages || m_pageMappingsContext->numInvalidatedPages >= m_options.maxInvalidatedPages )
             break;
 
-        const auto& p = m_pageTable.find( sp.pageId );
-        if( p != m_pageTable.end() && p->second.resident == true && p->second.inStagedList == false )
+        HostPageTableEntry p;
+        if( m_pageTable.find( sp.pageId, &p ) && p.resident == true && p.inStagedList == false )
         {
             // Stage the page
-            stagedMappings.emplace_back( PageMapping{sp.pageId, sp.lruVal, p->second.entry} );
-            p->second.resident     = false;
-            p->second.staged       = true;
-            p->second.inStagedList = true;
+            stagedMappings.emplace_back( PageMapping{sp.pageId, sp.lruVal, p.entry} );
+            m_pageTable.set( sp.pageId, HostPageTableEntry{p.entry, false, true, true} );
 
             // Schedule the page mapping to be invalidated on the device
             m_pageMappingsContext->invalidatedPages[m_pageMappingsContext->numInvalidatedPages++] = sp.pageId;
@@ -314,39 +355,84 @@ bool PagingSystem::freeStagedPage( PageMapping* m )
         *m = m_stagedPages[0].mappings.front();
         m_stagedPages[0].mappings.pop_front();
 
-        const auto& p = m_pageTable.find( m->id );
-        DEMAND_ASSERT( p != m_pageTable.end() );
-        p->second.inStagedList = false;
+        HostPageTableEntry p;
+        const bool         found = m_pageTable.find( m->id, &p );
+        DEMAND_ASSERT( found );
 
         // If the page is still staged, return. Otherwise, go around and look for another one
-        if( p->second.staged == true )
+        if( p.staged == true )
         {
-            m_pageTable.erase( p );
+            m_pageTable.erase( m->id );
             return true;
         }
+        p.inStagedList = false;
+        m_pageTable.set( m->id, p );
     }
     return false;
 }
 
-void PagingSystem::addMappingBody( unsigned int pageId, unsigned int lruVal, unsigned long long entry )
+bool PagingSystem::appendFilledPage( const PageMapping& mapping )
+{
+    // Reserve a slot in the filled page list of the current generation.  The generation cannot be
+    // retired by swapPageMappingsContext until the slot is committed, so the list remains valid.
+    const unsigned long long state = m_fillState.fetch_add( 1 );
+    const unsigned int       slot  = static_cast<unsigned int>( state >> 32 ) & 1;
+    const unsigned int       index = static_cast<unsigned int>( state );
+
+    PageMappingsContext* pageMappingsContext = m_fillContexts[slot];
+    const bool           appended            = index < pageMappingsContext->maxFilledPages;
+    if( appended )
+        pageMappingsContext->filledPages[index] = mapping;
+
+    m_numCommittedFills[slot].fetch_add( 1, std::memory_order_release );
+    return appended;
+}
+
+otk::MemoryBlockDesc PagingSystem::swapPageMappingsContext()
 {
     // Mutex acquired in caller
-    DEMAND_ASSERT_MSG( pageId < m_options.numPages, "pageId outside of page table range." );
 
-    m_pageMappingsContext->filledPages[m_pageMappingsContext->numFilledPages++] = PageMapping{pageId, lruVal, entry};
-    m_pageTable[pageId] = HostPageTableEntry{entry, true, false, false};
+    // Allocate the PageMappingsContext for the next generation.
+    otk::MemoryBlockDesc oldBlock = m_pageMappingsContextBlock;
+    m_pageMappingsContextBlock =
+        m_pinnedMemoryPool->alloc( PageMappingsContext::getAllocationSize( m_options ), alignof( PageMappingsContext ) );
+    m_pageMappingsContext = reinterpret_cast<PageMappingsContext*>( m_pageMappingsContextBlock.ptr );
+    m_pageMappingsContext->init( m_options );
+
+    // Start the next generation, resetting the number of reserved slots.  Only this method changes
+    // the generation, so it cannot change between the load and the exchange.
+    const unsigned long long generation = m_fillState.load() >> 32;
+    const unsigned int       oldSlot    = static_cast<unsigned int>( generation ) & 1;
+    m_fillContexts[oldSlot ^ 1]         = m_pageMappingsContext;
+    const unsigned int numReserved = static_cast<unsigned int>( m_fillState.exchange( ( generation + 1 ) << 32 ) );
+
+    // Wait for appendFilledPage calls that reserved a slot in the old generation, which finish
+    // promptly since they do not block.
+    while( m_numCommittedFills[oldSlot].load( std::memory_order_acquire ) != numReserved )
+        std::this_thread::yield();
+    m_numCommittedFills[oldSlot].store( 0 );
+
+    PageMappingsContext* oldContext = reinterpret_cast<PageMappingsContext*>( oldBlock.ptr );
+    oldContext->numFilledPages      = std::min( numReserved, oldContext->maxFilledPages );
+
+    // Move mappings that spilled from the old generation to the new one, as far as they fit.
+    std::unique_lock<std::mutex> lock( m_spilledPagesMutex );
+    size_t                       numMoved = 0;
+    while( numMoved < m_spilledPages.size() && appendFilledPage( m_spilledPages[numMoved] ) )
+        ++numMoved;
+    m_spilledPages.erase( m_spilledPages.begin(), m_spilledPages.begin() + numMoved );
+
+    return oldBlock;
 }
 
 bool PagingSystem::restoreMapping( unsigned int pageId )
 {
     // Mutex acquired in caller (processRequests).
 
-    const auto& p = m_pageTable.find( pageId );
-    if( p != m_pageTable.end() && p->second.staged && !p->second.resident
-        && m_pageMappingsContext->numFilledPages < m_pageMappingsContext->maxFilledPages )
+    HostPageTableEntry p;
+    if( m_pageTable.find( pageId, &p ) && p.staged && !p.resident && appendFilledPage( PageMapping{pageId, 0, p.entry} ) )
     {
-        p->second.staged = false;
-        addMappingBody( pageId, 0, p->second.entry );
+        m_pageTable.set( pageId, HostPageTableEntry{p.entry, true, false, false} );
         return true;
     }
 
@@ -364,34 +450,59 @@ size_t PagingSystem::getNumStagedPages()
 void PagingSystem::flushMappings()
 {
     std::unique_lock<std::mutex> lock( m_mutex );
-    m_pageMappingsContext->numFilledPages = 0;
+    {
+        std::unique_lock<std::mutex> spilledLock( m_spilledPagesMutex );
+        m_spilledPages.clear();
+    }
+
+    // Discard the filled pages, but retain the invalidated pages for the next push.
+    otk::MemoryBlockDesc oldBlock   = swapPageMappingsContext();
+    PageMappingsContext* oldContext = reinterpret_cast<PageMappingsContext*>( oldBlock.ptr );
+    std::copy( oldContext->invalidatedPages, oldContext->invalidatedPages + oldContext->numInvalidatedPages,
+               m_pageMappingsContext->invalidatedPages );
+    m_pageMappingsContext->numInvalidatedPages = oldContext->numInvalidatedPages;
+
+    // The old PageMappingsContext is freed by the next push, since there is no stream here.
+    m_retiredPageMappingsContextBlocks.push_back( oldBlock );
 }
 
-void PagingSystem::pushMappingsAndInvalidations( const DeviceContext& context, CUstream stream )
+unsigned int PagingSystem::pushMappingsAndInvalidations( const DeviceContext& context, CUstream stream )
 {
     // Mutex acquired in caller 
 
+    // Swap in the PageMappingsContext for the next cycle, so that pages filled from now on are
+    // not delayed while this one is copied to the device.
+    otk::MemoryBlockDesc block               = swapPageMappingsContext();
+    PageMappingsContext* pageMappingsContext = reinterpret_cast<PageMappingsContext*>( block.ptr );
+
     // First push any new mappings
-    const unsigned int numFilledPages = m_pageMappingsContext->numFilledPages;
+    const unsigned int numFilledPages = pageMappingsContext->numFilledPages;
     if( numFilledPages > 0 )
     {
         DEMAND_CUDA_CHECK( cuMemcpyAsync( reinterpret_cast<CUdeviceptr>( context.filledPages.data ),
-                                          reinterpret_cast<CUdeviceptr>( m_pageMappingsContext->filledPages ),
+                                          reinterpret_cast<CUdeviceptr>( pageMappingsContext->filledPages ),
                                           numFilledPages * sizeof( PageMapping ), stream ) );
         launchPushMappings( m_pagingKernels, stream, context, numFilledPages);
     }
     
     // Next, push the invalidated pages
-    const unsigned int numInvalidatedPages = m_pageMappingsContext->numInvalidatedPages;
+    const unsigned int numInvalidatedPages = pageMappingsContext->numInvalidatedPages;
     if( numInvalidatedPages > 0 )
     {
         DEMAND_CUDA_CHECK( cuMemcpyAsync( reinterpret_cast<CUdeviceptr>( context.invalidatedPages.data ),
-                                          reinterpret_cast<CUdeviceptr>( m_pageMappingsContext->invalidatedPages ),
+                                          reinterpret_cast<CUdeviceptr>( pageMappingsContext->invalidatedPages ),
                                           numInvalidatedPages * sizeof( unsigned int ), stream ) );
         launchInvalidatePages( m_pagingKernels, stream, context, numInvalidatedPages);
     }
-    
-    m_pageMappingsContext->clear();
+
+    // Free the old PageMappingsContext (and any retired by flushMappings) when the preceding
+    // operations on the stream are done.
+    m_pinnedMemoryPool->freeAsync( block, stream );
+    for( const otk::MemoryBlockDesc& retiredBlock : m_retiredPageMappingsContextBlocks )
+        m_pinnedMemoryPool->freeAsync( retiredBlock, stream );
+    m_retiredPageMappingsContextBlocks.clear();
+
+    return numFilledPages;
 }
 
 void PagingSystem::invalidatePages( unsigned int              startId,
@@ -404,33 +515,30 @@ void PagingSystem::invalidatePages( unsigned int              startId,
 
     // Remove specified page entries from the page table.
     std::set<unsigned int> stagedInvalidatedPages;
-    auto p = m_pageTable.lower_bound( startId );
-    while( p != m_pageTable.end() && p->first < endId )
+    endId = std::min( endId, m_pageTable.getNumPages() );
+    for( unsigned int pageId = m_pageTable.findNext( startId, endId ); pageId < endId;
+         pageId              = m_pageTable.findNext( pageId + 1, endId ) )
     {
-        const unsigned int pageId = p->first;
-        const unsigned long long pageVal = p->second.entry;
+        HostPageTableEntry p;
+        m_pageTable.find( pageId, &p );
+        const unsigned long long pageVal = p.entry;
 
         if( !predicate || (*predicate)( pageId, pageVal ) )
         {
             m_pageMappingsContext->invalidatedPages[m_pageMappingsContext->numInvalidatedPages++] = pageId;
-            if( p->second.inStagedList )
+            if( p.inStagedList )
             {
                 stagedInvalidatedPages.insert( pageId );
             }
-            p = m_pageTable.erase(p);
+            m_pageTable.erase( pageId );
 
             // If the buffer for invalidations is about to overflow, push the invalidated pages to clear it. 
             // This should not happen very often.  Usually, the mappings will be pushed from pushMappings.
             if( m_pageMappingsContext->numInvalidatedPages >= m_pageMappingsContext->maxInvalidatedPages )
             {
                 pushMappingsAndInvalidations( context, stream );
-                cuStreamSynchronize( stream ); // wait for the stream because we will reuse the context
             }
         }
-        else 
-        {
-            ++p;
-        }
     }
     
     if( stagedInvalidatedPages.empty() )
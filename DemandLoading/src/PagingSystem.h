@@ -27,6 +27,8 @@
 //
 #pragma once
 
+#include "HostPageTable.h"
+#include "PagingSystemHostKernels.h"  // for MIN_LRU_THRESHOLD
 #include "Util/Exception.h"
 
 #include <OptiXToolkit/Memory/Allocators.h>
@@ -39,8 +41,8 @@
 
 #include <cuda.h>
 
+#include <atomic>
 #include <deque>
-#include <map>
 #include <memory>
 #include <mutex>
 #include <vector>
@@ -48,8 +50,10 @@
 
 namespace demandLoading {
 
+class CompletionQueue;
 struct DeviceContext;
 class DeviceMemoryManager;
+class LatencyRecorder;
 struct PageMappingsContext;
 class PinnedMemoryManager;
 struct RequestContext;
@@ -66,19 +70,25 @@ class PageInvalidatorPredicate
 class PagingSystem
 {
   public:
-    /// Create paging system, allocating device memory based on the given options.
+    /// Create paging system, allocating device memory based on the given options.  Page requests
+    /// are processed by the given CompletionQueue once they have been pulled from the device.  If a
+    /// LatencyRecorder is provided, the latencies of pulling requests and pushing mappings are recorded.
     PagingSystem( const Options&       options,
                   DeviceMemoryManager* deviceMemoryManager,
                   otk::MemoryPool<otk::PinnedAllocator, otk::RingSuballocator>* pinnedMemoryPool,
-                  RequestProcessor* requestProcessor );
+                  RequestProcessor* requestProcessor,
+                  CompletionQueue*  completionQueue,
+                  LatencyRecorder*  latencyRecorder = nullptr );
 
     virtual ~PagingSystem();
     
     /// Pull requests from device to system memory.
     void pullRequests( const DeviceContext& context, CUstream stream, unsigned int id, unsigned int startPage, unsigned int endPage );
 
-    // Add a page mapping (thread safe).  The device-side page table (etc.) is not updated until
-    /// pushMappings is called.
+    /// Add a page mapping (thread safe).  The host page table entry is updated under the paging system
+    /// mutex, but the mapping is appended to the filled page list without locking.  The device-side
+    /// page table (etc.) is not updated until pushMappings is called.  If the filled page list is full,
+    /// the mapping is deferred to a subsequent pushMappings call.
     void addMapping( unsigned int pageId, unsigned int lruVal, unsigned long long entry );
 
     /// Check whether the specified page is resident (thread safe).
@@ -104,29 +114,35 @@ class PagingSystem
     void invalidatePages( unsigned int startId, unsigned int endId, PageInvalidatorPredicate* predicate, const DeviceContext& context, CUstream stream );
 
   private:
-    struct HostPageTableEntry
-    {
-        unsigned long long entry;
-        bool               resident;      // Whether a page is considered resident on the GPU
-        bool               staged;        // Pages that are currently staged (and not restored by second chance).
-        bool               inStagedList;  // All pages that are in the staged list, whether restored or not.
-    };
-
     Options              m_options{};
     DeviceMemoryManager* m_deviceMemoryManager{};
     RequestProcessor*    m_requestProcessor{};
+    CompletionQueue*     m_completionQueue{};
+    LatencyRecorder*     m_latencyRecorder{};
 
     otk::MemoryBlockDesc m_pageMappingsContextBlock;
     PageMappingsContext* m_pageMappingsContext; 
     otk::MemoryPool<otk::PinnedAllocator, otk::RingSuballocator>* m_pinnedMemoryPool;
+    std::vector<otk::MemoryBlockDesc> m_retiredPageMappingsContextBlocks;  // Freed by the next push.
+
+    // Filled pages are appended to the PageMappingsContext without locking (see appendFilledPage).
+    // Each pushMappings cycle is a generation.  The fill state packs the generation (high 32 bits)
+    // with the number of slots reserved in its filled page list (low 32 bits).  The contexts and
+    // committed slot counts of the current and previous generations are indexed by generation parity.
+    std::atomic<unsigned long long> m_fillState{0};
+    PageMappingsContext*            m_fillContexts[2]{};
+    std::atomic<unsigned int>       m_numCommittedFills[2]{};
 
-    std::map<unsigned int, HostPageTableEntry> m_pageTable;  // Host-side. Not copied to/from device. Used for eviction.
-    std::mutex m_mutex;  // Guards m_pageTable and filledPages list (see addMapping).
+    // Mappings that did not fit in the filled page list, which are deferred to the next cycle.
+    std::vector<PageMapping> m_spilledPages;
+    std::mutex               m_spilledPagesMutex;
+
+    HostPageTable m_pageTable;  // Host-side. Not copied to/from device. Used for eviction.
+    std::mutex m_mutex;  // Serializes pushMappings, request processing, page table updates, and invalidated page list updates.
 
     std::mt19937 m_rng; // Used for randomized eviction when LRU table is not present.
 
     // Variables related to eviction
-    const unsigned int MIN_LRU_THRESHOLD = 2;
     bool               m_evictionActive  = false;
     unsigned int       m_launchNum       = 0;
     unsigned int       m_lruThreshold    = MIN_LRU_THRESHOLD;
@@ -155,14 +171,23 @@ class PagingSystem
     // Pool of pinned RequestContext for processRequests function
     std::vector<RequestContext*> m_pinnedRequestContextPool;
 
+    // Pool of events that signal when pulled requests are ready to be processed.
+    std::vector<CUevent> m_requestEventPool;
+
     // CUDA module containing the PTX for the paging kernels.
     CUmodule m_pagingKernels{};
 
-    // A host function callback is used to invoke processRequests().
-    friend class ProcessRequestsCallback;
+    // Process requests, inserting them in the global request queue.  Invoked by the completion
+    // queue once the given event (recorded by pullRequests) has completed.
+    // The RequestContext and event are returned to their pools even if processing fails.
+    void processRequests( const DeviceContext& context, RequestContext* pinnedRequestContext, CUstream stream, unsigned int id, CUevent event );
 
-    // Process requests, inserting them in the global request queue.
-    void processRequests( const DeviceContext& context, RequestContext* pinnedRequestContext, CUstream stream, unsigned int id );
+    // Discard the requests of a launch whose kernel or copies failed.
+    void discardRequests( const DeviceContext& context, CUstream stream, unsigned int id );
+
+    // Restore staged pages, queue the requests, and stage stale pages.  Sets requestsAdded before
+    // the requests are passed to the request processor.  The caller must hold m_mutex.
+    void processRequestsImpl( const DeviceContext& context, RequestContext* pinnedRequestContext, CUstream stream, unsigned int id, bool& requestsAdded );
 
     // Update the lru threshold value
     void updateLruThreshold( unsigned int returnedStalePages, unsigned int requestedStalePages, unsigned int medianLruVal );
@@ -174,14 +199,19 @@ class PagingSystem
     // Get the number of staged pages (ready to be freed for reuse)
     size_t getNumStagedPages();
 
-    // Add mapping function without mutex
-    void addMappingBody( unsigned int pageId, unsigned int lruVal, unsigned long long entry );
+    // Append a mapping to the filled page list of the current generation without locking.
+    // Returns false if the list is full.
+    bool appendFilledPage( const PageMapping& mapping );
+
+    // Start a new generation with a newly allocated PageMappingsContext, waiting for appends to the
+    // old one to finish.  Returns the old PageMappingsContext block, which the caller frees.
+    otk::MemoryBlockDesc swapPageMappingsContext();
 
     // Restore the mapping for a staged page if possible
     bool restoreMapping( unsigned int pageId );
 
-    // Push invalidated pages to device
-    void pushMappingsAndInvalidations( const DeviceContext& context, CUstream stream );
+    // Push filled and invalidated pages to device, returning the number of filled pages.
+    unsigned int pushMappingsAndInvalidations( const DeviceContext& context, CUstream stream );
 };
 
 }  // namespace demandLoading
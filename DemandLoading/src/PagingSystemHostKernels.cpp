@@ -0,0 +1,243 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PagingSystemHostKernels.h"
+
+#include <cuda_runtime.h>  // for the __host__ qualifiers in Paging.h
+
+#include <OptiXToolkit/DemandLoading/Paging.h>
+
+#include <algorithm>
+
+namespace demandLoading {
+
+// The helpers below mirror the device functions of the same name in PagingSystemKernels.cu and
+// Paging.h, with atomics replaced by plain updates.  lruInc and getHalfByte are shared with the device.
+
+namespace {
+
+unsigned int countSetBits( unsigned int bits )
+{
+    unsigned int count = 0;
+    for( ; bits != 0; bits &= bits - 1 )
+        ++count;
+    return count;
+}
+
+// Index of the least significant set bit, which is __ffs( bits ) - 1 on the device.
+unsigned int findLowestSetBit( unsigned int bits )
+{
+    unsigned int bitIndex = 0;
+    while( ( bits & ( 1U << bitIndex ) ) == 0 )
+        ++bitIndex;
+    return bitIndex;
+}
+
+void setBit( unsigned int bitIndex, unsigned int* bitVector )
+{
+    bitVector[bitIndex / 32] |= 1U << ( bitIndex % 32 );
+}
+
+void unsetBit( unsigned int bitIndex, unsigned int* bitVector )
+{
+    bitVector[bitIndex / 32] &= ~( 1U << ( bitIndex % 32 ) );
+}
+
+void addHalfByte( unsigned int index, unsigned int val, unsigned int* words )
+{
+    words[index >> 3] += val << ( 4 * ( index & 0x7 ) );
+}
+
+void orHalfByte( unsigned int index, unsigned int mask, unsigned int* words )
+{
+    words[index >> 3] |= mask << ( 4 * ( index & 0x7 ) );
+}
+
+void clearHalfByte( unsigned int index, unsigned int* words )
+{
+    words[index >> 3] &= ~( 0xfU << ( 4 * ( index & 0x7 ) ) );
+}
+
+unsigned int countStaleBitsAboveThreshold( unsigned int  staleBits,
+                                           unsigned int  pageBitOffset,
+                                           unsigned int* lruTable,
+                                           unsigned int  lruThreshold,
+                                           unsigned int  launchNum )
+{
+    // If no lruTable, count all the stale bits
+    if( !lruTable )
+        return countSetBits( staleBits );
+
+    // Count stale bits with lru val >= threshold, aging the lru values along the way.
+    unsigned int numSetBits = 0;
+    while( staleBits != 0 )
+    {
+        unsigned int bitIndex = findLowestSetBit( staleBits );
+        staleBits ^= ( 1U << bitIndex );
+
+        unsigned int pageId = pageBitOffset + bitIndex;
+        unsigned int oldVal = getHalfByte( pageId, lruTable );
+        unsigned int newVal = lruInc( oldVal, launchNum + pageId );
+        if( newVal != oldVal )
+            addHalfByte( pageId, 1, lruTable );
+        if( newVal >= lruThreshold && newVal < NON_EVICTABLE_LRU_VAL )
+            numSetBits++;
+    }
+    return numSetBits;
+}
+
+void resetLruCountersForFreshPages( unsigned int freshBits, unsigned int pageBitOffset, unsigned int* lruTable )
+{
+    if( !lruTable )
+        return;
+
+    while( freshBits != 0 )
+    {
+        unsigned int bitIndex = findLowestSetBit( freshBits );
+        freshBits ^= ( 1U << bitIndex );
+        unsigned int pageId = pageBitOffset + bitIndex;
+        unsigned int lruVal = getHalfByte( pageId, lruTable );
+        if( lruVal != 0 && lruVal != NON_EVICTABLE_LRU_VAL )
+            clearHalfByte( pageId, lruTable );
+    }
+}
+
+void addPagesToList( unsigned int startingIndex, unsigned int pageBits, unsigned int pageBitOffset, unsigned int maxCount, unsigned int* outputArray )
+{
+    while( pageBits != 0 && ( startingIndex < maxCount ) )
+    {
+        unsigned int bitIndex = findLowestSetBit( pageBits );
+        pageBits ^= ( 1U << bitIndex );
+        outputArray[startingIndex++] = pageBitOffset + bitIndex;
+    }
+}
+
+void addStalePagesToList( unsigned int  startingIndex,
+                          unsigned int  pageBits,
+                          unsigned int  pageBitOffset,
+                          unsigned int  maxCount,
+                          unsigned int* lruTable,
+                          unsigned int  lruThreshold,
+                          StalePage*    outputArray )
+{
+    while( pageBits != 0 && ( startingIndex < maxCount ) )
+    {
+        unsigned int bitIndex = findLowestSetBit( pageBits );
+        pageBits ^= ( 1U << bitIndex );
+
+        unsigned int pageId = pageBitOffset + bitIndex;
+        unsigned int lruVal = ( lruTable != nullptr ) ? getHalfByte( pageId, lruTable ) : MAX_LRU_VAL;
+        if( lruVal >= lruThreshold && lruVal != NON_EVICTABLE_LRU_VAL )
+            outputArray[startingIndex++] = StalePage{0, lruVal, pageId};
+    }
+}
+
+}  // anonymous namespace
+
+void hostPullRequests( const DeviceContext& context, unsigned int launchNum, unsigned int lruThreshold, unsigned int startPage, unsigned int endPage )
+{
+    // Like the kernel, process whole words of the bit arrays.
+    const unsigned int startIndex   = startPage / 32;
+    const unsigned int endIndex     = ( endPage + 31 ) / 32;
+    unsigned int*      arrayLengths = context.arrayLengths.data;
+
+    for( unsigned int wordIndex = startIndex; wordIndex < endIndex; ++wordIndex )
+    {
+        const unsigned int pageBitOffset = wordIndex * 32;
+        const unsigned int referenceWord = context.referenceBits[wordIndex];
+        const unsigned int residenceWord = context.residenceBits[wordIndex];
+
+        // Gather requested pages (reference bit true, but not resident).
+        const unsigned int requestedPages = referenceWord & ~residenceWord;
+        addPagesToList( arrayLengths[PAGE_REQUESTS_LENGTH], requestedPages, pageBitOffset,
+                        context.requestedPages.capacity, context.requestedPages.data );
+        arrayLengths[PAGE_REQUESTS_LENGTH] += countSetBits( requestedPages );
+
+        // Only do the work of finding stale pages when they are requested
+        if( context.stalePages.capacity > 0 )
+        {
+            const unsigned int freshPages = referenceWord & residenceWord;
+            resetLruCountersForFreshPages( freshPages, pageBitOffset, context.lruTable );
+
+            // The stale pages are counted (aging their lru values) before they are listed, as on the device.
+            const unsigned int stalePages = ~referenceWord & residenceWord;
+            const unsigned int staleIndex = arrayLengths[STALE_PAGES_LENGTH];
+            arrayLengths[STALE_PAGES_LENGTH] +=
+                countStaleBitsAboveThreshold( stalePages, pageBitOffset, context.lruTable, lruThreshold, launchNum );
+            addStalePagesToList( staleIndex, stalePages, pageBitOffset, context.stalePages.capacity, context.lruTable,
+                                 lruThreshold, context.stalePages.data );
+        }
+    }
+
+    // Clamp counts of returned pages, since they may have been over-incremented
+    arrayLengths[PAGE_REQUESTS_LENGTH] = std::min( arrayLengths[PAGE_REQUESTS_LENGTH], context.requestedPages.capacity );
+    arrayLengths[STALE_PAGES_LENGTH]   = std::min( arrayLengths[STALE_PAGES_LENGTH], context.stalePages.capacity );
+}
+
+void hostPushMappings( const DeviceContext& context, int filledPageCount )
+{
+    for( int i = 0; i < filledPageCount; ++i )
+    {
+        const PageMapping& filledPage = context.filledPages.data[i];
+        // Page table entries are use only for samplers, not tiles.
+        if( filledPage.id < context.pageTable.capacity )
+            context.pageTable.data[filledPage.id] = filledPage.page;
+        setBit( filledPage.id, context.residenceBits );
+
+        if( context.lruTable )
+        {
+            clearHalfByte( filledPage.id, context.lruTable );
+            orHalfByte( filledPage.id, filledPage.lruVal, context.lruTable );
+        }
+    }
+}
+
+void hostInvalidatePages( const DeviceContext& context, int invalidatedPageCount )
+{
+    for( int i = 0; i < invalidatedPageCount; ++i )
+        unsetBit( context.invalidatedPages.data[i], context.residenceBits );
+}
+
+unsigned int nextLruThreshold( unsigned int lruThreshold, unsigned int returnedStalePages, unsigned int requestedStalePages, unsigned int medianLruVal )
+{
+    // Don't change the value if no stale pages were requested
+    if( requestedStalePages == 0 )
+        return lruThreshold;
+
+    // Heuristic to update the lruThreshold. The basic idea is to aggressively reduce the threshold
+    // if not enough stale pages are returned, but only gradually increase the threshold if it is too low.
+    if( returnedStalePages < requestedStalePages / 2 )
+        return lruThreshold - std::min( lruThreshold - MIN_LRU_THRESHOLD, 4u );
+    if( returnedStalePages < requestedStalePages )
+        return lruThreshold - std::min( lruThreshold - MIN_LRU_THRESHOLD, 2u );
+    if( medianLruVal > lruThreshold )
+        return lruThreshold + 1;
+    return lruThreshold;
+}
+
+}  // namespace demandLoading
@@ -0,0 +1,59 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <OptiXToolkit/DemandLoading/DeviceContext.h>
+
+namespace demandLoading {
+
+/// Minimum LRU threshold for stale pages (see nextLruThreshold).
+const unsigned int MIN_LRU_THRESHOLD = 2;
+
+/// Host implementations of the paging kernels in PagingSystemKernels.cu, for simulation and testing
+/// on machines without a GPU.  The arrays of the given DeviceContext must reside in host memory.
+/// The bit arrays, LRU table and array lengths are updated exactly as the kernels update them.  The
+/// kernels list requested and stale pages in an unspecified order, whereas the host versions list
+/// them in increasing page order, which also determines which pages are dropped when a list is full.
+
+/// Host version of devicePullRequests.  As on the device, the request and stale page counts are
+/// accumulated in context.arrayLengths, which the caller zeroes beforehand.
+void hostPullRequests( const DeviceContext& context, unsigned int launchNum, unsigned int lruThreshold, unsigned int startPage, unsigned int endPage );
+
+/// Host version of devicePushMappings, which maps the first filledPageCount pages of context.filledPages.
+void hostPushMappings( const DeviceContext& context, int filledPageCount );
+
+/// Host version of deviceInvalidatePages, which unmaps the first invalidatedPageCount pages of context.invalidatedPages.
+void hostInvalidatePages( const DeviceContext& context, int invalidatedPageCount );
+
+/// Returns the LRU threshold for the next pullRequests, given the current threshold, the number of stale
+/// pages returned and requested, and the median LRU value of the returned pages.  The threshold drops
+/// quickly when too few stale pages are returned, and rises gradually when they are plentiful.
+unsigned int nextLruThreshold( unsigned int lruThreshold, unsigned int returnedStalePages, unsigned int requestedStalePages, unsigned int medianLruVal );
+
+}  // namespace demandLoading
@@ -31,6 +31,8 @@
 #include <Util/Exception.h>
 #include "Util/MutexArray.h"
 
+#include <OptiXToolkit/DemandLoading/LatencyStatistics.h>
+
 #include <cuda.h>
 
 namespace demandLoading {
@@ -69,6 +71,25 @@ class RequestHandler
     /// Fill a request for the specified page using the given stream.
     virtual void fillRequest( CUstream stream, unsigned int pageId ) = 0;
 
+    /// Fill requests for a run of pages that all belong to this handler, using the given stream.
+    /// The default implementation fills each page individually.  Handlers override this to share
+    /// per-request overhead (e.g. transfer buffer allocation) across the batch.
+    virtual void fillRequests( CUstream stream, const unsigned int* pageIds, unsigned int numPageIds )
+    {
+        for( unsigned int i = 0; i < numPageIds; ++i )
+            fillRequest( stream, pageIds[i] );
+    }
+
+    /// Get the priority class of a request for the specified page (less than NUM_REQUEST_PRIORITIES,
+    /// where class 0 is the most urgent).  Requests are filled in priority order, and low priority
+    /// requests are evicted first when the request queue overflows.  By default every page is in
+    /// class 0.
+    virtual unsigned int getPriority( unsigned int /*pageId*/ ) const { return 0; }
+
+    /// Get the type of handler that fills requests for the specified page, by which request
+    /// latencies are recorded.  \see LatencyStatistics
+    virtual RequestHandlerType getHandlerType( unsigned int /*pageId*/ ) const { return REQUEST_HANDLER_OTHER; }
+
   protected:
     unsigned int                m_startPage = 0;
     unsigned int                m_numPages  = 0;
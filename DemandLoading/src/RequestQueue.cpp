@@ -31,60 +31,457 @@
 #include "Util/Exception.h"
 
 #include <algorithm>
+#include <cstddef>
+#include <vector>
 
 namespace demandLoading {
 
+namespace {
+
+unsigned int getLowestBit( unsigned int mask )
+{
+    unsigned int index = 0;
+    while( ( mask & 1 ) == 0 && index < 31 )
+    {
+        mask >>= 1;
+        ++index;
+    }
+    return index;
+}
+
+}  // anonymous namespace
+
+void RequestQueue::Ring::allocate( size_t capacity )
+{
+    m_mask = capacity - 1;
+    m_cells.reset( new Cell[capacity] );
+    for( size_t i = 0; i < capacity; ++i )
+        m_cells[i].sequence.store( i, std::memory_order_relaxed );
+
+    // Publish the cells to consumers.
+    m_isAllocated.store( true, std::memory_order_release );
+}
+
+bool RequestQueue::Ring::dequeue( PageRequest* requestPtr )
+{
+    if( !isAllocated() )
+        return false;
+
+    size_t pos = m_dequeuePos.load( std::memory_order_relaxed );
+    while( true )
+    {
+        Cell*                cell     = &m_cells[pos & m_mask];
+        const size_t         sequence = cell->sequence.load( std::memory_order_acquire );
+        const std::ptrdiff_t diff     = static_cast<std::ptrdiff_t>( sequence ) - static_cast<std::ptrdiff_t>( pos + 1 );
+        if( diff == 0 )
+        {
+            // The cell is full.  Try to claim it.
+            if( m_dequeuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+            {
+                *requestPtr = cell->request;
+
+                // Mark the cell as free for the producer that wraps around to it.
+                cell->sequence.store( pos + m_mask + 1, std::memory_order_release );
+                return true;
+            }
+            // On failure compare_exchange_weak reloads pos.
+        }
+        else if( diff < 0 )
+        {
+            // The cell has not been filled yet: the ring is empty.
+            return false;
+        }
+        else
+        {
+            // Another consumer claimed this cell; try again from the current position.
+            pos = m_dequeuePos.load( std::memory_order_relaxed );
+        }
+    }
+}
+
+void RequestQueue::Ring::enqueue( const PageRequest& request )
+{
+    size_t pos = m_enqueuePos.load( std::memory_order_relaxed );
+    while( true )
+    {
+        Cell*                cell     = &m_cells[pos & m_mask];
+        const size_t         sequence = cell->sequence.load( std::memory_order_acquire );
+        const std::ptrdiff_t diff     = static_cast<std::ptrdiff_t>( sequence ) - static_cast<std::ptrdiff_t>( pos );
+        if( diff == 0 )
+        {
+            // The cell is free.  Try to claim it.
+            if( m_enqueuePos.compare_exchange_weak( pos, pos + 1, std::memory_order_relaxed ) )
+            {
+                cell->request = request;
+                cell->sequence.store( pos + 1, std::memory_order_release );
+                return;
+            }
+        }
+        else
+        {
+            // Another producer claimed this cell, or a consumer has not yet finished moving the
+            // request out of it.  Slots were reserved, so the ring is never actually full.
+            pos = m_enqueuePos.load( std::memory_order_relaxed );
+        }
+    }
+}
+
+bool RequestQueue::SubQueue::dequeue( PageRequest* requestPtr )
+{
+    for( Ring& ring : rings )
+    {
+        if( ring.dequeue( requestPtr ) )
+            return true;
+    }
+    return false;
+}
+
+bool RequestQueue::SubQueue::dequeueLessUrgent( unsigned int priority, PageRequest* requestPtr )
+{
+    for( unsigned int i = NUM_REQUEST_PRIORITIES - 1; i > priority; --i )
+    {
+        if( rings[i].dequeue( requestPtr ) )
+            return true;
+    }
+    return false;
+}
+
+RequestQueue::RequestQueue( unsigned int maxQueueSize )
+    : m_maxQueueSize( maxQueueSize )
+{
+    // The ring capacity is a power of two no smaller than the max queue size, so that the slot
+    // reservation in push() guarantees that enqueue never finds a ring full, even if every
+    // request in a sub-queue is in the same priority class.
+    m_ringCapacity = 2;
+    while( m_ringCapacity < maxQueueSize )
+        m_ringCapacity *= 2;
+}
+
+RequestQueue::~RequestQueue()
+{
+    // Requests that were never processed are counted as done, so their tickets are released.
+    PageRequest request;
+    while( dequeue( &request ) )
+        complete( request );
+}
+
 void RequestQueue::shutDown()
 {
+    m_isShutDown.store( true );
     {
+        // Acquiring the mutex ensures that no waiter is between its shutdown check and its wait.
         std::unique_lock<std::mutex> lock( m_mutex );
-        m_isShutDown = true;
     }
     m_requestAvailable.notify_all();
 }
 
-bool RequestQueue::popOrWait( PageRequest* requestPtr )
+void RequestQueue::setStreamWeight( CUstream stream, unsigned int weight )
 {
-    // Wait until the queue is non-empty or destroyed.
-    std::unique_lock<std::mutex> lock( m_mutex );
-    m_requestAvailable.wait( lock, [this] { return !m_requests.empty() || m_isShutDown; } );
+    std::unique_lock<std::mutex> lock( m_streamsMutex );
+    m_streamWeights[stream] = std::max( 1u, std::min( weight, MAX_STREAM_WEIGHT ) );
+}
 
-    if( m_isShutDown )
-        return false;
+unsigned int RequestQueue::size() const
+{
+    unsigned int size = 0;
+    for( const SubQueue& subQueue : m_subQueues )
+        size += subQueue.size.load( std::memory_order_relaxed );
+    return size;
+}
 
-    *requestPtr = std::move( m_requests.front() );
-    m_requests.pop_front();
+bool RequestQueue::tryPop( PageRequest* requestPtr )
+{
+    if( m_isShutDown.load( std::memory_order_relaxed ) )
+        return false;
+    if( !dequeue( requestPtr ) )
+        return false;
 
+    // Release the reserved slot.
+    m_subQueues[requestPtr->subQueue].size.fetch_sub( 1, std::memory_order_release );
     return true;
 }
 
-void RequestQueue::push( const unsigned int* pageIds, unsigned int numPageIds, Ticket ticket )
+bool RequestQueue::dequeue( PageRequest* requestPtr )
+{
+    // Usually all streams have the same weight, in which case there is only one sub-queue to
+    // choose from.
+    const unsigned int used = m_usedSubQueues.load( std::memory_order_relaxed );
+    if( ( used & ( used - 1 ) ) == 0 )
+        return used != 0 && m_subQueues[getLowestBit( used )].dequeue( requestPtr );
+
+    // Weighted round robin: each turn maps to a non-empty sub-queue, with as many turns per round
+    // as its weight.  Sub-queue i has weight i + 1.
+    unsigned int totalWeight = 0;
+    for( unsigned int i = 0; i < MAX_STREAM_WEIGHT; ++i )
+    {
+        if( m_subQueues[i].size.load( std::memory_order_relaxed ) != 0 )
+            totalWeight += i + 1;
+    }
+    if( totalWeight == 0 )
+        return false;
+
+    unsigned int slot = m_turn.fetch_add( 1, std::memory_order_relaxed ) % totalWeight;
+    for( unsigned int i = MAX_STREAM_WEIGHT; i-- > 0; )
+    {
+        if( m_subQueues[i].size.load( std::memory_order_relaxed ) == 0 )
+            continue;
+        if( slot <= i && m_subQueues[i].dequeue( requestPtr ) )
+            return true;
+        slot = slot > i ? slot - ( i + 1 ) : 0;
+    }
+
+    // The chosen sub-queue was drained by another thread; take a request from any of them.
+    for( SubQueue& subQueue : m_subQueues )
+    {
+        if( subQueue.dequeue( requestPtr ) )
+            return true;
+    }
+    return false;
+}
+
+bool RequestQueue::popOrWait( PageRequest* requestPtr )
 {
+    // Fast path: no locking unless the queue is empty.
+    if( tryPop( requestPtr ) )
+        return true;
+
+    // Wait until the queue is non-empty or shut down.  The waiter count is incremented before the
+    // queue is checked again, which pairs with the check in push() to avoid lost wakeups.
     std::unique_lock<std::mutex> lock( m_mutex );
+    m_numWaiters.fetch_add( 1 );
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    bool popped = false;
+    m_requestAvailable.wait( lock, [this, requestPtr, &popped] {
+        popped = tryPop( requestPtr );
+        return popped || m_isShutDown.load();
+    } );
+    m_numWaiters.fetch_sub( 1 );
+
+    return popped && !m_isShutDown.load();
+}
+
+unsigned int RequestQueue::popBatchOrWait( PageRequest* requests, unsigned int maxRequests )
+{
+    if( maxRequests == 0 || !popOrWait( &requests[0] ) )
+        return 0;
+    return 1 + tryPopBatch( requests + 1, maxRequests - 1 );
+}
+
+unsigned int RequestQueue::tryPopBatch( PageRequest* requests, unsigned int maxRequests )
+{
+    unsigned int numRequests = 0;
+    while( numRequests < maxRequests && tryPop( &requests[numRequests] ) )
+        ++numRequests;
+    return numRequests;
+}
+
+unsigned int RequestQueue::reserve( SubQueue& subQueue, unsigned int numRequests )
+{
+    // Don't overfill the sub-queue
+    unsigned int size = subQueue.size.load( std::memory_order_relaxed );
+    while( true )
+    {
+        const unsigned int available = size < m_maxQueueSize ? m_maxQueueSize - size : 0;
+        const unsigned int count     = std::min( numRequests, available );
+        if( count == 0 )
+            return 0;
+        if( subQueue.size.compare_exchange_weak( size, size + count, std::memory_order_acquire, std::memory_order_relaxed ) )
+            return count;
+    }
+}
+
+bool RequestQueue::addPending( const PendingKey& key, TicketImpl* ticket )
+{
+    PendingShard&                shard = getPendingShard( key.pageId );
+    std::unique_lock<std::mutex> lock( shard.mutex );
 
+    auto result = shard.pages.emplace( key, std::vector<TicketImpl*>() );
+    if( !result.second )
+        result.first->second.push_back( ticket );
+    return result.second;
+}
+
+void RequestQueue::removePending( const PendingKey& key, std::vector<TicketImpl*>& attached )
+{
+    PendingShard&                shard = getPendingShard( key.pageId );
+    std::unique_lock<std::mutex> lock( shard.mutex );
+
+    auto it = shard.pages.find( key );
+    DEMAND_ASSERT( it != shard.pages.end() );
+    attached.insert( attached.end(), it->second.begin(), it->second.end() );
+    shard.pages.erase( it );
+}
+
+bool RequestQueue::hasLiveDuplicates( const PageRequest& request )
+{
+    const PendingKey             key{request.pageId, request.subQueue, request.ticket->getContext()};
+    PendingShard&                shard = getPendingShard( key.pageId );
+    std::unique_lock<std::mutex> lock( shard.mutex );
+
+    auto it = shard.pages.find( key );
+    return it != shard.pages.end()
+           && std::any_of( it->second.begin(), it->second.end(), []( const TicketImpl* ticket ) { return !ticket->isCancelled(); } );
+}
+
+void RequestQueue::push( const unsigned int* pageIds, const unsigned int* priorities, unsigned int numPageIds, Ticket ticket )
+{
     // Don't push requests if the queue is shut down.
-    if( m_isShutDown )
-        numPageIds = 0;
-    
-    // Don't overfill the queue
-    if( m_requests.size() >= m_maxQueueSize )
+    if( m_isShutDown.load() )
         numPageIds = 0;
-    else if( numPageIds + m_requests.size() > m_maxQueueSize )
-        numPageIds = static_cast<unsigned int>( m_maxQueueSize - m_requests.size() );
 
-    // Update the ticket, now that the number of tasks is known.
-    TicketImpl::getImpl( ticket )->update( numPageIds );
+    // Resolve the context of the ticket's stream, which keys the pending requests, once for the batch.
+    std::shared_ptr<TicketImpl>& impl = TicketImpl::getImpl( ticket );
+    TicketImpl*                  ptr  = impl.get();
+    if( numPageIds > 0 )
+    {
+        CUcontext context;
+        DEMAND_CUDA_CHECK( cuStreamGetCtx( ptr->getStream(), &context ) );
+        ptr->setContext( context );
+    }
 
+    // Update the ticket with the number of requests.  This must precede enqueuing or attaching any
+    // request, since its ticket may be notified as soon as the request is filled.  Requests that
+    // are dropped are discarded from the count below.  The ticket retains itself until the last
+    // request is notified, so the requests need not copy it.
+    ptr->update( numPageIds, impl );
     if( numPageIds == 0 )
         return;
 
+    const CUcontext context = ptr->getContext();
+
+    // Order the batch by priority class (a stable counting sort), so that the most urgent
+    // requests are the ones that fit if the queue is full.
+    std::vector<unsigned int> order( numPageIds );
+    unsigned int              offsets[NUM_REQUEST_PRIORITIES + 1] = {};
+    if( priorities )
+    {
+        for( unsigned int i = 0; i < numPageIds; ++i )
+        {
+            DEMAND_ASSERT( priorities[i] < NUM_REQUEST_PRIORITIES );
+            ++offsets[priorities[i] + 1];
+        }
+        for( unsigned int p = 0; p < NUM_REQUEST_PRIORITIES; ++p )
+            offsets[p + 1] += offsets[p];
+        for( unsigned int i = 0; i < numPageIds; ++i )
+            order[offsets[priorities[i]]++] = i;
+    }
+    else
+    {
+        for( unsigned int i = 0; i < numPageIds; ++i )
+            order[i] = i;
+        offsets[0] = numPageIds;
+    }
+
+    // Find the sub-queue for the weight of the ticket's stream, and allocate the rings for the
+    // priority classes in the batch.  (After the sort, offsets[p] is the end of class p.)
+    unsigned int subQueueIndex = 0;
+    {
+        std::unique_lock<std::mutex> lock( m_streamsMutex );
+        auto                         it = m_streamWeights.find( ptr->getStream() );
+        if( it != m_streamWeights.end() )
+            subQueueIndex = it->second - 1;
+        for( unsigned int p = 0, begin = 0; p < NUM_REQUEST_PRIORITIES; begin = offsets[p++] )
+        {
+            Ring& ring = m_subQueues[subQueueIndex].rings[p];
+            if( offsets[p] > begin && !ring.isAllocated() )
+                ring.allocate( m_ringCapacity );
+        }
+    }
+    SubQueue& subQueue = m_subQueues[subQueueIndex];
+    m_usedSubQueues.fetch_or( 1u << subQueueIndex, std::memory_order_relaxed );
+
+    // Record the requested pages as pending.  Requests for pages that are already pending are
+    // attached to the pending request; only the remainder need slots in the queue.
+    unsigned int numNew = 0;
     for( unsigned int i = 0; i < numPageIds; ++i )
     {
-        m_requests.emplace_back( pageIds[i], ticket );
+        if( addPending( PendingKey{pageIds[order[i]], subQueueIndex, context}, ptr ) )
+            order[numNew++] = order[i];
     }
+    if( numNew < numPageIds )
+        m_numDeduplicated.fetch_add( numPageIds - numNew, std::memory_order_relaxed );
 
-    // Notify any threads in popOrWait().
-    m_requestAvailable.notify_all();
+    // Reserve slots for as many requests as fit.  The remainder take over the slots of queued
+    // requests with lower priority, which are evicted.  Requests that still do not fit are dropped.
+    const unsigned int       numReserved = reserve( subQueue, numNew );
+    unsigned int             numAccepted = numReserved;
+    std::vector<PageRequest> evicted;
+    for( ; numAccepted < numNew; ++numAccepted )
+    {
+        const unsigned int priority = priorities ? priorities[order[numAccepted]] : 0;
+        PageRequest        request;
+        if( !subQueue.dequeueLessUrgent( priority, &request ) )
+            break;
+        evicted.push_back( request );
+    }
+
+    for( unsigned int i = 0; i < numAccepted; ++i )
+    {
+        const unsigned int index    = order[i];
+        const unsigned int priority = priorities ? priorities[index] : 0;
+        PageRequest        request;
+        request.pageId   = pageIds[index];
+        request.subQueue = subQueueIndex;
+        request.ticket   = ptr;
+        subQueue.rings[priority].enqueue( request );
+    }
+
+    // Dropped requests are no longer pending.  Any duplicates that were attached to them in the
+    // meantime are counted as done, like the dropped requests themselves.
+    if( numAccepted < numNew )
+    {
+        std::vector<TicketImpl*> attached;
+        for( unsigned int i = numAccepted; i < numNew; ++i )
+            removePending( PendingKey{pageIds[order[i]], subQueueIndex, context}, attached );
+        for( TicketImpl* attachedTicket : attached )
+            attachedTicket->notify();
+        ptr->discard( numNew - numAccepted );
+        m_numDropped.fetch_add( numNew - numAccepted, std::memory_order_relaxed );
+    }
+
+    // Evicted requests are counted as done, so their tickets are released.
+    if( !evicted.empty() )
+    {
+        m_numEvicted.fetch_add( evicted.size(), std::memory_order_relaxed );
+        complete( evicted.data(), static_cast<unsigned int>( evicted.size() ) );
+    }
+
+    if( numAccepted == 0 )
+        return;
+
+    // Notify any threads in popOrWait().  The mutex is only acquired if a worker is waiting.
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    if( m_numWaiters.load() > 0 )
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+        }
+        m_requestAvailable.notify_all();
+    }
+}
+
+void RequestQueue::complete( const PageRequest* requests, unsigned int numRequests )
+{
+    // Process runs of requests that share a ticket (and hence a context).
+    std::vector<TicketImpl*> attached;
+    unsigned int             begin = 0;
+    while( begin < numRequests )
+    {
+        TicketImpl*     ticket  = requests[begin].ticket;
+        const CUcontext context = ticket->getContext();
+
+        unsigned int end = begin;
+        for( ; end < numRequests && requests[end].ticket == ticket; ++end )
+            removePending( PendingKey{requests[end].pageId, requests[end].subQueue, context}, attached );
+
+        // Notify the tickets of the attached duplicates, then the ticket of the run, which may
+        // release it.
+        for( TicketImpl* attachedTicket : attached )
+            attachedTicket->notify();
+        attached.clear();
+        ticket->notify( end - begin );
+        begin = end;
+    }
 }
 
 }  // namespace demandLoading
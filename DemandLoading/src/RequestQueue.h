@@ -34,21 +34,29 @@
 
 #include <atomic>
 #include <condition_variable>
-#include <deque>
+#include <map>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace demandLoading {
 
-/// A page request contains a page id, which is a index into the page table.  It also holds a shared
-/// pointer to a Ticket, which must be notified when the request has been filled.
+class TicketImpl;
+
+/// A page request contains a page id, which is a index into the page table.  It also holds a
+/// pointer to the ticket of the batch it was pushed in, which must be notified when the request has
+/// been filled.  The ticket keeps itself alive until all the requests in the batch have been
+/// notified (see TicketImpl::update), so the request holds a plain pointer rather than a
+/// reference-counted Ticket.
 struct PageRequest
 {
     unsigned int pageId{};
-    Ticket       ticket;
+    unsigned int subQueue{};  // Index of the sub-queue the request was pushed to (see RequestQueue).
+    TicketImpl*  ticket{};
 
     // A constructor is necessary for emplace_back.
-    PageRequest( unsigned int pageId_, Ticket ticket_ )
+    PageRequest( unsigned int pageId_, TicketImpl* ticket_ )
         : pageId( pageId_ )
         , ticket( ticket_ )
     {
@@ -58,28 +66,108 @@ struct PageRequest
     PageRequest() {}
 };
 
+/// Number of request priority classes.  Class 0 is the most urgent (e.g. samplers and mip tails).
+/// Requests in higher classes are filled later, and are evicted first when the queue overflows.
+const unsigned int NUM_REQUEST_PRIORITIES = 8;
+
+/// Maximum scheduling weight of a stream.  \see RequestQueue::setStreamWeight
+const unsigned int MAX_STREAM_WEIGHT = 8;
+
+/// RequestQueue is a bounded multi-producer, multi-consumer queue of page requests, ordered by
+/// priority class and then FIFO.  Each priority class is held in a lock-free ring buffer (after
+/// Dmitry Vyukov's bounded MPMC queue), so worker threads popping requests do not contend on a
+/// mutex.  A mutex and condition variable are used only to put idle workers to sleep when the
+/// queue is empty.
+///
+/// A page that is requested again on the same device while an earlier request for it is queued or
+/// being filled (e.g. by a later launch, or by another stream) is not queued again.  Instead the
+/// duplicate request is attached to the pending one, which is filled on the stream of the pending
+/// request, and the duplicate's ticket is notified when the pending request is completed.
+///
+/// Requests from streams with different scheduling weights are held in separate sub-queues, each
+/// with its own capacity, and workers pop from them in proportion to their weights (weighted round
+/// robin).  A stream that floods the queue therefore cannot starve a stream with a higher weight,
+/// e.g. an interactive viewport sharing the DemandLoader with a background render.  By default all
+/// streams share the sub-queue with weight 1.
 class RequestQueue
 {
   public:
-    /// Construct request queue.
-    RequestQueue( unsigned int maxQueueSize )
-        : m_maxQueueSize( maxQueueSize )
+    /// Construct request queue.  Each sub-queue holds up to maxQueueSize requests.
+    RequestQueue( unsigned int maxQueueSize );
+
+    /// Requests that remain in the queue are notified, releasing their tickets.
+    ~RequestQueue();
+
+    /// Pop the most urgent request, waiting if necessary until the queue is non-empty or shut down.
+    /// Returns false if the queue was shut down.
+    bool popOrWait( PageRequest* request );
+
+    /// Pop a batch of up to maxRequests requests, waiting if necessary until the queue is non-empty
+    /// or shut down.  Only the first request is waited for; the rest are taken if immediately
+    /// available.  Returns the number of requests popped, which is zero if the queue was shut down.
+    unsigned int popBatchOrWait( PageRequest* requests, unsigned int maxRequests );
+
+    /// Pop the most urgent request without waiting.  Returns false if the queue is empty or shut down.
+    bool tryPop( PageRequest* request );
+
+    /// Pop a batch of up to maxRequests requests without waiting.  Returns the number of requests
+    /// popped, which is zero if the queue is empty or shut down.
+    unsigned int tryPopBatch( PageRequest* requests, unsigned int maxRequests );
+
+    /// Push a batch of page requests with the given priority classes (less than
+    /// NUM_REQUEST_PRIORITIES), which may be null to push every request in class 0.  The requests
+    /// go to the sub-queue for the weight of the ticket's stream.  Notifies any threads waiting in
+    /// popOrWait().  Requests for pages that are already pending in the same sub-queue, from any
+    /// stream in the same CUDA context (which is resolved once per ticket), are attached
+    /// to the pending request rather than queued.  If the sub-queue is full, queued requests in
+    /// lower priority classes are evicted (completing them) to make room for more urgent ones, and
+    /// requests that still do not fit are dropped.  Updates the given Ticket with the number of
+    /// requests that were queued or attached, and retains it until every one has been notified.
+    /// The caller must complete() each request that is popped.
+    void push( const unsigned int* pageIds, const unsigned int* priorities, unsigned int numPageIds, Ticket ticket );
+
+    /// Push a batch of page requests in priority class 0.
+    void push( const unsigned int* pageIds, unsigned int numPageIds, Ticket ticket )
     {
+        push( pageIds, nullptr, numPageIds, ticket );
     }
 
-    /// Pop a request, waiting if necessary until the queue is non-empty or shut down.  Returns
-    /// false if the queue was shut down.
-    bool popOrWait( PageRequest* request );
+    /// Complete a batch of popped requests once they have been filled, notifying their tickets and
+    /// the tickets of any duplicate requests that were attached to them.  This may release the
+    /// tickets, so they must not be used afterwards.
+    void complete( const PageRequest* requests, unsigned int numRequests );
 
-    /// Push a batch of page requests.  Notifies any threads waiting in popOrWait().  Updates the
-    /// given Ticket with the number of requests, and retains it for notifications as requests are
-    /// filled.
-    void push( const unsigned int* pageIds, unsigned int numPageIds, Ticket ticket );
+    /// Complete a single popped request.
+    void complete( const PageRequest& request ) { complete( &request, 1 ); }
+
+    /// Check whether a duplicate from a ticket that has not been cancelled is attached to the given
+    /// popped request, in which case its page should be filled even if the request's own ticket
+    /// has been cancelled.
+    bool hasLiveDuplicates( const PageRequest& request );
+
+    /// Set the scheduling weight of requests subsequently pushed from the given stream, which is
+    /// clamped to [1, MAX_STREAM_WEIGHT].  The default weight is 1.
+    void setStreamWeight( CUstream stream, unsigned int weight );
 
     /// Shut down the queue, signalling any waiting threads to exit.  Clients must call shutDown()
     /// and join with any waiting threads before invoking the RequestQueue destructor.
     void shutDown();
 
+    /// Check whether the queue has been shut down.
+    bool isShutDown() const { return m_isShutDown.load(); }
+
+    /// Get the number of requests currently in the queue (approximate if other threads are active).
+    unsigned int size() const;
+
+    /// Get the number of requests that have been evicted to make room for more urgent ones.
+    unsigned long long getNumEvicted() const { return m_numEvicted.load( std::memory_order_relaxed ); }
+
+    /// Get the number of requests that were dropped because the queue was full, excluding evicted requests.
+    unsigned long long getNumDropped() const { return m_numDropped.load( std::memory_order_relaxed ); }
+
+    /// Get the number of requests that were attached to a pending request for the same page.
+    unsigned long long getNumDeduplicated() const { return m_numDeduplicated.load( std::memory_order_relaxed ); }
+
     /// Not copyable.
     RequestQueue( const RequestQueue& ) = delete;
 
@@ -87,11 +175,133 @@ class RequestQueue
     RequestQueue& operator=( const RequestQueue& ) = delete;
 
   private:
-    std::deque<PageRequest> m_requests;
-    std::mutex              m_mutex;
-    std::condition_variable m_requestAvailable;
-    unsigned int            m_maxQueueSize;
-    bool                    m_isShutDown = false;
+    // Padding keeps the producer and consumer positions on separate cache lines.
+    static const size_t CACHE_LINE_SIZE = 64;
+
+    // A lock-free ring buffer holding the requests of one priority class.  Rings are allocated
+    // on first use, since most combinations of weight and priority class are never used.
+    class Ring
+    {
+      public:
+        // Allocate the ring with the given capacity, which must be a power of two.  The caller
+        // must prevent concurrent calls.
+        void allocate( size_t capacity );
+
+        // Check whether the ring has been allocated.
+        bool isAllocated() const { return m_isAllocated.load( std::memory_order_acquire ); }
+
+        // Dequeue a request.  Returns false if the ring is empty (or unallocated).
+        bool dequeue( PageRequest* request );
+
+        // Enqueue a request.  The caller must ensure that the ring is not full.
+        void enqueue( const PageRequest& request );
+
+      private:
+        // Each cell carries a sequence number that tells producers and consumers whether it is
+        // free (sequence == position), full (sequence == position + 1), or still in use by the
+        // previous lap.
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            PageRequest         request;
+        };
+
+        std::unique_ptr<Cell[]> m_cells;
+        size_t                  m_mask = 0;
+        std::atomic<bool>       m_isAllocated{false};
+        char                    m_pad0[CACHE_LINE_SIZE];
+        std::atomic<size_t>     m_enqueuePos{0};
+        char                    m_pad1[CACHE_LINE_SIZE];
+        std::atomic<size_t>     m_dequeuePos{0};
+        char                    m_pad2[CACHE_LINE_SIZE];
+    };
+
+    // The requests from streams with one scheduling weight, with a ring per priority class.
+    struct SubQueue
+    {
+        Ring                      rings[NUM_REQUEST_PRIORITIES];
+        std::atomic<unsigned int> size{0};  // Number of reserved slots (bounded by m_maxQueueSize).
+
+        // Dequeue the most urgent request, without releasing its slot.
+        bool dequeue( PageRequest* request );
+
+        // Dequeue the least urgent request in a class below the given priority, without releasing
+        // its slot.  Returns false if there is no such request.
+        bool dequeueLessUrgent( unsigned int priority, PageRequest* request );
+    };
+
+    // Pending requests are keyed by page and CUDA context, since each device has its own page table,
+    // so requests for a page from different streams on the same device are merged.  The sub-queue
+    // is part of the key so that a stream never waits on a request in a lower weight sub-queue.
+    struct PendingKey
+    {
+        unsigned int pageId;
+        unsigned int subQueue;
+        CUcontext    context;
+
+        bool operator==( const PendingKey& other ) const
+        {
+            return pageId == other.pageId && subQueue == other.subQueue && context == other.context;
+        }
+    };
+
+    struct PendingKeyHash
+    {
+        size_t operator()( const PendingKey& key ) const
+        {
+            return std::hash<unsigned int>()( key.pageId * MAX_STREAM_WEIGHT + key.subQueue ) ^ std::hash<CUcontext>()( key.context );
+        }
+    };
+
+    // The tickets of duplicate requests attached to a pending request.
+    typedef std::unordered_map<PendingKey, std::vector<TicketImpl*>, PendingKeyHash> PendingMap;
+
+    // The set of pending pages is sharded by page id to reduce contention.
+    static const unsigned int NUM_PENDING_SHARDS = 64;
+    struct PendingShard
+    {
+        std::mutex mutex;
+        PendingMap pages;
+    };
+
+    SubQueue                        m_subQueues[MAX_STREAM_WEIGHT];  // Indexed by weight - 1.
+    PendingShard                    m_pending[NUM_PENDING_SHARDS];
+    unsigned int                    m_maxQueueSize;
+    size_t                          m_ringCapacity;
+    std::atomic<unsigned long long> m_numEvicted{0};
+    std::atomic<unsigned long long> m_numDropped{0};
+    std::atomic<unsigned long long> m_numDeduplicated{0};
+    std::atomic<bool>               m_isShutDown{false};
+
+    // Turn counter for weighted round robin scheduling of the sub-queues.
+    std::atomic<unsigned int> m_turn{0};
+    std::atomic<unsigned int> m_usedSubQueues{0};  // Bit mask of sub-queues that have been pushed to.
+
+    // Stream weights, and the mutex that guards them and ring allocation.
+    std::map<CUstream, unsigned int> m_streamWeights;
+    std::mutex                       m_streamsMutex;
+
+    // Sleeping workers.  Producers only acquire the mutex when m_numWaiters is non-zero.
+    std::atomic<unsigned int> m_numWaiters{0};
+    std::mutex                m_mutex;
+    std::condition_variable   m_requestAvailable;
+
+    // Reserve space in a sub-queue for up to the given number of requests, returning the number reserved.
+    unsigned int reserve( SubQueue& subQueue, unsigned int numRequests );
+
+    // Dequeue the most urgent request from the sub-queue whose turn it is, ignoring shutdown and
+    // without releasing its slot.  Returns false if the queue is empty.
+    bool dequeue( PageRequest* request );
+
+    // Get the pending shard for the given page.
+    PendingShard& getPendingShard( unsigned int pageId ) { return m_pending[pageId % NUM_PENDING_SHARDS]; }
+
+    // Record the given page as pending, unless it already is, in which case the ticket is attached
+    // to the pending request.  Returns true if the page was not already pending.
+    bool addPending( const PendingKey& key, TicketImpl* ticket );
+
+    // Remove the given page from the pending set, appending the tickets of attached requests.
+    void removePending( const PendingKey& key, std::vector<TicketImpl*>& attached );
 };
 
 }  // namespace demandLoading
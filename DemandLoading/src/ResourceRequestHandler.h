@@ -51,6 +51,9 @@ class ResourceRequestHandler : public RequestHandler
     /// Fill a request for the specified page using the given stream.
     void fillRequest( CUstream stream, unsigned int pageIndex ) override;
 
+    /// Get the type of handler, by which request latencies are recorded.
+    RequestHandlerType getHandlerType( unsigned int /*pageId*/ ) const override { return REQUEST_HANDLER_RESOURCE; }
+
     /// Get the index of the first page table entry allocated to this resource.
     unsigned int getStartPage() const { return m_startPage; }
 
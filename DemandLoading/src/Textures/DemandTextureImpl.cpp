@@ -35,6 +35,7 @@
 #include "Util/Stopwatch.h"
 
 #include <OptiXToolkit/DemandLoading/TileIndexing.h>
+#include <OptiXToolkit/ImageSource/CachingImageSource.h>
 #include <OptiXToolkit/ImageSource/ImageSource.h>
 
 #include <cuda.h>
@@ -249,6 +250,7 @@ void DemandTextureImpl::initSampler()
         {
             m_requestHandler.reset( new TextureRequestHandler( this, m_loader ) );
             m_sampler.startPage = m_loader->getPageTableManager()->reserveUnbackedPages( m_sampler.numPages, m_requestHandler.get() );
+            m_loader->recordTexturePages( m_id, m_sampler );
         }
     }
     else // Dense texture 
@@ -352,6 +354,15 @@ void DemandTextureImpl::accumulateStatistics( Statistics& stats, std::set<imageS
     stats.numBytesRead += m_image->getNumBytesRead();
     stats.readTime += m_image->getTotalReadTime();
 
+    // Get the tile cache statistics if the image is cached.
+    const auto* cachingImage = dynamic_cast<const imageSource::CachingImageSource*>( m_image.get() );
+    if( cachingImage )
+    {
+        stats.numTileCacheHits += cachingImage->getNumCacheHits();
+        stats.numTileCacheMisses += cachingImage->getNumCacheMisses();
+        stats.numTileCacheBytesHit += cachingImage->getNumCacheBytesHit();
+    }
+
     // Calculate size (total number of bytes) in virtual texture
     const imageSource::TextureInfo &info = m_image->getInfo();
     if( info.isValid )  // texture initialized
@@ -398,6 +409,20 @@ bool DemandTextureImpl::readTile( unsigned int mipLevel, unsigned int tileX, uns
     return m_image->readTile( tileBuffer, mipLevel, tileX, tileY, getTileWidth(), getTileHeight(), stream );
 }
 
+// The ImageSource may read the tiles of a batch concurrently.
+bool DemandTextureImpl::readTiles( imageSource::TileRequest* requests, unsigned int numRequests, size_t tileBufferSize, CUstream stream ) const
+{
+    DEMAND_ASSERT( m_isInitialized );
+    for( unsigned int i = 0; i < numRequests; ++i )
+        DEMAND_ASSERT( requests[i].mipLevel < m_info.numMipLevels );
+
+    const unsigned int bytesPerPixel = imageSource::getBytesPerChannel( getInfo().format ) * getInfo().numChannels;
+    const unsigned int bytesPerTile  = getTileWidth() * getTileHeight() * bytesPerPixel;
+    DEMAND_ASSERT_MSG( bytesPerTile <= tileBufferSize, "Maximum tile size exceeded" );
+
+    return m_image->readTiles( requests, numRequests, getTileWidth(), getTileHeight(), stream );
+}
+
 // Tiles can be filled concurrently.
 void DemandTextureImpl::fillTile( CUstream                     stream,
                                   unsigned int                 mipLevel,
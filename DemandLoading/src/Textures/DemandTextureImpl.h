@@ -111,6 +111,9 @@ class DemandTextureImpl : public DemandTexture
     /// for each device (see getTextureObject).
     const TextureSampler& getSampler() const;
 
+    /// Check whether the texture has been initialized, which is a prerequisite for getSampler().
+    bool isInitialized() const { return m_isInitialized.load( std::memory_order_acquire ); }
+
     /// Get the CUDA texture object for the current CUDA context.
     CUtexObject getTextureObject() const;
 
@@ -148,6 +151,11 @@ class DemandTextureImpl : public DemandTexture
     bool readTile( unsigned int mipLevel, unsigned int tileX, unsigned int tileY, char* tileBuffer,
                    size_t tileBufferSize, CUstream stream ) const;
 
+    /// Read a batch of tiles into the buffers given by the requests, each of which holds
+    /// tileBufferSize bytes, and set the satisfied flag of each.  Throws an exception on error.
+    /// Returns true if every request was satisfied.
+    bool readTiles( imageSource::TileRequest* requests, unsigned int numRequests, size_t tileBufferSize, CUstream stream ) const;
+
     /// Fill the device tile backing storage for a texture tile and with the given data.
     void fillTile( CUstream                     stream,
                    unsigned int                 mipLevel,
@@ -226,7 +234,7 @@ class DemandTextureImpl : public DemandTexture
     bool m_isOpen{};
 
     // The texture is lazily initialized.  Invariant after init().
-    bool m_isInitialized{};
+    std::atomic<bool> m_isInitialized{ false };
 
     // Image info, including dimensions and format.  Invariant after init(), and not valid before then.
     imageSource::TextureInfo m_info{};
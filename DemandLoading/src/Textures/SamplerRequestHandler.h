@@ -30,6 +30,8 @@
 
 #include "RequestHandler.h"
 
+#include <OptiXToolkit/DemandLoading/TextureSampler.h>
+
 namespace demandLoading {
 
 class DemandLoaderImpl;
@@ -47,6 +49,12 @@ class SamplerRequestHandler : public RequestHandler
     /// Fill a request for the specified page using the given stream.  
     void fillRequest( CUstream stream, unsigned int pageId ) override;
 
+    /// Samplers and base colors share a page range, but their latencies are recorded separately.
+    RequestHandlerType getHandlerType( unsigned int pageId ) const override
+    {
+        return isBaseColorId( pageId ) ? REQUEST_HANDLER_BASE_COLOR : REQUEST_HANDLER_SAMPLER;
+    }
+
   private:
     bool fillDenseTexture( CUstream stream, unsigned int pageId );
     void fillBaseColorRequest( CUstream stream, DemandTextureImpl* texture, unsigned int pageId );
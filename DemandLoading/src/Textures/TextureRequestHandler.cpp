@@ -30,12 +30,18 @@
 #include "DemandLoaderImpl.h"
 #include <OptiXToolkit/Memory/MemoryBlockDesc.h>
 #include "PagingSystem.h"
+#include "RequestQueue.h"
 #include "Textures/DemandTextureImpl.h"
 #include "TransferBufferDesc.h"
+#include "Util/LatencyRecorder.h"
 #include "Util/NVTXProfiling.h"
+#include "Util/Stopwatch.h"
 
 #include <OptiXToolkit/DemandLoading/TileIndexing.h>
 
+#include <algorithm>
+#include <vector>
+
 using namespace otk;
 
 namespace demandLoading {
@@ -45,11 +51,197 @@ void TextureRequestHandler::fillRequest( CUstream stream, unsigned int pageId )
    loadPage( stream, pageId, false );
 }
 
+void TextureRequestHandler::fillRequests( CUstream stream, const unsigned int* pageIds, unsigned int numPageIds )
+{
+    SCOPED_NVTX_RANGE_FUNCTION_NAME();
+
+    // Staged tiles are freed in the background, ahead of demand, if the tile pool is running low.
+    m_loader->requestTileReclamation();
+
+    // Allocate one transfer buffer with a slot for each tile.  If that fails, fall back to
+    // loading the pages one at a time, each with a buffer of its own.
+    TransferBufferDesc transferBuffer{};
+    if( numPageIds > 1 )
+        transferBuffer = m_loader->allocateTransferBuffer( m_texture->getFillType(), numPageIds * TILE_SIZE_IN_BYTES, stream );
+    if( transferBuffer.memoryBlock.size == 0 )
+    {
+        for( unsigned int i = 0; i < numPageIds; ++i )
+            loadPageBody( stream, pageIds[i], false, nullptr, CU_MEMORYTYPE_HOST );
+        return;
+    }
+
+    fillTileRequests( stream, pageIds, numPageIds, reinterpret_cast<char*>( transferBuffer.memoryBlock.ptr ), transferBuffer.memoryType );
+
+    // The buffer is not reused until the copies issued by fillTile() are complete.
+    m_loader->freeTransferBuffer( transferBuffer, stream );
+}
+
+namespace {
+
+// Locks pages of a MutexArray, unlocking them on destruction.
+class PageLocks
+{
+  public:
+    PageLocks( MutexArray* mutex )
+        : m_mutex( mutex )
+    {
+    }
+
+    ~PageLocks()
+    {
+        for( unsigned int index : m_indices )
+            m_mutex->unlock( index );
+    }
+
+    void lock( unsigned int index )
+    {
+        m_mutex->lock( index );
+        m_indices.push_back( index );
+    }
+
+    // Unlock the most recently locked page.
+    void unlockLast()
+    {
+        m_mutex->unlock( m_indices.back() );
+        m_indices.pop_back();
+    }
+
+  private:
+    MutexArray*               m_mutex;
+    std::vector<unsigned int> m_indices;
+};
+
+}  // anonymous namespace
+
+void TextureRequestHandler::fillTileRequests( CUstream stream, const unsigned int* pageIds, unsigned int numPageIds, char* buffer, CUmemorytype bufferType )
+{
+    SCOPED_NVTX_RANGE_FUNCTION_NAME();
+
+    // The pages are locked in increasing order, so that concurrent batches cannot deadlock.
+    std::vector<unsigned int> sortedPageIds( pageIds, pageIds + numPageIds );
+    std::sort( sortedPageIds.begin(), sortedPageIds.end() );
+    sortedPageIds.erase( std::unique( sortedPageIds.begin(), sortedPageIds.end() ), sortedPageIds.end() );
+
+    // Gather the tiles that are not resident, allocating device memory for each one.  The mip tail
+    // is loaded separately, as are tiles for which no memory could be allocated, once the batch's
+    // pages are unlocked.
+    const TextureSampler&                 sampler = m_texture->getSampler();
+    std::vector<unsigned int>             deferred;
+    std::vector<unsigned int>             batchPageIds;
+    std::vector<TileBlockHandle>          blocks;
+    std::vector<imageSource::TileRequest> requests;
+    {
+        PageLocks locks( m_mutex.get() );
+        for( unsigned int i = 0; i < static_cast<unsigned int>( sortedPageIds.size() ); ++i )
+        {
+            const unsigned int pageId = sortedPageIds[i];
+            if( pageId == m_startPage && m_texture->isMipmapped() )
+            {
+                deferred.push_back( i );
+                continue;
+            }
+            locks.lock( pageId - m_startPage );
+            if( m_loader->getPagingSystem()->isResident( pageId ) )
+            {
+                locks.unlockLast();
+                continue;
+            }
+            const TileBlockHandle bh = allocateTileBlock( stream, TILE_SIZE_IN_BYTES );
+            if( bh.block.isBad() )
+            {
+                locks.unlockLast();
+                deferred.push_back( i );
+                continue;
+            }
+
+            imageSource::TileRequest request{buffer + i * TILE_SIZE_IN_BYTES, 0, 0, 0};
+            unpackTileIndex( sampler, pageId - m_startPage, request.mipLevel, request.tileX, request.tileY );
+            batchPageIds.push_back( pageId );
+            blocks.push_back( bh );
+            requests.push_back( request );
+        }
+
+        if( !requests.empty() )
+            fillTileBatch( stream, batchPageIds.data(), blocks.data(), requests.data(), static_cast<unsigned int>( requests.size() ), bufferType );
+    }
+
+    // Load the deferred pages now that the batch is unlocked, which frees staged tiles if the tile
+    // pool is still exhausted.
+    for( unsigned int i : deferred )
+        loadPageBody( stream, sortedPageIds[i], false, buffer + i * TILE_SIZE_IN_BYTES, bufferType );
+}
+
+void TextureRequestHandler::fillTileBatch( CUstream                        stream,
+                                           const unsigned int*             pageIds,
+                                           const TileBlockHandle*          blocks,
+                                           imageSource::TileRequest*       requests,
+                                           unsigned int                    numTiles,
+                                           CUmemorytype                    bufferType )
+{
+    // Read the tiles (possibly from disk) into the transfer buffer.  If the batch is not satisfied,
+    // only the tiles that were read are filled; the others are requested again on a later launch.
+    LatencyRecorder* latencyRecorder = m_loader->getLatencyRecorder();
+    Stopwatch        readStopwatch;
+    bool             allSatisfied;
+    try
+    {
+        allSatisfied = m_texture->readTiles( requests, numTiles, TILE_SIZE_IN_BYTES, stream );
+    }
+    catch( const std::exception& e )
+    {
+        for( unsigned int i = 0; i < numTiles; ++i )
+            m_loader->getDeviceMemoryManager()->freeTileBlock( blocks[i].block );
+
+        std::stringstream ss;
+        ss << "readTiles call failed: " << e.what() << ": " << __FILE__ << " (" << __LINE__ << ")";
+        throw Exception( ss.str().c_str() );
+    }
+
+    // The tiles are read together, so each is attributed an equal share of the read time.
+    const double readTime = readStopwatch.elapsed() / numTiles;
+    for( unsigned int i = 0; i < numTiles; ++i )
+        latencyRecorder->record( LATENCY_READ_TILE, REQUEST_HANDLER_TEXTURE, readTime );
+
+    for( unsigned int i = 0; i < numTiles; ++i )
+    {
+        if( !allSatisfied && !requests[i].satisfied )
+        {
+            m_loader->getDeviceMemoryManager()->freeTileBlock( blocks[i].block );
+            continue;
+        }
+
+        // Copy data from transfer buffer to the sparse texture on the device, and add a mapping
+        // for the tile, which will be sent to the device in pushMappings().
+        Stopwatch fillStopwatch;
+        m_texture->fillTile( stream, requests[i].mipLevel, requests[i].tileX, requests[i].tileY, requests[i].dest,
+                             bufferType, TILE_SIZE_IN_BYTES, blocks[i].handle, blocks[i].block.offset() );
+        m_loader->setPageTableEntry( pageIds[i], true, reinterpret_cast<void*>( blocks[i].block.data ) );
+        latencyRecorder->record( LATENCY_FILL_TILE, REQUEST_HANDLER_TEXTURE, fillStopwatch.elapsed() );
+    }
+}
+
 void TextureRequestHandler::loadPage( CUstream stream, unsigned int pageId, bool reloadIfResident )
 {
-    // Try to make sure there are free tiles to handle the request
-    m_loader->freeStagedTiles( stream );
+    // Staged tiles are freed in the background, ahead of demand, if the tile pool is running low.
+    m_loader->requestTileReclamation();
+
+    loadPageBody( stream, pageId, reloadIfResident, nullptr, CU_MEMORYTYPE_HOST );
+}
 
+void TextureRequestHandler::loadPageBody( CUstream stream, unsigned int pageId, bool reloadIfResident, char* tileBuffer, CUmemorytype tileBufferType )
+{
+    // If the tile pool is exhausted before the background reclaimer catches up, free staged tiles
+    // inline and try again.  The page must not be locked meanwhile, since freeing staged tiles locks
+    // the pages it unmaps, which might include this one.
+    if( !tryLoadPage( stream, pageId, reloadIfResident, tileBuffer, tileBufferType ) )
+    {
+        m_loader->freeStagedTiles( stream );
+        tryLoadPage( stream, pageId, reloadIfResident, tileBuffer, tileBufferType );
+    }
+}
+
+bool TextureRequestHandler::tryLoadPage( CUstream stream, unsigned int pageId, bool reloadIfResident, char* tileBuffer, CUmemorytype tileBufferType )
+{
     // We use MutexArray to ensure mutual exclusion on a per-page basis.  This is necessary because
     // multiple streams might race to fill the same tile (or the mip tail).
     unsigned int index = pageId - m_startPage;
@@ -59,7 +251,7 @@ void TextureRequestHandler::loadPage( CUstream stream, unsigned int pageId, bool
     unsigned long long pageEntry;
     bool resident =  m_loader->getPagingSystem()->isResident( pageId, &pageEntry );
     if( resident && !reloadIfResident )
-        return;
+        return true;
 
     // Get the TileBlockHandle from the page table if the page is resident
     TileBlockHandle bh{ 0, 0 };
@@ -71,12 +263,36 @@ void TextureRequestHandler::loadPage( CUstream stream, unsigned int pageId, bool
 
     // Decide if we need to fill a mip tail or a tile
     if( pageId == m_startPage && m_texture->isMipmapped() )
-        fillMipTailRequest( stream, pageId, bh );
+        return fillMipTailRequest( stream, pageId, bh );
+    else if( tileBuffer != nullptr )
+        return fillTileRequest( stream, pageId, bh, tileBuffer, tileBufferType );
     else
-        fillTileRequest( stream, pageId, bh );
+        return fillTileRequest( stream, pageId, bh );
+}
+
+TileBlockHandle TextureRequestHandler::allocateTileBlock( CUstream stream, size_t numBytes )
+{
+    // The block might have been unmapped on another stream, which must finish before it is mapped again.
+    TileBlockHandle bh = m_loader->getDeviceMemoryManager()->allocateTileBlock( numBytes );
+    if( !bh.block.isBad() )
+        m_loader->waitForUnmappedTiles( stream );
+    return bh;
 }
 
-void TextureRequestHandler::fillTileRequest( CUstream stream, unsigned int pageId, TileBlockHandle bh )
+bool TextureRequestHandler::fillTileRequest( CUstream stream, unsigned int pageId, TileBlockHandle bh )
+{
+    // Allocate a transfer buffer.
+    TransferBufferDesc transferBuffer = m_loader->allocateTransferBuffer( m_texture->getFillType(), TILE_SIZE_IN_BYTES, stream );
+    if( transferBuffer.memoryBlock.size == 0 )
+        return true;
+
+    const bool result = fillTileRequest( stream, pageId, bh, reinterpret_cast<char*>( transferBuffer.memoryBlock.ptr ), transferBuffer.memoryType );
+
+    m_loader->freeTransferBuffer( transferBuffer, stream );
+    return result;
+}
+
+bool TextureRequestHandler::fillTileRequest( CUstream stream, unsigned int pageId, TileBlockHandle bh, char* tileBuffer, CUmemorytype tileBufferType )
 {
     SCOPED_NVTX_RANGE_FUNCTION_NAME();
 
@@ -95,25 +311,18 @@ void TextureRequestHandler::fillTileRequest( CUstream stream, unsigned int pageI
     bool useNewBlock = bh.block.isBad();
     if( useNewBlock )
     {
-        bh = m_loader->getDeviceMemoryManager()->allocateTileBlock( TILE_SIZE_IN_BYTES );
+        bh = allocateTileBlock( stream, TILE_SIZE_IN_BYTES );
         if( bh.block.isBad() )
-            return;
-    }
-
-    // Allocate a transfer buffer.
-    TransferBufferDesc transferBuffer = m_loader->allocateTransferBuffer( m_texture->getFillType(), TILE_SIZE_IN_BYTES, stream );
-    if( transferBuffer.memoryBlock.size == 0 )
-    {
-        m_loader->getDeviceMemoryManager()->freeTileBlock( bh.block );
-        return;
+            return false;
     }
 
     // Read the tile (possibly from disk) into the transfer buffer.
-    bool satisfied;
+    LatencyRecorder* latencyRecorder = m_loader->getLatencyRecorder();
+    Stopwatch        readStopwatch;
+    bool             satisfied;
     try
     {
-        satisfied = m_texture->readTile( mipLevel, tileX, tileY, reinterpret_cast<char*>( transferBuffer.memoryBlock.ptr ),
-                                         transferBuffer.memoryBlock.size, stream );
+        satisfied = m_texture->readTile( mipLevel, tileX, tileY, tileBuffer, TILE_SIZE_IN_BYTES, stream );
     }
     catch( const std::exception& e )
     {
@@ -122,14 +331,17 @@ void TextureRequestHandler::fillTileRequest( CUstream stream, unsigned int pageI
         throw Exception( ss.str().c_str() );
     }
 
+    latencyRecorder->record( LATENCY_READ_TILE, REQUEST_HANDLER_TEXTURE, readStopwatch.elapsed() );
+
     if( satisfied )
     {
         // Copy data from transfer buffer to the sparse texture on the device
+        Stopwatch fillStopwatch;
         m_texture->fillTile( stream,
-                             mipLevel, tileX, tileY,                                     // Tile to fill
-                             reinterpret_cast<char*>( transferBuffer.memoryBlock.ptr ),  // Src buffer
-                             transferBuffer.memoryType, TILE_SIZE_IN_BYTES,              // Src type and size
-                             bh.handle, bh.block.offset()                                // Dest
+                             mipLevel, tileX, tileY,                // Tile to fill
+                             tileBuffer,                            // Src buffer
+                             tileBufferType, TILE_SIZE_IN_BYTES,    // Src type and size
+                             bh.handle, bh.block.offset()           // Dest
                              );
 
         // Add a mapping for the tile, which will be sent to the device in pushMappings().
@@ -137,12 +349,12 @@ void TextureRequestHandler::fillTileRequest( CUstream stream, unsigned int pageI
         {
             m_loader->setPageTableEntry( pageId, true, reinterpret_cast<void*>( bh.block.data ) );
         }
+        latencyRecorder->record( LATENCY_FILL_TILE, REQUEST_HANDLER_TEXTURE, fillStopwatch.elapsed() );
     }
-
-    m_loader->freeTransferBuffer( transferBuffer, stream );
+    return true;
 }
 
-void TextureRequestHandler::fillMipTailRequest( CUstream stream, unsigned int pageId, TileBlockHandle bh )
+bool TextureRequestHandler::fillMipTailRequest( CUstream stream, unsigned int pageId, TileBlockHandle bh )
 {
     SCOPED_NVTX_RANGE_FUNCTION_NAME();
 
@@ -155,9 +367,9 @@ void TextureRequestHandler::fillMipTailRequest( CUstream stream, unsigned int pa
     bool useNewBlock = bh.block.isBad();
     if( useNewBlock )
     {
-        bh = deviceMemoryManager->allocateTileBlock( mipTailSize );
+        bh = allocateTileBlock( stream, mipTailSize );
         if( bh.block.isBad() )
-            return;
+            return false;
     }
 
     // Allocate a transfer buffer.
@@ -165,11 +377,13 @@ void TextureRequestHandler::fillMipTailRequest( CUstream stream, unsigned int pa
     if( transferBuffer.memoryBlock.size == 0 )
     {
         deviceMemoryManager->freeTileBlock( bh.block );
-        return;
+        return true;
     }
 
     // Read the mip tail into the transfer buffer.
-    bool satisfied;
+    LatencyRecorder* latencyRecorder = m_loader->getLatencyRecorder();
+    Stopwatch        readStopwatch;
+    bool             satisfied;
     try
     {
         satisfied = m_texture->readMipTail( reinterpret_cast<char*>( transferBuffer.memoryBlock.ptr ), mipTailSize, stream );
@@ -181,9 +395,12 @@ void TextureRequestHandler::fillMipTailRequest( CUstream stream, unsigned int pa
         throw Exception( ss.str().c_str() );
     }
 
+    latencyRecorder->record( LATENCY_READ_TILE, REQUEST_HANDLER_TEXTURE, readStopwatch.elapsed() );
+
     if( satisfied )
     {
         // Copy data from the transfer buffer to the sparse texture on the device
+        Stopwatch fillStopwatch;
         m_texture->fillMipTail( stream,
                                 reinterpret_cast<char*>( transferBuffer.memoryBlock.ptr ),  // Src buffer
                                 transferBuffer.memoryType, mipTailSize,                     // Src type and size
@@ -196,9 +413,11 @@ void TextureRequestHandler::fillMipTailRequest( CUstream stream, unsigned int pa
         {
             m_loader->setPageTableEntry( pageId, true, reinterpret_cast<void*>( bh.block.data ) );
         }
+        latencyRecorder->record( LATENCY_FILL_TILE, REQUEST_HANDLER_TEXTURE, fillStopwatch.elapsed() );
     }
 
     m_loader->freeTransferBuffer( transferBuffer, stream );
+    return true;
 }
 
 void TextureRequestHandler::unmapTileResource( CUstream stream, unsigned int pageId )
@@ -230,6 +449,34 @@ void TextureRequestHandler::unmapTileResource( CUstream stream, unsigned int pag
     }
 }
 
+unsigned int TextureRequestHandler::getPriority( unsigned int pageId ) const
+{
+    const unsigned int lowestPriority = NUM_REQUEST_PRIORITIES - 1;
+
+    // The tile layout is unknown until the texture is initialized (e.g. when replaying a trace).
+    if( !m_texture || !m_texture->isInitialized() )
+        return lowestPriority;
+
+    // The first page of the range is the mip tail (or the whole texture, if it is dense), which is
+    // class 0.  A texture that is not mipmapped, or whose levels are all tiled, has no mip tail.
+    const TextureSampler& sampler   = m_texture->getSampler();
+    const unsigned int    tileIndex = pageId - m_startPage;
+    if( tileIndex == 0
+        && ( !sampler.desc.isSparseTexture || ( m_texture->isMipmapped() && sampler.mipTailFirstLevel < sampler.desc.numMipLevels ) ) )
+        return 0;
+
+    unsigned int mipLevel;
+    unsigned int tileX;
+    unsigned int tileY;
+    unpackTileIndex( sampler, tileIndex, mipLevel, tileX, tileY );
+    if( mipLevel > sampler.mipTailFirstLevel )
+        return lowestPriority;
+
+    // Coarser levels are more urgent; the level just above the mip tail is class 1.  Tiles are
+    // never class 0, which is reserved for the mip tail.
+    return std::min( std::max( sampler.mipTailFirstLevel - mipLevel, 1u ), lowestPriority );
+}
+
 unsigned int TextureRequestHandler::getTextureTilePageId( unsigned int mipLevel, unsigned int tileX, unsigned int tileY )
 {
     const demandLoading::TextureSampler& sampler = getTexture()->getSampler();
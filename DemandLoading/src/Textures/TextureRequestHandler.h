@@ -33,6 +33,10 @@
 
 #include <atomic>
 
+namespace imageSource {
+struct TileRequest;
+}  // namespace imageSource
+
 namespace demandLoading {
 
 class DemandLoaderImpl;
@@ -54,6 +58,17 @@ class TextureRequestHandler : public RequestHandler
     /// Fill a request for the specified page using the given stream.  
     void fillRequest( CUstream stream, unsigned int pageId ) override;
 
+    /// Fill requests for a run of pages, sharing a single transfer buffer across the tiles.
+    void fillRequests( CUstream stream, const unsigned int* pageIds, unsigned int numPageIds ) override;
+
+    /// Get the priority class of a request for the specified page.  The mip tail is most urgent,
+    /// followed by tiles in order of increasing resolution, since coarse levels cover more texels
+    /// and let rendering converge sooner.
+    unsigned int getPriority( unsigned int pageId ) const override;
+
+    /// Get the type of handler, by which request latencies are recorded.
+    RequestHandlerType getHandlerType( unsigned int /*pageId*/ ) const override { return REQUEST_HANDLER_TEXTURE; }
+
     // Load or reload a page
     void loadPage( CUstream stream, unsigned int pageId, bool reloadIfResident );
 
@@ -70,8 +85,31 @@ class TextureRequestHandler : public RequestHandler
     DemandTextureImpl* m_texture = nullptr;
     DemandLoaderImpl*  m_loader = nullptr;
 
-    void fillTileRequest( CUstream stream, unsigned int pageId, otk::TileBlockHandle bh );
-    void fillMipTailRequest( CUstream stream, unsigned int pageId, otk::TileBlockHandle bh );
+    // Load a page, reading tiles via the given transfer buffer (if non-null) or a newly allocated one.
+    void loadPageBody( CUstream stream, unsigned int pageId, bool reloadIfResident, char* tileBuffer, CUmemorytype tileBufferType );
+
+    // Fill the tiles of a batch of pages, reading them together into slots of the given buffer.
+    void fillTileRequests( CUstream stream, const unsigned int* pageIds, unsigned int numPageIds, char* buffer, CUmemorytype bufferType );
+
+    // Read the given tiles, whose pages are locked, and fill those that are satisfied into the
+    // given newly allocated blocks.
+    void fillTileBatch( CUstream                        stream,
+                        const unsigned int*             pageIds,
+                        const otk::TileBlockHandle*     blocks,
+                        imageSource::TileRequest*       requests,
+                        unsigned int                    numTiles,
+                        CUmemorytype                    bufferType );
+
+    // Lock the page and load it.  Returns false if no tile block could be allocated.
+    bool tryLoadPage( CUstream stream, unsigned int pageId, bool reloadIfResident, char* tileBuffer, CUmemorytype tileBufferType );
+
+    // Allocate a tile block of the given size.  Returns a bad block if the tile pool is exhausted.
+    otk::TileBlockHandle allocateTileBlock( CUstream stream, size_t numBytes );
+
+    // The fill methods return false if no tile block could be allocated.
+    bool fillTileRequest( CUstream stream, unsigned int pageId, otk::TileBlockHandle bh );
+    bool fillTileRequest( CUstream stream, unsigned int pageId, otk::TileBlockHandle bh, char* tileBuffer, CUmemorytype tileBufferType );
+    bool fillMipTailRequest( CUstream stream, unsigned int pageId, otk::TileBlockHandle bh );
 };
 
 }  // namespace demandLoading
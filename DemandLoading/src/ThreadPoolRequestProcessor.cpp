@@ -28,14 +28,29 @@
 
 #include "ThreadPoolRequestProcessor.h"
 
-#include "DemandLoaderImpl.h"
+#include "PageTableManager.h"
 #include "RequestHandler.h"
 #include "TicketImpl.h"
+#include "Util/ContextSaver.h"
+#include "Util/LatencyRecorder.h"
+#include "Util/Stopwatch.h"
+
+#include <algorithm>
+#include <iostream>
 
 namespace demandLoading {
 
-ThreadPoolRequestProcessor::ThreadPoolRequestProcessor( std::shared_ptr<PageTableManager> pageTableManager, const Options& options )
+// Maximum number of requests a worker pops from the queue at once.  Texture tile batches share a
+// single transfer buffer, so this also bounds the size of that allocation.
+const unsigned int MAX_REQUEST_BATCH_SIZE = 16;
+
+ThreadPoolRequestProcessor::ThreadPoolRequestProcessor( std::shared_ptr<PageTableManager> pageTableManager,
+                                                        const Options&                    options,
+                                                        LatencyRecorder*                  latencyRecorder )
     : m_pageTableManager( std::move( pageTableManager ) )
+    , m_executor( options.executor )
+    , m_latencyRecorder( latencyRecorder )
+    , m_maxRequestAge( options.maxRequestAge )
 {
     m_requests.reset( new RequestQueue( options.maxRequestQueueSize ) );
     if( !options.traceFile.empty() )
@@ -47,8 +62,16 @@ ThreadPoolRequestProcessor::ThreadPoolRequestProcessor( std::shared_ptr<PageTabl
 
 void ThreadPoolRequestProcessor::start( unsigned int maxThreads )
 {
+    // An external executor runs tasks that are submitted as requests are added.
+    if( m_executor )
+    {
+        m_numThreads = std::max( 1u, m_executor->getMaxConcurrency() );
+        return;
+    }
+
     if( maxThreads == 0 )
         maxThreads = std::thread::hardware_concurrency();
+    m_numThreads = std::max( 1u, maxThreads );
     m_threads.reserve( maxThreads );
     for( unsigned int i = 0; i < maxThreads; ++i )
     {
@@ -65,23 +88,55 @@ void ThreadPoolRequestProcessor::stop()
     {
         thread.join();
     }
+    m_threads.clear();
+
+    // Wait for any tasks submitted to the executor, which return promptly once the queue is shut down.
+    if( m_executor )
+    {
+        std::unique_lock<std::mutex> lock( m_tasksMutex );
+        m_tasksDone.wait( lock, [this] { return m_numTasks.load() == 0; } );
+    }
 }
 
 void ThreadPoolRequestProcessor::addRequests( CUstream stream, unsigned int id, const unsigned int* pageIds, unsigned int numPageIds )
 {
+    // Determine the priority of each request from its handler, so that the queue can fill
+    // mip tails and coarse levels first.
+    std::vector<unsigned int> priorities( numPageIds );
+    for( unsigned int i = 0; i < numPageIds; ++i )
+    {
+        const RequestHandler* handler = m_pageTableManager->getRequestHandler( pageIds[i] );
+        priorities[i]                 = handler ? std::min( handler->getPriority( pageIds[i] ), NUM_REQUEST_PRIORITIES - 1 ) : 0;
+    }
+
     std::unique_lock<std::mutex> lock( m_ticketsMutex );
     auto it = m_tickets.find( id );
     DEMAND_ASSERT( it != m_tickets.end() );
     Ticket ticket = it->second;
     // We won't be issued this id again, so we can discard it from the map.
     m_tickets.erase( it );
-    m_requests->push( pageIds, numPageIds, ticket );
+    if( m_latencyRecorder )
+        TicketImpl::getImpl( ticket )->markQueued();
+    m_requests->push( pageIds, priorities.data(), numPageIds, ticket );
 
-    // If recording is enabled, write the requests to the trace file.
+    // Track the batch while it has outstanding requests, so that it can be cancelled.
+    std::shared_ptr<TicketImpl>& impl = TicketImpl::getImpl( ticket );
+    if( impl->numTasksRemaining() > 0 )
+        m_batches.push_back( Batch{id, stream, impl} );
+    updateBatches( id );
+    lock.unlock();
+
+    // If recording is enabled, write the requests to the trace file.  The trace file is internally
+    // synchronized, so this is done without the lock.
     if( m_traceFile && numPageIds > 0 )
     {
-        m_traceFile->recordRequests( stream, pageIds, numPageIds );
+        m_traceFile->recordRequests( stream, id, pageIds, numPageIds );
     }
+
+    // Submit tasks to process the requests if there is an executor.  The lock is released first,
+    // in case the executor runs tasks immediately.
+    if( m_executor )
+        submitTasks();
 }
 
 void ThreadPoolRequestProcessor::recordTexture( std::shared_ptr<imageSource::ImageSource> imageSource, const TextureDescriptor& textureDesc )
@@ -92,6 +147,14 @@ void ThreadPoolRequestProcessor::recordTexture( std::shared_ptr<imageSource::Ima
     }
 }
 
+void ThreadPoolRequestProcessor::recordTexturePages( unsigned int textureId, const TextureSampler& sampler )
+{
+    if( m_traceFile )
+    {
+        m_traceFile->recordTexturePages( textureId, sampler );
+    }
+}
+
 void ThreadPoolRequestProcessor::setTicket( unsigned int id, Ticket ticket )
 {
     std::unique_lock<std::mutex> lock( m_ticketsMutex );
@@ -99,34 +162,129 @@ void ThreadPoolRequestProcessor::setTicket( unsigned int id, Ticket ticket )
     m_tickets[id] = ticket;
 }
 
+void ThreadPoolRequestProcessor::updateBatches( unsigned int id )
+{
+    const int maxAge = static_cast<int>( m_maxRequestAge );
+    auto      isDone = [id, maxAge]( const Batch& batch ) {
+        std::shared_ptr<TicketImpl> ticket = batch.ticket.lock();
+        if( !ticket || ticket->numTasksRemaining() == 0 )
+            return true;
+
+        // Launch ids increase monotonically (modulo wraparound), but batches from different streams
+        // can arrive out of order, so the age is a signed difference.
+        if( maxAge > 0 && static_cast<int>( id - batch.id ) > maxAge )
+        {
+            ticket->cancel();
+            return true;
+        }
+        return false;
+    };
+    m_batches.erase( std::remove_if( m_batches.begin(), m_batches.end(), isDone ), m_batches.end() );
+}
+
+void ThreadPoolRequestProcessor::cancelRequests( CUstream stream )
+{
+    std::unique_lock<std::mutex> lock( m_ticketsMutex );
+    for( const Batch& batch : m_batches )
+    {
+        std::shared_ptr<TicketImpl> ticket = batch.ticket.lock();
+        if( ticket && batch.stream == stream )
+            ticket->cancel();
+    }
+    m_batches.erase( std::remove_if( m_batches.begin(), m_batches.end(),
+                                     [stream]( const Batch& batch ) { return batch.stream == stream; } ),
+                     m_batches.end() );
+}
+
+void ThreadPoolRequestProcessor::accumulateStatistics( Statistics& stats ) const
+{
+    stats.numRequestsDropped += m_requests->getNumDropped() + m_requests->getNumEvicted();
+    stats.numRequestsCancelled += m_numCancelled.load( std::memory_order_relaxed );
+}
+
+// Get the number of requests a worker should pop at once: a share of the queued requests, leaving
+// enough for the other workers to stay busy.
+static unsigned int getBatchSize( unsigned int queueSize, unsigned int numWorkers )
+{
+    const unsigned int share = queueSize / numWorkers;
+    return std::max( 1u, std::min( share, MAX_REQUEST_BATCH_SIZE ) );
+}
+
 void ThreadPoolRequestProcessor::worker()
 {
     try
     {
-        PageRequest request;
+        std::vector<PageRequest>  requests( MAX_REQUEST_BATCH_SIZE );
+        std::vector<unsigned int> pageIds( MAX_REQUEST_BATCH_SIZE );
         while( true )
         {
-            // Pop a request from the queue, waiting if necessary until the queue is non-empty or shut down.
-            if( !m_requests->popOrWait( &request ) )
+            // Pop requests from the queue, waiting if necessary until the queue is non-empty or shut down.
+            const unsigned int batchSize   = getBatchSize( m_requests->size(), m_numThreads );
+            const unsigned int numRequests = m_requests->popBatchOrWait( requests.data(), batchSize );
+            if( numRequests == 0 )
                 return;  // Exit thread when queue is shut down.
 
-            // Ask the PageTableManager for the request handler associated with the range of pages in
-            // which the request occurred.
-            RequestHandler* handler = m_pageTableManager->getRequestHandler( request.pageId );
-            DEMAND_ASSERT_MSG( handler != nullptr, "Invalid page requested (no associated handler)" );
+            processRequests( requests.data(), numRequests, pageIds.data() );
+        }
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+#ifndef NDEBUG
+        std::terminate();
+#endif        
+    }
+}
 
-            // Use the CUDA context associated with the stream in the ticket.
-            std::shared_ptr<TicketImpl>& ticket = TicketImpl::getImpl( request.ticket );
-            CUcontext                    context;
-            DEMAND_CUDA_CHECK( cuStreamGetCtx( ticket->getStream(), &context ) );
-            DEMAND_CUDA_CHECK( cuCtxSetCurrent( context ) );
+void ThreadPoolRequestProcessor::submitTasks()
+{
+    // Submit a task per queued request, up to the executor's concurrency.  The fence pairs with
+    // the one in runTask(), so that either a retiring task sees newly pushed requests or we see
+    // that the task has retired.
+    std::atomic_thread_fence( std::memory_order_seq_cst );
+    unsigned int numTasks = m_numTasks.load();
+    while( numTasks < m_numThreads && numTasks < m_requests->size() )
+    {
+        if( m_numTasks.compare_exchange_weak( numTasks, numTasks + 1 ) )
+        {
+            m_executor->submit( [this] { runTask(); } );
+            ++numTasks;
+        }
+    }
+}
 
-            // Process the request.  Page table updates are accumulated in the PagingSystem.
-            handler->fillRequest( ticket->getStream(), request.pageId );
+void ThreadPoolRequestProcessor::runTask()
+{
+    try
+    {
+        std::vector<PageRequest>  requests( MAX_REQUEST_BATCH_SIZE );
+        std::vector<unsigned int> pageIds( MAX_REQUEST_BATCH_SIZE );
+        while( true )
+        {
+            // Process requests until the queue is empty (or shut down), without waiting.
+            while( true )
+            {
+                const unsigned int batchSize   = getBatchSize( m_requests->size(), m_numThreads );
+                const unsigned int numRequests = m_requests->tryPopBatch( requests.data(), batchSize );
+                if( numRequests == 0 )
+                    break;
+                processRequests( requests.data(), numRequests, pageIds.data() );
+            }
 
-            // Notify the associated Ticket that the request has been filled.
-            ticket->notify();
-            ticket.reset();
+            // Retire the task.  Requests pushed while the task was retiring might not have been given
+            // a task of their own, in which case this task resumes.  The fence pairs with the one in
+            // submitTasks().  This is done under the mutex so that stop() cannot return (destroying
+            // this object) until the last task is finished with it.
+            std::unique_lock<std::mutex> lock( m_tasksMutex );
+            unsigned int                 numTasks = m_numTasks.fetch_sub( 1 ) - 1;
+            std::atomic_thread_fence( std::memory_order_seq_cst );
+            if( m_requests->isShutDown() || m_requests->size() == 0 || numTasks >= m_numThreads
+                || !m_numTasks.compare_exchange_strong( numTasks, numTasks + 1 ) )
+            {
+                if( m_numTasks.load() == 0 )
+                    m_tasksDone.notify_all();
+                return;
+            }
         }
     }
     catch( const std::exception& e )
@@ -134,7 +292,96 @@ void ThreadPoolRequestProcessor::worker()
         std::cerr << "Error: " << e.what() << std::endl;
 #ifndef NDEBUG
         std::terminate();
-#endif        
+#endif
+        // Retire the task, so that stop() does not wait for it and submitTasks() can replace it.
+        std::unique_lock<std::mutex> lock( m_tasksMutex );
+        if( m_numTasks.fetch_sub( 1 ) == 1 )
+            m_tasksDone.notify_all();
+    }
+}
+
+void ThreadPoolRequestProcessor::fillRequests( RequestHandler* handler, TicketImpl* ticket, const unsigned int* pageIds, unsigned int numPageIds )
+{
+    // Use the CUDA context associated with the stream in the ticket, which was resolved when its
+    // requests were pushed.  The previous context is restored afterwards, since executor threads
+    // are not owned by the loader.
+    ContextSaver contextSaver;
+    DEMAND_CUDA_CHECK( cuCtxSetCurrent( ticket->getContext() ) );
+
+    // Process the requests.  Page table updates are accumulated in the PagingSystem.
+    if( !m_latencyRecorder )
+    {
+        handler->fillRequests( ticket->getStream(), pageIds, numPageIds );
+        return;
+    }
+
+    const double queueWait = ticket->getTimeSinceQueued();
+    Stopwatch    stopwatch;
+    handler->fillRequests( ticket->getStream(), pageIds, numPageIds );
+
+    // The requests in a run are filled together, so each is attributed an equal share.
+    const double fillTime = stopwatch.elapsed() / numPageIds;
+    for( unsigned int i = 0; i < numPageIds; ++i )
+    {
+        const RequestHandlerType type = handler->getHandlerType( pageIds[i] );
+        m_latencyRecorder->record( LATENCY_QUEUE_WAIT, type, queueWait );
+        m_latencyRecorder->record( LATENCY_FILL_REQUEST, type, fillTime );
+    }
+}
+
+void ThreadPoolRequestProcessor::processRequests( const PageRequest* requests, unsigned int numRequests, unsigned int* pageIds )
+{
+    // Process runs of consecutive requests that share a request handler and a ticket.
+    unsigned int begin = 0;
+    while( begin < numRequests )
+    {
+        // Ask the PageTableManager for the request handler associated with the range of pages in
+        // which the request occurred.
+        RequestHandler* handler = m_pageTableManager->getRequestHandler( requests[begin].pageId );
+        DEMAND_ASSERT_MSG( handler != nullptr, "Invalid page requested (no associated handler)" );
+
+        TicketImpl*  ticket = requests[begin].ticket;
+        unsigned int end    = begin;
+        unsigned int count  = 0;
+        while( end < numRequests && requests[end].ticket == ticket
+               && ( end == begin || m_pageTableManager->getRequestHandler( requests[end].pageId ) == handler ) )
+        {
+            pageIds[count++] = requests[end].pageId;
+            ++end;
+        }
+
+        // Cancelled requests are skipped without doing any I/O, unless a duplicate from a live
+        // ticket was attached to them, since the page is still wanted.  (A duplicate attached
+        // after this check is completed without a fill; its page will be requested again.)
+        unsigned int numToFill = count;
+        if( ticket->isCancelled() )
+        {
+            numToFill = 0;
+            for( unsigned int i = begin; i < end; ++i )
+            {
+                if( m_requests->hasLiveDuplicates( requests[i] ) )
+                    pageIds[numToFill++] = requests[i].pageId;
+            }
+            m_numCancelled.fetch_add( count - numToFill, std::memory_order_relaxed );
+        }
+
+        // A failed fill is reported, and its run is still completed, so that its ticket and those of
+        // attached duplicates are notified, and the pages are no longer pending.  Otherwise later
+        // requests for the pages would be attached to requests that never complete.
+        try
+        {
+            if( numToFill > 0 )
+                fillRequests( handler, ticket, pageIds, numToFill );
+        }
+        catch( const std::exception& e )
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+        }
+
+        // Notify the associated Ticket (and those of any duplicate requests) that the requests
+        // have been filled.  This may release the ticket, so it must not be used afterwards.
+        m_requests->complete( &requests[begin], count );
+        begin = end;
     }
 }
 
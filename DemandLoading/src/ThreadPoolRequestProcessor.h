@@ -28,14 +28,18 @@
 
 #pragma once
 
+#include <OptiXToolkit/DemandLoading/Executor.h>
 #include <OptiXToolkit/DemandLoading/Options.h>
 #include <OptiXToolkit/DemandLoading/RequestProcessor.h>
+#include <OptiXToolkit/DemandLoading/Statistics.h>
 
 #include "RequestQueue.h"
 #include "Util/TraceFile.h"
 
 #include <cuda.h>
 
+#include <atomic>
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -44,20 +48,27 @@
 
 namespace demandLoading {
 
+class LatencyRecorder;
 class PageTableManager;
+class RequestHandler;
+class TicketImpl;
 class TraceFileWriter;
 
 class ThreadPoolRequestProcessor : public RequestProcessor
 {
   public:
     /// Construct request processor, which uses the given PageTableManager to
-    /// find the RequestHandler associated with a range of pages.
-    ThreadPoolRequestProcessor( std::shared_ptr<PageTableManager> pageTableManager, const Options& options );
+    /// find the RequestHandler associated with a range of pages.  If a LatencyRecorder is
+    /// provided, queue wait and fill latencies are recorded.
+    ThreadPoolRequestProcessor( std::shared_ptr<PageTableManager> pageTableManager,
+                                const Options&                    options,
+                                LatencyRecorder*                  latencyRecorder = nullptr );
     ~ThreadPoolRequestProcessor() override = default;
 
     /// Start processing requests using the specified number of threads.  Options supplies
     /// the number of specified threads (if zero, std::thread::hardware_concurrency is used),
-    /// the trace file and the size of the request queue.
+    /// the trace file and the size of the request queue.  If Options supplies an Executor, no
+    /// threads are created; instead tasks are submitted to the executor as requests are added.
     void start( unsigned int maxThreads );
 
     /// Stop processing requests, terminating threads.
@@ -68,18 +79,69 @@ class ThreadPoolRequestProcessor : public RequestProcessor
 
     void recordTexture( std::shared_ptr<imageSource::ImageSource> imageSource, const TextureDescriptor& textureDesc );
 
+    void recordTexturePages( unsigned int textureId, const TextureSampler& sampler );
+
     void setTicket( unsigned int id, Ticket ticket );
 
+    /// Set the scheduling weight of requests from the given stream.  \see RequestQueue::setStreamWeight
+    void setStreamWeight( CUstream stream, unsigned int weight ) { m_requests->setStreamWeight( stream, weight ); }
+
+    /// Cancel the outstanding requests from the given stream.  Requests that have not yet been
+    /// filled are skipped without doing any I/O, and their tickets are notified.
+    void cancelRequests( CUstream stream );
+
+    /// Accumulate request queue statistics (e.g. the numbers of dropped and cancelled requests).
+    void accumulateStatistics( Statistics& stats ) const;
+
+    /// Get the number of requests waiting in the request queue (approximate while requests are processed).
+    unsigned int getQueueSize() const { return m_requests->size(); }
+
 private:
     std::shared_ptr<PageTableManager> m_pageTableManager;
     std::unique_ptr<RequestQueue>     m_requests;
     std::vector<std::thread>          m_threads;
+    std::shared_ptr<Executor>         m_executor;
+    LatencyRecorder*                  m_latencyRecorder{};
     std::unique_ptr<TraceFileWriter>  m_traceFile{};
     std::map<unsigned int, Ticket>    m_tickets;
     std::mutex                        m_ticketsMutex;
+    unsigned int                      m_numThreads = 1;  // Number of worker threads (or executor tasks).
+
+    // Number of tasks submitted to the executor that have not yet retired.
+    std::atomic<unsigned int> m_numTasks{0};
+    std::mutex                m_tasksMutex;
+    std::condition_variable   m_tasksDone;
+
+    // Batches of requests that may still be queued, which are tracked (under m_ticketsMutex) so
+    // that they can be cancelled.  Each batch is tagged with the id of the launch that produced it.
+    struct Batch
+    {
+        unsigned int              id;
+        CUstream                  stream;
+        std::weak_ptr<TicketImpl> ticket;
+    };
+    std::vector<Batch>  m_batches;
+    unsigned int        m_maxRequestAge = 0;
+    std::atomic<size_t> m_numCancelled{0};
 
     // Per-thread worker function.
     void worker();
+
+    // Submit tasks to the executor for the queued requests, up to its concurrency.
+    void submitTasks();
+
+    // Executor task function, which processes requests until the queue is empty.
+    void runTask();
+
+    // Process a batch of requests, using the given array as scratch space for page ids.
+    void processRequests( const PageRequest* requests, unsigned int numRequests, unsigned int* pageIds );
+
+    // Fill a run of requests that share a handler and a ticket, in the context of the ticket's stream.
+    void fillRequests( RequestHandler* handler, TicketImpl* ticket, const unsigned int* pageIds, unsigned int numPageIds );
+
+    // Stop tracking batches that are done, and cancel those older than m_maxRequestAge relative to
+    // the given launch id.  The caller must hold m_ticketsMutex.
+    void updateBatches( unsigned int id );
 };
 
 }  // namespace demandLoading
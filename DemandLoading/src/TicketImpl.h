@@ -35,12 +35,15 @@
 #include <cuda.h>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
 
 namespace demandLoading {
 
-/// A TicketImpl tracks the progress of a number of tasks.
+/// A TicketImpl tracks the progress of a number of tasks.  Completed tasks are counted down
+/// atomically; the mutex is only acquired to wake waiting threads when the last task is done.
 class TicketImpl
 {
   public:
@@ -59,41 +62,49 @@ class TicketImpl
     {
     }
 
-    /// The ticket is updated when the number of tasks are known.
-    void update( unsigned int numTasks )
+    /// The ticket is updated when the number of tasks are known.  If the ticket's own shared
+    /// pointer is provided, the ticket retains it until the last task is done, so that the tasks
+    /// can refer to the ticket by plain pointer (see RequestQueue).
+    void update( unsigned int numTasks, std::shared_ptr<TicketImpl> self = std::shared_ptr<TicketImpl>() )
     {
-        {
-            std::unique_lock<std::mutex> lock( m_mutex );
-            m_numTasksTotal     = numTasks;
-            m_numTasksRemaining = numTasks;
-        }
+        if( numTasks > 0 )
+            m_self = std::move( self );
+        m_numTasksTotal.store( static_cast<int>( numTasks ) );
+        m_numTasksRemaining.store( static_cast<int>( numTasks ) );
+
         // If there are no tasks, notify any threads waiting on the condition variable.
         if( numTasks == 0 )
-            m_isDone.notify_all();
+            wakeWaiters();
     }
 
     /// Get the stream associated with the ticket.
     CUstream getStream() const { return m_stream; }
 
+    /// Set the CUDA context of the ticket's stream.  This is resolved by RequestQueue::push, once
+    /// per ticket, and must precede queuing the ticket's requests.
+    void setContext( CUcontext context ) { m_context = context; }
+
+    /// Get the CUDA context of the ticket's stream, as set by setContext.
+    CUcontext getContext() const { return m_context; }
+
     /// Get the total number of tasks tracked by this ticket.  Returns -1 if the number of tasks is
     /// unknown, which indicates that task processing has not yet started.
-    int numTasksTotal() const { return m_numTasksTotal; }
+    int numTasksTotal() const { return m_numTasksTotal.load(); }
 
     /// Get the number of tasks remaining.  Returns -1 if the number of tasks is unknown, which
     /// indicates that task processing has not yet started.
-    int numTasksRemaining() const
-    {
-        std::unique_lock<std::mutex> lock( m_mutex );
-        return m_numTasksRemaining;
-    }
+    int numTasksRemaining() const { return m_numTasksRemaining.load(); }
 
     /// Wait for the host-side execution of the tasks to finish.  Optionally, if a CUDA event is
     /// provided, it is recorded when the last task is finished, allowing the caller to wait for
     /// device-side execution to finish (e.g. via cuEventSynchronize or cuStreamWaitEvent).
     void wait( CUevent* event = nullptr )
     {
-        std::unique_lock<std::mutex> lock( m_mutex );
-        m_isDone.wait( lock, [this] { return m_numTasksRemaining == 0; } );
+        if( m_numTasksRemaining.load() != 0 )
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_isDone.wait( lock, [this] { return m_numTasksRemaining.load() == 0; } );
+        }
         if( event )
         {
             DEMAND_CUDA_CHECK( cuEventRecord( *event, m_stream ) );
@@ -104,24 +115,66 @@ class TicketImpl
     /// when all the tasks are done.
     void notify( unsigned int tasksDone = 1 )
     {
-        std::unique_lock<std::mutex> lock( m_mutex );
+        const int done      = static_cast<int>( tasksDone );
+        const int remaining = m_numTasksRemaining.fetch_sub( done ) - done;
+        DEMAND_ASSERT( remaining >= 0 );
+        if( remaining == 0 )
+        {
+            // The retained pointer may be the last reference to the ticket, so it is released
+            // only after the waiters have been woken.
+            std::shared_ptr<TicketImpl> self = std::move( m_self );
+            wakeWaiters();
+        }
+    }
+
+    /// Discard tasks that were counted by update() but will not be performed (e.g. requests that
+    /// were dropped because the request queue is full).  They are counted as done.
+    void discard( unsigned int numTasks )
+    {
+        if( numTasks == 0 )
+            return;
+        m_numTasksTotal.fetch_sub( static_cast<int>( numTasks ) );
+        notify( numTasks );
+    }
 
-        // Atomically decrement the number of tasks remaining.
-        DEMAND_ASSERT( m_numTasksRemaining > 0 );
-        m_numTasksRemaining -= tasksDone;
+    /// Record the time at which the tasks were queued, from which queue wait latencies are measured.
+    /// This must precede queuing the tasks, which synchronizes it with the threads that pop them.
+    void markQueued() { m_queueTime = std::chrono::steady_clock::now(); }
 
-        // If there are no tasks remaining, notify any threads waiting on the condition variable.
-        // It's not necessary to acquire the mutex.  Redundant notifications are OK.
-        if( m_numTasksRemaining == 0 )
-            m_isDone.notify_all();
+    /// Get the time in seconds since the tasks were queued.  \see markQueued
+    double getTimeSinceQueued() const
+    {
+        using namespace std::chrono;
+        return duration_cast<duration<double>>( steady_clock::now() - m_queueTime ).count();
     }
 
+    /// Cancel the outstanding tasks.  Tasks that have not yet started are expected to check
+    /// isCancelled() and notify the ticket without doing any work.
+    void cancel() { m_isCancelled.store( true, std::memory_order_relaxed ); }
+
+    /// Check whether the ticket has been cancelled.
+    bool isCancelled() const { return m_isCancelled.load( std::memory_order_relaxed ); }
+
   private:
-    const CUstream          m_stream{};
-    int                     m_numTasksTotal{-1};
-    int                     m_numTasksRemaining{-1};
-    mutable std::mutex      m_mutex;
-    std::condition_variable m_isDone;
+    const CUstream              m_stream{};
+    CUcontext                   m_context{};
+    std::atomic<bool>           m_isCancelled{false};
+    std::atomic<int>            m_numTasksTotal{-1};
+    std::atomic<int>            m_numTasksRemaining{-1};
+    std::shared_ptr<TicketImpl> m_self;
+    std::mutex                  m_mutex;
+    std::condition_variable     m_isDone;
+
+    std::chrono::steady_clock::time_point m_queueTime{};
+
+    // Acquiring the mutex ensures that no waiter is between checking the count and waiting.
+    void wakeWaiters()
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+        }
+        m_isDone.notify_all();
+    }
 };
 
 }  // namespace demandLoading
@@ -0,0 +1,568 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Util/EvictionSimulator.h"
+#include "PagingSystemHostKernels.h"
+#include "Util/Exception.h"
+
+#include <OptiXToolkit/DemandLoading/LRU.h>
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+#include <unordered_map>
+#include <utility>
+
+namespace demandLoading {
+
+namespace {
+
+// Size of a sparse texture tile in device memory.
+const size_t TILE_SIZE = 64 * 1024;
+
+// Policies that respond to each reference in turn derive from ReplacementPolicy, which counts the
+// hits, misses and evictions.
+class ReplacementPolicy : public EvictionPolicy
+{
+  public:
+    explicit ReplacementPolicy( unsigned int capacity )
+        : m_capacity( capacity )
+    {
+    }
+
+    EvictionFrameStats simulateLaunch( unsigned int launchNum, const std::vector<unsigned int>& pageIds ) override
+    {
+        EvictionFrameStats stats{launchNum, 0, 0, 0, 0};
+        for( unsigned int pageId : pageIds )
+        {
+            if( reference( pageId ) )
+            {
+                ++stats.numHits;
+                continue;
+            }
+            ++stats.numMisses;
+            if( m_capacity == 0 )
+                continue;
+            if( m_numResident >= m_capacity )
+            {
+                evict( pageId );
+                ++stats.numEvictions;
+            }
+            else
+            {
+                ++m_numResident;
+            }
+            insert( pageId );
+        }
+        stats.numResident = m_numResident;
+        return stats;
+    }
+
+  protected:
+    // Reference a page, returning true if it is resident.
+    virtual bool reference( unsigned int pageId ) = 0;
+
+    // Evict a resident page to make room for the given page.
+    virtual void evict( unsigned int incomingPageId ) = 0;
+
+    // Make a page resident.
+    virtual void insert( unsigned int pageId ) = 0;
+
+  private:
+    unsigned int m_capacity;
+    unsigned int m_numResident = 0;
+};
+
+// Second chance replacement.  The clock hand sweeps the slots, clearing their reference bits, and
+// replaces the first page that was not referenced since the previous sweep.
+class ClockPolicy : public ReplacementPolicy
+{
+  public:
+    explicit ClockPolicy( unsigned int capacity )
+        : ReplacementPolicy( capacity )
+    {
+    }
+
+    const char* getName() const override { return "CLOCK"; }
+
+  protected:
+    bool reference( unsigned int pageId ) override
+    {
+        auto it = m_slotOfPage.find( pageId );
+        if( it == m_slotOfPage.end() )
+            return false;
+        m_slots[it->second].referenced = true;
+        return true;
+    }
+
+    void evict( unsigned int /*incomingPageId*/ ) override
+    {
+        while( m_slots[m_hand].referenced )
+        {
+            m_slots[m_hand].referenced = false;
+            m_hand                     = ( m_hand + 1 ) % m_slots.size();
+        }
+        m_slotOfPage.erase( m_slots[m_hand].pageId );
+        m_freeSlot = m_hand;
+        m_hand     = ( m_hand + 1 ) % m_slots.size();
+    }
+
+    void insert( unsigned int pageId ) override
+    {
+        if( m_freeSlot == NO_SLOT )
+        {
+            m_freeSlot = m_slots.size();
+            m_slots.push_back( Slot() );
+        }
+        m_slots[m_freeSlot]  = Slot{pageId, true};
+        m_slotOfPage[pageId] = m_freeSlot;
+        m_freeSlot           = NO_SLOT;
+    }
+
+  private:
+    struct Slot
+    {
+        unsigned int pageId;
+        bool         referenced;
+    };
+
+    static const size_t NO_SLOT = ~size_t( 0 );
+
+    std::vector<Slot>                        m_slots;
+    std::unordered_map<unsigned int, size_t> m_slotOfPage;
+    size_t                                   m_hand     = 0;
+    size_t                                   m_freeSlot = NO_SLOT;
+};
+
+// Adaptive replacement cache (Megiddo and Modha, 2003).  Resident pages referenced once (T1) or more
+// than once (T2) are kept in LRU order, along with ghost lists of the pages recently evicted from each
+// (B1 and B2).  A reference to a ghost page adapts the target size of T1.
+class ArcPolicy : public ReplacementPolicy
+{
+  public:
+    explicit ArcPolicy( unsigned int capacity )
+        : ReplacementPolicy( capacity )
+        , m_capacity( capacity )
+    {
+    }
+
+    const char* getName() const override { return "ARC"; }
+
+  protected:
+    bool reference( unsigned int pageId ) override
+    {
+        auto it = m_lists.find( pageId );
+        if( it == m_lists.end() )
+            return false;
+
+        const size_t b1Size = m_pages[B1].size();
+        const size_t b2Size = m_pages[B2].size();
+        switch( it->second )
+        {
+            case T1:
+            case T2:
+                moveToFront( pageId, T2 );
+                return true;
+            case B1:
+                m_target = std::min( m_capacity, m_target + std::max<size_t>( b2Size / b1Size, 1 ) );
+                return false;
+            case B2:
+                m_target -= std::min( m_target, std::max<size_t>( b1Size / b2Size, 1 ) );
+                return false;
+        }
+        return false;
+    }
+
+    void evict( unsigned int incomingPageId ) override
+    {
+        auto it = m_lists.find( incomingPageId );
+        if( it != m_lists.end() )
+        {
+            replace( it->second == B2 );
+        }
+        else if( m_pages[T1].size() + m_pages[B1].size() >= m_capacity )
+        {
+            // L1 (T1 and B1) is full.  Forget the oldest page of B1, or evict the oldest page of T1 without a ghost.
+            if( !m_pages[B1].empty() )
+            {
+                forgetOldest( B1 );
+                replace( false );
+            }
+            else
+            {
+                forgetOldest( T1 );
+            }
+        }
+        else
+        {
+            if( getDirectorySize() >= 2 * m_capacity )
+                forgetOldest( B2 );
+            replace( false );
+        }
+    }
+
+    void insert( unsigned int pageId ) override
+    {
+        // A ghost page is promoted to T2, and a new page goes to T1.
+        auto it = m_lists.find( pageId );
+        if( it != m_lists.end() )
+        {
+            moveToFront( pageId, T2 );
+        }
+        else
+        {
+            m_pages[T1].push_front( pageId );
+            m_lists[pageId]     = T1;
+            m_positions[pageId] = m_pages[T1].begin();
+        }
+    }
+
+  private:
+    enum ListId
+    {
+        T1 = 0,
+        T2,
+        B1,
+        B2
+    };
+
+    size_t                                                              m_capacity;
+    size_t                                                              m_target = 0;  // Target size of T1.
+    std::list<unsigned int>                                             m_pages[4];    // Most recent first.
+    std::unordered_map<unsigned int, ListId>                            m_lists;
+    std::unordered_map<unsigned int, std::list<unsigned int>::iterator> m_positions;
+
+    size_t getDirectorySize() const
+    {
+        return m_pages[T1].size() + m_pages[T2].size() + m_pages[B1].size() + m_pages[B2].size();
+    }
+
+    void moveToFront( unsigned int pageId, ListId list )
+    {
+        auto& position = m_positions[pageId];
+        m_pages[list].splice( m_pages[list].begin(), m_pages[m_lists[pageId]], position );
+        m_lists[pageId] = list;
+        position        = m_pages[list].begin();
+    }
+
+    void forgetOldest( ListId list )
+    {
+        const unsigned int pageId = m_pages[list].back();
+        m_pages[list].pop_back();
+        m_lists.erase( pageId );
+        m_positions.erase( pageId );
+    }
+
+    // Evict the oldest page of T1 or T2 to the corresponding ghost list, keeping T1 near its target size.
+    void replace( bool incomingFromB2 )
+    {
+        const size_t t1Size = m_pages[T1].size();
+        if( t1Size > 0 && ( t1Size > m_target || ( incomingFromB2 && t1Size == m_target ) || m_pages[T2].empty() ) )
+            moveToFront( m_pages[T1].back(), B1 );
+        else
+            moveToFront( m_pages[T2].back(), B2 );
+    }
+};
+
+// Eviction of a resident page chosen at random.  The modulus of the generator is used (rather than a
+// distribution) so that results are reproducible across standard libraries.
+class RandomPolicy : public ReplacementPolicy
+{
+  public:
+    RandomPolicy( unsigned int capacity, unsigned int seed )
+        : ReplacementPolicy( capacity )
+        , m_rng( seed )
+    {
+    }
+
+    const char* getName() const override { return "random"; }
+
+  protected:
+    bool reference( unsigned int pageId ) override { return m_slotOfPage.find( pageId ) != m_slotOfPage.end(); }
+
+    void evict( unsigned int /*incomingPageId*/ ) override
+    {
+        const size_t slot = m_rng() % m_slots.size();
+        m_slotOfPage.erase( m_slots[slot] );
+        m_slotOfPage[m_slots.back()] = slot;
+        m_slots[slot]                = m_slots.back();
+        m_slots.pop_back();
+    }
+
+    void insert( unsigned int pageId ) override
+    {
+        m_slotOfPage[pageId] = m_slots.size();
+        m_slots.push_back( pageId );
+    }
+
+  private:
+    std::mt19937                             m_rng;
+    std::vector<unsigned int>                m_slots;  // Resident pages.
+    std::unordered_map<unsigned int, size_t> m_slotOfPage;
+};
+
+}  // anonymous namespace
+
+std::unique_ptr<EvictionPolicy> createEvictionPolicy( EvictionPolicyType type, const Options& options, unsigned int capacity, unsigned int randomSeed )
+{
+    switch( type )
+    {
+        case EVICTION_THRESHOLD_LRU:
+            return std::unique_ptr<EvictionPolicy>( new ThresholdLruPolicy( options, capacity, randomSeed ) );
+        case EVICTION_CLOCK:
+            return std::unique_ptr<EvictionPolicy>( new ClockPolicy( capacity ) );
+        case EVICTION_ARC:
+            return std::unique_ptr<EvictionPolicy>( new ArcPolicy( capacity ) );
+        case EVICTION_RANDOM:
+            return std::unique_ptr<EvictionPolicy>( new RandomPolicy( capacity, randomSeed ) );
+    }
+    DEMAND_ASSERT_MSG( false, "Unknown eviction policy type" );
+    return std::unique_ptr<EvictionPolicy>();
+}
+
+ThresholdLruPolicy::ThresholdLruPolicy( const Options& options, unsigned int capacity, unsigned int randomSeed )
+    : m_options( options )
+    , m_capacity( capacity )
+    , m_lruThreshold( MIN_LRU_THRESHOLD )
+    , m_rng( randomSeed )
+    , m_referenceBits( ( options.numPages + 31 ) / 32, 0 )
+    , m_residenceBits( ( options.numPages + 31 ) / 32, 0 )
+    , m_lruTable( options.useLruTable ? ( options.numPages + 7 ) / 8 : 0, 0 )
+    , m_requestedPages( options.maxRequestedPages )
+    , m_stalePages( options.maxStalePages, StalePage{0, 0, 0} )
+    , m_arrayLengths( NUM_ARRAY_LENGTHS, 0 )
+    , m_filledPages( options.maxFilledPages )
+    , m_invalidatedPages( options.maxInvalidatedPages )
+    , m_context()
+    , m_pageStates( options.numPages, PAGE_NOT_LOADED )
+{
+    // Page table entries are not simulated, since only tiles are evicted.
+    m_context.pageTable        = DeviceArray<unsigned long long>{nullptr, 0};
+    m_context.maxNumPages      = options.numPages;
+    m_context.referenceBits    = m_referenceBits.data();
+    m_context.residenceBits    = m_residenceBits.data();
+    m_context.lruTable         = options.useLruTable ? m_lruTable.data() : nullptr;
+    m_context.requestedPages   = DeviceArray<unsigned int>{m_requestedPages.data(), options.maxRequestedPages};
+    m_context.stalePages       = DeviceArray<StalePage>{m_stalePages.data(), options.maxStalePages};
+    m_context.arrayLengths     = DeviceArray<unsigned int>{m_arrayLengths.data(), NUM_ARRAY_LENGTHS};
+    m_context.filledPages      = DeviceArray<PageMapping>{m_filledPages.data(), options.maxFilledPages};
+    m_context.invalidatedPages = DeviceArray<unsigned int>{m_invalidatedPages.data(), options.maxInvalidatedPages};
+}
+
+bool ThresholdLruPolicy::allocateTile( EvictionFrameStats& stats )
+{
+    if( m_numAllocated < m_capacity )
+    {
+        ++m_numAllocated;
+        return true;
+    }
+
+    // Memory is full, so start staging stale pages, and free the oldest staged page whose
+    // invalidation has reached the device (see PagingSystem::freeStagedPage).
+    m_evictionActive = true;
+    while( !m_stagedPages.empty() && m_stagedPages.front().launchNum < m_launchNum )
+    {
+        const unsigned int pageId = m_stagedPages.front().pageId;
+        m_stagedPages.pop_front();
+        if( m_pageStates[pageId] == PAGE_STAGED )
+        {
+            m_pageStates[pageId] = PAGE_NOT_LOADED;
+            ++stats.numEvictions;
+            return true;
+        }
+    }
+    return false;
+}
+
+EvictionFrameStats ThresholdLruPolicy::simulateLaunch( unsigned int launchNum, const std::vector<unsigned int>& pageIds )
+{
+    EvictionFrameStats stats{launchNum, 0, 0, 0, 0};
+
+    // The launch references the pages, and the hits are the pages that are resident on the device.
+    for( unsigned int pageId : pageIds )
+    {
+        DEMAND_ASSERT_MSG( pageId < m_options.numPages, "Page id outside of page table range" );
+        m_referenceBits[pageId / 32] |= 1U << ( pageId % 32 );
+        if( m_residenceBits[pageId / 32] & ( 1U << ( pageId % 32 ) ) )
+            ++stats.numHits;
+        else
+            ++stats.numMisses;
+    }
+
+    // Pull the requests and stale pages (see PagingSystem::pullRequests).
+    std::fill( m_arrayLengths.begin(), m_arrayLengths.end(), 0 );
+    ++m_launchNum;
+    hostPullRequests( m_context, m_launchNum, m_lruThreshold, 0, m_options.numPages );
+    const unsigned int numRequestedPages = m_arrayLengths[PAGE_REQUESTS_LENGTH];
+    const unsigned int numStalePages     = m_arrayLengths[STALE_PAGES_LENGTH];
+
+    // Restore staged pages that were requested, and load the others if there is memory for them.
+    unsigned int numFilledPages = 0;
+    for( unsigned int i = 0; i < numRequestedPages; ++i )
+    {
+        const unsigned int pageId = m_requestedPages[i];
+        if( m_pageStates[pageId] == PAGE_STAGED )
+        {
+            m_pageStates[pageId] = PAGE_RESIDENT;
+        }
+        else if( allocateTile( stats ) )
+        {
+            m_pageStates[pageId] = PAGE_RESIDENT;
+        }
+        else
+        {
+            continue;
+        }
+        m_filledPages[numFilledPages++] = PageMapping{pageId, 0, 0};
+    }
+
+    // Sort and stage the stale pages, and update the LRU threshold (see PagingSystem::processRequests).
+    unsigned int numInvalidatedPages = 0;
+    unsigned int medianLruVal        = 0;
+    if( numStalePages > 0 )
+    {
+        if( m_context.lruTable != nullptr )
+        {
+            // A stable sort keeps the results independent of the standard library.
+            std::stable_sort( m_stalePages.begin(), m_stalePages.begin() + numStalePages,
+                              []( StalePage a, StalePage b ) { return a.lruVal < b.lruVal; } );
+            medianLruVal = m_stalePages[numStalePages / 2].lruVal;
+        }
+        else
+        {
+            for( unsigned int i = numStalePages - 1; i > 0; --i )
+                std::swap( m_stalePages[i], m_stalePages[m_rng() % ( i + 1 )] );
+        }
+
+        // Count backwards to stage the oldest pages first
+        if( m_evictionActive )
+        {
+            for( int i = static_cast<int>( numStalePages - 1 ); i >= 0; --i )
+            {
+                if( m_stagedPages.size() >= m_options.maxStagedPages || numInvalidatedPages >= m_options.maxInvalidatedPages )
+                    break;
+                const unsigned int pageId = m_stalePages[i].pageId;
+                if( m_pageStates[pageId] == PAGE_RESIDENT )
+                {
+                    m_pageStates[pageId] = PAGE_STAGED;
+                    m_stagedPages.push_back( StagedPage{pageId, m_launchNum} );
+                    m_invalidatedPages[numInvalidatedPages++] = pageId;
+                }
+            }
+        }
+    }
+    m_lruThreshold = nextLruThreshold( m_lruThreshold, numStalePages, m_options.maxStalePages, medianLruVal );
+
+    // Push the mappings and invalidations, and clear the reference bits (see PagingSystem::pushMappings).
+    hostPushMappings( m_context, static_cast<int>( numFilledPages ) );
+    hostInvalidatePages( m_context, static_cast<int>( numInvalidatedPages ) );
+    std::fill( m_referenceBits.begin(), m_referenceBits.end(), 0 );
+
+    stats.numResident = m_numAllocated;
+    return stats;
+}
+
+std::vector<TraceLaunch> readTraceLaunches( const char* filename, Options& options )
+{
+    TraceFileReader reader( filename );
+    options = reader.readOptions();
+
+    // Version 1 traces have no launch numbers, so each batch is taken to be a launch.  Request
+    // records for the same launch (from different streams) are merged.
+    const bool               numberBatches = reader.getVersion() < 2;
+    unsigned int             batchNum      = 0;
+    std::vector<TraceLaunch> launches;
+    std::vector<TraceRecord> records;
+    for( size_t i = 0; i < reader.getBlocks().size(); ++i )
+    {
+        records.clear();
+        reader.readBlock( i, records );
+        for( const TraceRecord& record : records )
+        {
+            if( record.type != TRACE_RECORD_REQUESTS )
+                continue;
+            const unsigned int launchNum = numberBatches ? batchNum++ : record.launchNum;
+            if( launches.empty() || launches.back().launchNum != launchNum )
+                launches.push_back( TraceLaunch{launchNum, std::vector<unsigned int>()} );
+            std::vector<unsigned int>& pageIds = launches.back().pageIds;
+            std::copy_if( record.pageIds.begin(), record.pageIds.end(), std::back_inserter( pageIds ),
+                          [&options]( unsigned int pageId ) { return pageId >= options.numPageTableEntries; } );
+        }
+    }
+
+    for( TraceLaunch& launch : launches )
+    {
+        std::sort( launch.pageIds.begin(), launch.pageIds.end() );
+        launch.pageIds.erase( std::unique( launch.pageIds.begin(), launch.pageIds.end() ), launch.pageIds.end() );
+    }
+    return launches;
+}
+
+EvictionSimulationResult simulateEviction( EvictionPolicy& policy, const std::vector<TraceLaunch>& launches )
+{
+    EvictionSimulationResult result;
+    result.policyName = policy.getName();
+    for( const TraceLaunch& launch : launches )
+    {
+        const EvictionFrameStats stats = policy.simulateLaunch( launch.launchNum, launch.pageIds );
+        result.numHits += stats.numHits;
+        result.numMisses += stats.numMisses;
+        result.numEvictions += stats.numEvictions;
+        result.frames.push_back( stats );
+    }
+    return result;
+}
+
+std::vector<EvictionSimulationResult> simulateEviction( const char* filename, const EvictionSimulationOptions& options )
+{
+    Options                        traceOptions;
+    const std::vector<TraceLaunch> launches = readTraceLaunches( filename, traceOptions );
+
+    unsigned int capacity = options.capacity;
+    if( capacity == 0 && traceOptions.maxTexMemPerDevice > 0 )
+        capacity = static_cast<unsigned int>( std::max<size_t>( traceOptions.maxTexMemPerDevice / TILE_SIZE, 1 ) );
+    if( capacity == 0 )
+    {
+        std::vector<unsigned int> tiles;
+        for( const TraceLaunch& launch : launches )
+            tiles.insert( tiles.end(), launch.pageIds.begin(), launch.pageIds.end() );
+        std::sort( tiles.begin(), tiles.end() );
+        capacity = static_cast<unsigned int>( std::unique( tiles.begin(), tiles.end() ) - tiles.begin() );
+    }
+
+    std::vector<EvictionSimulationResult> results;
+    for( EvictionPolicyType type : options.policies )
+    {
+        std::unique_ptr<EvictionPolicy> policy = createEvictionPolicy( type, traceOptions, capacity, options.randomSeed );
+        results.push_back( simulateEviction( *policy, launches ) );
+        results.back().capacity = capacity;
+    }
+    return results;
+}
+
+}  // namespace demandLoading
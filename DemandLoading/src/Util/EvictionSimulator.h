@@ -0,0 +1,184 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include "Util/TraceFile.h"
+
+#include <OptiXToolkit/DemandLoading/DeviceContext.h>
+#include <OptiXToolkit/DemandLoading/Options.h>
+
+#include <deque>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace demandLoading {
+
+/// Outcome of simulating one launch under an eviction policy.
+struct EvictionFrameStats
+{
+    unsigned int launchNum;
+    unsigned int numHits;       // Referenced tiles that were resident.
+    unsigned int numMisses;     // Referenced tiles that were not resident.
+    unsigned int numEvictions;  // Resident tiles whose memory was reclaimed for other tiles.
+    unsigned int numResident;   // Tiles occupying memory at the end of the launch.
+};
+
+/// An eviction policy manages a fixed number of tile slots, given the tiles referenced by each launch.
+class EvictionPolicy
+{
+  public:
+    virtual ~EvictionPolicy() {}
+
+    /// Name of the policy, used in reports.
+    virtual const char* getName() const = 0;
+
+    /// Simulate a launch that references the given tile pages, which are distinct and in increasing order.
+    virtual EvictionFrameStats simulateLaunch( unsigned int launchNum, const std::vector<unsigned int>& pageIds ) = 0;
+};
+
+/// Eviction policies provided by the simulator.
+enum EvictionPolicyType
+{
+    EVICTION_THRESHOLD_LRU = 0,  ///< The paging system's policy, simulated with the host paging kernels.
+    EVICTION_CLOCK,              ///< Second chance replacement of tiles referenced since the clock hand passed.
+    EVICTION_ARC,                ///< Adaptive replacement cache, balancing recency against frequency.
+    EVICTION_RANDOM              ///< Eviction of a tile chosen at random.
+};
+
+/// Create an eviction policy with the specified number of tile slots.  The paging parameters of the
+/// threshold-LRU policy (page counts, list sizes and LRU table) are taken from the given options.
+std::unique_ptr<EvictionPolicy> createEvictionPolicy( EvictionPolicyType type, const Options& options, unsigned int capacity, unsigned int randomSeed = 1 );
+
+/// The current policy of the paging system.  Each launch runs the host versions of the paging kernels
+/// over host copies of the device bit arrays and LRU table.  The requested pages are loaded, restoring
+/// staged pages where possible.  The stale pages are staged, and the LRU threshold is updated, as in
+/// PagingSystem::processRequests.  Staging starts once tile memory is full, and staged pages are freed
+/// (and counted as evictions) as new tiles need their memory, from the launch after they were staged.
+/// Requests that cannot be satisfied for lack of memory are dropped, and are requested again later.
+class ThresholdLruPolicy : public EvictionPolicy
+{
+  public:
+    ThresholdLruPolicy( const Options& options, unsigned int capacity, unsigned int randomSeed = 1 );
+
+    const char* getName() const override { return "threshold-LRU"; }
+
+    EvictionFrameStats simulateLaunch( unsigned int launchNum, const std::vector<unsigned int>& pageIds ) override;
+
+    /// Returns the current LRU threshold.
+    unsigned int getLruThreshold() const { return m_lruThreshold; }
+
+  private:
+    enum PageState : unsigned char
+    {
+        PAGE_NOT_LOADED = 0,
+        PAGE_RESIDENT,
+        PAGE_STAGED
+    };
+
+    struct StagedPage
+    {
+        unsigned int pageId;
+        unsigned int launchNum;  // Simulated launch in which the page was staged.
+    };
+
+    Options      m_options;
+    unsigned int m_capacity;
+    unsigned int m_numAllocated = 0;  // Tiles that are resident or staged.
+    unsigned int m_lruThreshold;
+    unsigned int m_launchNum      = 0;
+    bool         m_evictionActive = false;
+    std::mt19937 m_rng;  // Shuffles stale pages when there is no LRU table.
+
+    // Host copies of the device arrays, and a DeviceContext that refers to them.
+    std::vector<unsigned int> m_referenceBits;
+    std::vector<unsigned int> m_residenceBits;
+    std::vector<unsigned int> m_lruTable;
+    std::vector<unsigned int> m_requestedPages;
+    std::vector<StalePage>    m_stalePages;
+    std::vector<unsigned int> m_arrayLengths;
+    std::vector<PageMapping>  m_filledPages;
+    std::vector<unsigned int> m_invalidatedPages;
+    DeviceContext             m_context;
+
+    std::vector<PageState> m_pageStates;
+    std::deque<StagedPage> m_stagedPages;  // Oldest first.  Restored pages are skipped when freed.
+
+    // Allocate memory for a tile, freeing a staged page if memory is full.  Returns false if there is none.
+    bool allocateTile( EvictionFrameStats& stats );
+};
+
+/// Request records of a trace, grouped by launch.
+struct TraceLaunch
+{
+    unsigned int              launchNum;
+    std::vector<unsigned int> pageIds;  // Distinct tile pages, in increasing order.
+};
+
+/// Results of simulating a trace under one eviction policy.
+struct EvictionSimulationResult
+{
+    std::string                     policyName;
+    unsigned int                    capacity = 0;  // Number of tile slots.
+    std::vector<EvictionFrameStats> frames;
+    unsigned long long              numHits      = 0;
+    unsigned long long              numMisses    = 0;
+    unsigned long long              numEvictions = 0;
+
+    double getHitRate() const { return numHits + numMisses ? static_cast<double>( numHits ) / ( numHits + numMisses ) : 0.0; }
+};
+
+/// Parameters of an eviction simulation.  \see simulateEviction
+struct EvictionSimulationOptions
+{
+    /// Number of tile slots.  If zero, the traced maxTexMemPerDevice determines the number of slots, or
+    /// if that is unlimited, the number of distinct tiles requested, so that nothing is evicted.
+    unsigned int capacity = 0;
+
+    /// Policies to simulate.
+    std::vector<EvictionPolicyType> policies{EVICTION_THRESHOLD_LRU, EVICTION_CLOCK, EVICTION_ARC, EVICTION_RANDOM};
+
+    /// Seed for the random eviction policy.
+    unsigned int randomSeed = 1;
+};
+
+/// Group the tile requests of a trace by launch.  Pages below options.numPageTableEntries (samplers,
+/// base colors and resources) are skipped.  The request batches of a version 1 trace are taken to be
+/// separate launches.  Also returns the traced options.  Throws an exception on error.
+std::vector<TraceLaunch> readTraceLaunches( const char* filename, Options& options );
+
+/// Simulate the given launches under a policy.  A trace records requests for pages that were not
+/// resident in the recorded run, not every access, so each launch references the tiles it requested.
+EvictionSimulationResult simulateEviction( EvictionPolicy& policy, const std::vector<TraceLaunch>& launches );
+
+/// Simulate the tile requests of a trace file under each of the specified policies.  Throws an exception on error.
+std::vector<EvictionSimulationResult> simulateEviction( const char* filename, const EvictionSimulationOptions& options );
+
+}  // namespace demandLoading
@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Util/LatencyRecorder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace demandLoading {
+
+namespace {
+
+std::atomic<unsigned long long> g_nextRecorderId( 1 );
+
+// Each thread caches the shards it last used, tagged with the ids of the recorders that own them,
+// so that threads shared by several recorders (e.g. one per demand loader) do not keep taking a
+// recorder's lock.  Slots are replaced round-robin.
+const unsigned int MAX_CACHED_SHARDS = 8;
+
+struct ShardCache
+{
+    unsigned long long recorderId;
+    void*              shard;
+};
+thread_local ShardCache   t_shardCache[MAX_CACHED_SHARDS] = {};
+thread_local unsigned int t_nextShardCacheSlot            = 0;
+
+}  // anonymous namespace
+
+LatencyRecorder::Shard::Shard()
+{
+    for( Histogram( &phaseHistograms )[NUM_REQUEST_HANDLER_TYPES] : histograms )
+    {
+        for( Histogram& histogram : phaseHistograms )
+        {
+            for( std::atomic<unsigned long long>& count : histogram.counts )
+                count.store( 0, std::memory_order_relaxed );
+            histogram.numSamples.store( 0, std::memory_order_relaxed );
+            histogram.totalNanoseconds.store( 0, std::memory_order_relaxed );
+            histogram.maxNanoseconds.store( 0, std::memory_order_relaxed );
+        }
+    }
+}
+
+LatencyRecorder::LatencyRecorder()
+    : m_id( g_nextRecorderId.fetch_add( 1 ) )
+{
+}
+
+LatencyRecorder::Shard& LatencyRecorder::getShard()
+{
+    for( const ShardCache& entry : t_shardCache )
+    {
+        if( entry.recorderId == m_id )
+            return *static_cast<Shard*>( entry.shard );
+    }
+
+    std::unique_lock<std::mutex> lock( m_mutex );
+    std::unique_ptr<Shard>&      shard = m_shards[std::this_thread::get_id()];
+    if( !shard )
+        shard.reset( new Shard );
+    t_shardCache[t_nextShardCacheSlot] = ShardCache{m_id, shard.get()};
+    t_nextShardCacheSlot               = ( t_nextShardCacheSlot + 1 ) % MAX_CACHED_SHARDS;
+    return *shard;
+}
+
+void LatencyRecorder::record( LatencyPhase phase, RequestHandlerType type, double seconds, unsigned int count )
+{
+    if( count == 0 )
+        return;
+    seconds                               = std::max( seconds, 0.0 );
+    const unsigned long long microseconds = static_cast<unsigned long long>( seconds * 1.0e6 );
+    const unsigned long long nanoseconds  = static_cast<unsigned long long>( std::llround( seconds * 1.0e9 ) );
+    Histogram&               histogram    = getShard().histograms[phase][type];
+
+    // Only the owning thread increments a shard, so relaxed updates suffice.
+    histogram.counts[LatencyHistogram::getBucketIndex( microseconds )].fetch_add( count, std::memory_order_relaxed );
+    histogram.numSamples.fetch_add( count, std::memory_order_relaxed );
+    histogram.totalNanoseconds.fetch_add( nanoseconds * count, std::memory_order_relaxed );
+
+    // The maximum is also cleared by getStatistics(), so it is updated with a compare-and-swap.
+    unsigned long long maxNanoseconds = histogram.maxNanoseconds.load( std::memory_order_relaxed );
+    while( nanoseconds > maxNanoseconds
+           && !histogram.maxNanoseconds.compare_exchange_weak( maxNanoseconds, nanoseconds, std::memory_order_relaxed ) )
+    {
+    }
+}
+
+LatencyStatistics LatencyRecorder::getStatistics( bool reset )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+
+    // Sum the shards.  The maximum is not cumulative, so it is taken (and optionally cleared) directly.
+    LatencyStatistics totals{};
+    for( const auto& entry : m_shards )
+    {
+        for( unsigned int phase = 0; phase < NUM_LATENCY_PHASES; ++phase )
+        {
+            for( unsigned int type = 0; type < NUM_REQUEST_HANDLER_TYPES; ++type )
+            {
+                Histogram&        histogram = entry.second->histograms[phase][type];
+                LatencyHistogram& total     = totals.histograms[phase][type];
+                for( unsigned int i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i )
+                    total.counts[i] += histogram.counts[i].load( std::memory_order_relaxed );
+                total.numSamples += histogram.numSamples.load( std::memory_order_relaxed );
+                total.totalTime += histogram.totalNanoseconds.load( std::memory_order_relaxed ) * 1.0e-9;
+
+                const unsigned long long maxNanoseconds =
+                    reset ? histogram.maxNanoseconds.exchange( 0, std::memory_order_relaxed ) :
+                            histogram.maxNanoseconds.load( std::memory_order_relaxed );
+                total.maxTime = std::max( total.maxTime, maxNanoseconds * 1.0e-9 );
+            }
+        }
+    }
+
+    // Report the totals relative to the baseline.
+    LatencyStatistics result = totals;
+    for( unsigned int phase = 0; phase < NUM_LATENCY_PHASES; ++phase )
+    {
+        for( unsigned int type = 0; type < NUM_REQUEST_HANDLER_TYPES; ++type )
+        {
+            LatencyHistogram&       histogram = result.histograms[phase][type];
+            const LatencyHistogram& baseline  = m_baseline.histograms[phase][type];
+            for( unsigned int i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i )
+                histogram.counts[i] -= baseline.counts[i];
+            histogram.numSamples -= baseline.numSamples;
+            histogram.totalTime = std::max( 0.0, histogram.totalTime - baseline.totalTime );
+        }
+    }
+
+    if( reset )
+        m_baseline = totals;
+    return result;
+}
+
+}  // namespace demandLoading
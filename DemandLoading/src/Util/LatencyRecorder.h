@@ -0,0 +1,87 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <OptiXToolkit/DemandLoading/LatencyStatistics.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace demandLoading {
+
+/// LatencyRecorder accumulates latency histograms for the phases of the demand loading pipeline.
+/// Recording is intended for hot paths: each thread records into its own shard of relaxed atomic
+/// counters, which is found via a small thread-local cache.  Recording takes a lock only for the
+/// first sample from a given thread, or if the thread has since recorded into more recorders than
+/// the cache holds.  getStatistics() sums the shards.
+class LatencyRecorder
+{
+  public:
+    /// Construct LatencyRecorder.
+    LatencyRecorder();
+
+    /// Record the given latency (in seconds) for the specified phase and request handler type.
+    /// The count allows a batch of requests that shared the latency to be recorded at once.
+    void record( LatencyPhase phase, RequestHandlerType type, double seconds, unsigned int count = 1 );
+
+    /// Get the latency histograms recorded since construction or since the last reset.  If reset is
+    /// true, the histograms are subsequently reported relative to the current values.  Samples
+    /// recorded concurrently with a reset are attributed to one side or the other.
+    LatencyStatistics getStatistics( bool reset );
+
+  private:
+    struct Histogram
+    {
+        std::atomic<unsigned long long> counts[LatencyHistogram::NUM_BUCKETS];
+        std::atomic<unsigned long long> numSamples;
+        std::atomic<unsigned long long> totalNanoseconds;
+        std::atomic<unsigned long long> maxNanoseconds;
+    };
+
+    struct Shard
+    {
+        Histogram histograms[NUM_LATENCY_PHASES][NUM_REQUEST_HANDLER_TYPES];
+        Shard();
+    };
+
+    // Recorders are identified by a unique id (rather than their address) in the thread-local
+    // shard cache, so a stale cache entry can never match a new recorder.
+    const unsigned long long m_id;
+
+    std::mutex                                        m_mutex;
+    std::map<std::thread::id, std::unique_ptr<Shard>> m_shards;
+    LatencyStatistics                                 m_baseline{};
+
+    Shard& getShard();
+};
+
+}  // namespace demandLoading
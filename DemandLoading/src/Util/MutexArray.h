@@ -30,47 +30,83 @@
 
 #include "Util/Exception.h"
 
+#include <atomic>
 #include <condition_variable>
+#include <memory>
 #include <mutex>
-#include <vector>
 
 namespace demandLoading {
 
 /// MutexArray is a space-efficient way to emulate a large number of mutexes.  It's used to provide
 /// mutual exclusion for thousands of tiles per texture, which is necessary because multiple streams
 /// might race to fill a tile, but concurrent memory mapping operations are not permitted by CUDA.
-/// The implementation uses a single mutex to guard a bit vector that indicates which items are
-/// currently locked.  When a thread attempts to lock an item that is already locked, it is
-/// suspended by waiting on a condition variable, which is notified when the item is unlocked.
-/// This is a performance compromise, since all threads are woken when any item is unlocked.
+/// The implementation keeps one lock bit per item in an array of atomic words, so an uncontended
+/// lock or unlock is a single atomic operation.  When a thread attempts to lock an item that is
+/// already locked, it waits on a condition variable belonging to one of a small number of stripes,
+/// selected by hashing the item index.  Unlocking an item only wakes threads waiting in its stripe,
+/// and only when there are any.
 class MutexArray
 {
   public:
     /// Construct a MutexArray of the specified size.
     MutexArray( unsigned int size )
-        : m_excluded( size, false )
+        : m_size( size )
+        , m_words( new std::atomic<unsigned int>[( size + BITS_PER_WORD - 1 ) / BITS_PER_WORD] )
     {
+        for( unsigned int i = 0; i < ( size + BITS_PER_WORD - 1 ) / BITS_PER_WORD; ++i )
+            m_words[i].store( 0, std::memory_order_relaxed );
+
+        // Use a power of two number of stripes, no more than the number of items.
+        while( m_numStripes < MAX_STRIPES && m_numStripes < size )
+            m_numStripes *= 2;
+        m_stripes.reset( new Stripe[m_numStripes] );
     }
 
     /// Lock the item represented by the specified index.
     void lock( unsigned int index )
     {
-        DEMAND_ASSERT( index < m_excluded.size() );
-        std::unique_lock<std::mutex> lock( m_mutex );
-        m_condition.wait( lock, [this, index] { return !m_excluded[index]; } );
-        m_excluded[index] = true;
+        DEMAND_ASSERT( index < m_size );
+        if( tryLock( index ) )
+            return;
+
+        // Slow path: register as a waiter in the item's stripe, then retry under the stripe mutex.
+        // The waiter count is incremented before retrying, which pairs with the check in unlock()
+        // to avoid lost wakeups.
+        Stripe&                      stripe = getStripe( index );
+        std::unique_lock<std::mutex> lock( stripe.mutex );
+        stripe.numWaiters.fetch_add( 1 );
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        stripe.condition.wait( lock, [this, index] { return tryLock( index ); } );
+        stripe.numWaiters.fetch_sub( 1 );
+    }
+
+    /// Lock the item represented by the specified index if it is not already locked.  Returns true
+    /// if the lock was acquired.
+    bool tryLock( unsigned int index )
+    {
+        const unsigned int bit = 1u << ( index % BITS_PER_WORD );
+        return ( m_words[index / BITS_PER_WORD].fetch_or( bit, std::memory_order_acquire ) & bit ) == 0;
     }
 
     /// Unlock the item represented by the specified index.
     void unlock( unsigned int index )
     {
-        DEMAND_ASSERT( index < m_excluded.size() );
+        DEMAND_ASSERT( index < m_size );
+        const unsigned int bit  = 1u << ( index % BITS_PER_WORD );
+        const unsigned int prev = m_words[index / BITS_PER_WORD].fetch_and( ~bit, std::memory_order_release );
+        DEMAND_ASSERT( prev & bit );
+
+        // Wake threads waiting in this item's stripe, if any.  Acquiring the stripe mutex ensures
+        // that a waiter is not between its retry and its wait.
+        std::atomic_thread_fence( std::memory_order_seq_cst );
+        Stripe& stripe = getStripe( index );
+        if( stripe.numWaiters.load() > 0 )
         {
-            std::unique_lock<std::mutex> lock( m_mutex );
-            DEMAND_ASSERT( m_excluded[index] );
-            m_excluded[index] = false;
+            {
+                std::unique_lock<std::mutex> lock( stripe.mutex );
+            }
+            stripe.condition.notify_all();
         }
-        m_condition.notify_all();
     }
 
     /// Not copyable.
@@ -80,9 +116,22 @@ class MutexArray
     MutexArray& operator=( const MutexArray& ) = delete;
 
   private:
-    std::mutex              m_mutex;
-    std::condition_variable m_condition;
-    std::vector<bool>       m_excluded;
+    static const unsigned int BITS_PER_WORD = 32;
+    static const unsigned int MAX_STRIPES   = 32;
+
+    struct Stripe
+    {
+        std::mutex                mutex;
+        std::condition_variable   condition;
+        std::atomic<unsigned int> numWaiters{0};
+    };
+
+    unsigned int                                 m_size;
+    std::unique_ptr<std::atomic<unsigned int>[]> m_words;  // One lock bit per item.
+    unsigned int                                 m_numStripes = 1;
+    std::unique_ptr<Stripe[]>                    m_stripes;
+
+    Stripe& getStripe( unsigned int index ) { return m_stripes[index & ( m_numStripes - 1 )]; }
 };
 
 
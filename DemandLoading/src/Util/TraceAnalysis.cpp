@@ -0,0 +1,355 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Util/TraceAnalysis.h"
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <unordered_map>
+#include <utility>
+
+namespace demandLoading {
+
+namespace {
+
+// Binary indexed tree over request positions, used to count the distinct tiles requested between
+// two requests in O(log n) time.
+class FenwickTree
+{
+  public:
+    explicit FenwickTree( size_t size )
+        : m_tree( size + 1, 0 )
+    {
+    }
+
+    void add( size_t index, int delta )
+    {
+        for( ++index; index < m_tree.size(); index += index & ( ~index + 1 ) )
+            m_tree[index] += delta;
+    }
+
+    // Sum of the values at indices [0, end).
+    int prefixSum( size_t end ) const
+    {
+        int sum = 0;
+        for( ; end > 0; end -= end & ( ~end + 1 ) )
+            sum += m_tree[end];
+        return sum;
+    }
+
+  private:
+    std::vector<int> m_tree;
+};
+
+// Index of the power-of-two bucket that counts the given reuse distance.
+unsigned int getReuseDistanceBucket( unsigned int distance )
+{
+    unsigned int bucket = 0;
+    while( ( static_cast<unsigned long long>( distance ) + 1 ) >> ( bucket + 1 ) )
+        ++bucket;
+    return bucket;
+}
+
+// Count the misses of Belady's optimal policy, given the position of the next request for the
+// tile of each request (or the number of requests if there is none).
+unsigned long long simulateOptimal( const std::vector<unsigned int>& tiles, const std::vector<size_t>& nextUse, unsigned int capacity )
+{
+    // Resident tiles, ordered by their next use.
+    std::set<std::pair<size_t, unsigned int>> resident;
+    unsigned long long                        misses = 0;
+    for( size_t i = 0; i < tiles.size(); ++i )
+    {
+        // A resident tile is keyed by the position of this request.
+        auto it = resident.find( std::make_pair( i, tiles[i] ) );
+        if( it != resident.end() )
+        {
+            resident.erase( it );
+        }
+        else
+        {
+            ++misses;
+            if( resident.size() >= capacity )
+                resident.erase( std::prev( resident.end() ) );
+        }
+        resident.insert( std::make_pair( nextUse[i], tiles[i] ) );
+    }
+    return misses;
+}
+
+// Count the misses of random eviction.  The modulus of the generator is used (rather than a
+// distribution) so that results are reproducible across standard libraries.
+unsigned long long simulateRandom( const std::vector<unsigned int>& tiles, unsigned int numTiles, unsigned int capacity, unsigned int seed )
+{
+    const unsigned int        NOT_RESIDENT = ~0U;
+    std::vector<unsigned int> slots;  // Resident tiles.
+    std::vector<unsigned int> slotOfTile( numTiles, NOT_RESIDENT );
+    std::mt19937              rng( seed );
+    unsigned long long        misses = 0;
+    for( unsigned int tile : tiles )
+    {
+        if( slotOfTile[tile] != NOT_RESIDENT )
+            continue;
+        ++misses;
+        if( slots.size() < capacity )
+        {
+            slotOfTile[tile] = static_cast<unsigned int>( slots.size() );
+            slots.push_back( tile );
+        }
+        else
+        {
+            const unsigned int slot = static_cast<unsigned int>( rng() % slots.size() );
+            slotOfTile[slots[slot]] = NOT_RESIDENT;
+            slotOfTile[tile]        = slot;
+            slots[slot]             = tile;
+        }
+    }
+    return misses;
+}
+
+bool hasMoreRequests( const TextureUsage& a, const TextureUsage& b )
+{
+    if( a.numRequests != b.numRequests )
+        return a.numRequests > b.numRequests;
+    return a.textureId != b.textureId ? a.textureId < b.textureId : a.mipLevel < b.mipLevel;
+}
+
+template <typename Key>
+std::vector<TextureUsage> getHottest( const std::map<Key, TextureUsage>& usages, unsigned int numHottest )
+{
+    std::vector<TextureUsage> result;
+    for( const auto& usage : usages )
+        result.push_back( usage.second );
+    std::sort( result.begin(), result.end(), hasMoreRequests );
+    if( result.size() > numHottest )
+        result.resize( numHottest );
+    return result;
+}
+
+}  // anonymous namespace
+
+TraceAnalyzer::TraceAnalyzer( const Options& options )
+    : m_firstTilePage( options.numPageTableEntries )
+{
+}
+
+void TraceAnalyzer::addRecord( const TraceRecord& record )
+{
+    if( record.type == TRACE_RECORD_TEXTURE_PAGES )
+    {
+        m_textures[record.startPage] = TexturePages{record.textureId, record.numPages, record.mipLevelStarts};
+    }
+    else if( record.type == TRACE_RECORD_REQUESTS )
+    {
+        for( unsigned int pageId : record.pageIds )
+        {
+            if( pageId < m_firstTilePage )
+            {
+                ++m_numOtherRequests;
+                continue;
+            }
+            m_requests.push_back( pageId );
+            m_launches.push_back( record.launchNum );
+        }
+    }
+}
+
+TraceAnalysis TraceAnalyzer::analyze( const TraceAnalysisOptions& options ) const
+{
+    TraceAnalysis analysis;
+    analysis.numRequests      = m_requests.size();
+    analysis.numOtherRequests = m_numOtherRequests;
+
+    // Number the distinct tiles densely, in order of their first request.
+    std::vector<unsigned int>                      tiles( m_requests.size() );
+    std::vector<unsigned int>                      tilePages;
+    std::unordered_map<unsigned int, unsigned int> tileOfPage;
+    for( size_t i = 0; i < m_requests.size(); ++i )
+    {
+        auto inserted = tileOfPage.insert( std::make_pair( m_requests[i], static_cast<unsigned int>( tilePages.size() ) ) );
+        if( inserted.second )
+            tilePages.push_back( m_requests[i] );
+        tiles[i] = inserted.first->second;
+    }
+    const unsigned int numTiles = static_cast<unsigned int>( tilePages.size() );
+    analysis.numTiles           = numTiles;
+
+    // The working set of each launch is its number of distinct (launch, tile) pairs.
+    std::vector<unsigned long long> launchTiles( tiles.size() );
+    for( size_t i = 0; i < tiles.size(); ++i )
+        launchTiles[i] = ( static_cast<unsigned long long>( m_launches[i] ) << 32 ) | tiles[i];
+    std::sort( launchTiles.begin(), launchTiles.end() );
+    launchTiles.erase( std::unique( launchTiles.begin(), launchTiles.end() ), launchTiles.end() );
+    for( size_t i = 0; i < launchTiles.size(); ++i )
+    {
+        if( i == 0 || ( launchTiles[i] >> 32 ) != ( launchTiles[i - 1] >> 32 ) )
+            analysis.workingSets.push_back( 0 );
+        ++analysis.workingSets.back();
+    }
+    analysis.numLaunches = static_cast<unsigned int>( analysis.workingSets.size() );
+
+    // Compute reuse distances.  The tree marks the position of the latest request for each tile,
+    // so the number of marks between two requests for a tile is the number of distinct tiles
+    // requested in between.  A tile is an LRU hit if its reuse distance is less than the capacity.
+    const unsigned int              NONE = ~0U;
+    std::vector<unsigned int>       lastRequest( numTiles, NONE );
+    std::vector<unsigned long long> distanceCounts( numTiles + 1, 0 );
+    FenwickTree                     marks( tiles.size() );
+    for( size_t i = 0; i < tiles.size(); ++i )
+    {
+        const unsigned int last = lastRequest[tiles[i]];
+        if( last != NONE )
+        {
+            const unsigned int distance = static_cast<unsigned int>( marks.prefixSum( i ) - marks.prefixSum( last + 1 ) );
+            const unsigned int bucket   = getReuseDistanceBucket( distance );
+            if( bucket >= analysis.reuseDistances.size() )
+                analysis.reuseDistances.resize( bucket + 1, 0 );
+            ++analysis.reuseDistances[bucket];
+            ++distanceCounts[distance];
+            marks.add( last, -1 );
+        }
+        marks.add( i, 1 );
+        lastRequest[tiles[i]] = static_cast<unsigned int>( i );
+    }
+
+    // Find the position of the next request for each tile, for the optimal policy.
+    std::vector<size_t> nextUse( tiles.size() );
+    {
+        std::vector<size_t> nextRequest( numTiles, tiles.size() );
+        for( size_t i = tiles.size(); i-- > 0; )
+        {
+            nextUse[i]            = nextRequest[tiles[i]];
+            nextRequest[tiles[i]] = i;
+        }
+    }
+
+    // Compute the miss curves.  The first request for each tile is always a miss.
+    std::vector<unsigned int> capacities = options.capacities;
+    if( capacities.empty() && numTiles > 0 )
+    {
+        for( unsigned int capacity = 1; capacity < numTiles; capacity *= 2 )
+            capacities.push_back( capacity );
+        capacities.push_back( numTiles );
+    }
+    std::vector<unsigned long long> lruMisses( numTiles + 1, 0 );  // LRU misses for capacities up to numTiles.
+    lruMisses[numTiles] = numTiles;
+    for( unsigned int capacity = numTiles; capacity-- > 0; )
+        lruMisses[capacity] = lruMisses[capacity + 1] + distanceCounts[capacity];
+    for( unsigned int capacity : capacities )
+    {
+        MissCurvePoint point{capacity, 0, 0, 0};
+        if( capacity == 0 )
+        {
+            point.optimalMisses = point.lruMisses = point.randomMisses = tiles.size();
+        }
+        else if( capacity >= numTiles )
+        {
+            point.optimalMisses = point.lruMisses = point.randomMisses = numTiles;
+        }
+        else
+        {
+            point.optimalMisses = simulateOptimal( tiles, nextUse, capacity );
+            point.lruMisses     = lruMisses[capacity];
+            point.randomMisses  = simulateRandom( tiles, numTiles, capacity, options.randomSeed );
+        }
+        analysis.missCurve.push_back( point );
+    }
+
+    rankTextures( tiles, tilePages, options.numHottest, analysis );
+    return analysis;
+}
+
+void TraceAnalyzer::rankTextures( const std::vector<unsigned int>& tiles,
+                                  const std::vector<unsigned int>& tilePages,
+                                  unsigned int                     numHottest,
+                                  TraceAnalysis&                   analysis ) const
+{
+    if( m_textures.empty() )
+        return;
+
+    std::map<unsigned int, TextureUsage>                  textures;
+    std::map<std::pair<unsigned int, int>, TextureUsage> mipLevels;
+    std::vector<bool>                                     seen( tilePages.size(), false );
+    for( unsigned int tile : tiles )
+    {
+        // Find the texture whose pages contain the tile, if any.
+        const unsigned int pageId = tilePages[tile];
+        auto               it     = m_textures.upper_bound( pageId );
+        if( it == m_textures.begin() )
+            continue;
+        --it;
+        const unsigned int offset = pageId - it->first;
+        if( offset >= it->second.numPages )
+            continue;
+
+        // Mip levels are laid out from the mip tail (at offset zero) to the finest level.
+        const TexturePages& pages    = it->second;
+        int                 mipLevel = 0;
+        while( mipLevel + 1 < static_cast<int>( pages.mipLevelStarts.size() ) && offset < pages.mipLevelStarts[mipLevel] )
+            ++mipLevel;
+
+        const unsigned int newTile = seen[tile] ? 0 : 1;
+        seen[tile]                 = true;
+
+        TextureUsage& texture = textures.insert( std::make_pair( pages.textureId, TextureUsage{pages.textureId, -1, 0, 0} ) ).first->second;
+        texture.numRequests += 1;
+        texture.numTiles += newTile;
+
+        const std::pair<unsigned int, int> key( pages.textureId, mipLevel );
+        TextureUsage& level = mipLevels.insert( std::make_pair( key, TextureUsage{pages.textureId, mipLevel, 0, 0} ) ).first->second;
+        level.numRequests += 1;
+        level.numTiles += newTile;
+    }
+    analysis.hottestTextures  = getHottest( textures, numHottest );
+    analysis.hottestMipLevels = getHottest( mipLevels, numHottest );
+}
+
+TraceAnalysis analyzeTraceFile( const char* filename, const TraceAnalysisOptions& options )
+{
+    TraceFileReader reader( filename );
+    TraceAnalyzer   analyzer( reader.readOptions() );
+
+    // Version 1 traces have no launch numbers, so each batch is taken to be a launch.
+    const bool               numberBatches = reader.getVersion() < 2;
+    unsigned int             batchNum      = 0;
+    std::vector<TraceRecord> records;
+    for( size_t i = 0; i < reader.getBlocks().size(); ++i )
+    {
+        records.clear();
+        reader.readBlock( i, records );
+        for( TraceRecord& record : records )
+        {
+            if( numberBatches && record.type == TRACE_RECORD_REQUESTS )
+                record.launchNum = batchNum++;
+            analyzer.addRecord( record );
+        }
+    }
+    return analyzer.analyze( options );
+}
+
+}  // namespace demandLoading
@@ -0,0 +1,139 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include "Util/TraceFile.h"
+
+#include <OptiXToolkit/DemandLoading/Options.h>
+
+#include <map>
+#include <vector>
+
+namespace demandLoading {
+
+/// Parameters of a trace analysis.  \see analyzeTraceFile
+struct TraceAnalysisOptions
+{
+    /// Sizes of tile memory, in tiles, at which miss curves are computed.  If empty, powers of two
+    /// are used, up to the number of distinct tiles that were requested.
+    std::vector<unsigned int> capacities;
+
+    /// Number of textures and mip levels to rank by their number of requests.
+    unsigned int numHottest = 10;
+
+    /// Seed for the random eviction policy.
+    unsigned int randomSeed = 1;
+};
+
+/// Number of misses of each eviction policy for a given size of tile memory.
+struct MissCurvePoint
+{
+    unsigned int       capacity;       // Size of tile memory, in tiles.
+    unsigned long long optimalMisses;  // Belady's policy, which evicts the tile that is next used furthest in the future.
+    unsigned long long lruMisses;      // Exact least-recently-used eviction.
+    unsigned long long randomMisses;   // Eviction of a tile chosen at random.
+};
+
+/// Requests for the tiles of a texture, or of one of its mip levels.
+struct TextureUsage
+{
+    unsigned int       textureId;
+    int                mipLevel;     // -1 for the texture as a whole.
+    unsigned long long numRequests;
+    unsigned int       numTiles;     // Number of distinct tiles requested.
+};
+
+/// Results of a trace analysis.
+///
+/// A trace holds the page requests of the recorded run, which are accesses to pages that were not
+/// resident, rather than every access.  Each request is treated as an access to its tile, so a tile
+/// that is requested again was evicted (or its request was dropped) in the meantime, and the
+/// working sets and miss curves characterize the request stream of the recorded configuration.
+struct TraceAnalysis
+{
+    unsigned int       numLaunches      = 0;
+    unsigned long long numRequests      = 0;  // Requests for texture tiles.
+    unsigned long long numOtherRequests = 0;  // Requests for samplers, base colors and resources.
+    unsigned int       numTiles         = 0;  // Number of distinct tiles requested.
+
+    /// Number of distinct tiles requested by each launch, in launch order.
+    std::vector<unsigned int> workingSets;
+
+    /// Histogram of reuse distances, where the reuse distance of a repeated request is the number
+    /// of distinct tiles requested since the previous request for the same tile.  reuseDistances[i]
+    /// counts the requests with reuse distance d such that 2^i <= d + 1 < 2^(i+1).
+    std::vector<unsigned long long> reuseDistances;
+
+    /// Misses of the optimal, LRU and random eviction policies, by tile memory size.
+    std::vector<MissCurvePoint> missCurve;
+
+    /// The textures and mip levels with the most requests, in decreasing order.  Tiles are
+    /// attributed to textures by the texture page records of version 2 traces.
+    std::vector<TextureUsage> hottestTextures;
+    std::vector<TextureUsage> hottestMipLevels;
+};
+
+/// TraceAnalyzer accumulates the records of a trace and analyzes the requests for texture tiles.
+class TraceAnalyzer
+{
+  public:
+    /// Pages below options.numPageTableEntries hold samplers, base colors and resources, and the
+    /// remaining pages hold texture tiles.
+    explicit TraceAnalyzer( const Options& options );
+
+    /// Add a record.  Request records are taken to be in launch order.
+    void addRecord( const TraceRecord& record );
+
+    /// Analyze the requests added so far.
+    TraceAnalysis analyze( const TraceAnalysisOptions& options ) const;
+
+  private:
+    // Tile pages reserved for a texture (see TRACE_RECORD_TEXTURE_PAGES).
+    struct TexturePages
+    {
+        unsigned int              textureId;
+        unsigned int              numPages;
+        std::vector<unsigned int> mipLevelStarts;
+    };
+
+    unsigned int                         m_firstTilePage;
+    std::vector<unsigned int>            m_requests;  // Tile page ids, in request order.
+    std::vector<unsigned int>            m_launches;  // Launch number of each tile request.
+    unsigned long long                   m_numOtherRequests = 0;
+    std::map<unsigned int, TexturePages> m_textures;  // Keyed by start page.
+
+    void rankTextures( const std::vector<unsigned int>& tiles, const std::vector<unsigned int>& tilePages,
+                       unsigned int numHottest, TraceAnalysis& analysis ) const;
+};
+
+/// Analyze the tile requests in the specified trace file (version 1 or 2).  The request batches of
+/// a version 1 trace are taken to be separate launches.  Throws an exception on error.
+TraceAnalysis analyzeTraceFile( const char* filename, const TraceAnalysisOptions& options );
+
+}  // namespace demandLoading
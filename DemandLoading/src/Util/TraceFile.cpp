@@ -25,7 +25,6 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
-
 #include "TraceFile.h"
 #include "DemandLoaderImpl.h"
 #include "Util/Exception.h"
@@ -33,78 +32,425 @@
 #include <OptiXToolkit/DemandLoading/Options.h>
 #include <OptiXToolkit/DemandLoading/TextureDescriptor.h>
 #include <OptiXToolkit/ImageSource/EXRReader.h>
+#include <OptiXToolkit/ImageSource/TileCache.h>
+
+#ifdef OTK_DEMAND_LOADING_USE_LZ4
+#include <lz4.h>
+#endif
+#ifdef OTK_DEMAND_LOADING_USE_ZSTD
+#include <zstd.h>
+#endif
 
+#include <algorithm>
 #include <cassert>
+#include <condition_variable>
+#include <cstring>
+#include <future>
+#include <ostream>
+#include <set>
+#include <sstream>
+#include <thread>
 
 namespace demandLoading {
 
-enum RecordType
+namespace {
+
+// Version 2 files begin with a magic number and the version.  The block index is followed by a
+// trailer holding its offset and another magic number.  Multi-byte values are in host byte order.
+const char               FILE_MAGIC[8]        = {'O', 'T', 'K', 'T', 'R', 'A', 'C', 'E'};
+const char               TRAILER_MAGIC[8]     = {'O', 'T', 'K', 'T', 'I', 'D', 'X', '2'};
+const unsigned int       BLOCK_MAGIC          = 0x424b544f;  // "OTKB"
+const unsigned int       INDEX_MAGIC          = 0x494b544f;  // "OTKI"
+const size_t             FILE_HEADER_SIZE     = 24;
+const size_t             BLOCK_HEADER_SIZE    = 40;
+const size_t             TRAILER_SIZE         = 16;
+const size_t             TRACE_BLOCK_SIZE     = 1 << 20;  // Uncompressed size at which a block is written.
+const unsigned long long MAX_BLOCK_DATA_SIZE  = 1ULL << 31;
+
+// Append the raw bytes of a value.
+template <typename T>
+void putRaw( std::vector<char>& out, const T& value )
+{
+    const char* bytes = reinterpret_cast<const char*>( &value );
+    out.insert( out.end(), bytes, bytes + sizeof( T ) );
+}
+
+// Append an unsigned LEB128 varint.
+void putVarint( std::vector<char>& out, unsigned long long value )
 {
-    OPTIONS,
-    TEXTURE,
-    REQUESTS
+    while( value >= 0x80 )
+    {
+        out.push_back( static_cast<char>( ( value & 0x7f ) | 0x80 ) );
+        value >>= 7;
+    }
+    out.push_back( static_cast<char>( value ) );
+}
+
+void putString( std::vector<char>& out, const std::string& str )
+{
+    putVarint( out, str.size() );
+    out.insert( out.end(), str.begin(), str.end() );
+}
+
+// Decodes the values appended above, throwing an exception if the data is truncated.
+class Decoder
+{
+  public:
+    Decoder( const char* begin, const char* end )
+        : m_pos( begin )
+        , m_end( end )
+    {
+    }
+
+    bool atEnd() const { return m_pos == m_end; }
+
+    template <typename T>
+    T raw()
+    {
+        T value;
+        std::memcpy( &value, bytes( sizeof( T ) ), sizeof( T ) );
+        return value;
+    }
+
+    unsigned long long varint()
+    {
+        unsigned long long value = 0;
+        for( unsigned int shift = 0; shift < 64; shift += 7 )
+        {
+            const unsigned char byte = static_cast<unsigned char>( *bytes( 1 ) );
+            value |= static_cast<unsigned long long>( byte & 0x7f ) << shift;
+            if( !( byte & 0x80 ) )
+                return value;
+        }
+        throw Exception( "Invalid varint in trace file" );
+    }
+
+    unsigned int varint32() { return static_cast<unsigned int>( varint() ); }
+
+    std::string string()
+    {
+        const size_t size = static_cast<size_t>( varint() );
+        const char*  data = bytes( size );
+        return std::string( data, size );
+    }
+
+    const char* bytes( size_t size )
+    {
+        if( size > static_cast<size_t>( m_end - m_pos ) )
+            throw Exception( "Truncated record in trace file" );
+        const char* data = m_pos;
+        m_pos += size;
+        return data;
+    }
+
+  private:
+    const char* m_pos;
+    const char* m_end;
 };
 
-TraceFileWriter::TraceFileWriter( const char* filename )
-    : m_file( filename, std::ios::out | std::ios::binary )
+// Apply a visitor to each recorded option, passing its name and a reference to its value.  The
+// order is that of version 1 trace files.
+template <typename Visitor>
+void visitOptions( Options& options, Visitor& visitor )
 {
+    visitor( "numPages", options.numPages );
+    visitor( "numPageTableEntries", options.numPageTableEntries );
+    visitor( "maxRequestedPages", options.maxRequestedPages );
+    visitor( "maxFilledPages", options.maxFilledPages );
+    visitor( "maxStalePages", options.maxStalePages );
+    visitor( "maxEvictablePages", options.maxEvictablePages );
+    visitor( "maxInvalidatedPages", options.maxInvalidatedPages );
+    visitor( "maxStagedPages", options.maxStagedPages );
+    visitor( "useLruTable", options.useLruTable );
+    visitor( "maxTexMemPerDevice", options.maxTexMemPerDevice );
+    visitor( "maxPinnedMemory", options.maxPinnedMemory );
+    visitor( "maxThreads", options.maxThreads );
+    visitor( "maxActiveStreams", options.maxActiveStreams );
 }
 
-TraceFileWriter::~TraceFileWriter()
+// Apply a visitor to the options recorded in version 2 trace files, which include options added
+// after version 1.  Options are keyed by name, so their order is immaterial.
+template <typename Visitor>
+void visitVersion2Options( Options& options, Visitor& visitor )
 {
-    m_file.close();
+    visitOptions( options, visitor );
+    visitor( "maxRequestQueueSize", options.maxRequestQueueSize );
+    visitor( "maxRequestAge", options.maxRequestAge );
+    visitor( "evictionActive", options.evictionActive );
+}
+
+// Options are encoded as (name, size, value) triples, so that readers can skip unknown options.
+struct OptionEncoder
+{
+    std::vector<char>& out;
+    unsigned int       count;
+
+    template <typename T>
+    void operator()( const char* name, const T& value )
+    {
+        putString( out, name );
+        putVarint( out, sizeof( T ) );
+        putRaw( out, value );
+        ++count;
+    }
+};
+
+struct OptionDecoder
+{
+    const std::string& name;
+    const char*        value;
+    size_t             size;
+
+    template <typename T>
+    void operator()( const char* expected, T& option )
+    {
+        if( name == expected && size == sizeof( T ) )
+            std::memcpy( &option, value, sizeof( T ) );
+    }
+};
+
+bool compressBlock( TraceCompression compression, const std::vector<char>& raw, std::vector<char>& out )
+{
+#ifdef OTK_DEMAND_LOADING_USE_LZ4
+    if( compression == TRACE_COMPRESSION_LZ4 )
+    {
+        out.resize( static_cast<size_t>( LZ4_compressBound( static_cast<int>( raw.size() ) ) ) );
+        const int size = LZ4_compress_default( raw.data(), out.data(), static_cast<int>( raw.size() ), static_cast<int>( out.size() ) );
+        out.resize( size > 0 ? static_cast<size_t>( size ) : 0 );
+        return size > 0;
+    }
+#endif
+#ifdef OTK_DEMAND_LOADING_USE_ZSTD
+    if( compression == TRACE_COMPRESSION_ZSTD )
+    {
+        out.resize( ZSTD_compressBound( raw.size() ) );
+        const size_t size = ZSTD_compress( out.data(), out.size(), raw.data(), raw.size(), 3 );
+        out.resize( ZSTD_isError( size ) ? 0 : size );
+        return !ZSTD_isError( size );
+    }
+#endif
+    (void)compression;
+    (void)raw;
+    (void)out;
+    return false;
 }
 
-template <>
-void TraceFileWriter::write( const std::string& str )
+void decompressBlock( TraceCompression compression, const std::vector<char>& stored, std::vector<char>& raw )
 {
-    write( str.size() );
-    write( str.data(), str.size() );
+    if( compression == TRACE_COMPRESSION_NONE )
+    {
+        DEMAND_ASSERT_MSG( stored.size() == raw.size(), "Invalid block size in trace file" );
+        std::copy( stored.begin(), stored.end(), raw.begin() );
+        return;
+    }
+#ifdef OTK_DEMAND_LOADING_USE_LZ4
+    if( compression == TRACE_COMPRESSION_LZ4 )
+    {
+        const int size = LZ4_decompress_safe( stored.data(), raw.data(), static_cast<int>( stored.size() ), static_cast<int>( raw.size() ) );
+        if( size != static_cast<int>( raw.size() ) )
+            throw Exception( "Error decompressing LZ4 block in trace file" );
+        return;
+    }
+#endif
+#ifdef OTK_DEMAND_LOADING_USE_ZSTD
+    if( compression == TRACE_COMPRESSION_ZSTD )
+    {
+        const size_t size = ZSTD_decompress( raw.data(), raw.size(), stored.data(), stored.size() );
+        if( ZSTD_isError( size ) || size != raw.size() )
+            throw Exception( "Error decompressing zstd block in trace file" );
+        return;
+    }
+#endif
+    throw Exception( "Trace file block uses a compression that is not supported by this build" );
+}
+
+// Decode the records of a version 2 block, whose first record has the given timestamp.
+void decodeRecords( const std::vector<char>& raw, unsigned long long timestamp, std::vector<TraceRecord>& records )
+{
+    Decoder decoder( raw.data(), raw.data() + raw.size() );
+    while( !decoder.atEnd() )
+    {
+        TraceRecord record;
+        record.type = static_cast<TraceRecordType>( decoder.varint32() );
+        timestamp += decoder.varint();
+        record.timestamp = timestamp;
+
+        if( record.type == TRACE_RECORD_OPTIONS )
+        {
+            const unsigned int numOptions = decoder.varint32();
+            for( unsigned int i = 0; i < numOptions; ++i )
+            {
+                const std::string name  = decoder.string();
+                const size_t      size  = static_cast<size_t>( decoder.varint() );
+                OptionDecoder     visit = {name, decoder.bytes( size ), size};
+                visitVersion2Options( record.options, visit );
+            }
+        }
+        else if( record.type == TRACE_RECORD_TEXTURE )
+        {
+            std::istringstream stream( decoder.string() );
+            record.imageSource                = imageSource::deserializeImageSource( stream );
+            record.textureDesc.addressMode[0] = static_cast<CUaddress_mode>( decoder.varint32() );
+            record.textureDesc.addressMode[1] = static_cast<CUaddress_mode>( decoder.varint32() );
+            record.textureDesc.filterMode       = static_cast<CUfilter_mode>( decoder.varint32() );
+            record.textureDesc.mipmapFilterMode = static_cast<CUfilter_mode>( decoder.varint32() );
+            record.textureDesc.maxAnisotropy    = decoder.varint32();
+            record.textureDesc.flags            = decoder.varint32();
+        }
+        else if( record.type == TRACE_RECORD_REQUESTS )
+        {
+            record.launchNum   = decoder.varint32();
+            record.deviceIndex = decoder.varint32();
+            record.streamId    = decoder.varint32();
+            record.pageIds.resize( decoder.varint32() );
+            unsigned int pageId = 0;
+            for( unsigned int& id : record.pageIds )
+            {
+                pageId += decoder.varint32();
+                id = pageId;
+            }
+        }
+        else if( record.type == TRACE_RECORD_TEXTURE_PAGES )
+        {
+            record.textureId = decoder.varint32();
+            record.startPage = decoder.varint32();
+            record.numPages  = decoder.varint32();
+            const unsigned int numLevels = decoder.varint32();
+            if( numLevels > MAX_TILE_LEVELS )
+                throw Exception( "Invalid number of mip levels in trace file" );
+            record.mipLevelStarts.resize( numLevels );
+            for( unsigned int& start : record.mipLevelStarts )
+                start = decoder.varint32();
+        }
+        else
+        {
+            throw Exception( "Unknown record type in trace file" );
+        }
+        records.push_back( std::move( record ) );
+    }
+}
+
+}  // anonymous namespace
+
+bool isTraceCompressionSupported( TraceCompression compression )
+{
+    switch( compression )
+    {
+        case TRACE_COMPRESSION_NONE:
+        case TRACE_COMPRESSION_DEFAULT:
+            return true;
+#ifdef OTK_DEMAND_LOADING_USE_LZ4
+        case TRACE_COMPRESSION_LZ4:
+            return true;
+#endif
+#ifdef OTK_DEMAND_LOADING_USE_ZSTD
+        case TRACE_COMPRESSION_ZSTD:
+            return true;
+#endif
+        default:
+            return false;
+    }
+}
+
+TraceFileWriter::TraceFileWriter( const char* filename, TraceCompression compression )
+    : m_file( filename, std::ios::out | std::ios::binary )
+    , m_compression( compression )
+    , m_startTime( std::chrono::steady_clock::now() )
+{
+    if( !m_file )
+        throw Exception( "Cannot open trace file for writing" );
+    if( !isTraceCompressionSupported( m_compression ) )
+        throw Exception( "Trace file compression is not supported by this build" );
+
+    // Use the best compression available by default.
+    if( m_compression == TRACE_COMPRESSION_DEFAULT )
+    {
+        m_compression = isTraceCompressionSupported( TRACE_COMPRESSION_ZSTD ) ? TRACE_COMPRESSION_ZSTD :
+                        isTraceCompressionSupported( TRACE_COMPRESSION_LZ4 )  ? TRACE_COMPRESSION_LZ4 :
+                                                                                TRACE_COMPRESSION_NONE;
+    }
+
+    // Write the file header, including the wall clock time at which the trace began.
+    std::vector<char> header( FILE_MAGIC, FILE_MAGIC + sizeof( FILE_MAGIC ) );
+    putRaw( header, TRACE_FILE_VERSION );
+    putRaw( header, 0U );
+    putRaw( header, static_cast<unsigned long long>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::system_clock::now().time_since_epoch() ).count() ) );
+    assert( header.size() == FILE_HEADER_SIZE );
+    m_file.write( header.data(), header.size() );
+}
+
+TraceFileWriter::~TraceFileWriter()
+{
+    flush();
+
+    // Write the block index, followed by the trailer that locates it.
+    std::unique_lock<std::mutex> lock( m_fileMutex );
+    const unsigned long long     indexOffset = static_cast<unsigned long long>( m_file.tellp() );
+    std::vector<char>            index;
+    putRaw( index, INDEX_MAGIC );
+    putRaw( index, static_cast<unsigned int>( m_index.size() ) );
+    for( const TraceBlockInfo& block : m_index )
+    {
+        putRaw( index, block.offset );
+        putRaw( index, block.firstTimestamp );
+        putRaw( index, block.lastTimestamp );
+        putRaw( index, block.numRecords );
+        putRaw( index, 0U );
+    }
+    putRaw( index, indexOffset );
+    index.insert( index.end(), TRAILER_MAGIC, TRAILER_MAGIC + sizeof( TRAILER_MAGIC ) );
+    m_file.write( index.data(), index.size() );
+    m_file.close();
 }
 
 void TraceFileWriter::recordOptions( const Options& options )
 {
-    std::unique_lock<std::mutex> lock( m_mutex );
-    write( OPTIONS );
-    writeOption( "numPages", options.numPages );
-    writeOption( "numPageTableEntries", options.numPageTableEntries );
-    writeOption( "maxRequestedPages", options.maxRequestedPages );
-    writeOption( "maxFilledPages", options.maxFilledPages );
-    writeOption( "maxStalePages", options.maxStalePages );
-    writeOption( "maxEvictablePages", options.maxEvictablePages );
-    writeOption( "maxInvalidatedPages", options.maxInvalidatedPages );
-    writeOption( "maxStagedPages", options.maxStagedPages );
-    writeOption( "useLruTable", options.useLruTable );
-    writeOption( "maxTexMemPerDevice", options.maxTexMemPerDevice );
-    writeOption( "maxPinnedMemory", options.maxPinnedMemory );
-    writeOption( "maxThreads", options.maxThreads );
-    writeOption( "maxActiveStreams", options.maxActiveStreams );
+    std::vector<char> encodedOptions;
+    Options           copy = options;
+    OptionEncoder     encoder{encodedOptions, 0};
+    visitVersion2Options( copy, encoder );
+
+    // The number of options precedes them.
+    std::vector<char> body;
+    putVarint( body, encoder.count );
+    body.insert( body.end(), encodedOptions.begin(), encodedOptions.end() );
+    appendRecord( TRACE_RECORD_OPTIONS, body );
 }
 
 void TraceFileWriter::recordTexture( std::shared_ptr<imageSource::ImageSource> imageSource, const TextureDescriptor& desc )
 {
-    std::unique_lock<std::mutex> lock( m_mutex );
-
-    // For now, only EXRReader can be serialized.
-    std::shared_ptr<imageSource::EXRReader> exrReader( std::dynamic_pointer_cast<imageSource::EXRReader>( imageSource ) );
-    if( !exrReader )
-        throw Exception( "Cannot serialize ImageSource (expected EXRReader)" );
+    // The image source is serialized with its type tag, so any registered type can be replayed.
+    std::ostringstream stream;
+    imageSource::serializeImageSource( *imageSource, stream );
 
-    write( TEXTURE );
-    exrReader->serialize( m_file );
+    std::vector<char> body;
+    putString( body, stream.str() );
+    putVarint( body, desc.addressMode[0] );
+    putVarint( body, desc.addressMode[1] );
+    putVarint( body, desc.filterMode );
+    putVarint( body, desc.mipmapFilterMode );
+    putVarint( body, desc.maxAnisotropy );
+    putVarint( body, desc.flags );
+    appendRecord( TRACE_RECORD_TEXTURE, body );
+}
 
-    // Serialize TextureDescriptor.
-    write( desc.addressMode[0] );
-    write( desc.addressMode[1] );
-    write( desc.filterMode );
-    write( desc.mipmapFilterMode );
-    write( desc.maxAnisotropy );
-    write( desc.flags );
+void TraceFileWriter::recordTexturePages( unsigned int textureId, const TextureSampler& sampler )
+{
+    std::vector<char> body;
+    putVarint( body, textureId );
+    putVarint( body, sampler.startPage );
+    putVarint( body, sampler.numPages );
+    putVarint( body, sampler.mipTailFirstLevel + 1 );
+    for( unsigned int mipLevel = 0; mipLevel <= sampler.mipTailFirstLevel; ++mipLevel )
+        putVarint( body, sampler.mipLevelSizes[mipLevel].mipLevelStart );
+    appendRecord( TRACE_RECORD_TEXTURE_PAGES, body );
 }
 
 // CUDA streams are assigned integer identifiers as they are encountered.
 unsigned int TraceFileWriter::getStreamId( CUstream stream )
 {
+    std::unique_lock<std::mutex> lock( m_mutex );
     auto it = m_streamIds.find( stream );
     if( it != m_streamIds.end() )
         return it->second;
@@ -115,12 +461,12 @@ unsigned int TraceFileWriter::getStreamId( CUstream stream )
 
 // Check that the current CUDA context matches the one associated with the given stream
 // and return the associated device index.
-static unsigned int getDeviceIndex( CUstream /*stream*/ )
+static unsigned int getDeviceIndex( CUstream stream )
 {
-    // Get the current CUDA context.
+    // Get the current CUDA context, and the one associated with the stream.
     CUcontext cudaContext, streamContext;
     DEMAND_CUDA_CHECK( cuCtxGetCurrent( &cudaContext ) );
-    DEMAND_CUDA_CHECK( cuCtxGetCurrent( &streamContext ) );
+    DEMAND_CUDA_CHECK( cuStreamGetCtx( stream, &streamContext ) );
     DEMAND_ASSERT_MSG( cudaContext == streamContext,
                        "The current CUDA context must match the one associated with the given stream" );
 
@@ -130,80 +476,251 @@ static unsigned int getDeviceIndex( CUstream /*stream*/ )
     return static_cast<unsigned int>( device );
 }
 
-void TraceFileWriter::recordRequests( CUstream stream, const unsigned int* pageIds, unsigned int numPageIds )
+void TraceFileWriter::recordRequests( CUstream stream, unsigned int launchNum, const unsigned int* pageIds, unsigned int numPageIds )
+{
+    // Encode the record before acquiring the lock.  The page ids are sorted and delta encoded, so
+    // the order of the requests within the batch is not preserved (see TRACE_FILE_VERSION).
+    std::vector<unsigned int> sortedPageIds( pageIds, pageIds + numPageIds );
+    std::sort( sortedPageIds.begin(), sortedPageIds.end() );
+
+    std::vector<char> body;
+    body.reserve( 16 + 2 * numPageIds );
+    putVarint( body, launchNum );
+    putVarint( body, getDeviceIndex( stream ) );
+    putVarint( body, getStreamId( stream ) );
+    putVarint( body, numPageIds );
+    unsigned int previous = 0;
+    for( unsigned int pageId : sortedPageIds )
+    {
+        putVarint( body, pageId - previous );
+        previous = pageId;
+    }
+    appendRecord( TRACE_RECORD_REQUESTS, body );
+}
+
+void TraceFileWriter::appendRecord( TraceRecordType type, const std::vector<char>& body )
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+
+    // Timestamps are taken under the lock, so they increase monotonically through the file.  Each
+    // is encoded relative to the previous record in the block.
+    const unsigned long long timestamp = static_cast<unsigned long long>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - m_startTime ).count() );
+    if( m_numBlockRecords == 0 )
+        m_blockStartTime = m_lastTimestamp = timestamp;
+    putVarint( m_block, type );
+    putVarint( m_block, timestamp - m_lastTimestamp );
+    m_block.insert( m_block.end(), body.begin(), body.end() );
+    m_lastTimestamp = timestamp;
+    ++m_numBlockRecords;
+
+    if( m_block.size() >= TRACE_BLOCK_SIZE )
+        writeBlock( lock );
+}
+
+void TraceFileWriter::flush()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    writeBlock( lock );
+}
+
+void TraceFileWriter::writeBlock( std::unique_lock<std::mutex>& lock )
+{
+    if( m_numBlockRecords == 0 )
+        return;
+
+    // Take the block, and acquire the file mutex before releasing the block mutex, so that blocks
+    // are written in order while other threads fill the next block.
+    std::vector<char> raw;
+    raw.swap( m_block );
+    m_block.reserve( TRACE_BLOCK_SIZE + TRACE_BLOCK_SIZE / 8 );
+    TraceBlockInfo info{0, m_blockStartTime, m_lastTimestamp, m_numBlockRecords};
+    m_numBlockRecords = 0;
+    std::unique_lock<std::mutex> fileLock( m_fileMutex );
+    lock.unlock();
+
+    // Blocks that do not compress are stored uncompressed.
+    std::vector<char> compressed;
+    TraceCompression  compression = m_compression;
+    if( compression != TRACE_COMPRESSION_NONE
+        && !( compressBlock( compression, raw, compressed ) && compressed.size() < raw.size() ) )
+        compression = TRACE_COMPRESSION_NONE;
+    const std::vector<char>& stored = ( compression == TRACE_COMPRESSION_NONE ) ? raw : compressed;
+
+    std::vector<char> header;
+    putRaw( header, BLOCK_MAGIC );
+    putRaw( header, static_cast<unsigned int>( compression ) );
+    putRaw( header, static_cast<unsigned int>( raw.size() ) );
+    putRaw( header, static_cast<unsigned int>( stored.size() ) );
+    putRaw( header, info.numRecords );
+    putRaw( header, 0U );
+    putRaw( header, info.firstTimestamp );
+    putRaw( header, info.lastTimestamp );
+    assert( header.size() == BLOCK_HEADER_SIZE );
+
+    info.offset = static_cast<unsigned long long>( m_file.tellp() );
+    m_file.write( header.data(), header.size() );
+    m_file.write( stored.data(), stored.size() );
+    m_index.push_back( info );
+}
+
+TraceFileReader::TraceFileReader( const char* filename )
+    : m_file( filename, std::ios::in | std::ios::binary )
 {
     if( !m_file )
+        throw Exception( "Cannot open trace file for reading" );
+    m_file.seekg( 0, std::ios::end );
+    const unsigned long long fileSize = static_cast<unsigned long long>( m_file.tellg() );
+    m_file.seekg( 0 );
+
+    // Version 1 files have no header.  They are presented as a single block.
+    char magic[sizeof( FILE_MAGIC )] = {};
+    if( fileSize < FILE_HEADER_SIZE || !m_file.read( magic, sizeof( magic ) ) || std::memcmp( magic, FILE_MAGIC, sizeof( magic ) ) != 0 )
+    {
+        m_file.clear();
+        m_version = 1;
+        m_blocks.push_back( TraceBlockInfo{0, 0, 0, 0} );
         return;
+    }
 
-    std::unique_lock<std::mutex> lock( m_mutex );
-    unsigned int deviceIndex = getDeviceIndex( stream );
-    unsigned int streamId = getStreamId( stream ) ;
+    m_file.read( reinterpret_cast<char*>( &m_version ), sizeof( m_version ) );
+    if( m_version != TRACE_FILE_VERSION )
+        throw Exception( "Unsupported trace file version" );
 
-    write( REQUESTS );
-    write( deviceIndex );
-    write( streamId );
-    write( numPageIds );
-    write( pageIds, numPageIds );
+    readIndex( fileSize );
+    if( m_blocks.empty() )
+        scanBlocks( fileSize );
 }
 
-class TraceFileReader
+void TraceFileReader::readIndex( unsigned long long fileSize )
 {
-  public:
-    TraceFileReader( const char* filename )
-        : m_file( filename, std::ios::in | std::ios::binary )
+    // The trailer locates the index.  It is missing if the trace was not closed.
+    if( fileSize < FILE_HEADER_SIZE + TRAILER_SIZE )
+        return;
+    char trailer[TRAILER_SIZE];
+    m_file.seekg( fileSize - TRAILER_SIZE );
+    if( !m_file.read( trailer, TRAILER_SIZE ) || std::memcmp( trailer + 8, TRAILER_MAGIC, sizeof( TRAILER_MAGIC ) ) != 0 )
+    {
+        m_file.clear();
+        return;
+    }
+    unsigned long long indexOffset;
+    std::memcpy( &indexOffset, trailer, sizeof( indexOffset ) );
+    if( indexOffset < FILE_HEADER_SIZE || indexOffset > fileSize - TRAILER_SIZE )
+        return;
+
+    std::vector<char> index( static_cast<size_t>( fileSize - TRAILER_SIZE - indexOffset ) );
+    m_file.seekg( indexOffset );
+    m_file.read( index.data(), index.size() );
+    Decoder decoder( index.data(), index.data() + index.size() );
+    if( decoder.raw<unsigned int>() != INDEX_MAGIC )
+        throw Exception( "Invalid block index in trace file" );
+    const unsigned int numBlocks = decoder.raw<unsigned int>();
+    m_blocks.resize( numBlocks );
+    for( TraceBlockInfo& block : m_blocks )
     {
+        block.offset         = decoder.raw<unsigned long long>();
+        block.firstTimestamp = decoder.raw<unsigned long long>();
+        block.lastTimestamp  = decoder.raw<unsigned long long>();
+        block.numRecords     = decoder.raw<unsigned int>();
+        decoder.raw<unsigned int>();
     }
+}
 
-    Options readOptions()
+void TraceFileReader::scanBlocks( unsigned long long fileSize )
+{
+    // Follow the chain of block headers, stopping at the index or at a truncated block.
+    unsigned long long offset = FILE_HEADER_SIZE;
+    char               header[BLOCK_HEADER_SIZE];
+    while( offset + BLOCK_HEADER_SIZE <= fileSize )
     {
-        RecordType recordType;
-        read( &recordType );
-        assert( recordType == OPTIONS );
+        m_file.seekg( offset );
+        if( !m_file.read( header, BLOCK_HEADER_SIZE ) )
+            break;
+        Decoder decoder( header, header + BLOCK_HEADER_SIZE );
+        if( decoder.raw<unsigned int>() != BLOCK_MAGIC )
+            break;
+        decoder.raw<unsigned int>();
+        decoder.raw<unsigned int>();
+        const unsigned int storedSize = decoder.raw<unsigned int>();
+        TraceBlockInfo     block{offset, 0, 0, decoder.raw<unsigned int>()};
+        decoder.raw<unsigned int>();
+        block.firstTimestamp = decoder.raw<unsigned long long>();
+        block.lastTimestamp  = decoder.raw<unsigned long long>();
+        if( offset + BLOCK_HEADER_SIZE + storedSize > fileSize )
+            break;
+        m_blocks.push_back( block );
+        offset += BLOCK_HEADER_SIZE + storedSize;
+    }
+    m_file.clear();
+}
 
-        Options options;
-        readOption( "numPages", &options.numPages );
-        readOption( "numPageTableEntries", &options.numPageTableEntries );
-        readOption( "maxRequestedPages", &options.maxRequestedPages );
-        readOption( "maxFilledPages", &options.maxFilledPages );
-        readOption( "maxStalePages", &options.maxStalePages );
-        readOption( "maxEvictablePages", &options.maxEvictablePages );
-        readOption( "maxInvalidatedPages", &options.maxInvalidatedPages );
-        readOption( "maxStagedPages", &options.maxStagedPages );
-        readOption( "useLruTable", &options.useLruTable );
-        readOption( "maxTexMemPerDevice", &options.maxTexMemPerDevice );
-        readOption( "maxPinnedMemory", &options.maxPinnedMemory );
-        readOption( "maxThreads", &options.maxThreads );
-        readOption( "maxActiveStreams", &options.maxActiveStreams );
-        return options;
+void TraceFileReader::readBlock( size_t blockIndex, std::vector<TraceRecord>& records ) const
+{
+    DEMAND_ASSERT( blockIndex < m_blocks.size() );
+    records.clear();
+    if( m_version == 1 )
+    {
+        readVersion1( records );
+        return;
     }
 
-    void replay( DemandLoader* loader )
+    // Only reading the block is serialized.  It is decompressed and decoded without the lock.
+    char              header[BLOCK_HEADER_SIZE];
+    std::vector<char> stored;
     {
-        while( true )
-        {
-            RecordType recordType;
-            read( &recordType );
-            if( m_file.eof() )
-                break;
-            if( recordType == TEXTURE )
-            {
-                replayCreateTexture( loader );
-            }
-            else if( recordType == REQUESTS )
-            {
-                replayRequests( loader );
-            }
-            else
-            {
-                throw Exception( "Unknown record type in trace file" );
-            }
-        }
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_file.clear();
+        m_file.seekg( m_blocks[blockIndex].offset );
+        if( !m_file.read( header, BLOCK_HEADER_SIZE ) )
+            throw Exception( "Truncated block in trace file" );
+        unsigned int storedSize;
+        std::memcpy( &storedSize, header + 12, sizeof( storedSize ) );
+        stored.resize( storedSize );
+        if( !m_file.read( stored.data(), storedSize ) )
+            throw Exception( "Truncated block in trace file" );
     }
 
-  private:
-    std::ifstream          m_file;
-    std::vector<CUcontext> m_contexts;
-    std::vector<CUstream>  m_streams;
+    Decoder decoder( header, header + BLOCK_HEADER_SIZE );
+    if( decoder.raw<unsigned int>() != BLOCK_MAGIC )
+        throw Exception( "Invalid block in trace file" );
+    const TraceCompression compression = static_cast<TraceCompression>( decoder.raw<unsigned int>() );
+    const unsigned int     rawSize     = decoder.raw<unsigned int>();
+    if( rawSize > MAX_BLOCK_DATA_SIZE )
+        throw Exception( "Invalid block size in trace file" );
+    decoder.raw<unsigned int>();
+    decoder.raw<unsigned int>();
+    decoder.raw<unsigned int>();
+    const unsigned long long firstTimestamp = decoder.raw<unsigned long long>();
+
+    std::vector<char> raw( rawSize );
+    decompressBlock( compression, stored, raw );
+    decodeRecords( raw, firstTimestamp, records );
+}
+
+Options TraceFileReader::readOptions() const
+{
+    std::vector<TraceRecord> records;
+    if( !m_blocks.empty() )
+        readBlock( 0, records );
+    for( const TraceRecord& record : records )
+    {
+        if( record.type == TRACE_RECORD_OPTIONS )
+            return record.options;
+    }
+    throw Exception( "Trace file does not record options" );
+}
+
+namespace {
+
+// Reads the raw records of a version 1 trace file.
+class Version1Reader
+{
+  public:
+    Version1Reader( std::istream& file )
+        : m_file( file )
+    {
+    }
 
     template <typename T>
     void read( T* dest )
@@ -213,7 +730,7 @@ class TraceFileReader
 
     std::string readString()
     {
-        size_t size;
+        size_t size = 0;
         read( &size );
         std::vector<char> buffer( size );
         m_file.read( buffer.data(), size );
@@ -221,13 +738,7 @@ class TraceFileReader
     }
 
     template <typename T>
-    void read( T* dest, unsigned int count )
-    {
-        m_file.read( reinterpret_cast<char*>( dest ), count * sizeof( T ) );
-    }
-
-    template <typename T>
-    void readOption( const std::string& expected, T* option )
+    void operator()( const char* expected, T& option )
     {
         std::string found = readString();
         if( found != expected )
@@ -236,24 +747,122 @@ class TraceFileReader
             stream << "Error reading option from trace file.  Expected " << expected << ", found " << found;
             throw Exception( stream.str().c_str() );
         }
-        read( option );
+        read( &option );
     }
 
-    void replayCreateTexture( DemandLoader* loader )
+  private:
+    std::istream& m_file;
+};
+
+}  // anonymous namespace
+
+void TraceFileReader::readVersion1( std::vector<TraceRecord>& records ) const
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_file.clear();
+    m_file.seekg( 0 );
+    Version1Reader reader( m_file );
+    while( true )
+    {
+        int recordType;
+        reader.read( &recordType );
+        if( m_file.eof() )
+            break;
+
+        TraceRecord record;
+        record.type = static_cast<TraceRecordType>( recordType );
+        if( record.type == TRACE_RECORD_OPTIONS )
+        {
+            visitOptions( record.options, reader );
+        }
+        else if( record.type == TRACE_RECORD_TEXTURE )
+        {
+            // Version 1 traces could only hold an EXRReader, which was serialized without a tag.
+            record.imageSource = imageSource::EXRReader::deserialize( m_file );
+            reader.read( &record.textureDesc.addressMode[0] );
+            reader.read( &record.textureDesc.addressMode[1] );
+            reader.read( &record.textureDesc.filterMode );
+            reader.read( &record.textureDesc.mipmapFilterMode );
+            reader.read( &record.textureDesc.maxAnisotropy );
+            reader.read( &record.textureDesc.flags );
+        }
+        else if( record.type == TRACE_RECORD_REQUESTS )
+        {
+            unsigned int numPageIds = 0;
+            reader.read( &record.deviceIndex );
+            reader.read( &record.streamId );
+            reader.read( &numPageIds );
+            record.pageIds.resize( numPageIds );
+            m_file.read( reinterpret_cast<char*>( record.pageIds.data() ), numPageIds * sizeof( unsigned int ) );
+        }
+        else
+        {
+            throw Exception( "Unknown record type in trace file" );
+        }
+        if( !m_file )
+            throw Exception( "Truncated record in trace file" );
+        records.push_back( std::move( record ) );
+    }
+}
+
+namespace {
+
+// Replays trace records, creating a CUDA context per device and a stream per recorded stream.  The
+// player owns the DemandLoader, which it destroys before the streams and contexts, so that they are
+// released even if the replay throws an exception.
+class TraceFilePlayer
+{
+  public:
+    TraceFilePlayer( const Options& options )
+        : m_loader( createDemandLoader( options ) )
     {
-        std::shared_ptr<imageSource::ImageSource> imageSource( imageSource::EXRReader::deserialize( m_file ) );
+    }
 
-        TextureDescriptor desc;
-        read( &desc.addressMode[0] );
-        read( &desc.addressMode[1] );
-        read( &desc.filterMode );
-        read( &desc.mipmapFilterMode );
-        read( &desc.maxAnisotropy );
-        read( &desc.flags );
+    ~TraceFilePlayer()
+    {
+        destroyDemandLoader( m_loader );
+        for( const StreamInfo& info : m_streams )
+        {
+            DEMAND_CUDA_CHECK_NOTHROW( cuCtxSetCurrent( info.context ) );
+            DEMAND_CUDA_CHECK_NOTHROW( cuStreamDestroy( info.stream ) );
+        }
+        for( CUcontext context : m_contexts )
+        {
+            if( context )
+                DEMAND_CUDA_CHECK_NOTHROW( cuCtxDestroy( context ) );
+        }
+    }
 
-        loader->createTexture( imageSource, desc );
+    DemandLoader* getLoader() const { return m_loader; }
+
+    // Create the contexts for the given devices ahead of the replay, so their creation is not timed.
+    void createContexts( const std::vector<unsigned int>& devices )
+    {
+        for( unsigned int deviceIndex : devices )
+            getContext( deviceIndex );
+    }
+
+    // Replay the given record.  Returns a ticket for the requests of a request record.
+    Ticket replay( TraceRecord& record )
+    {
+        if( record.type == TRACE_RECORD_TEXTURE )
+            m_loader->createTexture( record.imageSource, record.textureDesc );
+        else if( record.type == TRACE_RECORD_REQUESTS )
+            return replayRequests( record );
+        return Ticket();
     }
 
+  private:
+    struct StreamInfo
+    {
+        CUcontext context;
+        CUstream  stream;
+    };
+
+    DemandLoader*           m_loader;
+    std::vector<CUcontext>  m_contexts;
+    std::vector<StreamInfo> m_streams;
+
     CUcontext getContext( unsigned int deviceIndex )
     {
         if( deviceIndex >= m_contexts.size() )
@@ -273,7 +882,7 @@ class TraceFileReader
     {
 
         if( streamId < m_streams.size() )
-            return m_streams[streamId];
+            return m_streams[streamId].stream;
 
         if( streamId != m_streams.size() )
             throw Exception( "Unexpected stream id in page request trace file" );
@@ -283,55 +892,277 @@ class TraceFileReader
 
         CUstream stream;
         DEMAND_CUDA_CHECK( cuStreamCreate( &stream, 0U ) );
-        m_streams.push_back( stream );
+        m_streams.push_back( StreamInfo{context, stream} );
         return stream;
     }
 
-    void replayRequests( DemandLoader* loader )
+    Ticket replayRequests( TraceRecord& record )
     {
-        unsigned int deviceIndex;
-        read( &deviceIndex );
+        // Downcast demand loader, since trace file playback relies on internal interface.
+        DemandLoaderImpl* loaderImpl = dynamic_cast<DemandLoaderImpl*>( m_loader );
+        assert( loaderImpl );
 
-        unsigned int streamId;
-        read( &streamId );
+        CUstream stream = getStream( record.deviceIndex, record.streamId );
+        return loaderImpl->replayRequests( stream, record.pageIds.data(), static_cast<unsigned int>( record.pageIds.size() ) );
+    }
+};
 
-        unsigned int numPageIds;
-        read( &numPageIds );
+// Samples the depth of the request queue on a background thread until it is stopped.
+class QueueDepthSampler
+{
+  public:
+    QueueDepthSampler( DemandLoaderImpl* loader, double interval, std::chrono::steady_clock::time_point startTime )
+        : m_loader( loader )
+        , m_interval( interval )
+        , m_startTime( startTime )
+    {
+        if( m_interval > 0.0 )
+            m_thread = std::thread( &QueueDepthSampler::run, this );
+    }
 
-        std::vector<unsigned int> pageIds( numPageIds );
-        read( pageIds.data(), numPageIds );
+    ~QueueDepthSampler() { stop(); }
 
-        // Downcast demand loader, since trace file playback relies on internal interface.
-        DemandLoaderImpl* loaderImpl = dynamic_cast<DemandLoaderImpl*>( loader );
-        assert( loaderImpl );
+    // Stop sampling and return the samples.
+    std::vector<QueueDepthSample> stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_stopped = true;
+        }
+        m_stoppedCondition.notify_all();
+        if( m_thread.joinable() )
+            m_thread.join();
+        return std::move( m_samples );
+    }
 
-        CUstream stream = getStream( deviceIndex, streamId );
-        Ticket ticket = loaderImpl->replayRequests( stream, pageIds.data(), numPageIds );
-        ticket.wait();
+  private:
+    DemandLoaderImpl*                     m_loader;
+    double                                m_interval;
+    std::chrono::steady_clock::time_point m_startTime;
+    std::vector<QueueDepthSample>         m_samples;
+    std::thread                           m_thread;
+    std::mutex                            m_mutex;
+    std::condition_variable               m_stoppedCondition;
+    bool                                  m_stopped = false;
+
+    void run()
+    {
+        const std::chrono::duration<double> interval( m_interval );
+        std::unique_lock<std::mutex>        lock( m_mutex );
+        while( !m_stopped )
+        {
+            const std::chrono::duration<double> time = std::chrono::steady_clock::now() - m_startTime;
+            m_samples.push_back( QueueDepthSample{time.count(), m_loader->getRequestQueueSize()} );
+            m_stoppedCondition.wait_for( lock, interval, [this] { return m_stopped; } );
+        }
+    }
+};
+
+// Sets the capacity of the process-wide tile cache, restoring it on destruction.
+class TileCacheSizeSaver
+{
+  public:
+    TileCacheSizeSaver( size_t maxBytes )
+        : m_savedMaxBytes( imageSource::TileCache::getInstance().getMaxBytes() )
+    {
+        if( maxBytes > 0 )
+            imageSource::TileCache::getInstance().setMaxBytes( maxBytes );
     }
+
+    ~TileCacheSizeSaver() { imageSource::TileCache::getInstance().setMaxBytes( m_savedMaxBytes ); }
+
+  private:
+    size_t m_savedMaxBytes;
 };
 
+}  // anonymous namespace
+
 Statistics replayTraceFile( const char* filename )
+{
+    return replayTraceFile( filename, TraceReplayConfig() ).stats;
+}
+
+TraceReplayReport replayTraceFile( const char* filename, const TraceReplayConfig& config )
 {
     // Open the trace file.  Throws an exception if an error occurs.
     TraceFileReader reader( filename );
 
-    // Read options.
+    // Read options, adjusting them as configured.
     Options options = reader.readOptions();
     options.traceFile = "";
+    if( config.adjustOptions )
+        config.adjustOptions( options );
+
+    TileCacheSizeSaver tileCacheSize( config.tileCacheSize );
 
-    // Create demand loader.
-    DemandLoader* loader = createDemandLoader( options );
+    TraceReplayReport report;
+    report.name          = config.name;
+    report.options       = options;
+    report.timeScale     = reader.getVersion() >= 2 ? config.timeScale : 0.0;
+    report.tileCacheSize = imageSource::TileCache::getInstance().getMaxBytes();
 
-    // Replay the trace file.
-    reader.replay( loader );
-    Statistics stats = loader->getStatistics();
+    // Create demand loader, and the contexts on its devices before the clock starts.
+    TraceFilePlayer   player( options );
+    DemandLoader*     loader     = player.getLoader();
+    DemandLoaderImpl* loaderImpl = dynamic_cast<DemandLoaderImpl*>( loader );
+    assert( loaderImpl );
+    player.createContexts( loader->getDevices() );
 
-    // Clean up.
-    destroyDemandLoader( loader );
+    // Replay the trace file.  The next block is decoded while the current one is replayed.
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    QueueDepthSampler                           sampler( loaderImpl, config.queueSampleInterval, startTime );
+    std::vector<Ticket>                         tickets;
+    std::set<unsigned int>                      launches;
+    bool                                        haveFirstTimestamp = false;
+    unsigned long long                          firstTimestamp     = 0;
+    const size_t                                numBlocks          = reader.getBlocks().size();
+    std::future<std::vector<TraceRecord>>       next;
+    auto readBlock = [&reader]( size_t blockIndex ) {
+        std::vector<TraceRecord> records;
+        reader.readBlock( blockIndex, records );
+        return records;
+    };
+    if( numBlocks > 0 )
+        next = std::async( std::launch::async, readBlock, 0 );
+    for( size_t i = 0; i < numBlocks; ++i )
+    {
+        std::vector<TraceRecord> records = next.get();
+        if( i + 1 < numBlocks )
+            next = std::async( std::launch::async, readBlock, i + 1 );
+        for( TraceRecord& record : records )
+        {
+            // Pace the records by their scaled timestamps, relative to the first record.
+            if( report.timeScale > 0.0 )
+            {
+                if( !haveFirstTimestamp )
+                {
+                    firstTimestamp     = record.timestamp;
+                    haveFirstTimestamp = true;
+                }
+                const double offset = ( record.timestamp - firstTimestamp ) * 1.0e-9 * report.timeScale;
+                std::this_thread::sleep_until( startTime + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                                               std::chrono::duration<double>( offset ) ) );
+            }
 
-    return stats;
+            Ticket ticket = player.replay( record );
+            if( record.type != TRACE_RECORD_REQUESTS )
+                continue;
+            report.numBatches += 1;
+            report.numRequests += record.pageIds.size();
+            launches.insert( record.launchNum );
+
+            // Paced batches are filled concurrently; tickets that are done are discarded as we go.
+            if( report.timeScale > 0.0 )
+            {
+                tickets.erase( std::remove_if( tickets.begin(), tickets.end(),
+                                               []( const Ticket& t ) { return t.numTasksRemaining() == 0; } ),
+                               tickets.end() );
+                tickets.push_back( ticket );
+            }
+            else
+            {
+                ticket.wait();
+            }
+        }
+    }
+    for( Ticket& ticket : tickets )
+        ticket.wait();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - startTime;
+    report.elapsedTime = elapsed.count();
+    report.queueDepth  = sampler.stop();
+    report.numLaunches = static_cast<unsigned int>( launches.size() );
+    report.stats       = loader->getStatistics();
+    report.latency     = loader->getLatencyStatistics( false );
+
+    return report;
+}
+
+namespace {
+
+// Names of the latency phases in replay reports, indexed by LatencyPhase.
+const char* const LATENCY_PHASE_NAMES[NUM_LATENCY_PHASES] = {
+    "pullRequests", "queueWait", "fillRequest", "readTile", "allocateTransferBuffer", "fillTile", "pushMappings",
+};
+
+void writeJsonString( std::ostream& stream, const std::string& str )
+{
+    stream << '"';
+    for( char c : str )
+    {
+        if( c == '"' || c == '\\' )
+            stream << '\\' << c;
+        else if( static_cast<unsigned char>( c ) < 0x20 )
+            stream << "\\u00" << "0123456789abcdef"[( c >> 4 ) & 0xf] << "0123456789abcdef"[c & 0xf];
+        else
+            stream << c;
+    }
+    stream << '"';
 }
 
+void writeLatencyJson( std::ostream& stream, const LatencyHistogram& histogram )
+{
+    stream << "{\"count\": " << histogram.numSamples << ", \"mean\": " << histogram.getMean()
+           << ", \"p50\": " << histogram.getPercentile( 0.5 ) << ", \"p90\": " << histogram.getPercentile( 0.9 )
+           << ", \"p99\": " << histogram.getPercentile( 0.99 ) << ", \"max\": " << histogram.maxTime << "}";
+}
+
+void writeReportJson( std::ostream& stream, const TraceReplayReport& report )
+{
+    const Options&    options = report.options;
+    const Statistics& stats   = report.stats;
+
+    stream << "    {\n      \"name\": ";
+    writeJsonString( stream, report.name );
+    stream << ",\n      \"options\": {\"maxThreads\": " << options.maxThreads
+           << ", \"maxRequestQueueSize\": " << options.maxRequestQueueSize
+           << ", \"maxRequestedPages\": " << options.maxRequestedPages
+           << ", \"maxTexMemPerDevice\": " << options.maxTexMemPerDevice
+           << ", \"maxPinnedMemory\": " << options.maxPinnedMemory
+           << ", \"tileCacheSize\": " << report.tileCacheSize << "},\n";
+    stream << "      \"timeScale\": " << report.timeScale << ",\n";
+    stream << "      \"elapsedTime\": " << report.elapsedTime << ",\n";
+    stream << "      \"numLaunches\": " << report.numLaunches << ",\n";
+    stream << "      \"numBatches\": " << report.numBatches << ",\n";
+    stream << "      \"numRequests\": " << report.numRequests << ",\n";
+    stream << "      \"numTilesRead\": " << stats.numTilesRead << ",\n";
+    stream << "      \"numBytesRead\": " << stats.numBytesRead << ",\n";
+    stream << "      \"tilesPerSecond\": " << report.getTilesPerSecond() << ",\n";
+    stream << "      \"megabytesPerSecond\": " << report.getMegabytesPerSecond() << ",\n";
+    stream << "      \"numRequestsDropped\": " << stats.numRequestsDropped << ",\n";
+    stream << "      \"numRequestsCancelled\": " << stats.numRequestsCancelled << ",\n";
+    stream << "      \"numTileCacheHits\": " << stats.numTileCacheHits << ",\n";
+    stream << "      \"numTileCacheMisses\": " << stats.numTileCacheMisses << ",\n";
+
+    stream << "      \"latency\": {";
+    for( unsigned int phase = 0; phase < NUM_LATENCY_PHASES; ++phase )
+    {
+        stream << ( phase > 0 ? ",\n        \"" : "\n        \"" ) << LATENCY_PHASE_NAMES[phase] << "\": ";
+        writeLatencyJson( stream, report.latency.getPhase( static_cast<LatencyPhase>( phase ) ) );
+    }
+    stream << "\n      },\n";
+
+    // Queue depth samples are written as [time, depth] pairs.
+    stream << "      \"queueDepth\": [";
+    for( size_t i = 0; i < report.queueDepth.size(); ++i )
+    {
+        const QueueDepthSample& sample = report.queueDepth[i];
+        stream << ( i > 0 ? ", [" : "[" ) << sample.time << ", " << sample.depth << "]";
+    }
+    stream << "]\n    }";
+}
+
+}  // anonymous namespace
+
+void writeTraceReplayReport( std::ostream& stream, const std::vector<TraceReplayReport>& reports )
+{
+    stream << "{\n  \"version\": 1,\n  \"runs\": [\n";
+    for( size_t i = 0; i < reports.size(); ++i )
+    {
+        writeReportJson( stream, reports[i] );
+        stream << ( i + 1 < reports.size() ? ",\n" : "\n" );
+    }
+    stream << "  ]\n}\n";
+}
 
 }  // namespace demandLoading
@@ -25,17 +25,25 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
-
 #pragma once
 
+#include <OptiXToolkit/DemandLoading/LatencyStatistics.h>
+#include <OptiXToolkit/DemandLoading/Options.h>
 #include <OptiXToolkit/DemandLoading/Statistics.h>
+#include <OptiXToolkit/DemandLoading/TextureDescriptor.h>
+#include <OptiXToolkit/DemandLoading/TextureSampler.h>
 
 #include <cuda.h>
 
+#include <chrono>
 #include <fstream>
+#include <functional>
+#include <iosfwd>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <string>
+#include <vector>
 
 namespace imageSource {
 class ImageSource;
@@ -44,57 +52,237 @@ class ImageSource;
 namespace demandLoading {
 
 class DemandLoader;
-struct TextureDescriptor;
-struct Options;
 
+/// Trace files record the options, textures and page requests of a DemandLoader, so that its
+/// request processing can be replayed and analyzed offline.
+///
+/// Version 1 trace files are a headerless sequence of raw records.  Version 2 trace files begin
+/// with a header carrying a magic number and the version, followed by a sequence of blocks, each of
+/// which holds a number of records and may be compressed.  Every record is timestamped, and
+/// request batches carry their launch number.  Page ids are sorted and delta encoded as varints, so
+/// the order of the requests within a batch is not preserved.  (Request processing reorders them by
+/// priority class regardless.)
+/// Blocks are self-contained, so they can be decoded independently (e.g. in parallel), and an
+/// index of the blocks at the end of the file allows seeking by time.  If the index is missing
+/// (e.g. because the application crashed), the blocks are found by scanning the file.
+const unsigned int TRACE_FILE_VERSION = 2;
+
+/// Compression applied to the blocks of a trace file.  LZ4 and zstd are available if the
+/// library was built with them (see OTK_DEMAND_LOADING_TRACE_COMPRESSION).
+enum TraceCompression
+{
+    TRACE_COMPRESSION_NONE = 0,
+    TRACE_COMPRESSION_LZ4,
+    TRACE_COMPRESSION_ZSTD,
+    TRACE_COMPRESSION_DEFAULT  ///< The best compression available.
+};
+
+/// Check whether the given compression is available in this build.
+bool isTraceCompressionSupported( TraceCompression compression );
+
+/// Types of trace file records.  The values are those of version 1 trace files, which do not
+/// contain texture page records.
+enum TraceRecordType
+{
+    TRACE_RECORD_OPTIONS = 0,
+    TRACE_RECORD_TEXTURE,
+    TRACE_RECORD_REQUESTS,
+    TRACE_RECORD_TEXTURE_PAGES  ///< The range of tile pages reserved for a sparse texture.
+};
+
+/// A record read from a trace file.  Only the fields for the type of record are valid.
+struct TraceRecord
+{
+    TraceRecordType    type = TRACE_RECORD_OPTIONS;
+    unsigned long long timestamp = 0;  // Nanoseconds since the trace began (zero in version 1 traces).
+
+    // TRACE_RECORD_OPTIONS
+    Options options;
+
+    // TRACE_RECORD_TEXTURE
+    std::shared_ptr<imageSource::ImageSource> imageSource;
+    TextureDescriptor                         textureDesc;
+
+    // TRACE_RECORD_REQUESTS
+    unsigned int              launchNum   = 0;  // Zero in version 1 traces.
+    unsigned int              deviceIndex = 0;
+    unsigned int              streamId    = 0;
+    std::vector<unsigned int> pageIds;
+
+    // TRACE_RECORD_TEXTURE_PAGES
+    unsigned int              textureId = 0;
+    unsigned int              startPage = 0;
+    unsigned int              numPages  = 0;
+    std::vector<unsigned int> mipLevelStarts;  // Offset of each mip level from startPage, up to the mip tail.
+};
+
+/// Location and time span of a block of trace records.
+struct TraceBlockInfo
+{
+    unsigned long long offset;          // File offset of the block header.
+    unsigned long long firstTimestamp;  // Timestamp of the first record (nanoseconds).
+    unsigned long long lastTimestamp;   // Timestamp of the last record (nanoseconds).
+    unsigned int       numRecords;
+};
+
+/// TraceFileWriter records a version 2 trace file.  Records are encoded by the calling thread,
+/// and only appending them to the current block is serialized.  Full blocks are compressed and
+/// written while other threads continue to record.
 class TraceFileWriter
 {
   public:
-    /// Create trace file, opening the specified file.  Throws an exception on error.
-    TraceFileWriter( const char* filename );
+    /// Create trace file, opening the specified file.  Throws an exception on error, or if the
+    /// requested compression is not supported.
+    TraceFileWriter( const char* filename, TraceCompression compression = TRACE_COMPRESSION_DEFAULT );
 
-    /// Close the trace file.
+    /// Write any buffered records and the block index, and close the trace file.
     ~TraceFileWriter();
 
     /// Record demand loading options.
     void recordOptions( const Options& options );
 
-    /// Record createTexture call.
+    /// Record createTexture call.  Throws an exception if the image source cannot be serialized
+    /// (see imageSource::serializeImageSource).
     void recordTexture( std::shared_ptr<imageSource::ImageSource> imageSource, const TextureDescriptor& desc );
 
-    /// Record a batch of page requests.
-    void recordRequests( CUstream stream, const unsigned int* pageIds, unsigned int numPageIds );
+    /// Record the range of tile pages reserved for a sparse texture when it is initialized, which
+    /// allows page requests to be attributed to textures and mip levels offline.
+    void recordTexturePages( unsigned int textureId, const TextureSampler& sampler );
+
+    /// Record a batch of page requests from the specified launch.
+    void recordRequests( CUstream stream, unsigned int launchNum, const unsigned int* pageIds, unsigned int numPageIds );
+
+    /// Write the current block, even if it is not full.
+    void flush();
 
   private:
-    mutable std::mutex m_mutex;
-    std::ofstream      m_file;
+    // Guards the current block and the stream ids.
+    std::mutex                       m_mutex;
+    std::vector<char>                m_block;
+    unsigned int                     m_numBlockRecords = 0;
+    unsigned long long               m_blockStartTime  = 0;
+    unsigned long long               m_lastTimestamp   = 0;
     std::map<CUstream, unsigned int> m_streamIds;
-    unsigned int m_nextStreamId = 0;
+    unsigned int                     m_nextStreamId = 0;
 
-    template <typename T>
-    void write( const T& value )
-    {
-        m_file.write( reinterpret_cast<const char*>( &value ), sizeof( T ) );
-    }
+    // Guards the file and the block index.  Acquired before releasing m_mutex, so that blocks are
+    // written in order.
+    std::mutex                  m_fileMutex;
+    std::ofstream               m_file;
+    TraceCompression            m_compression;
+    std::vector<TraceBlockInfo> m_index;
 
-    template <typename T>
-    void write( const T* value, size_t count )
-    {
-        m_file.write( reinterpret_cast<const char*>( value ), count * sizeof( T ) );
-    }
+    const std::chrono::steady_clock::time_point m_startTime;
 
-    template <typename T>
-    void writeOption( const std::string& name, const T& value )
-    {
-        write( name );
-        write( value );
-    }
+    // Append an encoded record to the current block, writing the block if it is full.
+    void appendRecord( TraceRecordType type, const std::vector<char>& body );
+
+    // Write the current block.  The caller holds m_mutex, which is released.
+    void writeBlock( std::unique_lock<std::mutex>& lock );
 
     // CUDA streams are assigned integer identifiers as they are encountered.
     unsigned int getStreamId( CUstream stream );
 };
 
-/// Replay the specified trace file.  Throws an exception on error.
+/// TraceFileReader reads version 1 and version 2 trace files.  A version 1 trace is presented as a
+/// single block without timestamps.
+class TraceFileReader
+{
+  public:
+    /// Open the specified trace file and read its block index.  Throws an exception on error.
+    TraceFileReader( const char* filename );
+
+    /// Get the version of the trace file.
+    unsigned int getVersion() const { return m_version; }
+
+    /// Get the blocks of the trace file, in order.
+    const std::vector<TraceBlockInfo>& getBlocks() const { return m_blocks; }
+
+    /// Read and decode the records of the specified block.  Thread safe: only reading the block
+    /// from the file is serialized, so blocks can be decoded in parallel.
+    void readBlock( size_t blockIndex, std::vector<TraceRecord>& records ) const;
+
+    /// Read the demand loading options, which are recorded first.
+    Options readOptions() const;
+
+  private:
+    mutable std::mutex          m_mutex;
+    mutable std::ifstream       m_file;
+    unsigned int                m_version = 1;
+    std::vector<TraceBlockInfo> m_blocks;
+
+    void readIndex( unsigned long long fileSize );
+    void scanBlocks( unsigned long long fileSize );
+    void readVersion1( std::vector<TraceRecord>& records ) const;
+};
+
+/// Replay the specified trace file (version 1 or 2) as fast as possible.  Throws an exception on error.
 Statistics replayTraceFile( const char* filename );
 
+/// Configuration of a trace file replay.  A performance regression harness replays the same trace
+/// with a number of configurations, e.g. varying the thread count or cache sizes.
+struct TraceReplayConfig
+{
+    /// Name of the replay in the report.
+    std::string name;
+
+    /// Scale factor applied to the recorded time between request batches: 1 replays them in real
+    /// time, 2 at half speed, and 0 as fast as possible.  Paced batches are issued without waiting
+    /// for earlier ones to be filled, as in the recorded application, whereas batches replayed as
+    /// fast as possible are filled one at a time.  Version 1 traces have no timestamps, so they are
+    /// always replayed as fast as possible.
+    double timeScale = 0.0;
+
+    /// Interval in seconds at which the depth of the request queue is sampled (zero disables sampling).
+    double queueSampleInterval = 0.01;
+
+    /// Capacity in bytes of the process-wide TileCache used by CachingImageSource during the replay.
+    /// Zero keeps the current capacity.
+    size_t tileCacheSize = 0;
+
+    /// Optionally adjust the recorded options before the DemandLoader is created, e.g. to vary
+    /// maxThreads, maxRequestQueueSize or maxTexMemPerDevice.
+    std::function<void( Options& options )> adjustOptions;
+};
+
+/// Depth of the request queue at a point in a trace replay.
+struct QueueDepthSample
+{
+    double       time;   // Seconds since the replay began.
+    unsigned int depth;  // Number of queued page requests.
+};
+
+/// Results of a trace file replay.  \see replayTraceFile
+struct TraceReplayReport
+{
+    std::string                   name;
+    Options                       options;        // Options with which the trace was replayed.
+    double                        timeScale     = 0.0;
+    size_t                        tileCacheSize = 0;
+    double                        elapsedTime   = 0.0;  // Seconds from the first record until all batches were filled.
+    unsigned int                  numLaunches   = 0;    // Number of distinct launches that requested pages.
+    unsigned int                  numBatches    = 0;
+    size_t                        numRequests   = 0;
+    Statistics                    stats{};
+    LatencyStatistics             latency{};
+    std::vector<QueueDepthSample> queueDepth;
+
+    /// Get the number of tiles read per second of elapsed time.
+    double getTilesPerSecond() const { return elapsedTime > 0.0 ? stats.numTilesRead / elapsedTime : 0.0; }
+
+    /// Get the number of megabytes read per second of elapsed time.
+    double getMegabytesPerSecond() const
+    {
+        return elapsedTime > 0.0 ? stats.numBytesRead / ( 1024.0 * 1024.0 ) / elapsedTime : 0.0;
+    }
+};
+
+/// Replay the specified trace file (version 1 or 2) with the given configuration, measuring
+/// throughput, per-phase latencies and the depth of the request queue.  Throws an exception on error.
+TraceReplayReport replayTraceFile( const char* filename, const TraceReplayConfig& config );
+
+/// Write the given replay reports to the stream as a JSON document, which holds an array of runs
+/// with their options, throughput, latency percentiles per phase, and queue depth over time.
+void writeTraceReplayReport( std::ostream& stream, const std::vector<TraceReplayReport>& reports );
+
 }  // namespace demandLoading
@@ -90,6 +90,10 @@ class MockImageSource : public imageSource::ImageSource
                  readTile,
                  ( char* dest, unsigned int mipLevel, unsigned int tileX, unsigned int tileY, unsigned int tileWidth, unsigned int tileHeight, CUstream stream ),
                  ( override ) );
+    MOCK_METHOD( bool,
+                 readTiles,
+                 ( imageSource::TileRequest* requests, unsigned int numRequests, unsigned int tileWidth, unsigned int tileHeight, CUstream stream ),
+                 ( override ) );
     MOCK_METHOD( bool,
                  readMipLevel,
                  ( char* dest, unsigned int mipLevel, unsigned int expectedWidth, unsigned int expectedHeight, CUstream stream ),
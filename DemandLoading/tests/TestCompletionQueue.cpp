@@ -0,0 +1,164 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "CompletionQueue.h"
+#include "Util/Exception.h"
+
+#include <gtest/gtest.h>
+
+#include <cuda.h>
+#include <cuda_runtime.h>
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace demandLoading;
+
+class TestCompletionQueue : public testing::Test
+{
+  public:
+    void SetUp() override
+    {
+        DEMAND_CUDA_CHECK( cudaFree( nullptr ) );
+        m_streams.resize( 4 );
+        for( CUstream& stream : m_streams )
+            DEMAND_CUDA_CHECK( cuStreamCreate( &stream, CU_STREAM_NON_BLOCKING ) );
+    }
+
+    void TearDown() override
+    {
+        for( CUstream stream : m_streams )
+            DEMAND_CUDA_CHECK( cuStreamDestroy( stream ) );
+        for( CUevent event : m_events )
+            DEMAND_CUDA_CHECK( cuEventDestroy( event ) );
+    }
+
+  protected:
+    std::vector<CUstream> m_streams;
+    std::vector<CUevent>  m_events;
+
+    // Create an event, which is destroyed by TearDown (after the completion queue).
+    CUevent createEvent()
+    {
+        CUevent event;
+        DEMAND_CUDA_CHECK( cuEventCreate( &event, CU_EVENT_DISABLE_TIMING ) );
+        m_events.push_back( event );
+        return event;
+    }
+};
+
+TEST_F( TestCompletionQueue, RunsCallbacksInStreamOrder )
+{
+    const unsigned int            numCallbacks = 64;
+    std::mutex                    mutex;
+    std::vector<std::vector<int>> order( m_streams.size() );
+    {
+        CompletionQueue queue( 4 );
+        for( unsigned int i = 0; i < numCallbacks; ++i )
+        {
+            const size_t s = i % m_streams.size();
+            queue.enqueue( m_streams[s], createEvent(), [&mutex, &order, s, i]( CUresult ) {
+                std::unique_lock<std::mutex> lock( mutex );
+                order[s].push_back( i );
+            } );
+        }
+        // The destructor runs the outstanding callbacks.
+    }
+
+    unsigned int numRun = 0;
+    for( const std::vector<int>& streamOrder : order )
+    {
+        EXPECT_TRUE( std::is_sorted( streamOrder.begin(), streamOrder.end() ) );
+        numRun += static_cast<unsigned int>( streamOrder.size() );
+    }
+    EXPECT_EQ( numCallbacks, numRun );
+}
+
+TEST_F( TestCompletionQueue, RunsStreamsInParallel )
+{
+    // A callback on one stream blocks until a callback on another stream has run, which would
+    // deadlock if the callbacks were run serially.
+    std::mutex              mutex;
+    std::condition_variable cond;
+    bool                    secondRan = false;
+    bool                    firstRan  = false;
+
+    CompletionQueue queue( 2 );
+    queue.enqueue( m_streams[0], createEvent(), [&]( CUresult ) {
+        std::unique_lock<std::mutex> lock( mutex );
+        firstRan = cond.wait_for( lock, std::chrono::seconds( 10 ), [&] { return secondRan; } );
+    } );
+    queue.enqueue( m_streams[1], createEvent(), [&]( CUresult ) {
+        std::unique_lock<std::mutex> lock( mutex );
+        secondRan = true;
+        cond.notify_all();
+    } );
+
+    while( queue.size() > 0 )
+        std::this_thread::yield();
+    EXPECT_TRUE( secondRan );
+    EXPECT_TRUE( firstRan );
+}
+
+TEST_F( TestCompletionQueue, CallbacksMayCallCuda )
+{
+    // Unlike host functions enqueued with cuLaunchHostFunc, callbacks may make CUDA calls.
+    CUresult        result = CUDA_ERROR_NOT_READY;
+    CompletionQueue queue( 1 );
+    queue.enqueue( m_streams[0], createEvent(), [this, &result]( CUresult ) { result = cuStreamQuery( m_streams[0] ); } );
+    while( queue.size() > 0 )
+        std::this_thread::yield();
+    EXPECT_EQ( CUDA_SUCCESS, result );
+}
+
+TEST_F( TestCompletionQueue, CallbacksRunInStreamContext )
+{
+    CUcontext streamContext;
+    DEMAND_CUDA_CHECK( cuStreamGetCtx( m_streams[0], &streamContext ) );
+
+    CUcontext       callbackContext{};
+    CompletionQueue queue( 1 );
+    queue.enqueue( m_streams[0], createEvent(), [&callbackContext]( CUresult ) { DEMAND_CUDA_CHECK( cuCtxGetCurrent( &callbackContext ) ); } );
+    while( queue.size() > 0 )
+        std::this_thread::yield();
+    EXPECT_EQ( streamContext, callbackContext );
+}
+
+TEST_F( TestCompletionQueue, PassesEventStatus )
+{
+    CUresult        status = CUDA_ERROR_UNKNOWN;
+    CompletionQueue queue( 1 );
+    queue.enqueue( m_streams[0], createEvent(), [&status]( CUresult eventStatus ) { status = eventStatus; } );
+    while( queue.size() > 0 )
+        std::this_thread::yield();
+    EXPECT_EQ( CUDA_SUCCESS, status );
+}
@@ -29,6 +29,8 @@
 #include "CudaCheck.h"
 #include "DemandLoaderImpl.h"
 #include "DemandLoaderTestKernels.h"
+#include "Memory/DeviceMemoryManager.h"
+#include "TestExecutor.h"
 
 #include <OptiXToolkit/ImageSource/CheckerBoardImage.h>
 
@@ -43,7 +45,9 @@ using namespace demandLoading;
 using namespace imageSource;
 
 
-class TestDemandLoader : public testing::Test
+// The loader is tested with its own request processing threads (false) and with a user-supplied
+// executor (true).
+class TestDemandLoader : public testing::TestWithParam<bool>
 {
   public:
     void SetUp() override
@@ -63,7 +67,10 @@ class TestDemandLoader : public testing::Test
         }
 
         // Create DemandLoader
-        m_loader = dynamic_cast<DemandLoaderImpl*>( createDemandLoader( Options() ) );
+        Options options;
+        if( GetParam() )
+            options.executor = std::make_shared<TestExecutor>( 4 );
+        m_loader = dynamic_cast<DemandLoaderImpl*>( createDemandLoader( options ) );
 
         // Create ImageSource
         m_imageSource =
@@ -114,12 +121,12 @@ class TestDemandLoader : public testing::Test
     TextureDescriptor            m_descriptor{};
 };
 
-TEST_F( TestDemandLoader, TestCreateDestroy )
+TEST_P( TestDemandLoader, TestCreateDestroy )
 {
     // No operations
 }
 
-TEST_F( TestDemandLoader, TestCreateTexture )
+TEST_P( TestDemandLoader, TestCreateTexture )
 {
     m_loader->createTexture( m_imageSource, m_descriptor );
     // The texture is opaque, so we can't really validate it.
@@ -177,7 +184,7 @@ class TestDemandLoaderResident : public TestDemandLoader
     std::vector<unsigned long long*> m_devPageTableEntry;
 };
 
-TEST_F( TestDemandLoaderResident, TestSamplerRequest )
+TEST_P( TestDemandLoaderResident, TestSamplerRequest )
 {
     const DemandTexture& texture = m_loader->createTexture( m_imageSource, m_descriptor );
     const unsigned int   pageId  = texture.getId();
@@ -214,7 +221,7 @@ class MockResourceLoader
     }
 };
 
-TEST_F( TestDemandLoaderResident, TestResourceRequest )
+TEST_P( TestDemandLoaderResident, TestResourceRequest )
 {
     // TODO: this fails with multiple GPUs under both Windows and Linux.
     //const std::vector<unsigned int> devices = m_loader->getDevices();
@@ -250,7 +257,7 @@ TEST_F( TestDemandLoaderResident, TestResourceRequest )
     }
 }
 
-TEST_F( TestDemandLoaderResident, TestDeferredResourceRequest )
+TEST_P( TestDemandLoaderResident, TestDeferredResourceRequest )
 {
     // TODO: this fails with multiple GPUs under both Windows and Linux.
     //const std::vector<unsigned int> devices = m_loader->getDevices();
@@ -289,7 +296,48 @@ TEST_F( TestDemandLoaderResident, TestDeferredResourceRequest )
     }
 }
 
-TEST_F( TestDemandLoader, TestTextureVariants )
+TEST_P( TestDemandLoaderResident, TestTileReclamation )
+{
+    // Limit the tile pool to a few arenas, so that filling twice as many tiles requires staged tiles
+    // to be freed and their blocks reused.
+    DEMAND_CUDA_CHECK( cudaSetDevice( 0 ) );
+    const size_t arenaSize = m_loader->getDeviceMemoryManager()->getTilePoolArenaSize();
+    m_loader->setMaxTextureMemory( 4 * arenaSize );
+    const unsigned int numTiles = static_cast<unsigned int>( 2 * 4 * arenaSize / ( 64 * 1024 ) );
+
+    // Request the sampler, which initializes the texture.
+    std::shared_ptr<ImageSource> image( new CheckerBoardImage( 8192, 8192, 32 /*squaresPerSide*/, true /*useMipmaps*/ ) );
+    const DemandTexture& texture = m_loader->createTexture( image, m_descriptor );
+    bool                 isResident{};
+    launchKernelAndSynchronize( 0, texture.getId(), &isResident );
+    const TextureSampler& sampler = m_loader->getTexture( texture.getId() )->getSampler();
+    ASSERT_LT( numTiles, sampler.numPages );
+
+    // Request each tile (skipping the mip tail) until it is resident.  Tiles that are no longer
+    // requested become stale and are staged, and are then freed by the reclaimer or by the fill
+    // that finds the pool exhausted.
+    for( unsigned int i = 1; i <= numTiles; ++i )
+    {
+        isResident = false;
+        for( int attempt = 0; attempt < 8 && !isResident; ++attempt )
+            launchKernelAndSynchronize( 0, sampler.startPage + i, &isResident );
+        ASSERT_TRUE( isResident ) << "Tile " << i << " was not filled";
+    }
+}
+
+TEST_P( TestDemandLoader, TestDestroyWithPendingReclamation )
+{
+    // With a single arena the tile pool's reserve is always low, so each call wakes the reclaimer.
+    // Destroying the loader must stop the reclaimer even though requests are pending.
+    DEMAND_CUDA_CHECK( cudaSetDevice( 0 ) );
+    m_loader->setMaxTextureMemory( m_loader->getDeviceMemoryManager()->getTilePoolArenaSize() );
+    for( int i = 0; i < 100; ++i )
+        m_loader->requestTileReclamation();
+    destroyDemandLoader( m_loader );
+    m_loader = nullptr;
+}
+
+TEST_P( TestDemandLoader, TestTextureVariants )
 {
     // Make first texture
     TextureDescriptor  texDesc1 = m_descriptor;
@@ -423,7 +471,7 @@ void TestDemandLoaderBatches::testBatch( CUstream stream )
     cudaFree( devPageTableEntries );
 }
 
-TEST_F( TestDemandLoaderBatches, LoopTest )
+TEST_P( TestDemandLoaderBatches, LoopTest )
 {
     for( unsigned int device : m_loader->getDevices() )
     {
@@ -432,3 +480,7 @@ TEST_F( TestDemandLoaderBatches, LoopTest )
             testBatch( m_streams[device] );
     }
 }
+
+INSTANTIATE_TEST_SUITE_P( Executors, TestDemandLoader, testing::Bool() );
+INSTANTIATE_TEST_SUITE_P( Executors, TestDemandLoaderResident, testing::Bool() );
+INSTANTIATE_TEST_SUITE_P( Executors, TestDemandLoaderBatches, testing::Bool() );
@@ -29,6 +29,7 @@
 #include "CudaCheck.h"
 #include "DemandLoaderTestKernels.h"
 #include "ErrorCheck.h"
+#include "TestExecutor.h"
 
 #include "Util/Exception.h"
 
@@ -53,7 +54,8 @@ public:
   MOCK_METHOD( void, stop, () );
 };
 
-class DemandPageLoaderTest : public Test
+// The page loader is tested without and with a user-supplied executor in its options.
+class DemandPageLoaderTest : public TestWithParam<bool>
 {
   public:
     void SetUp() override
@@ -62,7 +64,10 @@ class DemandPageLoaderTest : public Test
         ERROR_CHECK( cuStreamCreate( &m_stream, 0 ) );
         ERROR_CHECK( cudaMalloc( &m_devIsResident, sizeof( bool ) ) );
         ERROR_CHECK( cudaMalloc( &m_devPageTableEntry, sizeof( unsigned long long ) ) );
-        m_loader      = createDemandPageLoader( &m_processor, demandLoading::Options{} );
+        demandLoading::Options options{};
+        if( GetParam() )
+            options.executor = std::make_shared<demandLoading::TestExecutor>( 4 );
+        m_loader      = createDemandPageLoader( &m_processor, options );
         m_deviceIndex = m_loader->getDevices()[0];
         DEMAND_CUDA_CHECK( cudaSetDevice( m_deviceIndex ) );
     }
@@ -107,12 +112,12 @@ class DemandPageLoaderTest : public Test
 
 }  // namespace
 
-TEST_F( DemandPageLoaderTest, create_destroy )
+TEST_P( DemandPageLoaderTest, create_destroy )
 {
     // create done in SetUp, destroy done in TearDown
 }
 
-TEST_F( DemandPageLoaderTest, request_non_resident_page )
+TEST_P( DemandPageLoaderTest, request_non_resident_page )
 {
     unsigned int actualRequestedPage{};
     EXPECT_CALL( m_processor, addRequests( m_stream, _, NotNull(), 1 ) ).WillOnce( SaveArgPointee<2>( &actualRequestedPage ) );
@@ -128,7 +133,7 @@ TEST_F( DemandPageLoaderTest, request_non_resident_page )
     EXPECT_EQ( requestedPage, actualRequestedPage );
 }
 
-TEST_F( DemandPageLoaderTest, request_resident_page )
+TEST_P( DemandPageLoaderTest, request_resident_page )
 {
     unsigned int actualRequestedPage{};
     EXPECT_CALL( m_processor, addRequests( m_stream, 0, NotNull(), 1 ) ).WillOnce( SaveArgPointee<2>( &actualRequestedPage ) );
@@ -146,3 +151,5 @@ TEST_F( DemandPageLoaderTest, request_resident_page )
     EXPECT_TRUE( getIsResident() );
     EXPECT_EQ( requestedPage, actualRequestedPage );
 }
+
+INSTANTIATE_TEST_SUITE_P( Executors, DemandPageLoaderTest, Bool() );
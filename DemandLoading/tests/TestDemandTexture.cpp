@@ -32,6 +32,8 @@
 #include "DemandLoaderImpl.h"
 #include "Memory/DeviceMemoryManager.h"
 #include "PageTableManager.h"
+#include "RequestQueue.h"
+#include "Textures/TextureRequestHandler.h"
 #include "Textures/DemandTextureImpl.h"
 
 #include <OptiXToolkit/DemandLoading/DemandTexture.h>
@@ -43,6 +45,7 @@
 
 #include <cuda.h>
 
+#include <algorithm>
 #include <memory>
 
 using namespace demandLoading;
@@ -113,6 +116,33 @@ TEST_F( TestDemandTexture, TestInitNonMipMapped )
     initTexture(256, 256, false);
 }
 
+TEST_F( TestDemandTexture, TestRequestPriorities )
+{
+    initTexture( 2048, 2048 );
+    const TextureSampler&  sampler = m_texture->getSampler();
+    TextureRequestHandler* handler = m_texture->getRequestHandler();
+    ASSERT_LT( 1u, sampler.mipTailFirstLevel );
+
+    // The mip tail is class 0, the level just above it is class 1, and finer levels follow.
+    const unsigned int coarsestLevel = sampler.mipTailFirstLevel - 1;
+    EXPECT_EQ( 0u, handler->getPriority( sampler.startPage ) );
+    EXPECT_EQ( 1u, handler->getPriority( handler->getTextureTilePageId( coarsestLevel, 0, 0 ) ) );
+    EXPECT_EQ( 2u, handler->getPriority( handler->getTextureTilePageId( coarsestLevel - 1, 0, 0 ) ) );
+    EXPECT_EQ( std::min( sampler.mipTailFirstLevel, NUM_REQUEST_PRIORITIES - 1 ),
+               handler->getPriority( handler->getTextureTilePageId( 0, 0, 0 ) ) );
+}
+
+TEST_F( TestDemandTexture, TestRequestPrioritiesNonMipMapped )
+{
+    initTexture( 2048, 2048, false );
+    const TextureSampler&  sampler = m_texture->getSampler();
+    TextureRequestHandler* handler = m_texture->getRequestHandler();
+
+    // Without a mip tail, the first page is an ordinary tile, which is not class 0.
+    EXPECT_LT( 0u, handler->getPriority( sampler.startPage ) );
+    EXPECT_EQ( handler->getPriority( sampler.startPage ), handler->getPriority( handler->getTextureTilePageId( 0, 1, 1 ) ) );
+}
+
 TEST_F( TestDemandTexture, TestFillTile )
 {
     initTexture(256, 256);
@@ -0,0 +1,312 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "CudaCheck.h"
+#include "PagingSystemHostKernels.h"
+#include "Util/EvictionSimulator.h"
+#include "Util/TraceFile.h"
+
+#include <OptiXToolkit/DemandLoading/LRU.h>
+#include <OptiXToolkit/DemandLoading/Options.h>
+
+#include <cuda_runtime.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace demandLoading;
+
+namespace {
+
+// Host arrays for the paging kernels, sized like the device arrays of TestPagingSystemKernels.
+class HostContext
+{
+  public:
+    HostContext()
+        : referenceBits( 33, 0 )
+        , residenceBits( 33, 0 )
+        , lruTable( 129, 0 )
+        , requestedPages( 65, 0 )
+        , stalePages( 33, StalePage{0, 0, 0} )
+        , arrayLengths( NUM_ARRAY_LENGTHS, 0 )
+        , filledPages( 63 )
+        , invalidatedPages( 31 )
+    {
+        context                  = DeviceContext{};
+        context.maxNumPages      = 1025;
+        context.referenceBits    = referenceBits.data();
+        context.residenceBits    = residenceBits.data();
+        context.lruTable         = lruTable.data();
+        context.requestedPages   = DeviceArray<unsigned int>{requestedPages.data(), 65};
+        context.stalePages       = DeviceArray<StalePage>{stalePages.data(), 33};
+        context.arrayLengths     = DeviceArray<unsigned int>{arrayLengths.data(), NUM_ARRAY_LENGTHS};
+        context.filledPages      = DeviceArray<PageMapping>{filledPages.data(), 63};
+        context.invalidatedPages = DeviceArray<unsigned int>{invalidatedPages.data(), 31};
+    }
+
+    void pullRequests( unsigned int launchNum, unsigned int lruThreshold )
+    {
+        std::fill( arrayLengths.begin(), arrayLengths.end(), 0 );
+        hostPullRequests( context, launchNum, lruThreshold, 0, context.maxNumPages );
+    }
+
+    std::vector<unsigned int> getRequestedPages() const
+    {
+        return std::vector<unsigned int>( requestedPages.begin(), requestedPages.begin() + arrayLengths[PAGE_REQUESTS_LENGTH] );
+    }
+
+    unsigned int getLruVal( unsigned int pageId ) const { return ( lruTable[pageId / 8] >> ( 4 * ( pageId % 8 ) ) ) & 0xf; }
+
+    std::vector<unsigned int> referenceBits;
+    std::vector<unsigned int> residenceBits;
+    std::vector<unsigned int> lruTable;
+    std::vector<unsigned int> requestedPages;
+    std::vector<StalePage>    stalePages;
+    std::vector<unsigned int> arrayLengths;
+    std::vector<PageMapping>  filledPages;
+    std::vector<unsigned int> invalidatedPages;
+    DeviceContext             context;
+};
+
+std::vector<unsigned int> getHits( const EvictionSimulationResult& result )
+{
+    std::vector<unsigned int> hits;
+    for( const EvictionFrameStats& frame : result.frames )
+        hits.push_back( frame.numHits );
+    return hits;
+}
+
+std::vector<unsigned int> getEvictions( const EvictionSimulationResult& result )
+{
+    std::vector<unsigned int> evictions;
+    for( const EvictionFrameStats& frame : result.frames )
+        evictions.push_back( frame.numEvictions );
+    return evictions;
+}
+
+Options makeOptions()
+{
+    Options options;
+    options.numPages            = 64;
+    options.numPageTableEntries = 16;
+    return options;
+}
+
+}  // anonymous namespace
+
+class TestEvictionSimulator : public testing::Test
+{
+};
+
+TEST_F( TestEvictionSimulator, HostPullRequests )
+{
+    // Request all the pages of the first word, some of which are resident.
+    HostContext host;
+    host.residenceBits[0] = 0x0F0F0F0F;
+    host.referenceBits[0] = 0xFFFFFFFF;
+    host.pullRequests( 0, 4 );
+
+    // Unlike the device, the host lists pages in increasing order.
+    EXPECT_EQ( std::vector<unsigned int>( {4, 5, 6, 7, 12, 13, 14, 15, 20, 21, 22, 23, 28, 29, 30, 31} ), host.getRequestedPages() );
+    EXPECT_EQ( 0U, host.arrayLengths[STALE_PAGES_LENGTH] );
+}
+
+TEST_F( TestEvictionSimulator, HostStalePages )
+{
+    // The first 32 pages are resident but not referenced.  The LRU values of the first 16 pages
+    // are their page ids, and 0xF is the non-evictable value.
+    HostContext host;
+    host.residenceBits[0] = 0xFFFFFFFF;
+    host.lruTable[0]      = 0x76543210;
+    host.lruTable[1]      = 0xFEDCBA98;
+    host.pullRequests( 0, 4 );
+
+    ASSERT_EQ( 11U, host.arrayLengths[STALE_PAGES_LENGTH] );
+    for( unsigned int i = 0; i < 11; ++i )
+    {
+        EXPECT_EQ( i + 4, host.stalePages[i].pageId );
+        EXPECT_EQ( i + 4, host.stalePages[i].lruVal );
+    }
+
+    // Aging increments the LRU values of zero, since the increment interval grows with the value.
+    EXPECT_EQ( 0x76543211U, host.lruTable[0] );
+    EXPECT_EQ( 0xFEDCBA98U, host.lruTable[1] );
+    EXPECT_EQ( 0x11111111U, host.lruTable[2] );
+    EXPECT_EQ( 0x11111111U, host.lruTable[3] );
+}
+
+TEST_F( TestEvictionSimulator, LruValuesAgeLogarithmically )
+{
+    // Page 40 is resident, but not referenced.  Its LRU value is incremented when the launch number
+    // plus the page id is a multiple of 2^lruVal.
+    HostContext        host;
+    const unsigned int pageId = 40;
+    host.residenceBits[pageId / 32] |= 1U << ( pageId % 32 );
+    std::vector<unsigned int> lruVals;
+    for( unsigned int launchNum = 1; launchNum <= 24; ++launchNum )
+    {
+        host.pullRequests( launchNum, NON_EVICTABLE_LRU_VAL );
+        lruVals.push_back( host.getLruVal( pageId ) );
+    }
+    EXPECT_EQ( 1U, lruVals[0] );
+    EXPECT_EQ( 2U, lruVals[1] );
+    EXPECT_EQ( 3U, lruVals[3] );
+    EXPECT_EQ( 4U, lruVals[7] );
+    EXPECT_EQ( 4U, lruVals[22] );
+    EXPECT_EQ( 5U, lruVals[23] );
+
+    // A reference resets the LRU value.
+    host.referenceBits[pageId / 32] |= 1U << ( pageId % 32 );
+    host.pullRequests( 25, NON_EVICTABLE_LRU_VAL );
+    EXPECT_EQ( 0U, host.getLruVal( pageId ) );
+}
+
+TEST_F( TestEvictionSimulator, HostPushMappingsAndInvalidatePages )
+{
+    HostContext host;
+    host.filledPages[0] = PageMapping{3, 0, 0};
+    host.filledPages[1] = PageMapping{40, 5, 0};
+    hostPushMappings( host.context, 2 );
+    EXPECT_EQ( 1U << 3, host.residenceBits[0] );
+    EXPECT_EQ( 1U << 8, host.residenceBits[1] );
+    EXPECT_EQ( 5U, host.getLruVal( 40 ) );
+
+    host.invalidatedPages[0] = 3;
+    hostInvalidatePages( host.context, 1 );
+    EXPECT_EQ( 0U, host.residenceBits[0] );
+    EXPECT_EQ( 1U << 8, host.residenceBits[1] );
+}
+
+TEST_F( TestEvictionSimulator, NextLruThreshold )
+{
+    // No change unless stale pages were requested.
+    EXPECT_EQ( 8U, nextLruThreshold( 8, 0, 0, 12 ) );
+
+    // Drop quickly when too few stale pages were returned, but not below the minimum.
+    EXPECT_EQ( 4U, nextLruThreshold( 8, 10, 100, 12 ) );
+    EXPECT_EQ( 6U, nextLruThreshold( 8, 60, 100, 12 ) );
+    EXPECT_EQ( MIN_LRU_THRESHOLD, nextLruThreshold( 3, 10, 100, 12 ) );
+
+    // Rise gradually when the median LRU value exceeds the threshold.
+    EXPECT_EQ( 9U, nextLruThreshold( 8, 100, 100, 12 ) );
+    EXPECT_EQ( 8U, nextLruThreshold( 8, 100, 100, 8 ) );
+}
+
+TEST_F( TestEvictionSimulator, ThresholdLru )
+{
+    // Two tiles fill memory.  A third tile cannot be loaded until a stale tile has aged past the
+    // LRU threshold and been staged, and its invalidation has been pushed.
+    std::vector<TraceLaunch> launches{{0, {20, 21}}, {1, {20, 21}}, {2, {22}}, {3, {22}}, {4, {22}}, {5, {22}}};
+    ThresholdLruPolicy             policy( makeOptions(), 2 );
+    const EvictionSimulationResult result = simulateEviction( policy, launches );
+
+    EXPECT_EQ( std::vector<unsigned int>( {0, 2, 0, 0, 0, 1} ), getHits( result ) );
+    EXPECT_EQ( std::vector<unsigned int>( {0, 0, 0, 0, 1, 0} ), getEvictions( result ) );
+    EXPECT_EQ( 3U, result.numHits );
+    EXPECT_EQ( 5U, result.numMisses );
+    EXPECT_EQ( 2U, result.frames.back().numResident );
+}
+
+TEST_F( TestEvictionSimulator, Clock )
+{
+    std::vector<TraceLaunch> launches{{0, {1}}, {1, {2}}, {2, {1}}, {3, {3}}, {4, {1}}, {5, {3}}};
+    std::unique_ptr<EvictionPolicy> policy = createEvictionPolicy( EVICTION_CLOCK, makeOptions(), 2 );
+    const EvictionSimulationResult  result = simulateEviction( *policy, launches );
+
+    // The hand clears both reference bits before evicting page 1, and then evicts page 2.
+    EXPECT_EQ( std::vector<unsigned int>( {0, 0, 1, 0, 0, 1} ), getHits( result ) );
+    EXPECT_EQ( std::vector<unsigned int>( {0, 0, 0, 1, 1, 0} ), getEvictions( result ) );
+}
+
+TEST_F( TestEvictionSimulator, ArcResistsScans )
+{
+    // Pages 1 and 2 are referenced repeatedly, and then a scan of other pages passes through.
+    std::vector<TraceLaunch> launches{{0, {1, 2}}, {1, {1, 2}}};
+    for( unsigned int pageId = 10; pageId < 16; ++pageId )
+        launches.push_back( TraceLaunch{pageId, {pageId}} );
+    launches.push_back( TraceLaunch{16, {1, 2}} );
+
+    std::unique_ptr<EvictionPolicy> arc   = createEvictionPolicy( EVICTION_ARC, makeOptions(), 4 );
+    std::unique_ptr<EvictionPolicy> clock = createEvictionPolicy( EVICTION_CLOCK, makeOptions(), 4 );
+    EXPECT_EQ( 2U, simulateEviction( *arc, launches ).frames.back().numHits );
+    EXPECT_EQ( 0U, simulateEviction( *clock, launches ).frames.back().numHits );
+}
+
+TEST_F( TestEvictionSimulator, NoEvictionsWhenAllTilesFit )
+{
+    std::vector<TraceLaunch> launches{{0, {20, 21, 22}}, {1, {21, 23}}, {2, {20, 22, 23}}};
+    for( EvictionPolicyType type : {EVICTION_THRESHOLD_LRU, EVICTION_CLOCK, EVICTION_ARC, EVICTION_RANDOM} )
+    {
+        std::unique_ptr<EvictionPolicy> policy = createEvictionPolicy( type, makeOptions(), 4 );
+        const EvictionSimulationResult  result = simulateEviction( *policy, launches );
+        EXPECT_EQ( 4U, result.numMisses ) << result.policyName;
+        EXPECT_EQ( 4U, result.numHits ) << result.policyName;
+        EXPECT_EQ( 0U, result.numEvictions ) << result.policyName;
+    }
+}
+
+TEST_F( TestEvictionSimulator, SimulateTraceFile )
+{
+    DEMAND_CUDA_CHECK( cudaSetDevice( 0 ) );
+    DEMAND_CUDA_CHECK( cudaFree( nullptr ) );
+    CUstream stream;
+    DEMAND_CUDA_CHECK( cuStreamCreate( &stream, 0 ) );
+
+    const char* traceFilename = "DemandLoadingEvictionSimulator.dat";
+    {
+        Options options            = makeOptions();
+        options.maxTexMemPerDevice = 2 * 64 * 1024;
+        TraceFileWriter writer( traceFilename );
+        writer.recordOptions( options );
+
+        // A sampler page is skipped, and the requests of a launch from two streams are merged.
+        const unsigned int pageIds[] = {0, 20, 21, 22};
+        writer.recordRequests( stream, 0, pageIds, 3 );
+        writer.recordRequests( stream, 0, pageIds + 1, 1 );
+        writer.recordRequests( stream, 1, pageIds + 3, 1 );
+    }
+    DEMAND_CUDA_CHECK( cuStreamDestroy( stream ) );
+
+    Options                        options;
+    const std::vector<TraceLaunch> launches = readTraceLaunches( traceFilename, options );
+    ASSERT_EQ( 2U, launches.size() );
+    EXPECT_EQ( std::vector<unsigned int>( {20, 21} ), launches[0].pageIds );
+    EXPECT_EQ( std::vector<unsigned int>( {22} ), launches[1].pageIds );
+
+    const std::vector<EvictionSimulationResult> results = simulateEviction( traceFilename, EvictionSimulationOptions() );
+    ASSERT_EQ( 4U, results.size() );
+    EXPECT_EQ( "threshold-LRU", results[0].policyName );
+    EXPECT_EQ( "random", results[3].policyName );
+    for( const EvictionSimulationResult& result : results )
+    {
+        EXPECT_EQ( 2U, result.capacity );
+        EXPECT_EQ( 2U, result.frames.size() );
+        EXPECT_EQ( 3U, result.numMisses );
+    }
+}
@@ -0,0 +1,104 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <OptiXToolkit/DemandLoading/Executor.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace demandLoading {
+
+// Minimal thread pool standing in for a host application's task system.
+class TestExecutor : public Executor
+{
+  public:
+    explicit TestExecutor( unsigned int numThreads )
+    {
+        for( unsigned int i = 0; i < numThreads; ++i )
+            m_threads.emplace_back( &TestExecutor::worker, this );
+    }
+
+    ~TestExecutor() override
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_isShutDown = true;
+        }
+        m_taskAvailable.notify_all();
+        for( std::thread& thread : m_threads )
+            thread.join();
+    }
+
+    void submit( std::function<void()> task ) override
+    {
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_tasks.push_back( std::move( task ) );
+        }
+        m_numSubmitted.fetch_add( 1 );
+        m_taskAvailable.notify_one();
+    }
+
+    unsigned int getMaxConcurrency() const override { return static_cast<unsigned int>( m_threads.size() ); }
+
+    unsigned int getNumSubmitted() const { return m_numSubmitted.load(); }
+
+  private:
+    std::vector<std::thread>          m_threads;
+    std::deque<std::function<void()>> m_tasks;
+    std::mutex                        m_mutex;
+    std::condition_variable           m_taskAvailable;
+    bool                              m_isShutDown = false;
+    std::atomic<unsigned int>         m_numSubmitted{0};
+
+    void worker()
+    {
+        while( true )
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock( m_mutex );
+                m_taskAvailable.wait( lock, [this] { return m_isShutDown || !m_tasks.empty(); } );
+                if( m_tasks.empty() )
+                    return;
+                task = std::move( m_tasks.front() );
+                m_tasks.pop_front();
+            }
+            task();
+        }
+    }
+};
+
+}  // namespace demandLoading
@@ -0,0 +1,206 @@
+//
+// Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include "HostPageTable.h"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace demandLoading;
+
+class TestHostPageTable : public testing::Test
+{
+  public:
+    HostPageTable table;
+
+    TestHostPageTable()
+        : table( 1024u * 1024u )
+    {
+    }
+};
+
+TEST_F( TestHostPageTable, EmptyNotFound )
+{
+    HostPageTableEntry entry;
+    EXPECT_FALSE( table.find( 0, &entry ) );
+    EXPECT_FALSE( table.isResident( 0, nullptr ) );
+    EXPECT_FALSE( table.erase( 0 ) );
+}
+
+TEST_F( TestHostPageTable, OutOfRangeNotFound )
+{
+    HostPageTableEntry entry;
+    EXPECT_FALSE( table.find( table.getNumPages(), &entry ) );
+    EXPECT_FALSE( table.isResident( table.getNumPages(), nullptr ) );
+}
+
+TEST_F( TestHostPageTable, SetFind )
+{
+    table.set( 5000, HostPageTableEntry{42, false, true, true} );
+
+    HostPageTableEntry entry;
+    ASSERT_TRUE( table.find( 5000, &entry ) );
+    EXPECT_EQ( 42ULL, entry.entry );
+    EXPECT_FALSE( entry.resident );
+    EXPECT_TRUE( entry.staged );
+    EXPECT_TRUE( entry.inStagedList );
+    EXPECT_FALSE( table.find( 5001, &entry ) );
+}
+
+TEST_F( TestHostPageTable, IsResident )
+{
+    table.set( 7, HostPageTableEntry{42, true, false, false} );
+    table.set( 8, HostPageTableEntry{43, false, true, true} );
+
+    unsigned long long entry = 0;
+    EXPECT_TRUE( table.isResident( 7, &entry ) );
+    EXPECT_EQ( 42ULL, entry );
+    EXPECT_FALSE( table.isResident( 8, &entry ) );
+}
+
+TEST_F( TestHostPageTable, Erase )
+{
+    table.set( 7, HostPageTableEntry{42, true, false, false} );
+    EXPECT_TRUE( table.erase( 7 ) );
+    EXPECT_FALSE( table.erase( 7 ) );
+
+    HostPageTableEntry entry;
+    EXPECT_FALSE( table.find( 7, &entry ) );
+}
+
+TEST_F( TestHostPageTable, FindNext )
+{
+    const unsigned int pages[] = {3, 4095, 4096, 500000, 1024u * 1024u - 1};
+    for( unsigned int pageId : pages )
+        table.set( pageId, HostPageTableEntry{pageId, true, false, false} );
+
+    std::vector<unsigned int> found;
+    for( unsigned int pageId = table.findNext( 0, table.getNumPages() ); pageId < table.getNumPages();
+         pageId              = table.findNext( pageId + 1, table.getNumPages() ) )
+        found.push_back( pageId );
+    EXPECT_EQ( std::vector<unsigned int>( std::begin( pages ), std::end( pages ) ), found );
+
+    EXPECT_EQ( 4095u, table.findNext( 4, 10000 ) );
+    EXPECT_EQ( 400000u, table.findNext( 4097, 400000 ) );
+}
+
+TEST_F( TestHostPageTable, ConcurrentSetFind )
+{
+    const unsigned int       numThreads     = 4;
+    const unsigned int       pagesPerThread = 10000;
+    std::vector<std::thread> threads;
+    for( unsigned int t = 0; t < numThreads; ++t )
+    {
+        threads.emplace_back( [this, t] {
+            for( unsigned int i = 0; i < pagesPerThread; ++i )
+            {
+                const unsigned int pageId = i * numThreads + t;
+                table.set( pageId, HostPageTableEntry{pageId, true, false, false} );
+            }
+        } );
+    }
+    for( std::thread& thread : threads )
+        thread.join();
+
+    for( unsigned int pageId = 0; pageId < numThreads * pagesPerThread; ++pageId )
+    {
+        unsigned long long entry = 0;
+        EXPECT_TRUE( table.isResident( pageId, &entry ) );
+        EXPECT_EQ( pageId, entry );
+    }
+}
+
+// Compare the flat page table against the std::map it replaced, performing the sequence of
+// operations a tile goes through: a mapping is added, checked for residency, staged and freed.
+TEST( TestHostPageTableBenchmark, DISABLED_MapVsFlatTable )
+{
+    const unsigned int numPages    = 8u * 1024u * 1024u;
+    const unsigned int numResident = 256u * 1024u;
+
+    std::mt19937                                rng( 1 );
+    std::uniform_int_distribution<unsigned int> pageDist( 0, numPages - 1 );
+    std::vector<unsigned int>                   pageIds( numResident );
+    for( unsigned int& pageId : pageIds )
+        pageId = pageDist( rng );
+
+    typedef std::chrono::duration<double> seconds;
+    size_t numFound = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    {
+        std::map<unsigned int, HostPageTableEntry> map;
+        for( unsigned int pageId : pageIds )
+            map[pageId] = HostPageTableEntry{pageId, true, false, false};
+        for( unsigned int pageId : pageIds )
+        {
+            auto p = map.find( pageId );
+            numFound += ( p != map.end() && p->second.resident ) ? 1 : 0;
+        }
+        for( unsigned int pageId : pageIds )
+        {
+            auto p = map.find( pageId );
+            if( p != map.end() )
+            {
+                p->second.resident = false;
+                p->second.staged   = true;
+            }
+        }
+        for( unsigned int pageId : pageIds )
+            map.erase( pageId );
+    }
+    const seconds mapTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    {
+        HostPageTable table( numPages );
+        for( unsigned int pageId : pageIds )
+            table.set( pageId, HostPageTableEntry{pageId, true, false, false} );
+        for( unsigned int pageId : pageIds )
+            numFound -= table.isResident( pageId, nullptr ) ? 1 : 0;
+        for( unsigned int pageId : pageIds )
+        {
+            HostPageTableEntry entry;
+            if( table.find( pageId, &entry ) )
+                table.set( pageId, HostPageTableEntry{entry.entry, false, true, entry.inStagedList} );
+        }
+        for( unsigned int pageId : pageIds )
+            table.erase( pageId );
+    }
+    const seconds tableTime = std::chrono::steady_clock::now() - start;
+
+    // Both tables found the same pages.
+    EXPECT_EQ( 0u, numFound );
+
+    std::cout << "[ HostPageTable ] " << numResident << " pages: std::map " << mapTime.count() << " sec, flat table "
+              << tableTime.count() << " sec\n";
+}
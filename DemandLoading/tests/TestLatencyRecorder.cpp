@@ -0,0 +1,171 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Util/LatencyRecorder.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace demandLoading;
+
+TEST( TestLatencyRecorder, BucketIndexIsExactForSmallValues )
+{
+    for( unsigned long long us = 0; us < LatencyHistogram::NUM_SUB_BUCKETS; ++us )
+    {
+        EXPECT_EQ( us, LatencyHistogram::getBucketIndex( us ) );
+        EXPECT_EQ( us, LatencyHistogram::getBucketLowerBound( static_cast<unsigned int>( us ) ) );
+    }
+}
+
+TEST( TestLatencyRecorder, BucketBoundsAreConsistent )
+{
+    for( unsigned int i = 0; i + 1 < LatencyHistogram::NUM_BUCKETS; ++i )
+    {
+        const unsigned long long lower = LatencyHistogram::getBucketLowerBound( i );
+        const unsigned long long upper = LatencyHistogram::getBucketLowerBound( i + 1 );
+        ASSERT_LT( lower, upper );
+        EXPECT_EQ( i, LatencyHistogram::getBucketIndex( lower ) );
+        EXPECT_EQ( i, LatencyHistogram::getBucketIndex( upper - 1 ) );
+
+        // The relative width of a bucket is bounded by the number of sub-buckets.
+        if( lower > 0 )
+        {
+            EXPECT_LE( upper - lower, ( lower + LatencyHistogram::NUM_SUB_BUCKETS - 1 ) / LatencyHistogram::NUM_SUB_BUCKETS );
+        }
+    }
+
+    // Values beyond the range are clamped to the last bucket.
+    EXPECT_EQ( static_cast<unsigned int>( LatencyHistogram::NUM_BUCKETS - 1 ), LatencyHistogram::getBucketIndex( ~0ULL ) );
+}
+
+TEST( TestLatencyRecorder, RecordsByPhaseAndType )
+{
+    LatencyRecorder recorder;
+    recorder.record( LATENCY_READ_TILE, REQUEST_HANDLER_TEXTURE, 0.001 );
+    recorder.record( LATENCY_READ_TILE, REQUEST_HANDLER_TEXTURE, 0.003 );
+    recorder.record( LATENCY_QUEUE_WAIT, REQUEST_HANDLER_SAMPLER, 0.002, 4 );
+
+    const LatencyStatistics stats   = recorder.getStatistics( false );
+    const LatencyHistogram& read    = stats.histograms[LATENCY_READ_TILE][REQUEST_HANDLER_TEXTURE];
+    const LatencyHistogram& waiting = stats.histograms[LATENCY_QUEUE_WAIT][REQUEST_HANDLER_SAMPLER];
+    EXPECT_EQ( 2ULL, read.numSamples );
+    EXPECT_NEAR( 0.004, read.totalTime, 1.0e-9 );
+    EXPECT_NEAR( 0.003, read.maxTime, 1.0e-9 );
+    EXPECT_NEAR( 0.002, read.getMean(), 1.0e-9 );
+    EXPECT_EQ( 1ULL, read.counts[LatencyHistogram::getBucketIndex( 1000 )] );
+    EXPECT_EQ( 4ULL, waiting.numSamples );
+    EXPECT_NEAR( 0.008, waiting.totalTime, 1.0e-9 );
+    EXPECT_EQ( 0ULL, stats.histograms[LATENCY_READ_TILE][REQUEST_HANDLER_SAMPLER].numSamples );
+
+    const LatencyHistogram merged = stats.getPhase( LATENCY_QUEUE_WAIT );
+    EXPECT_EQ( 4ULL, merged.numSamples );
+}
+
+TEST( TestLatencyRecorder, Percentiles )
+{
+    LatencyRecorder recorder;
+    for( unsigned int i = 1; i <= 100; ++i )
+        recorder.record( LATENCY_FILL_TILE, REQUEST_HANDLER_TEXTURE, i * 1.0e-3 );
+
+    const LatencyHistogram histogram = recorder.getStatistics( false ).getPhase( LATENCY_FILL_TILE );
+    EXPECT_NEAR( 0.050, histogram.getPercentile( 0.5 ), 0.050 / LatencyHistogram::NUM_SUB_BUCKETS );
+    EXPECT_NEAR( 0.099, histogram.getPercentile( 0.99 ), 0.099 / LatencyHistogram::NUM_SUB_BUCKETS );
+    EXPECT_DOUBLE_EQ( histogram.maxTime, histogram.getPercentile( 1.0 ) );
+    EXPECT_EQ( 0.0, LatencyHistogram{}.getPercentile( 0.5 ) );
+}
+
+TEST( TestLatencyRecorder, ResetReportsDeltas )
+{
+    LatencyRecorder recorder;
+    recorder.record( LATENCY_PUSH_MAPPINGS, REQUEST_HANDLER_OTHER, 0.010 );
+    EXPECT_EQ( 1ULL, recorder.getStatistics( true ).histograms[LATENCY_PUSH_MAPPINGS][REQUEST_HANDLER_OTHER].numSamples );
+
+    // Nothing has been recorded since the reset.
+    const LatencyHistogram empty = recorder.getStatistics( false ).histograms[LATENCY_PUSH_MAPPINGS][REQUEST_HANDLER_OTHER];
+    EXPECT_EQ( 0ULL, empty.numSamples );
+    EXPECT_EQ( 0.0, empty.maxTime );
+
+    recorder.record( LATENCY_PUSH_MAPPINGS, REQUEST_HANDLER_OTHER, 0.001 );
+    const LatencyHistogram delta = recorder.getStatistics( true ).histograms[LATENCY_PUSH_MAPPINGS][REQUEST_HANDLER_OTHER];
+    EXPECT_EQ( 1ULL, delta.numSamples );
+    EXPECT_NEAR( 0.001, delta.totalTime, 1.0e-9 );
+    EXPECT_NEAR( 0.001, delta.maxTime, 1.0e-9 );
+    EXPECT_EQ( 0ULL, delta.counts[LatencyHistogram::getBucketIndex( 10000 )] );
+}
+
+TEST( TestLatencyRecorder, MergesThreads )
+{
+    const unsigned int numThreads = 8;
+    const unsigned int numSamples = 1000;
+
+    LatencyRecorder          recorder;
+    std::vector<std::thread> threads;
+    for( unsigned int i = 0; i < numThreads; ++i )
+    {
+        threads.emplace_back( [&recorder, i] {
+            for( unsigned int j = 0; j < numSamples; ++j )
+                recorder.record( LATENCY_FILL_REQUEST, static_cast<RequestHandlerType>( i % NUM_REQUEST_HANDLER_TYPES ), 1.0e-6 * j );
+        } );
+    }
+
+    // Reading concurrently with recording is permitted.
+    unsigned long long numRead = 0;
+    while( numRead < numThreads * numSamples )
+        numRead = recorder.getStatistics( false ).getPhase( LATENCY_FILL_REQUEST ).numSamples;
+
+    for( std::thread& thread : threads )
+        thread.join();
+    const LatencyHistogram histogram = recorder.getStatistics( false ).getPhase( LATENCY_FILL_REQUEST );
+    EXPECT_EQ( numThreads * numSamples, histogram.numSamples );
+    EXPECT_NEAR( 1.0e-6 * ( numSamples - 1 ), histogram.maxTime, 1.0e-9 );
+}
+
+TEST( TestLatencyRecorder, InterleavesRecorders )
+{
+    // More recorders than a thread caches shards for, so some shards are found again under the lock.
+    const unsigned int numRecorders = 12;
+    const unsigned int numSamples   = 100;
+
+    std::vector<std::unique_ptr<LatencyRecorder>> recorders;
+    for( unsigned int i = 0; i < numRecorders; ++i )
+        recorders.emplace_back( new LatencyRecorder );
+    for( unsigned int j = 0; j < numSamples; ++j )
+    {
+        for( unsigned int i = 0; i < numRecorders; ++i )
+            recorders[i]->record( LATENCY_FILL_REQUEST, REQUEST_HANDLER_TEXTURE, 1.0e-6 * i, i + 1 );
+    }
+
+    for( unsigned int i = 0; i < numRecorders; ++i )
+    {
+        const LatencyHistogram histogram = recorders[i]->getStatistics( false ).getPhase( LATENCY_FILL_REQUEST );
+        EXPECT_EQ( ( i + 1 ) * numSamples, histogram.numSamples );
+        EXPECT_NEAR( 1.0e-6 * i, histogram.maxTime, 1.0e-9 );
+    }
+}
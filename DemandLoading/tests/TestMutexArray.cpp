@@ -30,9 +30,12 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <atomic>
 #include <chrono>
+#include <iostream>
 #include <thread>
+#include <vector>
 
 using msec = std::chrono::duration<int, std::milli>;
 
@@ -186,3 +189,56 @@ TEST_F( TestMutexArray, ExclusionMulti )
         EXPECT_EQ( 0, bucket );
     }
 }
+
+TEST_F( TestMutexArray, TryLock )
+{
+    MutexArray mutex( 40 );
+    EXPECT_TRUE( mutex.tryLock( 33 ) );
+    EXPECT_FALSE( mutex.tryLock( 33 ) );
+    EXPECT_TRUE( mutex.tryLock( 1 ) );
+    mutex.unlock( 33 );
+    EXPECT_TRUE( mutex.tryLock( 33 ) );
+    mutex.unlock( 33 );
+    mutex.unlock( 1 );
+}
+
+// Contention benchmark: many threads lock and unlock tiles of one large texture, with a small
+// critical section.  A hot subset of tiles is shared by all threads to exercise the wait path.
+TEST_F( TestMutexArray, DISABLED_ContentionBenchmark )
+{
+    const unsigned int numItems       = 64 * 1024;
+    const unsigned int numHotItems    = 64;
+    const unsigned int numThreads     = std::max( 4u, std::thread::hardware_concurrency() );
+    const unsigned int itersPerThread = 20000;
+
+    MutexArray               mutex( numItems );
+    std::vector<int>         counters( numItems, 0 );
+    std::vector<std::thread> threads;
+
+    const auto start = std::chrono::steady_clock::now();
+    for( unsigned int t = 0; t < numThreads; ++t )
+    {
+        threads.emplace_back( [&mutex, &counters, t] {
+            unsigned int state = t * 2654435761u + 1;
+            for( unsigned int i = 0; i < itersPerThread; ++i )
+            {
+                state              = state * 1664525u + 1013904223u;
+                unsigned int index = ( i % 4 == 0 ) ? ( state >> 8 ) % numHotItems : ( state >> 8 ) % numItems;
+                MutexArrayLock lock( &mutex, index );
+                ++counters[index];
+            }
+        } );
+    }
+    for( std::thread& thread : threads )
+        thread.join();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    // Every increment was performed under the lock, so none were lost.
+    long long total = 0;
+    for( int counter : counters )
+        total += counter;
+    EXPECT_EQ( static_cast<long long>( numThreads ) * itersPerThread, total );
+
+    std::cout << "[ MutexArray ] " << numThreads << " threads: "
+              << static_cast<unsigned int>( numThreads * itersPerThread / elapsed.count() ) << " lock/unlock pairs/sec\n";
+}
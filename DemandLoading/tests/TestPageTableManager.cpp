@@ -30,6 +30,15 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
 using namespace demandLoading;
 
 class DummyRequestHandler : public RequestHandler
@@ -134,3 +143,133 @@ TEST_F( TestPageTableManager, TestMappingOrderPreserved )
     EXPECT_EQ( &handler2, mgr.getRequestHandler( pageId2 ) );
     EXPECT_EQ( &handler3, mgr.getRequestHandler( pageId3 ) );
 }
+
+TEST_F( TestPageTableManager, TestLookupDuringReservation )
+{
+    const unsigned int               count = 10000;
+    std::vector<DummyRequestHandler> handlers( count );
+    std::atomic<unsigned int>        numReserved( 0 );
+    std::atomic<bool>                failed( false );
+
+    // Each reader repeatedly looks up the pages of every mapping published so far while the main
+    // thread continues to reserve pages.
+    std::vector<std::thread> readers;
+    for( unsigned int t = 0; t < 2; ++t )
+    {
+        readers.emplace_back( [&] {
+            unsigned int reserved = 0;
+            while( reserved < count )
+            {
+                reserved = numReserved.load( std::memory_order_acquire );
+                for( unsigned int i = 0; i < reserved; ++i )
+                {
+                    if( mgr.getRequestHandler( i ) != &handlers[i] )
+                        failed = true;
+                }
+            }
+        } );
+    }
+    for( unsigned int i = 0; i < count; ++i )
+    {
+        // The first 1024 pages are backed, so page ids match mapping indices.
+        if( i < 1024u )
+            mgr.reserveBackedPages( 1, &handlers[i] );
+        else
+            mgr.reserveUnbackedPages( 1, &handlers[i] );
+        numReserved.store( i + 1, std::memory_order_release );
+    }
+    for( std::thread& reader : readers )
+        reader.join();
+
+    EXPECT_FALSE( failed );
+}
+
+namespace {
+
+// Reference implementation of the previous lookup: a sorted vector guarded by a mutex.
+class LockedPageTable
+{
+  public:
+    void insert( unsigned int firstPage, unsigned int numPages, RequestHandler* handler )
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_mappings.push_back( Mapping{ firstPage, firstPage + numPages - 1, handler } );
+    }
+
+    RequestHandler* find( unsigned int pageId ) const
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        const auto least = std::lower_bound( m_mappings.cbegin(), m_mappings.cend(), pageId,
+                                             []( const Mapping& entry, unsigned int id ) { return id > entry.lastPage; } );
+        return least != m_mappings.cend() ? least->handler : nullptr;
+    }
+
+  private:
+    struct Mapping
+    {
+        unsigned int    firstPage;
+        unsigned int    lastPage;
+        RequestHandler* handler;
+    };
+    std::vector<Mapping> m_mappings;
+    mutable std::mutex   m_mutex;
+};
+
+// Look up random pages in [0, numPages) from the given number of threads and return lookups per second.
+template <typename Lookup>
+double measureLookups( unsigned int numThreads, unsigned int numPages, Lookup lookup )
+{
+    const unsigned int       lookupsPerThread = 250000;
+    std::atomic<size_t>      numFound( 0 );
+    std::vector<std::thread> threads;
+
+    const auto start = std::chrono::steady_clock::now();
+    for( unsigned int t = 0; t < numThreads; ++t )
+    {
+        threads.emplace_back( [&, t] {
+            std::mt19937                                rng( t );
+            std::uniform_int_distribution<unsigned int> pageDist( 0, numPages - 1 );
+            size_t                                      found = 0;
+            for( unsigned int i = 0; i < lookupsPerThread; ++i )
+                found += lookup( pageDist( rng ) ) ? 1 : 0;
+            numFound += found;
+        } );
+    }
+    for( std::thread& thread : threads )
+        thread.join();
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_EQ( static_cast<size_t>( numThreads ) * lookupsPerThread, numFound.load() );
+    return numThreads * lookupsPerThread / elapsed.count();
+}
+
+}  // namespace
+
+// Compare lookup throughput against a mutex-guarded sorted vector, for up to a million ranges.
+TEST( TestPageTableManagerBenchmark, DISABLED_LookupThroughput )
+{
+    const unsigned int numThreads = std::max( 4u, std::thread::hardware_concurrency() );
+
+    for( unsigned int numRanges : {10000u, 100000u, 1000000u} )
+    {
+        // Reserve single-page ranges, splitting them between backed and unbacked pages.
+        const unsigned int               numBackedRanges = numRanges / 2;
+        PageTableManager                 mgr( numRanges, numBackedRanges );
+        LockedPageTable                  reference;
+        std::vector<DummyRequestHandler> handlers( numRanges );
+        for( unsigned int i = 0; i < numRanges; ++i )
+        {
+            const unsigned int page = i < numBackedRanges ? mgr.reserveBackedPages( 1, &handlers[i] ) :
+                                                            mgr.reserveUnbackedPages( 1, &handlers[i] );
+            reference.insert( page, 1, &handlers[i] );
+        }
+
+        const double lockFree =
+            measureLookups( numThreads, numRanges, [&mgr]( unsigned int pageId ) { return mgr.getRequestHandler( pageId ); } );
+        const double locked =
+            measureLookups( numThreads, numRanges, [&reference]( unsigned int pageId ) { return reference.find( pageId ); } );
+
+        std::cout << "[ PageTableManager ] " << numRanges << " ranges, " << numThreads << " threads: " << lockFree
+                  << " lookups/sec (mutex + sorted vector: " << locked << " lookups/sec)" << std::endl;
+    }
+}
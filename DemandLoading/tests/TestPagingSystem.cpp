@@ -28,6 +28,7 @@
 
 #include "PagingSystemTestKernels.h"
 
+#include "CompletionQueue.h"
 #include "Memory/DeviceMemoryManager.h"
 #include "PageTableManager.h"
 #include "PagingSystem.h"
@@ -39,6 +40,8 @@
 #include <cuda.h>
 
 #include <memory>
+#include <thread>
+#include <vector>
 
 const unsigned long long PINNED_ALLOC = 2u << 20;
 const unsigned long long MAX_PINNED_MEM = 32u << 20;
@@ -56,11 +59,11 @@ class DevicePaging
     CUstream                                      m_stream{};
     std::unique_ptr<bool[]>                       m_pagesResident;
 
-    DevicePaging( unsigned int deviceIndex, const Options& options, RequestProcessor* requestProcessor )
+    DevicePaging( unsigned int deviceIndex, const Options& options, RequestProcessor* requestProcessor, CompletionQueue* completionQueue )
         : m_deviceIndex( deviceIndex )
         , m_deviceMemoryManager( options )
         , m_pinnedMemoryPool( new PinnedAllocator(), new RingSuballocator( PINNED_ALLOC ), PINNED_ALLOC, MAX_PINNED_MEM )
-        , m_paging( options, &m_deviceMemoryManager, &m_pinnedMemoryPool, requestProcessor )
+        , m_paging( options, &m_deviceMemoryManager, &m_pinnedMemoryPool, requestProcessor, completionQueue )
     {
         DEMAND_CUDA_CHECK( cudaSetDevice( m_deviceIndex ) );
         DEMAND_CUDA_CHECK( cuStreamCreate( &m_stream, 0U ) );
@@ -137,6 +140,7 @@ class TestPagingSystem : public testing::Test
 
         m_pageTableManager = std::make_shared<PageTableManager>( m_options.numPages, m_options.numPageTableEntries );
         m_requestProcessor.reset( new ThreadPoolRequestProcessor( m_pageTableManager, m_options ) );
+        m_completionQueue.reset( new CompletionQueue( m_options.maxActiveStreams ) );
 
         // Create per-device PagingSystem, etc.
         int numDevices;
@@ -149,7 +153,7 @@ class TestPagingSystem : public testing::Test
             DEMAND_CUDA_CHECK( cudaFree( nullptr ) );
 
             // Create PagingSystem, etc.
-            m_devices.emplace_back( new DevicePaging( deviceIndex, m_options, m_requestProcessor.get() ) );
+            m_devices.emplace_back( new DevicePaging( deviceIndex, m_options, m_requestProcessor.get(), m_completionQueue.get() ) );
         }
         m_firstDevice = m_devices.at( 0 ).get();
     }
@@ -160,6 +164,7 @@ class TestPagingSystem : public testing::Test
     std::unique_ptr<RequestProcessor>          m_requestProcessor;
     std::vector<std::unique_ptr<DevicePaging>> m_devices;
     DevicePaging*                              m_firstDevice{};
+    std::unique_ptr<CompletionQueue>           m_completionQueue;
 };
 
 TEST_F( TestPagingSystem, TestNonResidentPage )
@@ -222,3 +227,50 @@ TEST_F( TestPagingSystem, TestUnbackedPageTableEntry )
         EXPECT_TRUE( device->m_pagesResident[0] ) << "page " << pageId << " was not resident.";
     }
 }
+
+TEST_F( TestPagingSystem, TestSpilledMappings )
+{
+    for( auto& device : m_devices )
+    {
+        DEMAND_CUDA_CHECK( cudaSetDevice( device->m_deviceIndex ) );
+
+        // Mappings that do not fit in the filled page list are deferred to the next push.
+        const unsigned int numPages = m_options.maxFilledPages + 10;
+        for( unsigned int pageId = 0; pageId < numPages; ++pageId )
+            device->m_paging.addMapping( pageId, 0, 42ULL + pageId );
+        EXPECT_EQ( m_options.maxFilledPages, device->pushMappings() );
+        EXPECT_EQ( 10U, device->pushMappings() );
+        EXPECT_EQ( 0U, device->pushMappings() );
+
+        // All of the mappings are resident on the device.
+        std::vector<unsigned int> pageIds{0, m_options.maxFilledPages - 1, numPages - 1};
+        device->requestPages( pageIds );
+        for( size_t i = 0; i < pageIds.size(); ++i )
+            EXPECT_TRUE( device->m_pagesResident[i] ) << "page " << pageIds[i] << " was not resident.";
+    }
+}
+
+TEST_F( TestPagingSystem, TestConcurrentMappings )
+{
+    DEMAND_CUDA_CHECK( cudaSetDevice( m_firstDevice->m_deviceIndex ) );
+
+    // Add mappings from several threads while pushing them, which does not block the threads.
+    const unsigned int       numThreads     = 4;
+    const unsigned int       pagesPerThread = 256;
+    std::vector<std::thread> threads;
+    for( unsigned int i = 0; i < numThreads; ++i )
+    {
+        threads.emplace_back( [this, i] {
+            for( unsigned int j = 0; j < pagesPerThread; ++j )
+                m_firstDevice->m_paging.addMapping( i * pagesPerThread + j, 0, 42ULL );
+        } );
+    }
+    unsigned int numPushed = 0;
+    while( numPushed < numThreads * pagesPerThread )
+        numPushed += m_firstDevice->pushMappings();
+    for( std::thread& thread : threads )
+        thread.join();
+
+    EXPECT_EQ( numThreads * pagesPerThread, numPushed );
+    EXPECT_EQ( 0U, m_firstDevice->pushMappings() );
+}
@@ -29,6 +29,7 @@
 #include "CudaCheck.h"
 #include "DemandLoadingKernelsPTX.h"
 #include "Memory/DeviceMemoryManager.h"
+#include "PagingSystemHostKernels.h"
 #include "PagingSystemKernels.h"
 
 #include <gtest/gtest.h>
@@ -36,6 +37,8 @@
 #include <cuda.h>
 
 #include <algorithm> 
+#include <random>
+#include <vector>
 
 using namespace demandLoading;
 
@@ -201,3 +204,73 @@ TEST_F( TestPagingSystemKernels, TestPushMappings )
 
     EXPECT_EQ( 2U, residenceBits );
 }
+
+TEST_F( TestPagingSystemKernels, TestHostPullRequestsMatchDevice )
+{
+    // Randomize the reference bits, residence bits and LRU table, sparsely enough that the
+    // request and stale page lists do not overflow (which pages are dropped then depends on the order).
+    const DeviceContext& context  = getContext();
+    const unsigned int   numWords = ( context.maxNumPages + 31 ) / 32;
+    std::mt19937         rng( 7 );
+    std::vector<unsigned int> referenceBits( numWords ), residenceBits( numWords ), lruTable( ( context.maxNumPages + 7 ) / 8 );
+    for( unsigned int i = 0; i < numWords; ++i )
+    {
+        referenceBits[i] = rng() & rng() & rng() & rng() & rng();
+        residenceBits[i] = rng() & rng() & rng() & rng();
+    }
+    const unsigned int lastWordMask = ( 1U << ( context.maxNumPages % 32 ) ) - 1;  // Only pages within range.
+    referenceBits[numWords - 1] &= lastWordMask;
+    residenceBits[numWords - 1] &= lastWordMask;
+    for( unsigned int& word : lruTable )
+        word = rng();
+    DEMAND_CUDA_CHECK( cudaMemcpy( context.referenceBits, referenceBits.data(), numWords * sizeof( unsigned int ), cudaMemcpyHostToDevice ) );
+    DEMAND_CUDA_CHECK( cudaMemcpy( context.residenceBits, residenceBits.data(), numWords * sizeof( unsigned int ), cudaMemcpyHostToDevice ) );
+    DEMAND_CUDA_CHECK( cudaMemcpy( context.lruTable, lruTable.data(), lruTable.size() * sizeof( unsigned int ), cudaMemcpyHostToDevice ) );
+    DEMAND_CUDA_CHECK( cudaMemset( context.arrayLengths.data, 0, context.arrayLengths.capacity * sizeof( unsigned int ) ) );
+
+    // Run the kernel and its host version.
+    const unsigned int launchNum    = 5;
+    const unsigned int lruThreshold = 12;
+    CUstream           stream{};
+    launchPullRequests( m_pagingKernels, stream, context, launchNum, lruThreshold, 0, context.maxNumPages );
+
+    std::vector<unsigned int> requestedPages( context.requestedPages.capacity );
+    std::vector<StalePage>    stalePages( context.stalePages.capacity, StalePage{0, 0, 0} );
+    std::vector<unsigned int> arrayLengths( context.arrayLengths.capacity, 0 );
+    DeviceContext             hostContext = context;
+    hostContext.referenceBits             = referenceBits.data();
+    hostContext.residenceBits             = residenceBits.data();
+    hostContext.lruTable                  = lruTable.data();
+    hostContext.requestedPages.data       = requestedPages.data();
+    hostContext.stalePages.data           = stalePages.data();
+    hostContext.arrayLengths.data         = arrayLengths.data();
+    hostPullRequests( hostContext, launchNum, lruThreshold, 0, context.maxNumPages );
+    DEMAND_CUDA_CHECK( cudaDeviceSynchronize() );
+
+    // The LRU tables and list lengths are identical.
+    std::vector<unsigned int> deviceLruTable( lruTable.size() ), deviceArrayLengths( arrayLengths.size() );
+    DEMAND_CUDA_CHECK( cudaMemcpy( deviceLruTable.data(), context.lruTable, lruTable.size() * sizeof( unsigned int ), cudaMemcpyDeviceToHost ) );
+    DEMAND_CUDA_CHECK( cudaMemcpy( deviceArrayLengths.data(), context.arrayLengths.data, arrayLengths.size() * sizeof( unsigned int ), cudaMemcpyDeviceToHost ) );
+    EXPECT_EQ( lruTable, deviceLruTable );
+    EXPECT_EQ( arrayLengths, deviceArrayLengths );
+    const unsigned int numRequestedPages = arrayLengths[PAGE_REQUESTS_LENGTH];
+    const unsigned int numStalePages     = arrayLengths[STALE_PAGES_LENGTH];
+    ASSERT_GT( numRequestedPages, 0U );
+    ASSERT_LT( numRequestedPages, context.requestedPages.capacity );
+    ASSERT_GT( numStalePages, 0U );
+    ASSERT_LT( numStalePages, context.stalePages.capacity );
+
+    // The lists hold the same pages, in increasing order on the host.
+    std::vector<unsigned int> deviceRequestedPages( numRequestedPages );
+    std::vector<StalePage>    deviceStalePages( numStalePages, StalePage{0, 0, 0} );
+    DEMAND_CUDA_CHECK( cudaMemcpy( deviceRequestedPages.data(), context.requestedPages.data, numRequestedPages * sizeof( unsigned int ), cudaMemcpyDeviceToHost ) );
+    DEMAND_CUDA_CHECK( cudaMemcpy( deviceStalePages.data(), context.stalePages.data, numStalePages * sizeof( StalePage ), cudaMemcpyDeviceToHost ) );
+    std::sort( deviceRequestedPages.begin(), deviceRequestedPages.end() );
+    EXPECT_EQ( std::vector<unsigned int>( requestedPages.begin(), requestedPages.begin() + numRequestedPages ), deviceRequestedPages );
+    std::sort( deviceStalePages.begin(), deviceStalePages.end(), []( StalePage a, StalePage b ) { return a.pageId < b.pageId; } );
+    for( unsigned int i = 0; i < numStalePages; ++i )
+    {
+        EXPECT_EQ( stalePages[i].pageId, deviceStalePages[i].pageId );
+        EXPECT_EQ( stalePages[i].lruVal, deviceStalePages[i].lruVal );
+    }
+}
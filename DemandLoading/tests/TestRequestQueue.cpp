@@ -0,0 +1,675 @@
+//
+// Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include "RequestHandler.h"
+#include "RequestQueue.h"
+#include "TicketImpl.h"
+#include "Util/Exception.h"
+
+#include <gtest/gtest.h>
+
+#include <cuda.h>
+#include <cuda_runtime.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace demandLoading;
+
+namespace {
+
+// Stub request handler that does a small, fixed amount of work per page, standing in for tile
+// decode without requiring a GPU.
+class StubRequestHandler : public RequestHandler
+{
+  public:
+    StubRequestHandler( unsigned int workPerPage = 64 )
+        : m_workPerPage( workPerPage )
+    {
+    }
+
+    void fillRequest( CUstream /*stream*/, unsigned int pageId ) override
+    {
+        unsigned int value = pageId;
+        for( unsigned int i = 0; i < m_workPerPage; ++i )
+            value = value * 1664525u + 1013904223u;
+        m_checksum.fetch_add( value, std::memory_order_relaxed );
+        m_numFilled.fetch_add( 1, std::memory_order_relaxed );
+    }
+
+    unsigned int getNumFilled() const { return m_numFilled.load(); }
+
+  private:
+    const unsigned int        m_workPerPage;
+    std::atomic<unsigned int> m_numFilled{0};
+    std::atomic<unsigned int> m_checksum{0};
+};
+
+}  // anonymous namespace
+
+class TestRequestQueue : public testing::Test
+{
+  public:
+    // Streams are only needed to distinguish requests, but they must be real streams, since the
+    // small integer handles are reserved (e.g. CU_STREAM_LEGACY).
+    void SetUp() override
+    {
+        DEMAND_CUDA_CHECK( cudaFree( nullptr ) );
+        for( CUstream& stream : m_streams )
+            DEMAND_CUDA_CHECK( cuStreamCreate( &stream, CU_STREAM_NON_BLOCKING ) );
+    }
+
+    void TearDown() override
+    {
+        for( CUstream stream : m_streams )
+            DEMAND_CUDA_CHECK( cuStreamDestroy( stream ) );
+    }
+
+    // Drain the queue with the given number of worker threads, mimicking ThreadPoolRequestProcessor::worker.
+    static std::vector<std::thread> startWorkers( RequestQueue& queue, RequestHandler& handler, unsigned int numWorkers )
+    {
+        std::vector<std::thread> workers;
+        for( unsigned int i = 0; i < numWorkers; ++i )
+        {
+            workers.emplace_back( [&queue, &handler] {
+                PageRequest request;
+                while( queue.popOrWait( &request ) )
+                {
+                    if( !request.ticket->isCancelled() || queue.hasLiveDuplicates( request ) )
+                        handler.fillRequest( request.ticket->getStream(), request.pageId );
+                    queue.complete( request );
+                }
+            } );
+        }
+        return workers;
+    }
+
+    static void stopWorkers( RequestQueue& queue, std::vector<std::thread>& workers )
+    {
+        queue.shutDown();
+        for( std::thread& worker : workers )
+            worker.join();
+    }
+
+  protected:
+    CUstream m_streams[2]{};
+};
+
+TEST_F( TestRequestQueue, PushPop )
+{
+    RequestQueue queue( 16 );
+    Ticket       ticket = TicketImpl::create( CUstream{} );
+
+    const unsigned int pageIds[] = {3, 1, 4};
+    queue.push( pageIds, 3, ticket );
+    EXPECT_EQ( 3, ticket.numTasksTotal() );
+    EXPECT_EQ( 3u, queue.size() );
+
+    // Requests are popped in FIFO order, and refer to the ticket they were pushed with.
+    PageRequest request;
+    for( unsigned int pageId : pageIds )
+    {
+        ASSERT_TRUE( queue.tryPop( &request ) );
+        EXPECT_EQ( pageId, request.pageId );
+        EXPECT_EQ( TicketImpl::getImpl( ticket ).get(), request.ticket );
+        queue.complete( request );
+    }
+    EXPECT_FALSE( queue.tryPop( &request ) );
+    EXPECT_EQ( 0u, queue.size() );
+    EXPECT_EQ( 0, ticket.numTasksRemaining() );
+}
+
+TEST_F( TestRequestQueue, RetainsTicketUntilNotified )
+{
+    RequestQueue queue( 16 );
+    PageRequest  request;
+    {
+        Ticket             ticket    = TicketImpl::create( CUstream{} );
+        const unsigned int pageIds[] = {1, 2};
+        queue.push( pageIds, 2, ticket );
+    }
+
+    // The queue holds the only reference to the ticket, which must remain valid until the last
+    // request is notified.
+    ASSERT_TRUE( queue.tryPop( &request ) );
+    queue.complete( request );
+    ASSERT_TRUE( queue.tryPop( &request ) );
+    EXPECT_EQ( 1, request.ticket->numTasksRemaining() );
+    queue.complete( request );
+}
+
+TEST_F( TestRequestQueue, DestructorReleasesTickets )
+{
+    Ticket ticket = TicketImpl::create( CUstream{} );
+    {
+        RequestQueue       queue( 16 );
+        const unsigned int pageIds[] = {1, 2, 3};
+        queue.push( pageIds, 3, ticket );
+    }
+    EXPECT_EQ( 0, ticket.numTasksRemaining() );
+    EXPECT_EQ( 1, TicketImpl::getImpl( ticket ).use_count() );
+}
+
+TEST_F( TestRequestQueue, PopBatch )
+{
+    RequestQueue queue( 16 );
+    Ticket       ticket = TicketImpl::create( CUstream{} );
+
+    const unsigned int pageIds[] = {3, 1, 4, 5, 9};
+    queue.push( pageIds, 5, ticket );
+
+    PageRequest requests[4];
+    ASSERT_EQ( 4u, queue.popBatchOrWait( requests, 4 ) );
+    for( unsigned int i = 0; i < 4; ++i )
+        EXPECT_EQ( pageIds[i], requests[i].pageId );
+    queue.complete( requests, 4 );
+
+    // Only the remaining request is returned, without waiting for more.
+    ASSERT_EQ( 1u, queue.popBatchOrWait( requests, 4 ) );
+    EXPECT_EQ( pageIds[4], requests[0].pageId );
+    queue.complete( requests[0] );
+
+    queue.shutDown();
+    EXPECT_EQ( 0u, queue.popBatchOrWait( requests, 4 ) );
+}
+
+TEST_F( TestRequestQueue, FillRequestsDefaultsToFillRequest )
+{
+    StubRequestHandler handler;
+    const unsigned int pageIds[] = {7, 8, 9};
+    handler.fillRequests( CUstream{}, pageIds, 3 );
+    EXPECT_EQ( 3u, handler.getNumFilled() );
+}
+
+TEST_F( TestRequestQueue, TruncatesWhenFull )
+{
+    RequestQueue queue( 4 );
+    Ticket       ticket1 = TicketImpl::create( CUstream{} );
+    Ticket       ticket2 = TicketImpl::create( CUstream{} );
+
+    const unsigned int pageIds[] = {0, 1, 2, 3, 4, 5};
+    queue.push( pageIds, 3, ticket1 );
+    queue.push( pageIds + 3, 3, ticket2 );
+    EXPECT_EQ( 3, ticket1.numTasksTotal() );
+    EXPECT_EQ( 1, ticket2.numTasksTotal() );
+    EXPECT_EQ( 4u, queue.size() );
+}
+
+TEST_F( TestRequestQueue, PopsInPriorityOrder )
+{
+    RequestQueue queue( 16 );
+    Ticket       ticket = TicketImpl::create( CUstream{} );
+
+    const unsigned int pageIds[]    = {10, 11, 12, 13, 14, 15};
+    const unsigned int priorities[] = {3, 0, 7, 0, 3, 1};
+    queue.push( pageIds, priorities, 6, ticket );
+    EXPECT_EQ( 6, ticket.numTasksTotal() );
+
+    // Requests are popped by priority class, and in FIFO order within a class.
+    const unsigned int expected[] = {11, 13, 15, 10, 14, 12};
+    PageRequest        request;
+    for( unsigned int pageId : expected )
+    {
+        ASSERT_TRUE( queue.tryPop( &request ) );
+        EXPECT_EQ( pageId, request.pageId );
+        queue.complete( request );
+    }
+    EXPECT_FALSE( queue.tryPop( &request ) );
+    EXPECT_EQ( 0, ticket.numTasksRemaining() );
+}
+
+TEST_F( TestRequestQueue, EvictsLowerPriorityWhenFull )
+{
+    RequestQueue queue( 4 );
+    Ticket       lowTicket  = TicketImpl::create( CUstream{} );
+    Ticket       highTicket = TicketImpl::create( CUstream{} );
+
+    const unsigned int lowPageIds[]    = {0, 1, 2, 3};
+    const unsigned int lowPriorities[] = {5, 5, 6, 6};
+    queue.push( lowPageIds, lowPriorities, 4, lowTicket );
+
+    // The most urgent of the new requests displace the oldest requests in the lowest class.
+    const unsigned int highPageIds[]    = {10, 11, 12};
+    const unsigned int highPriorities[] = {2, 0, 6};
+    queue.push( highPageIds, highPriorities, 3, highTicket );
+    EXPECT_EQ( 2, highTicket.numTasksTotal() );
+    EXPECT_EQ( 4u, queue.size() );
+    EXPECT_EQ( 2u, queue.getNumEvicted() );
+
+    // The evicted requests count as done.
+    EXPECT_EQ( 2, lowTicket.numTasksRemaining() );
+
+    const unsigned int expected[] = {11, 10, 0, 1};
+    PageRequest        request;
+    for( unsigned int pageId : expected )
+    {
+        ASSERT_TRUE( queue.tryPop( &request ) );
+        EXPECT_EQ( pageId, request.pageId );
+        queue.complete( request );
+    }
+    EXPECT_EQ( 0, lowTicket.numTasksRemaining() );
+    EXPECT_EQ( 0, highTicket.numTasksRemaining() );
+}
+
+TEST_F( TestRequestQueue, DropsLowerPriorityWhenFull )
+{
+    RequestQueue queue( 2 );
+    Ticket       highTicket = TicketImpl::create( CUstream{} );
+    Ticket       lowTicket  = TicketImpl::create( CUstream{} );
+
+    const unsigned int highPageIds[]    = {0, 1};
+    const unsigned int highPriorities[] = {1, 1};
+    queue.push( highPageIds, highPriorities, 2, highTicket );
+
+    // Requests of equal or lower priority do not displace queued requests.
+    const unsigned int lowPageIds[]    = {2, 3};
+    const unsigned int lowPriorities[] = {1, 4};
+    queue.push( lowPageIds, lowPriorities, 2, lowTicket );
+    EXPECT_EQ( 0, lowTicket.numTasksTotal() );
+    EXPECT_EQ( 0u, queue.getNumEvicted() );
+    EXPECT_EQ( 2u, queue.size() );
+}
+
+TEST_F( TestRequestQueue, DeduplicatesPendingRequests )
+{
+    RequestQueue queue( 16 );
+    Ticket       ticket1 = TicketImpl::create( CUstream{} );
+    Ticket       ticket2 = TicketImpl::create( CUstream{} );
+
+    const unsigned int pageIds1[] = {1, 2};
+    const unsigned int pageIds2[] = {2, 3, 3};
+    queue.push( pageIds1, 2, ticket1 );
+    queue.push( pageIds2, 3, ticket2 );
+
+    // Duplicates are attached to the pending requests rather than queued, but are still counted.
+    EXPECT_EQ( 3, ticket2.numTasksTotal() );
+    EXPECT_EQ( 3u, queue.size() );
+    EXPECT_EQ( 2u, queue.getNumDeduplicated() );
+
+    // Completing the first request for page 2 also notifies the ticket of the duplicate.
+    PageRequest request;
+    ASSERT_TRUE( queue.tryPop( &request ) );
+    EXPECT_EQ( 1u, request.pageId );
+    queue.complete( request );
+    ASSERT_TRUE( queue.tryPop( &request ) );
+    EXPECT_EQ( 2u, request.pageId );
+    queue.complete( request );
+    EXPECT_EQ( 0, ticket1.numTasksRemaining() );
+    EXPECT_EQ( 2, ticket2.numTasksRemaining() );
+
+    ASSERT_TRUE( queue.tryPop( &request ) );
+    EXPECT_EQ( 3u, request.pageId );
+    queue.complete( request );
+    EXPECT_EQ( 0, ticket2.numTasksRemaining() );
+
+    // Once completed, a page is no longer pending, so it is queued again if requested.
+    Ticket ticket3 = TicketImpl::create( CUstream{} );
+    queue.push( pageIds1, 2, ticket3 );
+    EXPECT_EQ( 2u, queue.size() );
+    EXPECT_EQ( 2u, queue.getNumDeduplicated() );
+}
+
+TEST_F( TestRequestQueue, DeduplicatesAcrossStreams )
+{
+    // Both streams belong to the same context, so their requests for a page are merged.
+    RequestQueue       queue( 16 );
+    StubRequestHandler handler;
+    Ticket             ticket1 = TicketImpl::create( m_streams[0] );
+    Ticket             ticket2 = TicketImpl::create( m_streams[1] );
+
+    const unsigned int pageIds[] = {1, 2};
+    queue.push( pageIds, 2, ticket1 );
+    queue.push( pageIds, 2, ticket2 );
+    EXPECT_EQ( 2u, queue.size() );
+    EXPECT_EQ( 2u, queue.getNumDeduplicated() );
+
+    // The pages are filled once, on the first stream, and both tickets are notified.
+    std::vector<std::thread> workers = startWorkers( queue, handler, 2 );
+    ticket1.wait();
+    ticket2.wait();
+    stopWorkers( queue, workers );
+    EXPECT_EQ( 2u, handler.getNumFilled() );
+    EXPECT_EQ( 0, ticket2.numTasksRemaining() );
+}
+
+TEST_F( TestRequestQueue, EvictionCompletesDuplicates )
+{
+    RequestQueue queue( 1 );
+    Ticket       lowTicket1 = TicketImpl::create( CUstream{} );
+    Ticket       lowTicket2 = TicketImpl::create( CUstream{} );
+    Ticket       highTicket = TicketImpl::create( CUstream{} );
+
+    const unsigned int lowPageIds[]    = {1};
+    const unsigned int lowPriorities[] = {4};
+    queue.push( lowPageIds, lowPriorities, 1, lowTicket1 );
+    queue.push( lowPageIds, lowPriorities, 1, lowTicket2 );
+    EXPECT_EQ( 1, lowTicket2.numTasksRemaining() );
+
+    // Evicting the pending request also completes the duplicate attached to it.
+    const unsigned int highPageIds[]    = {2};
+    const unsigned int highPriorities[] = {0};
+    queue.push( highPageIds, highPriorities, 1, highTicket );
+    EXPECT_EQ( 0, lowTicket1.numTasksRemaining() );
+    EXPECT_EQ( 0, lowTicket2.numTasksRemaining() );
+
+    // The evicted page is no longer pending.
+    Ticket ticket = TicketImpl::create( CUstream{} );
+    queue.push( lowPageIds, lowPriorities, 1, ticket );
+    EXPECT_EQ( 0, ticket.numTasksTotal() );
+    EXPECT_EQ( 1u, queue.getNumDeduplicated() );
+}
+
+TEST_F( TestRequestQueue, CancelledRequestsAreNotFilled )
+{
+    RequestQueue       queue( 16 );
+    StubRequestHandler handler;
+    Ticket             staleTicket = TicketImpl::create( CUstream{} );
+    Ticket             freshTicket = TicketImpl::create( CUstream{} );
+
+    const unsigned int stalePageIds[] = {1, 2, 3};
+    const unsigned int freshPageIds[] = {3, 4};
+    queue.push( stalePageIds, 3, staleTicket );
+    queue.push( freshPageIds, 2, freshTicket );
+    TicketImpl::getImpl( staleTicket )->cancel();
+
+    // Cancelled requests complete their tickets without being filled, except for page 3, which
+    // is still wanted by the duplicate attached from the fresh ticket.
+    EXPECT_EQ( 1u, queue.getNumDeduplicated() );
+    std::vector<std::thread> workers = startWorkers( queue, handler, 2 );
+    staleTicket.wait();
+    freshTicket.wait();
+    stopWorkers( queue, workers );
+    EXPECT_EQ( 2u, handler.getNumFilled() );
+    EXPECT_EQ( 0, staleTicket.numTasksRemaining() );
+    EXPECT_EQ( 0, freshTicket.numTasksRemaining() );
+}
+
+TEST_F( TestRequestQueue, CountsDroppedRequests )
+{
+    RequestQueue queue( 2 );
+    Ticket       ticket1 = TicketImpl::create( CUstream{} );
+    Ticket       ticket2 = TicketImpl::create( CUstream{} );
+
+    const unsigned int pageIds1[]    = {1, 2, 3};
+    const unsigned int priorities1[] = {5, 5, 5};
+    const unsigned int pageIds2[]    = {4, 5};
+    const unsigned int priorities2[] = {0, 7};
+    queue.push( pageIds1, priorities1, 3, ticket1 );
+    queue.push( pageIds2, priorities2, 2, ticket2 );
+    EXPECT_EQ( 2u, queue.getNumDropped() );
+    EXPECT_EQ( 1u, queue.getNumEvicted() );
+    EXPECT_EQ( 1, ticket1.numTasksRemaining() );
+    EXPECT_EQ( 1, ticket2.numTasksRemaining() );
+}
+
+TEST_F( TestRequestQueue, SchedulesStreamsByWeight )
+{
+    RequestQueue   queue( 64 );
+    const CUstream lightStream = m_streams[0];
+    const CUstream heavyStream = m_streams[1];
+    queue.setStreamWeight( heavyStream, 3 );
+
+    std::vector<unsigned int> pageIds( 40 );
+    for( unsigned int i = 0; i < 40; ++i )
+        pageIds[i] = i;
+    Ticket lightTicket = TicketImpl::create( lightStream );
+    Ticket heavyTicket = TicketImpl::create( heavyStream );
+    queue.push( pageIds.data(), 40, lightTicket );
+    queue.push( pageIds.data(), 40, heavyTicket );
+
+    // Pages requested by both streams are queued separately, since requests are not deduplicated
+    // across sub-queues.
+    EXPECT_EQ( 80u, queue.size() );
+    EXPECT_EQ( 0u, queue.getNumDeduplicated() );
+
+    // While both streams have requests, three of every four pops go to the heavier stream.
+    unsigned int numHeavy = 0;
+    PageRequest  request;
+    for( unsigned int i = 0; i < 40; ++i )
+    {
+        ASSERT_TRUE( queue.tryPop( &request ) );
+        if( request.ticket->getStream() == heavyStream )
+            ++numHeavy;
+        queue.complete( request );
+    }
+    EXPECT_EQ( 30u, numHeavy );
+
+    // Once one stream is drained, the other gets every turn.
+    while( queue.tryPop( &request ) )
+        queue.complete( request );
+    EXPECT_EQ( 0, lightTicket.numTasksRemaining() );
+    EXPECT_EQ( 0, heavyTicket.numTasksRemaining() );
+}
+
+TEST_F( TestRequestQueue, WrapsAround )
+{
+    RequestQueue queue( 4 );
+    PageRequest  request;
+    for( unsigned int i = 0; i < 100; ++i )
+    {
+        Ticket             ticket    = TicketImpl::create( CUstream{} );
+        const unsigned int pageIds[] = {i, i + 1, i + 2};
+        queue.push( pageIds, 3, ticket );
+        for( unsigned int pageId : pageIds )
+        {
+            ASSERT_TRUE( queue.tryPop( &request ) );
+            EXPECT_EQ( pageId, request.pageId );
+            queue.complete( request );
+        }
+    }
+}
+
+TEST_F( TestRequestQueue, ShutDownWakesWaiters )
+{
+    RequestQueue      queue( 16 );
+    std::atomic<bool> finished( false );
+    std::thread       waiter( [&queue, &finished] {
+        PageRequest request;
+        EXPECT_FALSE( queue.popOrWait( &request ) );
+        finished = true;
+    } );
+
+    queue.shutDown();
+    waiter.join();
+    EXPECT_TRUE( finished.load() );
+}
+
+TEST_F( TestRequestQueue, MultipleProducersAndConsumers )
+{
+    const unsigned int numProducers = 4;
+    const unsigned int numBatches   = 64;
+    const unsigned int batchSize    = 256;
+
+    RequestQueue             queue( numProducers * batchSize );
+    StubRequestHandler       handler;
+    std::vector<std::thread> workers = startWorkers( queue, handler, 4 );
+
+    std::vector<std::thread> producers;
+    for( unsigned int p = 0; p < numProducers; ++p )
+    {
+        producers.emplace_back( [&queue, batchSize] {
+            std::vector<unsigned int> pageIds( batchSize );
+            for( unsigned int i = 0; i < batchSize; ++i )
+                pageIds[i] = i;
+            for( unsigned int b = 0; b < numBatches; ++b )
+            {
+                Ticket ticket = TicketImpl::create( CUstream{} );
+                queue.push( pageIds.data(), batchSize, ticket );
+                EXPECT_EQ( static_cast<int>( batchSize ), ticket.numTasksTotal() );
+                ticket.wait();
+            }
+        } );
+    }
+    for( std::thread& producer : producers )
+        producer.join();
+
+    stopWorkers( queue, workers );
+
+    // Concurrent requests for the same page may be deduplicated, but each producer's requests
+    // are filled after they are pushed, so every batch of a producer requires a separate fill.
+    EXPECT_LE( numBatches * batchSize, handler.getNumFilled() );
+    EXPECT_EQ( numProducers * numBatches * batchSize, handler.getNumFilled() + queue.getNumDeduplicated() );
+}
+
+// Contention microbenchmark: one producer pushes batches of requests while 1 to N workers drain
+// the queue through a stub handler.  Reports throughput for each worker count.
+TEST_F( TestRequestQueue, DISABLED_ContentionBenchmark )
+{
+    const unsigned int maxWorkers = std::max( 1u, std::thread::hardware_concurrency() );
+    const unsigned int batchSize  = 8192;
+    const unsigned int numBatches = 32;
+
+    std::vector<unsigned int> pageIds( batchSize );
+    for( unsigned int i = 0; i < batchSize; ++i )
+        pageIds[i] = i;
+
+    std::vector<unsigned int> workerCounts;
+    for( unsigned int numWorkers = 1; numWorkers < maxWorkers; numWorkers *= 2 )
+        workerCounts.push_back( numWorkers );
+    workerCounts.push_back( maxWorkers );
+
+    for( unsigned int numWorkers : workerCounts )
+    {
+        RequestQueue             queue( 32768 );
+        StubRequestHandler       handler;
+        std::vector<std::thread> workers = startWorkers( queue, handler, numWorkers );
+
+        const auto start = std::chrono::steady_clock::now();
+        for( unsigned int b = 0; b < numBatches; ++b )
+        {
+            Ticket ticket = TicketImpl::create( CUstream{} );
+            queue.push( pageIds.data(), batchSize, ticket );
+            ticket.wait();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        stopWorkers( queue, workers );
+        EXPECT_EQ( batchSize * numBatches, handler.getNumFilled() );
+
+        std::cout << "[ RequestQueue ] " << numWorkers << " workers: "
+                  << static_cast<unsigned int>( batchSize * numBatches / elapsed.count() ) << " requests/sec\n";
+    }
+}
+
+// Latency isolation benchmark: a background stream floods the queue while an interactive stream
+// pushes small batches and waits for them to be filled.  Reports the interactive latency when both
+// streams have the same weight (sharing one FIFO) and when the interactive stream has a higher weight.
+TEST_F( TestRequestQueue, DISABLED_LatencyIsolationBenchmark )
+{
+    const CUstream     backgroundStream  = m_streams[0];
+    const CUstream     interactiveStream = m_streams[1];
+    const unsigned int backgroundBatch   = 2048;
+    const unsigned int interactiveBatch  = 16;
+    const unsigned int numFrames         = 20;
+
+    for( unsigned int interactiveWeight : {1u, MAX_STREAM_WEIGHT} )
+    {
+        RequestQueue queue( 4 * backgroundBatch );
+        queue.setStreamWeight( interactiveStream, interactiveWeight );
+        StubRequestHandler       handler( 4096 );
+        std::vector<std::thread> workers = startWorkers( queue, handler, 2 );
+
+        // The background stream keeps a deep backlog of requests, without waiting for them.  It
+        // leaves room for the interactive requests, so that they are not simply dropped.
+        std::atomic<bool> done( false );
+        std::thread       background( [&queue, &done, backgroundStream, backgroundBatch] {
+            std::vector<unsigned int> pageIds( backgroundBatch );
+            for( unsigned int batch = 0; !done.load(); ++batch )
+            {
+                while( queue.size() > 2 * backgroundBatch && !done.load() )
+                    std::this_thread::yield();
+                for( unsigned int i = 0; i < backgroundBatch; ++i )
+                    pageIds[i] = batch * backgroundBatch + i;
+                queue.push( pageIds.data(), backgroundBatch, TicketImpl::create( backgroundStream ) );
+            }
+        } );
+        while( queue.size() < backgroundBatch )
+            std::this_thread::yield();
+
+        std::vector<unsigned int>     pageIds( interactiveBatch );
+        std::chrono::duration<double> total( 0 );
+        std::chrono::duration<double> worst( 0 );
+        for( unsigned int frame = 0; frame < numFrames; ++frame )
+        {
+            for( unsigned int i = 0; i < interactiveBatch; ++i )
+                pageIds[i] = 0x80000000u + frame * interactiveBatch + i;
+
+            const auto start  = std::chrono::steady_clock::now();
+            Ticket     ticket = TicketImpl::create( interactiveStream );
+            queue.push( pageIds.data(), interactiveBatch, ticket );
+            ticket.wait();
+            const std::chrono::duration<double> latency = std::chrono::steady_clock::now() - start;
+            total += latency;
+            worst = std::max( worst, latency );
+        }
+
+        done = true;
+        background.join();
+        stopWorkers( queue, workers );
+
+        std::cout << "[ RequestQueue ] interactive weight " << interactiveWeight << ": mean latency "
+                  << total.count() / numFrames * 1e3 << " ms, max " << worst.count() * 1e3 << " ms\n";
+    }
+}
+
+// Microbenchmark of the push/pop/notify cycle on a single thread, which isolates the per-request
+// bookkeeping cost from contention.  Requests are popped in batches and notified per batch, as in
+// ThreadPoolRequestProcessor::worker.
+TEST_F( TestRequestQueue, DISABLED_PushPopNotifyBenchmark )
+{
+    const unsigned int maxBatch        = 16;
+    const unsigned int requestsPerSize = 1 << 21;
+
+    for( unsigned int batchSize : {64u, 1024u, 8192u} )
+    {
+        std::vector<unsigned int> pageIds( batchSize );
+        for( unsigned int i = 0; i < batchSize; ++i )
+            pageIds[i] = i;
+        const unsigned int numBatches = requestsPerSize / batchSize;
+
+        RequestQueue queue( batchSize );
+        PageRequest  requests[maxBatch];
+        const auto   start = std::chrono::steady_clock::now();
+        for( unsigned int b = 0; b < numBatches; ++b )
+        {
+            Ticket ticket = TicketImpl::create( CUstream{} );
+            queue.push( pageIds.data(), batchSize, ticket );
+            while( unsigned int count = queue.popBatchOrWait( requests, std::min( maxBatch, queue.size() ) ) )
+                queue.complete( requests, count );
+            ticket.wait();
+        }
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        EXPECT_EQ( 0u, queue.size() );
+
+        std::cout << "[ RequestQueue ] push/pop/notify, batch " << batchSize << ": "
+                  << elapsed.count() * 1e9 / ( static_cast<double>( numBatches ) * batchSize ) << " ns/request\n";
+    }
+}
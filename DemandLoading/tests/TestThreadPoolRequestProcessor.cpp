@@ -0,0 +1,224 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "PageTableManager.h"
+#include "RequestHandler.h"
+#include "TestExecutor.h"
+#include "ThreadPoolRequestProcessor.h"
+#include "TicketImpl.h"
+#include "Util/Exception.h"
+#include "Util/LatencyRecorder.h"
+
+#include <gtest/gtest.h>
+
+#include <cuda_runtime.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+using namespace demandLoading;
+
+namespace {
+
+// Stub request handler that counts the pages it fills.
+class CountingRequestHandler : public RequestHandler
+{
+  public:
+    void fillRequest( CUstream /*stream*/, unsigned int /*pageId*/ ) override { m_numFilled.fetch_add( 1 ); }
+
+    unsigned int getNumFilled() const { return m_numFilled.load(); }
+
+  private:
+    std::atomic<unsigned int> m_numFilled{0};
+};
+
+// Stub request handler that fails the first time each page is filled.
+class FailingRequestHandler : public RequestHandler
+{
+  public:
+    void fillRequest( CUstream /*stream*/, unsigned int pageId ) override
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        if( m_failedPages.insert( pageId ).second )
+            throw Exception( "fill failed" );
+        ++m_numFilled;
+    }
+
+    unsigned int getNumFilled()
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        return m_numFilled;
+    }
+
+  private:
+    std::mutex             m_mutex;
+    std::set<unsigned int> m_failedPages;
+    unsigned int           m_numFilled = 0;
+};
+
+}  // anonymous namespace
+
+// The processor is tested with its own thread pool (false) and with a user-supplied executor (true).
+class TestThreadPoolRequestProcessor : public testing::TestWithParam<bool>
+{
+  public:
+    void SetUp() override
+    {
+        DEMAND_CUDA_CHECK( cudaFree( nullptr ) );
+
+        m_pageTableManager = std::make_shared<PageTableManager>( 1024, 512 );
+        m_startPage        = m_pageTableManager->reserveBackedPages( 256, &m_handler );
+        if( GetParam() )
+        {
+            m_executor         = std::make_shared<TestExecutor>( 4 );
+            m_options.executor = m_executor;
+        }
+        m_processor.reset( new ThreadPoolRequestProcessor( m_pageTableManager, m_options, &m_latencyRecorder ) );
+        m_processor->start( 4 );
+    }
+
+    void TearDown() override
+    {
+        m_processor->stop();
+        m_processor.reset();
+        m_executor.reset();
+    }
+
+  protected:
+    Options                                     m_options;
+    CountingRequestHandler                      m_handler;
+    std::shared_ptr<PageTableManager>           m_pageTableManager;
+    std::shared_ptr<TestExecutor>               m_executor;
+    LatencyRecorder                             m_latencyRecorder;
+    std::unique_ptr<ThreadPoolRequestProcessor> m_processor;
+    unsigned int                                m_startPage = 0;
+    unsigned int                                m_launchId  = 0;
+
+    // Add the given requests as a new launch, returning the ticket that tracks them.
+    Ticket addRequests( const std::vector<unsigned int>& pageIds )
+    {
+        Ticket ticket = TicketImpl::create( CUstream{} );
+        m_processor->setTicket( m_launchId, ticket );
+        m_processor->addRequests( CUstream{}, m_launchId++, pageIds.data(), static_cast<unsigned int>( pageIds.size() ) );
+        return ticket;
+    }
+};
+
+TEST_P( TestThreadPoolRequestProcessor, ProcessesRequests )
+{
+    std::vector<Ticket> tickets;
+    for( unsigned int batch = 0; batch < 8; ++batch )
+    {
+        std::vector<unsigned int> pageIds;
+        for( unsigned int i = 0; i < 32; ++i )
+            pageIds.push_back( m_startPage + batch * 32 + i );
+        tickets.push_back( addRequests( pageIds ) );
+    }
+    for( Ticket& ticket : tickets )
+    {
+        ticket.wait();
+        EXPECT_EQ( 0, ticket.numTasksRemaining() );
+    }
+    EXPECT_EQ( 256u, m_handler.getNumFilled() );
+
+    // Tasks are submitted to the executor on demand.
+    if( m_executor )
+    {
+        EXPECT_LT( 0u, m_executor->getNumSubmitted() );
+    }
+}
+
+TEST_P( TestThreadPoolRequestProcessor, ProcessesEmptyBatch )
+{
+    Ticket ticket = addRequests( std::vector<unsigned int>() );
+    ticket.wait();
+    EXPECT_EQ( 0, ticket.numTasksTotal() );
+    EXPECT_EQ( 0u, m_handler.getNumFilled() );
+}
+
+TEST_P( TestThreadPoolRequestProcessor, ResumesAfterIdle )
+{
+    // Requests added after the tasks have retired are still processed.
+    for( unsigned int i = 0; i < 16; ++i )
+    {
+        Ticket ticket = addRequests( {m_startPage + i} );
+        ticket.wait();
+    }
+    EXPECT_EQ( 16u, m_handler.getNumFilled() );
+}
+
+TEST_P( TestThreadPoolRequestProcessor, StopsWithQueuedRequests )
+{
+    std::vector<unsigned int> pageIds;
+    for( unsigned int i = 0; i < 256; ++i )
+        pageIds.push_back( m_startPage + i );
+    addRequests( pageIds );
+
+    // Stopping does not wait for queued requests to be filled.
+    m_processor->stop();
+    EXPECT_GE( 256u, m_handler.getNumFilled() );
+}
+
+TEST_P( TestThreadPoolRequestProcessor, RecordsLatencies )
+{
+    std::vector<unsigned int> pageIds;
+    for( unsigned int i = 0; i < 64; ++i )
+        pageIds.push_back( m_startPage + i );
+    Ticket ticket = addRequests( pageIds );
+    ticket.wait();
+
+    // Latencies are recorded before the ticket is notified.
+    const LatencyStatistics stats = m_latencyRecorder.getStatistics( true );
+    EXPECT_EQ( 64ULL, stats.histograms[LATENCY_QUEUE_WAIT][REQUEST_HANDLER_OTHER].numSamples );
+    EXPECT_EQ( 64ULL, stats.histograms[LATENCY_FILL_REQUEST][REQUEST_HANDLER_OTHER].numSamples );
+    EXPECT_EQ( 0ULL, stats.getPhase( LATENCY_READ_TILE ).numSamples );
+    EXPECT_EQ( 0ULL, m_latencyRecorder.getStatistics( false ).getPhase( LATENCY_QUEUE_WAIT ).numSamples );
+}
+
+TEST_P( TestThreadPoolRequestProcessor, CompletesFailedRequests )
+{
+    FailingRequestHandler handler;
+    const unsigned int    pageId = m_pageTableManager->reserveBackedPages( 1, &handler );
+
+    // The failed fill still completes its ticket, and the page is no longer pending, so a second
+    // request for it is filled rather than attached to the failed one.
+    Ticket ticket1 = addRequests( std::vector<unsigned int>{pageId} );
+    ticket1.wait();
+    EXPECT_EQ( 0, ticket1.numTasksRemaining() );
+    EXPECT_EQ( 0u, handler.getNumFilled() );
+
+    Ticket ticket2 = addRequests( std::vector<unsigned int>{pageId} );
+    ticket2.wait();
+    EXPECT_EQ( 0, ticket2.numTasksRemaining() );
+    EXPECT_EQ( 1u, handler.getNumFilled() );
+}
+
+INSTANTIATE_TEST_SUITE_P( Executors, TestThreadPoolRequestProcessor, testing::Bool() );
@@ -0,0 +1,225 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "CudaCheck.h"
+#include "Util/TraceAnalysis.h"
+#include "Util/TraceFile.h"
+
+#include <OptiXToolkit/DemandLoading/Options.h>
+#include <OptiXToolkit/DemandLoading/TextureSampler.h>
+
+#include <cuda_runtime.h>
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+using namespace demandLoading;
+
+namespace {
+
+const unsigned int FIRST_TILE_PAGE = 16;
+
+TraceRecord makeRequests( unsigned int launchNum, const std::vector<unsigned int>& pageIds )
+{
+    TraceRecord record;
+    record.type      = TRACE_RECORD_REQUESTS;
+    record.launchNum = launchNum;
+    record.pageIds   = pageIds;
+    return record;
+}
+
+// A texture whose tile pages start at the given page: a one-page mip tail (level 2), then 4 tiles
+// in level 1 and 16 tiles in level 0.
+TraceRecord makeTexturePages( unsigned int textureId, unsigned int startPage )
+{
+    TraceRecord record;
+    record.type           = TRACE_RECORD_TEXTURE_PAGES;
+    record.textureId      = textureId;
+    record.startPage      = startPage;
+    record.numPages       = 21;
+    record.mipLevelStarts = {5, 1, 0};
+    return record;
+}
+
+Options makeOptions()
+{
+    Options options;
+    options.numPageTableEntries = FIRST_TILE_PAGE;
+    return options;
+}
+
+}  // anonymous namespace
+
+class TestTraceAnalysis : public testing::Test
+{
+};
+
+TEST_F( TestTraceAnalysis, WorkingSetsAndReuseDistances )
+{
+    TraceAnalyzer analyzer( makeOptions() );
+
+    // Sampler and base color pages are not tiles.
+    const unsigned int A = FIRST_TILE_PAGE, B = A + 1, C = A + 2;
+    analyzer.addRecord( makeRequests( 0, {0, 1, A, B} ) );
+    analyzer.addRecord( makeRequests( 1, {C, A} ) );
+    analyzer.addRecord( makeRequests( 1, {A} ) );
+    analyzer.addRecord( makeRequests( 2, {B} ) );
+    const TraceAnalysis analysis = analyzer.analyze( TraceAnalysisOptions() );
+
+    EXPECT_EQ( 2U, analysis.numOtherRequests );
+    EXPECT_EQ( 6U, analysis.numRequests );
+    EXPECT_EQ( 3U, analysis.numTiles );
+    EXPECT_EQ( 3U, analysis.numLaunches );
+    EXPECT_EQ( std::vector<unsigned int>( {2, 2, 1} ), analysis.workingSets );
+
+    // Reuse distances: A after {B, C} is 2, A after A is 0, and B after {C, A} is 2.
+    EXPECT_EQ( std::vector<unsigned long long>( {1, 2} ), analysis.reuseDistances );
+}
+
+TEST_F( TestTraceAnalysis, MissCurves )
+{
+    TraceAnalyzer analyzer( makeOptions() );
+    const unsigned int A = FIRST_TILE_PAGE, B = A + 1, C = A + 2;
+    analyzer.addRecord( makeRequests( 0, {A, B, C, A, B, C} ) );
+
+    TraceAnalysisOptions options;
+    options.capacities = {0, 1, 2, 3, 4};
+    const TraceAnalysis analysis = analyzer.analyze( options );
+    ASSERT_EQ( 5U, analysis.missCurve.size() );
+
+    // Cyclic access defeats LRU until every tile fits, whereas the optimal policy evicts the tile
+    // that is used furthest in the future.
+    EXPECT_EQ( 6U, analysis.missCurve[0].lruMisses );
+    EXPECT_EQ( 6U, analysis.missCurve[1].optimalMisses );
+    EXPECT_EQ( 6U, analysis.missCurve[2].lruMisses );
+    EXPECT_EQ( 4U, analysis.missCurve[2].optimalMisses );
+    EXPECT_GE( analysis.missCurve[2].randomMisses, analysis.missCurve[2].optimalMisses );
+    EXPECT_LE( analysis.missCurve[2].randomMisses, 6U );
+    for( unsigned int i = 3; i < 5; ++i )
+    {
+        EXPECT_EQ( 3U, analysis.missCurve[i].optimalMisses );
+        EXPECT_EQ( 3U, analysis.missCurve[i].lruMisses );
+        EXPECT_EQ( 3U, analysis.missCurve[i].randomMisses );
+    }
+}
+
+TEST_F( TestTraceAnalysis, OptimalNeverWorseThanLru )
+{
+    TraceAnalyzer analyzer( makeOptions() );
+    unsigned int  state = 12345;
+    for( unsigned int launchNum = 0; launchNum < 100; ++launchNum )
+    {
+        std::vector<unsigned int> pageIds;
+        for( unsigned int i = 0; i < 20; ++i )
+        {
+            state = state * 1664525u + 1013904223u;
+            pageIds.push_back( FIRST_TILE_PAGE + ( state >> 16 ) % 64 );
+        }
+        analyzer.addRecord( makeRequests( launchNum, pageIds ) );
+    }
+    const TraceAnalysis analysis = analyzer.analyze( TraceAnalysisOptions() );
+    ASSERT_FALSE( analysis.missCurve.empty() );
+    for( const MissCurvePoint& point : analysis.missCurve )
+    {
+        EXPECT_LE( point.optimalMisses, point.lruMisses );
+        EXPECT_LE( point.optimalMisses, point.randomMisses );
+        EXPECT_GE( point.optimalMisses, analysis.numTiles );
+    }
+    EXPECT_EQ( analysis.numTiles, analysis.missCurve.back().capacity );
+}
+
+TEST_F( TestTraceAnalysis, HottestTextures )
+{
+    TraceAnalyzer analyzer( makeOptions() );
+    analyzer.addRecord( makeTexturePages( 0, FIRST_TILE_PAGE ) );
+    analyzer.addRecord( makeTexturePages( 2, FIRST_TILE_PAGE + 21 ) );
+
+    // Texture 2: its mip tail twice and two level 0 tiles.  Texture 0: one level 1 tile.
+    const unsigned int tex0 = FIRST_TILE_PAGE, tex2 = FIRST_TILE_PAGE + 21;
+    analyzer.addRecord( makeRequests( 0, {tex2, tex2 + 5, tex2 + 20, tex0 + 1} ) );
+    analyzer.addRecord( makeRequests( 1, {tex2} ) );
+
+    TraceAnalysisOptions options;
+    options.numHottest           = 2;
+    const TraceAnalysis analysis = analyzer.analyze( options );
+
+    ASSERT_EQ( 2U, analysis.hottestTextures.size() );
+    EXPECT_EQ( 2U, analysis.hottestTextures[0].textureId );
+    EXPECT_EQ( -1, analysis.hottestTextures[0].mipLevel );
+    EXPECT_EQ( 4U, analysis.hottestTextures[0].numRequests );
+    EXPECT_EQ( 3U, analysis.hottestTextures[0].numTiles );
+    EXPECT_EQ( 0U, analysis.hottestTextures[1].textureId );
+
+    // Levels with the same number of requests are ranked by texture id and mip level.
+    ASSERT_EQ( 2U, analysis.hottestMipLevels.size() );
+    EXPECT_EQ( 2U, analysis.hottestMipLevels[0].textureId );
+    EXPECT_EQ( 0, analysis.hottestMipLevels[0].mipLevel );
+    EXPECT_EQ( 2U, analysis.hottestMipLevels[0].numRequests );
+    EXPECT_EQ( 2U, analysis.hottestMipLevels[0].numTiles );
+    EXPECT_EQ( 2U, analysis.hottestMipLevels[1].textureId );
+    EXPECT_EQ( 2, analysis.hottestMipLevels[1].mipLevel );
+    EXPECT_EQ( 2U, analysis.hottestMipLevels[1].numRequests );
+    EXPECT_EQ( 1U, analysis.hottestMipLevels[1].numTiles );
+}
+
+TEST_F( TestTraceAnalysis, AnalyzeTraceFile )
+{
+    DEMAND_CUDA_CHECK( cudaSetDevice( 0 ) );
+    DEMAND_CUDA_CHECK( cudaFree( nullptr ) );
+    CUstream stream;
+    DEMAND_CUDA_CHECK( cuStreamCreate( &stream, 0 ) );
+
+    const char* traceFilename = "DemandLoadingTraceAnalysis.dat";
+    {
+        TraceFileWriter writer( traceFilename );
+        writer.recordOptions( makeOptions() );
+
+        TextureSampler sampler{};
+        sampler.startPage                      = FIRST_TILE_PAGE;
+        sampler.numPages                       = 21;
+        sampler.mipTailFirstLevel              = 2;
+        sampler.mipLevelSizes[0].mipLevelStart = 5;
+        sampler.mipLevelSizes[1].mipLevelStart = 1;
+        writer.recordTexturePages( 0, sampler );
+
+        // A sampler page and two level 1 tiles.
+        const unsigned int pageIds[] = {0, FIRST_TILE_PAGE + 1, FIRST_TILE_PAGE + 2};
+        writer.recordRequests( stream, 0, pageIds, 3 );
+        writer.recordRequests( stream, 1, pageIds + 1, 1 );
+    }
+    DEMAND_CUDA_CHECK( cuStreamDestroy( stream ) );
+
+    const TraceAnalysis analysis = analyzeTraceFile( traceFilename, TraceAnalysisOptions() );
+    EXPECT_EQ( 1U, analysis.numOtherRequests );
+    EXPECT_EQ( 3U, analysis.numRequests );
+    EXPECT_EQ( std::vector<unsigned int>( {2, 1} ), analysis.workingSets );
+    ASSERT_EQ( 1U, analysis.hottestMipLevels.size() );
+    EXPECT_EQ( 1, analysis.hottestMipLevels[0].mipLevel );
+    EXPECT_EQ( 3U, analysis.hottestMipLevels[0].numRequests );
+}
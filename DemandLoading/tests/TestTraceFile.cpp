@@ -39,7 +39,14 @@
 
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iterator>
+#include <sstream>
 #include <thread>
+#include <vector>
 
 using namespace demandLoading;
 using namespace imageSource;
@@ -54,8 +61,7 @@ class TestTraceFile : public testing::Test
         DEMAND_CUDA_CHECK( cudaFree( nullptr ) );
 
         // Create stream.
-        CUstream stream;
-        DEMAND_CUDA_CHECK( cuStreamCreate( &stream, 0 ) );
+        DEMAND_CUDA_CHECK( cuStreamCreate( &m_stream, 0 ) );
     }
 
     unsigned int m_deviceIndex = 0;
@@ -78,8 +84,259 @@ TEST_F( TestTraceFile, TestWriteAndRead )
 
         // The first page represents the sampler for the first texture.
         unsigned int pageIds[1] = {0};
-        writer.recordRequests( m_stream, pageIds, 1 );
+        writer.recordRequests( m_stream, 0, pageIds, 1 );
     }
 
     replayTraceFile( traceFilename );
 }
+
+TEST_F( TestTraceFile, TestReplayReport )
+{
+    std::string textureFilename( getSourceDir() + "/Textures/TiledMipMapped.exr" );
+    const char* traceFilename = "DemandLoadingTraceReplay.dat";
+    {
+        TraceFileWriter writer( traceFilename );
+        writer.recordOptions( Options() );
+        writer.recordTexture( std::shared_ptr<EXRReader>( new EXRReader( textureFilename.c_str() ) ), TextureDescriptor{} );
+
+        // Record three launches, 20 ms apart.
+        unsigned int pageIds[2] = {0, 1};
+        for( unsigned int launchNum = 0; launchNum < 3; ++launchNum )
+        {
+            if( launchNum > 0 )
+                std::this_thread::sleep_for( std::chrono::milliseconds( 20 ) );
+            writer.recordRequests( m_stream, launchNum, pageIds, 2 );
+        }
+    }
+
+    // Replay in real time with adjusted options.
+    TraceReplayConfig config;
+    config.name                = "realtime";
+    config.timeScale           = 1.0;
+    config.queueSampleInterval = 0.005;
+    config.adjustOptions       = []( Options& options ) {
+        options.maxThreads          = 2;
+        options.maxRequestQueueSize = 128;
+    };
+    TraceReplayReport report = replayTraceFile( traceFilename, config );
+
+    EXPECT_EQ( "realtime", report.name );
+    EXPECT_EQ( 2U, report.options.maxThreads );
+    EXPECT_EQ( 128U, report.options.maxRequestQueueSize );
+    EXPECT_EQ( 3U, report.numLaunches );
+    EXPECT_EQ( 3U, report.numBatches );
+    EXPECT_EQ( 6U, report.numRequests );
+    EXPECT_GE( report.elapsedTime, 0.035 );
+    EXPECT_FALSE( report.queueDepth.empty() );
+
+    // Replaying as fast as possible ignores the recorded times.  Its elapsed time is not compared
+    // with the paced replay, which would depend on the load of the machine running the test.
+    TraceReplayConfig fast;
+    fast.name = "fast \"unpaced\"";
+    std::vector<TraceReplayReport> reports{report, replayTraceFile( traceFilename, fast )};
+    EXPECT_EQ( 0.0, reports[1].timeScale );
+    EXPECT_EQ( 3U, reports[1].numBatches );
+    EXPECT_EQ( 6U, reports[1].numRequests );
+    EXPECT_GT( reports[1].elapsedTime, 0.0 );
+
+    std::ostringstream json;
+    writeTraceReplayReport( json, reports );
+    EXPECT_NE( std::string::npos, json.str().find( "\"name\": \"realtime\"" ) );
+    EXPECT_NE( std::string::npos, json.str().find( "\"name\": \"fast \\\"unpaced\\\"\"" ) );
+    EXPECT_NE( std::string::npos, json.str().find( "\"fillRequest\": {\"count\": " ) );
+    EXPECT_NE( std::string::npos, json.str().find( "\"queueDepth\": [[" ) );
+}
+
+namespace {
+
+std::vector<TraceCompression> getSupportedCompressions()
+{
+    std::vector<TraceCompression> compressions;
+    for( TraceCompression compression : {TRACE_COMPRESSION_NONE, TRACE_COMPRESSION_LZ4, TRACE_COMPRESSION_ZSTD} )
+    {
+        if( isTraceCompressionSupported( compression ) )
+            compressions.push_back( compression );
+    }
+    return compressions;
+}
+
+// Read the records of all the blocks, decoding the blocks in parallel.
+std::vector<TraceRecord> readAllRecords( const TraceFileReader& reader )
+{
+    std::vector<std::future<std::vector<TraceRecord>>> blocks;
+    for( size_t i = 0; i < reader.getBlocks().size(); ++i )
+    {
+        blocks.push_back( std::async( std::launch::async, [&reader, i] {
+            std::vector<TraceRecord> records;
+            reader.readBlock( i, records );
+            return records;
+        } ) );
+    }
+    std::vector<TraceRecord> records;
+    for( auto& block : blocks )
+    {
+        std::vector<TraceRecord> blockRecords = block.get();
+        std::move( blockRecords.begin(), blockRecords.end(), std::back_inserter( records ) );
+    }
+    return records;
+}
+
+}  // anonymous namespace
+
+TEST_F( TestTraceFile, TestRequestRecords )
+{
+    const char* traceFilename = "DemandLoadingTraceV2.dat";
+    for( TraceCompression compression : getSupportedCompressions() )
+    {
+        Options options;
+        options.numPages            = 1 << 20;
+        options.maxRequestQueueSize = 1024;
+        options.maxRequestAge       = 3;
+        options.evictionActive      = false;
+        {
+            TraceFileWriter writer( traceFilename, compression );
+            writer.recordOptions( options );
+            const unsigned int pageIds[] = {42, 7, 1000000, 8};
+            writer.recordRequests( m_stream, 3, pageIds, 4 );
+            writer.recordRequests( m_stream, 4, pageIds + 1, 1 );
+        }
+
+        TraceFileReader reader( traceFilename );
+        EXPECT_EQ( TRACE_FILE_VERSION, reader.getVersion() );
+        const Options readOptions = reader.readOptions();
+        EXPECT_EQ( options.numPages, readOptions.numPages );
+        EXPECT_EQ( options.maxRequestQueueSize, readOptions.maxRequestQueueSize );
+        EXPECT_EQ( options.maxRequestAge, readOptions.maxRequestAge );
+        EXPECT_FALSE( readOptions.evictionActive );
+        ASSERT_EQ( 1u, reader.getBlocks().size() );
+        EXPECT_EQ( 3u, reader.getBlocks()[0].numRecords );
+
+        std::vector<TraceRecord> records;
+        reader.readBlock( 0, records );
+        ASSERT_EQ( 3u, records.size() );
+        EXPECT_EQ( TRACE_RECORD_OPTIONS, records[0].type );
+        EXPECT_EQ( TRACE_RECORD_REQUESTS, records[1].type );
+        EXPECT_EQ( 3u, records[1].launchNum );
+        EXPECT_EQ( m_deviceIndex, records[1].deviceIndex );
+        EXPECT_EQ( ( std::vector<unsigned int>{7, 8, 42, 1000000} ), records[1].pageIds );
+        EXPECT_EQ( 4u, records[2].launchNum );
+        EXPECT_EQ( records[1].streamId, records[2].streamId );
+        EXPECT_EQ( std::vector<unsigned int>{7}, records[2].pageIds );
+        EXPECT_LE( records[0].timestamp, records[1].timestamp );
+        EXPECT_LE( records[1].timestamp, records[2].timestamp );
+        EXPECT_EQ( records[2].timestamp, reader.getBlocks()[0].lastTimestamp );
+    }
+}
+
+TEST_F( TestTraceFile, TestBlockIndex )
+{
+    const char*        traceFilename = "DemandLoadingTraceBlocks.dat";
+    const unsigned int numBatches    = 64;
+    const unsigned int batchSize     = 8192;
+    {
+        TraceFileWriter writer( traceFilename, TRACE_COMPRESSION_NONE );
+        writer.recordOptions( Options() );
+
+        // Widely spaced page ids take several bytes each, so the batches span multiple blocks.
+        std::vector<unsigned int> pageIds( batchSize );
+        for( unsigned int batch = 0; batch < numBatches; ++batch )
+        {
+            for( unsigned int i = 0; i < batchSize; ++i )
+                pageIds[i] = ( batch + i * numBatches ) * 4096;
+            writer.recordRequests( m_stream, batch, pageIds.data(), batchSize );
+        }
+    }
+
+    TraceFileReader reader( traceFilename );
+    const std::vector<TraceBlockInfo> blocks = reader.getBlocks();
+    ASSERT_LT( 1u, blocks.size() );
+    unsigned int numRecords = 0;
+    for( size_t i = 0; i < blocks.size(); ++i )
+    {
+        EXPECT_LE( blocks[i].firstTimestamp, blocks[i].lastTimestamp );
+        if( i > 0 )
+        {
+            EXPECT_LE( blocks[i - 1].lastTimestamp, blocks[i].firstTimestamp );
+        }
+        numRecords += blocks[i].numRecords;
+    }
+    EXPECT_EQ( numBatches + 1, numRecords );
+
+    const std::vector<TraceRecord> records = readAllRecords( reader );
+    ASSERT_EQ( numBatches + 1, records.size() );
+    for( unsigned int batch = 0; batch < numBatches; ++batch )
+    {
+        const TraceRecord& record = records[batch + 1];
+        EXPECT_EQ( batch, record.launchNum );
+        ASSERT_EQ( batchSize, record.pageIds.size() );
+        EXPECT_EQ( batch * 4096, record.pageIds.front() );
+        EXPECT_TRUE( std::is_sorted( record.pageIds.begin(), record.pageIds.end() ) );
+    }
+
+    // Without the trailer, the blocks are found by scanning the file.
+    std::string contents;
+    {
+        std::ifstream file( traceFilename, std::ios::binary );
+        contents.assign( std::istreambuf_iterator<char>( file ), std::istreambuf_iterator<char>() );
+    }
+    const char* truncatedFilename = "DemandLoadingTraceTruncated.dat";
+    {
+        std::ofstream file( truncatedFilename, std::ios::binary );
+        file.write( contents.data(), contents.size() - 1 );
+    }
+    TraceFileReader truncatedReader( truncatedFilename );
+    ASSERT_EQ( blocks.size(), truncatedReader.getBlocks().size() );
+    EXPECT_EQ( blocks.back().offset, truncatedReader.getBlocks().back().offset );
+    EXPECT_EQ( numBatches + 1, readAllRecords( truncatedReader ).size() );
+}
+
+TEST_F( TestTraceFile, TestReadVersion1 )
+{
+    // Write a version 1 trace by hand: raw record types, length-prefixed option names, and raw arrays.
+    const char* traceFilename = "DemandLoadingTraceV1.dat";
+    Options     options;
+    options.maxThreads = 3;
+    {
+        std::ofstream file( traceFilename, std::ios::binary );
+        auto          write = [&file]( const void* data, size_t size ) { file.write( static_cast<const char*>( data ), size ); };
+        auto          writeOption = [&write]( const std::string& name, const void* value, size_t size ) {
+            const size_t length = name.size();
+            write( &length, sizeof( length ) );
+            write( name.data(), length );
+            write( value, size );
+        };
+        const int optionsType = 0;
+        write( &optionsType, sizeof( optionsType ) );
+        writeOption( "numPages", &options.numPages, sizeof( options.numPages ) );
+        writeOption( "numPageTableEntries", &options.numPageTableEntries, sizeof( options.numPageTableEntries ) );
+        writeOption( "maxRequestedPages", &options.maxRequestedPages, sizeof( options.maxRequestedPages ) );
+        writeOption( "maxFilledPages", &options.maxFilledPages, sizeof( options.maxFilledPages ) );
+        writeOption( "maxStalePages", &options.maxStalePages, sizeof( options.maxStalePages ) );
+        writeOption( "maxEvictablePages", &options.maxEvictablePages, sizeof( options.maxEvictablePages ) );
+        writeOption( "maxInvalidatedPages", &options.maxInvalidatedPages, sizeof( options.maxInvalidatedPages ) );
+        writeOption( "maxStagedPages", &options.maxStagedPages, sizeof( options.maxStagedPages ) );
+        writeOption( "useLruTable", &options.useLruTable, sizeof( options.useLruTable ) );
+        writeOption( "maxTexMemPerDevice", &options.maxTexMemPerDevice, sizeof( options.maxTexMemPerDevice ) );
+        writeOption( "maxPinnedMemory", &options.maxPinnedMemory, sizeof( options.maxPinnedMemory ) );
+        writeOption( "maxThreads", &options.maxThreads, sizeof( options.maxThreads ) );
+        writeOption( "maxActiveStreams", &options.maxActiveStreams, sizeof( options.maxActiveStreams ) );
+
+        const int          requestsType = 2;
+        const unsigned int header[3]    = {0, 0, 2};  // device index, stream id, number of page ids
+        const unsigned int pageIds[2]   = {5, 1};
+        write( &requestsType, sizeof( requestsType ) );
+        write( header, sizeof( header ) );
+        write( pageIds, sizeof( pageIds ) );
+    }
+
+    TraceFileReader reader( traceFilename );
+    EXPECT_EQ( 1u, reader.getVersion() );
+    EXPECT_EQ( 3u, reader.readOptions().maxThreads );
+
+    std::vector<TraceRecord> records;
+    reader.readBlock( 0, records );
+    ASSERT_EQ( 2u, records.size() );
+    EXPECT_EQ( TRACE_RECORD_REQUESTS, records[1].type );
+    EXPECT_EQ( ( std::vector<unsigned int>{5, 1} ), records[1].pageIds );
+    EXPECT_EQ( 0ULL, records[1].timestamp );
+}
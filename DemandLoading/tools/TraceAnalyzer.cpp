@@ -0,0 +1,231 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Util/EvictionSimulator.h"
+#include "Util/TraceAnalysis.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace demandLoading;
+
+// Analyze a demand loading trace file, reporting the working set of each launch, the distribution
+// of tile reuse distances, the misses of optimal, LRU and random eviction as a function of tile
+// memory, and the textures and mip levels with the most requests.  Optionally simulate the paging
+// system's threshold-LRU policy, CLOCK, ARC and random eviction, reporting hits and evictions.
+//
+// Usage: traceAnalyzer <trace file> [--memory <MB>]... [--hottest <count>] [--simulate <MB> [--frames]]
+
+namespace {
+
+// Sparse texture tiles occupy 64 KB of device memory.
+const double TILE_SIZE_IN_MB = 64.0 / 1024.0;
+
+void printUsage( const char* program )
+{
+    std::cerr << "Usage: " << program << " <trace file> [--memory <MB>]... [--hottest <count>] [--simulate <MB> [--frames]]\n"
+              << "  --memory <MB>      Tile memory size at which to compute misses (default: powers of two)\n"
+              << "  --hottest <count>  Number of textures and mip levels to rank (default: 10)\n"
+              << "  --simulate <MB>    Simulate the eviction policies with this tile memory size (0: traced size)\n"
+              << "  --frames           Print the hits, misses and evictions of each launch\n";
+}
+
+void printWorkingSets( const TraceAnalysis& analysis )
+{
+    std::vector<unsigned int> sizes( analysis.workingSets );
+    if( sizes.empty() )
+        return;
+    std::sort( sizes.begin(), sizes.end() );
+    auto percentile = [&sizes]( double fraction ) { return sizes[static_cast<size_t>( fraction * ( sizes.size() - 1 ) )]; };
+
+    std::cout << "\nWorking set per launch (tiles / MB):\n";
+    for( double fraction : {0.0, 0.5, 0.9, 0.99, 1.0} )
+    {
+        const unsigned int tiles = percentile( fraction );
+        std::cout << "  p" << std::left << std::setw( 4 ) << static_cast<int>( fraction * 100 ) << std::right
+                  << std::setw( 10 ) << tiles << std::setw( 12 ) << tiles * TILE_SIZE_IN_MB << "\n";
+    }
+}
+
+void printReuseDistances( const TraceAnalysis& analysis )
+{
+    if( analysis.reuseDistances.empty() )
+        return;
+    unsigned long long numReuses = 0;
+    for( unsigned long long count : analysis.reuseDistances )
+        numReuses += count;
+
+    std::cout << "\nReuse distance (distinct tiles between repeated requests):\n";
+    for( size_t i = 0; i < analysis.reuseDistances.size(); ++i )
+    {
+        const unsigned long long first = ( 1ULL << i ) - 1;
+        const unsigned long long last  = ( 1ULL << ( i + 1 ) ) - 2;
+        std::cout << "  " << std::setw( 10 ) << first << " - " << std::left << std::setw( 10 ) << last << std::right
+                  << std::setw( 12 ) << analysis.reuseDistances[i] << std::setw( 9 ) << std::fixed << std::setprecision( 2 )
+                  << 100.0 * analysis.reuseDistances[i] / numReuses << "%\n";
+    }
+}
+
+void printMissCurve( const TraceAnalysis& analysis )
+{
+    std::cout << "\nMisses by tile memory size:\n"
+              << std::setw( 12 ) << "tiles" << std::setw( 12 ) << "MB" << std::setw( 14 ) << "optimal"
+              << std::setw( 14 ) << "LRU" << std::setw( 14 ) << "random" << std::setw( 12 ) << "LRU/opt" << "\n";
+    for( const MissCurvePoint& point : analysis.missCurve )
+    {
+        const double ratio = point.optimalMisses > 0 ? static_cast<double>( point.lruMisses ) / point.optimalMisses : 1.0;
+        std::cout << std::setw( 12 ) << point.capacity << std::setw( 12 ) << std::setprecision( 1 )
+                  << point.capacity * TILE_SIZE_IN_MB << std::setw( 14 ) << point.optimalMisses << std::setw( 14 )
+                  << point.lruMisses << std::setw( 14 ) << point.randomMisses << std::setw( 12 )
+                  << std::setprecision( 3 ) << ratio << "\n";
+    }
+}
+
+void printUsages( const char* title, const std::vector<TextureUsage>& usages )
+{
+    if( usages.empty() )
+        return;
+    std::cout << "\n" << title << ":\n"
+              << std::setw( 10 ) << "texture" << std::setw( 8 ) << "level" << std::setw( 14 ) << "requests"
+              << std::setw( 10 ) << "tiles" << std::setw( 12 ) << "MB" << "\n";
+    for( const TextureUsage& usage : usages )
+    {
+        std::cout << std::setw( 10 ) << usage.textureId << std::setw( 8 )
+                  << ( usage.mipLevel < 0 ? std::string( "all" ) : std::to_string( usage.mipLevel ) ) << std::setw( 14 )
+                  << usage.numRequests << std::setw( 10 ) << usage.numTiles << std::setw( 12 )
+                  << std::setprecision( 1 ) << usage.numTiles * TILE_SIZE_IN_MB << "\n";
+    }
+}
+
+void printSimulation( const std::vector<EvictionSimulationResult>& results, bool printFrames )
+{
+    if( results.empty() )
+        return;
+    std::cout << "\nEviction simulation with " << results[0].capacity << " tiles (" << std::setprecision( 1 )
+              << results[0].capacity * TILE_SIZE_IN_MB << " MB):\n"
+              << std::setw( 16 ) << "policy" << std::setw( 14 ) << "hits" << std::setw( 14 ) << "misses"
+              << std::setw( 10 ) << "hit rate" << std::setw( 14 ) << "evictions" << std::setw( 12 ) << "evict/frame"
+              << std::setw( 10 ) << "max" << "\n";
+    for( const EvictionSimulationResult& result : results )
+    {
+        unsigned int maxEvictions = 0;
+        for( const EvictionFrameStats& frame : result.frames )
+            maxEvictions = std::max( maxEvictions, frame.numEvictions );
+        const double evictionsPerFrame = result.frames.empty() ? 0.0 : static_cast<double>( result.numEvictions ) / result.frames.size();
+        std::cout << std::setw( 16 ) << result.policyName << std::setw( 14 ) << result.numHits << std::setw( 14 )
+                  << result.numMisses << std::setw( 9 ) << std::setprecision( 2 ) << 100.0 * result.getHitRate() << "%"
+                  << std::setw( 14 ) << result.numEvictions << std::setw( 12 ) << std::setprecision( 1 )
+                  << evictionsPerFrame << std::setw( 10 ) << maxEvictions << "\n";
+    }
+
+    if( !printFrames )
+        return;
+    for( const EvictionSimulationResult& result : results )
+    {
+        std::cout << "\nLaunches (" << result.policyName << "):\n"
+                  << std::setw( 10 ) << "launch" << std::setw( 10 ) << "hits" << std::setw( 10 ) << "misses"
+                  << std::setw( 10 ) << "evictions" << std::setw( 10 ) << "resident" << "\n";
+        for( const EvictionFrameStats& frame : result.frames )
+        {
+            std::cout << std::setw( 10 ) << frame.launchNum << std::setw( 10 ) << frame.numHits << std::setw( 10 )
+                      << frame.numMisses << std::setw( 10 ) << frame.numEvictions << std::setw( 10 ) << frame.numResident << "\n";
+        }
+    }
+}
+
+}  // anonymous namespace
+
+int main( int argc, char* argv[] )
+{
+    const char*               filename = nullptr;
+    TraceAnalysisOptions      options;
+    EvictionSimulationOptions simulationOptions;
+    bool                      simulate    = false;
+    bool                      printFrames = false;
+    for( int i = 1; i < argc; ++i )
+    {
+        const bool hasValue = i + 1 < argc;
+        if( strcmp( argv[i], "--memory" ) == 0 && hasValue )
+            options.capacities.push_back( static_cast<unsigned int>( std::atof( argv[++i] ) / TILE_SIZE_IN_MB ) );
+        else if( strcmp( argv[i], "--hottest" ) == 0 && hasValue )
+            options.numHottest = static_cast<unsigned int>( std::atoi( argv[++i] ) );
+        else if( strcmp( argv[i], "--simulate" ) == 0 && hasValue )
+        {
+            simulationOptions.capacity = static_cast<unsigned int>( std::atof( argv[++i] ) / TILE_SIZE_IN_MB );
+            simulate                   = true;
+        }
+        else if( strcmp( argv[i], "--frames" ) == 0 )
+            printFrames = true;
+        else if( argv[i][0] != '-' && !filename )
+            filename = argv[i];
+        else
+        {
+            printUsage( argv[0] );
+            return EXIT_FAILURE;
+        }
+    }
+    if( !filename )
+    {
+        printUsage( argv[0] );
+        return EXIT_FAILURE;
+    }
+
+    TraceAnalysis                         analysis;
+    std::vector<EvictionSimulationResult> simulationResults;
+    try
+    {
+        analysis = analyzeTraceFile( filename, options );
+        if( simulate )
+            simulationResults = simulateEviction( filename, simulationOptions );
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << "Error analyzing " << filename << ": " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision( 1 );
+    std::cout << "Trace file:      " << filename << "\n"
+              << "Launches:        " << analysis.numLaunches << "\n"
+              << "Tile requests:   " << analysis.numRequests << "\n"
+              << "Other requests:  " << analysis.numOtherRequests << " (samplers, base colors and resources)\n"
+              << "Distinct tiles:  " << analysis.numTiles << " (" << analysis.numTiles * TILE_SIZE_IN_MB << " MB)\n";
+    printWorkingSets( analysis );
+    printReuseDistances( analysis );
+    printMissCurve( analysis );
+    printUsages( "Hottest textures", analysis.hottestTextures );
+    printUsages( "Hottest mip levels", analysis.hottestMipLevels );
+    printSimulation( simulationResults, printFrames );
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,136 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace imageSource {
+
+/// A byte range to be read by AsyncFileReader::read.
+struct AsyncReadRequest
+{
+    char*    dest;    ///< Destination buffer, e.g. a pinned transfer buffer.
+    uint64_t offset;  ///< Offset of the range in the file.
+    size_t   size;    ///< Size of the range in bytes.
+};
+
+/// Called when a batch of reads submitted with AsyncFileReader::submit completes.  The argument is
+/// null if all the reads succeeded, otherwise it holds the exception describing the failure.
+using AsyncReadCallback = std::function<void( std::exception_ptr )>;
+
+/// The state of a batch of reads submitted with AsyncFileReader::submit.
+class AsyncReadBatch
+{
+  public:
+    /// Returns true once the batch has completed, successfully or not.
+    bool isComplete() const;
+
+    /// Wait for the batch to complete.  Throws an exception if any read failed.
+    void wait();
+
+  private:
+    friend class AsyncFileReader;
+
+    mutable std::mutex      m_mutex;
+    std::condition_variable m_completed;
+    bool                    m_isComplete = false;
+    std::exception_ptr      m_exception;
+
+    void complete( std::exception_ptr exception );
+};
+
+/// Reads batches of byte ranges from a file, keeping all the reads in a batch in flight at once
+/// rather than waiting for each one in turn.  On Linux the reads are submitted to an io_uring;
+/// elsewhere, or if io_uring is unavailable, they are issued from a pool of I/O threads.
+///
+/// Batches may be read synchronously, or submitted to be read in the background while the caller
+/// does other work.  The methods may be called from multiple threads.
+///
+/// Only TileFileReader reads through an AsyncFileReader; the EXR and OIIO readers still read each
+/// tile synchronously.  TileFileReader::readTiles keeps a batch of tiles in flight at once, but
+/// waits for the batch before returning, so the demand loader's request threads still block on
+/// I/O, and the number of request threads (Options::maxThreads) bounds the number of batches in
+/// flight.
+class AsyncFileReader
+{
+  public:
+    /// Open the given file.  io_uring is used if allowed and supported by the system.  Throws an
+    /// exception on error.
+    explicit AsyncFileReader( const std::string& filename, bool allowIoUring = true );
+
+    /// Wait for submitted batches to complete, and close the file.
+    ~AsyncFileReader();
+
+    /// Read the requested ranges, returning when all of them have completed.  Throws an exception
+    /// if any read fails or extends past the end of the file.
+    void read( const AsyncReadRequest* requests, unsigned int numRequests );
+
+    /// Submit the requested ranges to be read in the background, returning immediately.  The
+    /// destination buffers must remain valid until the batch completes.  The optional callback is
+    /// called on an I/O thread when the batch completes, before the returned batch is marked
+    /// complete, so it must not wait for the batch.  Exceptions thrown by the callback are ignored.
+    std::shared_ptr<AsyncReadBatch> submit( const AsyncReadRequest* requests,
+                                            unsigned int            numRequests,
+                                            AsyncReadCallback       callback = AsyncReadCallback() );
+
+    /// Returns true if reads are submitted to an io_uring.
+    bool usesIoUring() const { return m_useIoUring; }
+
+  private:
+    // An io_uring and its mapped queues (see acquireRing).
+    struct Ring;
+
+#ifdef _WIN32
+    void* m_file = nullptr;
+#else
+    int m_file = -1;
+#endif
+    std::string                        m_filename;
+    bool                               m_useIoUring = false;
+    std::mutex                         m_ringsMutex;
+    std::vector<std::unique_ptr<Ring>> m_rings;
+    std::mutex                         m_pendingMutex;
+    std::condition_variable            m_pendingDone;
+    unsigned int                       m_numPending = 0;  // Number of submitted batches not yet complete.
+
+    void                  readWithThreads( const AsyncReadRequest* requests, unsigned int numRequests );
+    void                  readRange( const AsyncReadRequest& request );
+    std::unique_ptr<Ring> acquireRing();
+    void                  releaseRing( std::unique_ptr<Ring> ring );
+};
+
+}  // namespace imageSource
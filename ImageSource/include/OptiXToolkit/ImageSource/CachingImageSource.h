@@ -0,0 +1,140 @@
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <OptiXToolkit/ImageSource/ImageSource.h>
+#include <OptiXToolkit/ImageSource/TileCache.h>
+
+#include <atomic>
+#include <memory>
+
+namespace imageSource {
+
+/// CachingImageSource wraps another ImageSource, keeping copies of the tiles it reads in a
+/// TileCache.  A tile that is requested again (e.g. after it was evicted from device memory) is
+/// then copied from the cache rather than being read and decoded again.  Only images that fill
+/// host memory (CU_MEMORYTYPE_HOST) are cached; other requests are forwarded unchanged.
+class CachingImageSource : public ImageSource
+{
+  public:
+    /// Wrap the given image source.  Tiles are cached in the given cache, which defaults to the
+    /// process-wide TileCache.  The cache must outlive the CachingImageSource.
+    explicit CachingImageSource( std::shared_ptr<ImageSource> imageSource, TileCache* cache = nullptr );
+
+    /// Tiles of this image that remain in the cache are discarded as they become least recently used.
+    ~CachingImageSource() override = default;
+
+    /// Return the wrapped image source.
+    ImageSource* getImageSource() const { return m_imageSource.get(); }
+
+    void open( TextureInfo* info ) override { m_imageSource->open( info ); }
+
+    void close() override { m_imageSource->close(); }
+
+    bool isOpen() const override { return m_imageSource->isOpen(); }
+
+    const TextureInfo& getInfo() const override { return m_imageSource->getInfo(); }
+
+    CUmemorytype getFillType() const override { return m_imageSource->getFillType(); }
+
+    /// Copy the specified tile from the cache if present; otherwise read it from the wrapped image
+    /// source and add it to the cache.
+    bool readTile( char*        dest,
+                   unsigned int mipLevel,
+                   unsigned int tileX,
+                   unsigned int tileY,
+                   unsigned int tileWidth,
+                   unsigned int tileHeight,
+                   CUstream     stream ) override;
+
+    /// Copy the cached tiles in the batch, and read the rest from the wrapped image source as a
+    /// batch, adding those that are read to the cache.
+    bool readTiles( TileRequest*       requests,
+                    unsigned int       numRequests,
+                    unsigned int       tileWidth,
+                    unsigned int       tileHeight,
+                    CUstream           stream ) override;
+
+    bool readMipLevel( char* dest, unsigned int mipLevel, unsigned int expectedWidth, unsigned int expectedHeight, CUstream stream ) override
+    {
+        return m_imageSource->readMipLevel( dest, mipLevel, expectedWidth, expectedHeight, stream );
+    }
+
+    bool readMipTail( char*        dest,
+                      unsigned int mipTailFirstLevel,
+                      unsigned int numMipLevels,
+                      const uint2* mipLevelDims,
+                      unsigned int pixelSizeInBytes,
+                      CUstream     stream ) override
+    {
+        return m_imageSource->readMipTail( dest, mipTailFirstLevel, numMipLevels, mipLevelDims, pixelSizeInBytes, stream );
+    }
+
+    bool readBaseColor( float4& dest ) override { return m_imageSource->readBaseColor( dest ); }
+
+    /// Returns the number of tiles read by the wrapped image source (i.e. excluding cache hits).
+    unsigned long long getNumTilesRead() const override { return m_imageSource->getNumTilesRead(); }
+
+    /// Returns the number of bytes read by the wrapped image source.
+    unsigned long long getNumBytesRead() const override { return m_imageSource->getNumBytesRead(); }
+
+    /// Returns the time in seconds spent reading image data by the wrapped image source.
+    double getTotalReadTime() const override { return m_imageSource->getTotalReadTime(); }
+
+    /// Returns the number of tile requests satisfied from the cache.
+    unsigned long long getNumCacheHits() const { return m_numCacheHits; }
+
+    /// Returns the number of tile requests that were not in the cache.
+    unsigned long long getNumCacheMisses() const { return m_numCacheMisses; }
+
+    /// Returns the number of bytes copied from the cache.
+    unsigned long long getNumCacheBytesHit() const { return m_numCacheBytesHit; }
+
+    /// Returns "CachingImageSource".
+    const char* getSerializationTag() const override { return "CachingImageSource"; }
+
+    /// Serialize the wrapped image source, including its tag.  The cache is not serialized.
+    void serialize( std::ostream& stream ) const override;
+
+    /// Deserialize a CachingImageSource, which caches tiles in the process-wide TileCache.  Called
+    /// from deserializeImageSource.
+    static std::shared_ptr<ImageSource> deserialize( std::istream& stream );
+
+  private:
+    std::shared_ptr<ImageSource>    m_imageSource;
+    TileCache*                      m_cache;
+    const unsigned long long        m_imageId;
+    std::atomic<unsigned long long> m_numCacheHits{0};
+    std::atomic<unsigned long long> m_numCacheMisses{0};
+    std::atomic<unsigned long long> m_numCacheBytesHit{0};
+
+    size_t getTileSizeInBytes( unsigned int tileWidth, unsigned int tileHeight ) const;
+};
+
+}  // namespace imageSource
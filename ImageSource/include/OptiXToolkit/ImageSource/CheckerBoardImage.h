@@ -79,6 +79,15 @@ class CheckerBoardImage : public ImageSourceBase
     /// Read the base color of the image (1x1 mip level) as a float4. Returns true on success.
     bool readBaseColor( float4& /*dest*/ ) override { return false; }
 
+    /// Returns "CheckerBoardImage".
+    const char* getSerializationTag() const override { return "CheckerBoardImage"; }
+
+    /// Serialize the image dimensions and constructor parameters to the given stream.
+    void serialize( std::ostream& stream ) const override;
+
+    /// Deserialize a CheckerBoardImage.  Called from deserializeImageSource.
+    static std::shared_ptr<ImageSource> deserialize( std::istream& stream );
+
   private:
     bool isOddChecker( float x, float y, unsigned int squaresPerSide );
 
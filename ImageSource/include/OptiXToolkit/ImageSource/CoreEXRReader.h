@@ -31,6 +31,7 @@
 #include <OptiXToolkit/ImageSource/ImageSource.h>
 #include <OptiXToolkit/ImageSource/TextureInfo.h>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -79,6 +80,14 @@ class CoreEXRReader : public ImageSourceBase
                    unsigned int tileHeight,
                    CUstream     stream ) override;
 
+    /// Read a batch of tiles, decoding the EXR tiles they contain in parallel.  dest of each
+    /// request must be large enough to hold a tile.  Throws an exception on error.
+    bool readTiles( TileRequest*       requests,
+                    unsigned int       numRequests,
+                    unsigned int       tileWidth,
+                    unsigned int       tileHeight,
+                    CUstream           stream ) override;
+
     /// Read the specified mipLevel. Throws an exception on error.
     bool readMipLevel( char* dest, unsigned int mipLevel, unsigned int expectedWidth, unsigned int expectedHeight,
                        CUstream stream ) override;
@@ -101,7 +110,29 @@ class CoreEXRReader : public ImageSourceBase
     /// Returns the time in seconds spent reading image tiles.
     double getTotalReadTime() const override { return m_totalReadTime; }
 
+    /// Returns "CoreEXRReader".
+    const char* getSerializationTag() const override { return "CoreEXRReader"; }
+
+    /// Serialize the image filename and constructor parameters to the given stream.
+    void serialize( std::ostream& stream ) const override;
+
+    /// Deserialize a CoreEXRReader.  Called from deserializeImageSource.
+    static std::shared_ptr<ImageSource> deserialize( std::istream& stream );
+
   private:
+    // OpenEXR decode pipeline, which is reused for multiple chunks (see acquireDecodeContext).
+    struct DecodeContext;
+
+    // An EXR tile to be decoded, and where to put it.
+    struct SourceTile
+    {
+        char* dest;
+        int   rowPitch;
+        int   mipLevel;
+        int   tileX;
+        int   tileY;
+    };
+
     std::string        m_filename;
     exr_context_t      m_exrCtx = nullptr;
     bool               m_isScanline = false;
@@ -112,11 +143,16 @@ class CoreEXRReader : public ImageSourceBase
     bool               m_readBaseColor    = false;
     bool               m_baseColorWasRead = false;
     std::mutex         m_initMutex;
-    std::mutex         m_statsMutex;
-    unsigned long long m_numTilesRead  = 0;
-    unsigned long long m_numBytesRead  = 0;
+    std::mutex         m_statsMutex;  // Guards m_totalReadTime
     double             m_totalReadTime = 0.0;
 
+    std::atomic<unsigned long long> m_numTilesRead{0};
+    std::atomic<unsigned long long> m_numBytesRead{0};
+
+    // Decode pipelines not currently in use.  Their scratch buffers are reused across tiles.
+    std::vector<std::unique_ptr<DecodeContext>> m_decodeContexts;
+    std::mutex                                  m_decodeContextsMutex;
+
     int m_tileWidths[20]{};
     int m_tileHeights[20]{};
     int m_levelWidths[20]{};
@@ -129,7 +165,12 @@ class CoreEXRReader : public ImageSourceBase
     // We are only supporting one-part files for now
     static constexpr int m_partIndex = 0;
 
-    void readActualTile( char* dest, int rowPitch, int mipLevel, int tileX, int tileY );
+    std::unique_ptr<DecodeContext> acquireDecodeContext();
+    void releaseDecodeContext( std::unique_ptr<DecodeContext> context );
+    void destroyDecodeContexts();
+
+    void readActualTile( DecodeContext* context, char* dest, int rowPitch, int mipLevel, int tileX, int tileY );
+    void readSourceTiles( const std::vector<SourceTile>& tiles );
     void readScanlineData( char* dest );
 };
 
@@ -121,10 +121,13 @@ class EXRReader : public ImageSourceBase
         return m_totalReadTime;
     }
 
+    /// Returns "EXRReader".
+    const char* getSerializationTag() const override { return "EXRReader"; }
+
     /// Serialize the image filename (etc.) to the give stream.
-    void serialize( std::ostream& stream ) const;
+    void serialize( std::ostream& stream ) const override;
 
-    /// Deserialize an EXRReader.  Called from ImageSource::deserialize.
+    /// Deserialize an EXRReader.  Called from deserializeImageSource.
     static std::shared_ptr<ImageSource> deserialize( std::istream& stream );
 
   private:
@@ -35,6 +35,8 @@
 #include <vector_types.h>
 
 #include <cmath>
+#include <functional>
+#include <iosfwd>
 #include <memory>
 #include <string>
 
@@ -42,6 +44,16 @@ namespace imageSource {
 
 struct TextureInfo;
 
+/// A tile to be read by ImageSource::readTiles.
+struct TileRequest
+{
+    char*        dest;               ///< Destination buffer, which must be large enough to hold the tile.
+    unsigned int mipLevel;           ///< Mip level of the tile.
+    unsigned int tileX;              ///< Tile x coordinate within the mip level.
+    unsigned int tileY;              ///< Tile y coordinate within the mip level.
+    bool         satisfied = false;  ///< Set by readTiles if the tile was read into dest.
+};
+
 /// Interface for a mipmapped image.
 ///
 /// Any method may be called from multiple threads; the implementation must be threadsafe.
@@ -81,6 +93,16 @@ class ImageSource
                            unsigned int tileHeight,
                            CUstream     stream ) = 0;
 
+    /// Read a batch of tiles with the given dimensions, as if readTile were called for each one.
+    /// The tiles may be read concurrently.  Throws an exception on error.  Sets the satisfied flag
+    /// of each request, and returns true if every request was satisfied.  The default
+    /// implementation calls readTile for each request in turn.
+    virtual bool readTiles( TileRequest*       requests,
+                            unsigned int       numRequests,
+                            unsigned int       tileWidth,
+                            unsigned int       tileHeight,
+                            CUstream           stream );
+
     /// Read the specified mipLevel. Throws an exception on error.
     /// Returns true if the request was satisfied and data was copied into dest.
     virtual bool readMipLevel( char* dest, unsigned int mipLevel, unsigned int expectedWidth, unsigned int expectedHeight, CUstream stream ) = 0;
@@ -110,6 +132,15 @@ class ImageSource
     /// Returns the time in seconds spent reading image data (tiles or mip levels).  This number may
     /// be zero if the reader does not load tiles from disk, e.g. for procedural textures.
     virtual double getTotalReadTime() const = 0;
+
+    /// Returns the tag under which this image source is serialized, or nullptr if it cannot be
+    /// serialized.  The tag selects the deserializer registered with
+    /// registerImageSourceDeserializer().
+    virtual const char* getSerializationTag() const { return nullptr; }
+
+    /// Serialize the constructor parameters of this image source (not including its tag) to the
+    /// given stream.  The default implementation throws an exception.
+    virtual void serialize( std::ostream& stream ) const;
 };
 
 /// Base class for ImageSource with default implementation of readMipTail, etc.
@@ -141,4 +172,20 @@ inline unsigned int calculateNumMipLevels( unsigned int width, unsigned int heig
 
 std::shared_ptr<ImageSource> createImageSource( const std::string& filename, const std::string& directory = "" );
 
+/// Reconstructs an image source from the payload written by ImageSource::serialize.
+using ImageSourceDeserializer = std::function<std::shared_ptr<ImageSource>( std::istream& stream )>;
+
+/// Register a deserializer for image sources with the given serialization tag, replacing any
+/// previous registration.  Deserializers for the built-in image sources are registered
+/// automatically.  Threadsafe.
+void registerImageSourceDeserializer( const std::string& tag, ImageSourceDeserializer deserializer );
+
+/// Serialize the given image source, preceded by its serialization tag.  Throws an exception if the
+/// image source cannot be serialized.
+void serializeImageSource( const ImageSource& imageSource, std::ostream& stream );
+
+/// Deserialize an image source written by serializeImageSource.  Throws an exception if its tag
+/// has no registered deserializer.
+std::shared_ptr<ImageSource> deserializeImageSource( std::istream& stream );
+
 }  // namespace imageSource
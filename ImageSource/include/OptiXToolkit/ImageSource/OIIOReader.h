@@ -31,6 +31,7 @@
 #include <OptiXToolkit/ImageSource/ImageSource.h>
 #include <OptiXToolkit/ImageSource/TextureInfo.h>
 
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -98,18 +99,10 @@ class OIIOReader : public ImageSourceBase
     unsigned int getTileHeight() const { return m_tileHeight; }
 
     /// Returns the number of tiles that have been read.
-    unsigned long long getNumTilesRead() const override
-    {
-        std::unique_lock<std::mutex> lock( m_mutex );
-        return m_numTilesRead;
-    };
+    unsigned long long getNumTilesRead() const override { return m_numTilesRead; }
 
     /// Returns the number of bytes that have been read.
-    unsigned long long getNumBytesRead() const override
-    {
-        std::unique_lock<std::mutex> lock( m_mutex );
-        return m_numBytesRead;
-    };
+    unsigned long long getNumBytesRead() const override { return m_numBytesRead; }
 
     /// Returns the time in seconds spent reading image tiles.
     double getTotalReadTime() const override
@@ -118,8 +111,23 @@ class OIIOReader : public ImageSourceBase
         return m_totalReadTime;
     }
 
+    /// Returns "OIIOReader".
+    const char* getSerializationTag() const override { return "OIIOReader"; }
+
+    /// Serialize the image filename and constructor parameters to the given stream.
+    void serialize( std::ostream& stream ) const override;
+
+    /// Deserialize an OIIOReader.  Called from deserializeImageSource.
+    static std::shared_ptr<ImageSource> deserialize( std::istream& stream );
+
   private:
-    void readActualTile( char* dest, unsigned int rowPitch, unsigned int mipLevel, unsigned int tileX, unsigned int tileY );
+    // Holds a handle from the input pool, returning it to the pool on destruction.
+    class PooledInput;
+
+    std::unique_ptr<OIIO::ImageInput> acquireInput();
+    void releaseInput( std::unique_ptr<OIIO::ImageInput> input );
+
+    void readActualTile( OIIO::ImageInput* input, char* dest, unsigned int rowPitch, unsigned int mipLevel, unsigned int tileX, unsigned int tileY );
 
     std::string                       m_filename;
     std::unique_ptr<OIIO::ImageInput> m_input;
@@ -129,15 +137,19 @@ class OIIOReader : public ImageSourceBase
     unsigned int                      m_tileHeight{0};
     mutable std::mutex                m_mutex;
 
+    // Additional handles to the image, each used by one thread at a time for reading.
+    std::vector<std::unique_ptr<OIIO::ImageInput>> m_inputPool;
+    std::mutex                                     m_inputPoolMutex;
+
     std::vector<int> m_levelWidths, m_levelHeights;
 
     float4 m_baseColor{};
     bool   m_readBaseColor    = false;
     bool   m_baseColorWasRead = false;
 
-    unsigned long long m_numTilesRead  = 0;
-    unsigned long long m_numBytesRead  = 0;
-    double             m_totalReadTime = 0.0;
+    std::atomic<unsigned long long> m_numTilesRead{0};
+    std::atomic<unsigned long long> m_numBytesRead{0};
+    double                          m_totalReadTime = 0.0;
 };
 
 }  // namespace demandLoading
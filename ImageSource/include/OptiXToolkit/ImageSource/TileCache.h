@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+/// \file TileCache.h
+/// Byte-budgeted LRU cache of decoded image tiles.
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace imageSource {
+
+/// Identifies a tile of a particular image.
+struct TileCacheKey
+{
+    unsigned long long imageId;  ///< Unique id of the image (see TileCache::newImageId).
+    unsigned int       mipLevel;
+    unsigned int       tileX;
+    unsigned int       tileY;
+
+    bool operator==( const TileCacheKey& other ) const
+    {
+        return imageId == other.imageId && mipLevel == other.mipLevel && tileX == other.tileX && tileY == other.tileY;
+    }
+};
+
+/// A thread-safe cache of decoded tiles with a limit on the total number of bytes it holds.  The
+/// cache is divided into shards, each with its own lock and least-recently-used list, so that
+/// threads accessing different tiles rarely contend.  When a shard exceeds its share of the byte
+/// budget, its least recently used tiles are discarded.
+class TileCache
+{
+  public:
+    /// Return the process-wide tile cache, which is shared by all CachingImageSources by default.
+    static TileCache& getInstance();
+
+    /// Construct a cache that holds at most maxBytes of tile data.
+    explicit TileCache( size_t maxBytes );
+
+    /// Return a new unique image id, for use in TileCacheKey.
+    static unsigned long long newImageId();
+
+    /// Set the maximum number of bytes held by the cache, discarding tiles if necessary.
+    void setMaxBytes( size_t maxBytes );
+
+    /// Return the maximum number of bytes held by the cache.
+    size_t getMaxBytes() const { return m_maxBytes; }
+
+    /// Return the number of bytes currently held by the cache.
+    size_t getNumBytes() const;
+
+    /// If the specified tile is in the cache, copy it to dest and return true.  The tile is
+    /// expected to be numBytes in size.
+    bool find( const TileCacheKey& key, char* dest, size_t numBytes );
+
+    /// Add a copy of a tile to the cache, replacing any existing copy.  Tiles larger than a shard's
+    /// share of the budget are not cached.
+    void insert( const TileCacheKey& key, const char* data, size_t numBytes );
+
+    /// Discard all the tiles.
+    void clear();
+
+  private:
+    static const unsigned int NUM_SHARDS = 16;
+
+    struct KeyHash
+    {
+        size_t operator()( const TileCacheKey& key ) const;
+    };
+
+    struct Entry
+    {
+        TileCacheKey      key;
+        std::vector<char> data;
+    };
+
+    struct Shard
+    {
+        mutable std::mutex                                                    mutex;
+        std::list<Entry>                                                      lru;  // Most recently used first
+        std::unordered_map<TileCacheKey, std::list<Entry>::iterator, KeyHash> entries;
+        size_t                                                                numBytes = 0;
+
+        void evict( size_t maxBytes );
+    };
+
+    Shard               m_shards[NUM_SHARDS];
+    std::atomic<size_t> m_maxBytes;
+
+    Shard& getShard( const TileCacheKey& key ) { return m_shards[KeyHash()( key ) % NUM_SHARDS]; }
+};
+
+}  // namespace imageSource
@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <OptiXToolkit/ImageSource/ImageSource.h>
+#include <OptiXToolkit/ImageSource/TextureInfo.h>
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace imageSource {
+
+class AsyncFileReader;
+struct TileFileLayout;
+
+/// Reader for tile files written by writeTileFile.  A tile file holds a texture that has already
+/// been decoded and cut into the tiles used by the demand loader, so the reader simply maps the
+/// file into memory and copies each tile with a single memcpy.  Loading is then limited by the
+/// file system cache rather than by decoding.
+///
+/// Optionally, stored tiles and the mip tail are read with an AsyncFileReader instead of being
+/// copied from the mapping.  A batch of tiles is then read with all the reads in flight at once,
+/// rather than faulting in one tile after another, which hides the latency of network storage.
+class TileFileReader : public ImageSourceBase
+{
+  public:
+    /// The constructor copies the given filename.  The file is not opened until open() is called.
+    /// If useAsyncReads is true, tiles are read with an AsyncFileReader.
+    explicit TileFileReader( const std::string& filename, bool useAsyncReads = false );
+
+    /// Destructor
+    ~TileFileReader() override;
+
+    /// Map the file and read header info, including dimensions and format.  Throws an exception on error.
+    void open( TextureInfo* info ) override;
+
+    /// Unmap the file.
+    void close() override;
+
+    /// Check if image is currently open.
+    bool isOpen() const override { return m_data != nullptr; }
+
+    /// Get the image info.  Valid only after calling open().
+    const TextureInfo& getInfo() const override { return m_info; }
+
+    /// Return the mode in which the image fills part of itself
+    CUmemorytype getFillType() const override { return CU_MEMORYTYPE_HOST; }
+
+    /// Read the specified tile, returning the data in dest.  A tile with the dimensions stored in
+    /// the file is copied with a single memcpy; other tiles are assembled from the stored data.
+    /// Pixels outside the bounds of the mip level are filled in with black.  Throws an exception on
+    /// error.
+    bool readTile( char*        dest,
+                   unsigned int mipLevel,
+                   unsigned int tileX,
+                   unsigned int tileY,
+                   unsigned int tileWidth,
+                   unsigned int tileHeight,
+                   CUstream     stream ) override;
+
+    /// Read a batch of tiles.  If async reads are enabled, the stored tiles in the batch are read
+    /// concurrently.  Throws an exception on error.
+    bool readTiles( TileRequest*       requests,
+                    unsigned int       numRequests,
+                    unsigned int       tileWidth,
+                    unsigned int       tileHeight,
+                    CUstream           stream ) override;
+
+    /// Read the specified mipLevel. Throws an exception on error.
+    bool readMipLevel( char* dest, unsigned int mipLevel, unsigned int expectedWidth, unsigned int expectedHeight,
+                       CUstream stream ) override;
+
+    /// Read the mip tail.  If it starts at the level stored in the file, it is copied with a single
+    /// memcpy.  Throws an exception on error.
+    bool readMipTail( char*        dest,
+                      unsigned int mipTailFirstLevel,
+                      unsigned int numMipLevels,
+                      const uint2* mipLevelDims,
+                      unsigned int pixelSizeInBytes,
+                      CUstream     stream ) override;
+
+    /// Read the base color of the image (1x1 mip level) as a float4. Returns true on success.
+    bool readBaseColor( float4& dest ) override;
+
+    /// Return a pointer to the mapped data of the specified tile, or nullptr if the file does not
+    /// store that tile (e.g. it is in the mip tail).  The pointer is valid until close() is called.
+    const char* getTileData( unsigned int mipLevel, unsigned int tileX, unsigned int tileY ) const;
+
+    /// Get the width of the stored tiles.
+    unsigned int getTileWidth() const { return m_tileWidth; }
+
+    /// Get the height of the stored tiles.
+    unsigned int getTileHeight() const { return m_tileHeight; }
+
+    /// Get the first mip level of the stored mip tail.
+    unsigned int getMipTailFirstLevel() const { return m_mipTailFirstLevel; }
+
+    /// Returns the number of tiles that have been read.
+    unsigned long long getNumTilesRead() const override { return m_numTilesRead; }
+
+    /// Returns the number of bytes that have been read.
+    unsigned long long getNumBytesRead() const override { return m_numBytesRead; }
+
+    /// Returns the time in seconds spent reading image data.
+    double getTotalReadTime() const override { return m_totalReadTime; }
+
+    /// Returns "TileFileReader".
+    const char* getSerializationTag() const override { return "TileFileReader"; }
+
+    /// Serialize the tile file name and constructor parameters to the given stream.
+    void serialize( std::ostream& stream ) const override;
+
+    /// Deserialize a TileFileReader.  Called from deserializeImageSource.
+    static std::shared_ptr<ImageSource> deserialize( std::istream& stream );
+
+  private:
+    std::string                      m_filename;
+    bool                             m_useAsyncReads;
+    std::mutex                       m_initMutex;
+    TextureInfo                      m_info{};
+    std::unique_ptr<TileFileLayout>  m_layout;
+    std::unique_ptr<AsyncFileReader> m_asyncReader;
+    unsigned int                     m_tileWidth         = 0;
+    unsigned int                     m_tileHeight        = 0;
+    unsigned int                     m_mipTailFirstLevel = 0;
+    bool                             m_hasBaseColor      = false;
+    float4                           m_baseColor{};
+
+    const char* m_data     = nullptr;
+    size_t      m_dataSize = 0;
+#ifdef _WIN32
+    void* m_fileHandle    = nullptr;
+    void* m_mappingHandle = nullptr;
+#endif
+
+    std::atomic<unsigned long long> m_numTilesRead{0};
+    std::atomic<unsigned long long> m_numBytesRead{0};
+    std::mutex                      m_statsMutex;
+    double                          m_totalReadTime = 0.0;
+
+    void mapFile();
+    void unmapFile();
+    void copyRect( char* dest, unsigned int mipLevel, unsigned int x, unsigned int y, unsigned int width,
+                   unsigned int height ) const;
+    void addReadStats( unsigned long long numTiles, unsigned long long numBytes, double readTime );
+};
+
+}  // namespace imageSource
@@ -0,0 +1,53 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <OptiXToolkit/ImageSource/ImageSource.h>
+
+#include <vector_types.h>
+
+#include <string>
+
+namespace imageSource {
+
+/// Get the dimensions of the 64 KB tiles that the demand loader uses for sparse textures with the
+/// given pixel size (e.g. 64x64 for float4 pixels).
+uint2 getDefaultTileDimensions( unsigned int pixelSizeInBytes );
+
+/// Convert the given image into a tile file that can be read by TileFileReader.  The image is
+/// opened if necessary.  If tileWidth or tileHeight is zero, the default tile dimensions for the
+/// pixel size are used.  The mip tail starts with the first level that is smaller than a tile in
+/// either dimension, unless mipTailFirstLevel is specified.  Throws an exception on error.
+void writeTileFile( ImageSource&       image,
+                    const std::string& filename,
+                    unsigned int       tileWidth         = 0,
+                    unsigned int       tileHeight        = 0,
+                    unsigned int       mipTailFirstLevel = ~0u );
+
+}  // namespace imageSource
@@ -0,0 +1,450 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "Config.h"  // for OTK_USE_IO_URING
+
+#include <OptiXToolkit/ImageSource/AsyncFileReader.h>
+
+#include "Exception.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if OTK_USE_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+namespace imageSource {
+
+namespace {
+
+// Number of threads used to issue reads when io_uring is unavailable.  The threads spend most of
+// their time blocked on I/O, so there can be more of them than hardware threads.
+const unsigned int IO_THREAD_POOL_SIZE = 16;
+
+// Maximum number of reads each io_uring keeps in flight.
+const unsigned int RING_ENTRIES = 64;
+
+ThreadPool& getIOThreadPool()
+{
+    static ThreadPool pool( IO_THREAD_POOL_SIZE );
+    return pool;
+}
+
+void throwReadError( const std::string& filename, int error )
+{
+    const std::string reason = error ? std::strerror( error ) : "read past end of file";
+    throw Exception( ( "Error reading " + filename + ": " + reason ).c_str() );
+}
+
+}  // namespace
+
+#if OTK_USE_IO_URING
+
+// An io_uring with its submission and completion queues mapped into memory.  Each ring is used by
+// one thread at a time (see acquireRing), so the queues need no locking beyond the acquire/release
+// ordering required by the kernel.
+struct AsyncFileReader::Ring
+{
+    int           fd         = -1;
+    unsigned int  entries    = 0;
+    void*         sqRing     = MAP_FAILED;
+    void*         cqRing     = MAP_FAILED;
+    io_uring_sqe* sqes       = static_cast<io_uring_sqe*>( MAP_FAILED );
+    size_t        sqRingSize = 0;
+    size_t        cqRingSize = 0;
+    size_t        sqesSize   = 0;
+
+    unsigned int* sqHead  = nullptr;
+    unsigned int* sqTail  = nullptr;
+    unsigned int* sqMask  = nullptr;
+    unsigned int* sqArray = nullptr;
+    unsigned int* cqHead  = nullptr;
+    unsigned int* cqTail  = nullptr;
+    unsigned int* cqMask  = nullptr;
+    io_uring_cqe* cqes    = nullptr;
+
+    ~Ring()
+    {
+        if( sqes != MAP_FAILED )
+            munmap( sqes, sqesSize );
+        if( cqRing != MAP_FAILED && cqRing != sqRing )
+            munmap( cqRing, cqRingSize );
+        if( sqRing != MAP_FAILED )
+            munmap( sqRing, sqRingSize );
+        if( fd >= 0 )
+            ::close( fd );
+    }
+
+    // Create the ring and map its queues.  Returns false if io_uring is not supported.
+    bool init( unsigned int numEntries )
+    {
+        io_uring_params params;
+        std::memset( &params, 0, sizeof( params ) );
+        fd = static_cast<int>( syscall( __NR_io_uring_setup, numEntries, &params ) );
+        if( fd < 0 )
+            return false;
+        entries = params.sq_entries;
+
+        sqRingSize            = params.sq_off.array + params.sq_entries * sizeof( unsigned int );
+        cqRingSize            = params.cq_off.cqes + params.cq_entries * sizeof( io_uring_cqe );
+        const bool singleMmap = ( params.features & IORING_FEAT_SINGLE_MMAP ) != 0;
+        if( singleMmap )
+            sqRingSize = cqRingSize = std::max( sqRingSize, cqRingSize );
+
+        const int prot  = PROT_READ | PROT_WRITE;
+        const int flags = MAP_SHARED | MAP_POPULATE;
+        sqRing          = mmap( nullptr, sqRingSize, prot, flags, fd, IORING_OFF_SQ_RING );
+        if( sqRing == MAP_FAILED )
+            return false;
+        cqRing = singleMmap ? sqRing : mmap( nullptr, cqRingSize, prot, flags, fd, IORING_OFF_CQ_RING );
+        if( cqRing == MAP_FAILED )
+            return false;
+        sqesSize = params.sq_entries * sizeof( io_uring_sqe );
+        sqes     = static_cast<io_uring_sqe*>( mmap( nullptr, sqesSize, prot, flags, fd, IORING_OFF_SQES ) );
+        if( sqes == MAP_FAILED )
+            return false;
+
+        char* sq = static_cast<char*>( sqRing );
+        sqHead   = reinterpret_cast<unsigned int*>( sq + params.sq_off.head );
+        sqTail   = reinterpret_cast<unsigned int*>( sq + params.sq_off.tail );
+        sqMask   = reinterpret_cast<unsigned int*>( sq + params.sq_off.ring_mask );
+        sqArray  = reinterpret_cast<unsigned int*>( sq + params.sq_off.array );
+        char* cq = static_cast<char*>( cqRing );
+        cqHead   = reinterpret_cast<unsigned int*>( cq + params.cq_off.head );
+        cqTail   = reinterpret_cast<unsigned int*>( cq + params.cq_off.tail );
+        cqMask   = reinterpret_cast<unsigned int*>( cq + params.cq_off.ring_mask );
+        cqes     = reinterpret_cast<io_uring_cqe*>( cq + params.cq_off.cqes );
+        return true;
+    }
+
+    // Read the requested ranges from the given file, keeping up to 'entries' reads in flight.
+    // Short reads are resubmitted for the remainder of the range.  If any read fails, the reads in
+    // flight are drained before the error is thrown, since they write to the destination buffers.
+    void read( int file, const AsyncReadRequest* requests, unsigned int numRequests, const std::string& filename )
+    {
+        std::vector<iovec>        vecs( numRequests );
+        std::vector<uint64_t>     offsets( numRequests );
+        std::vector<unsigned int> queue;
+        for( unsigned int i = numRequests; i-- > 0; )
+        {
+            vecs[i]    = iovec{requests[i].dest, requests[i].size};
+            offsets[i] = requests[i].offset;
+            if( requests[i].size > 0 )
+                queue.push_back( i );
+        }
+
+        unsigned int inFlight = 0;
+        int          error    = 0;
+        bool         pastEnd  = false;
+        while( inFlight > 0 || ( !queue.empty() && !error && !pastEnd ) )
+        {
+            // Queue as many reads as will fit.
+            unsigned int tail = *sqTail;
+            while( !queue.empty() && !error && !pastEnd && inFlight < entries )
+            {
+                const unsigned int index = queue.back();
+                queue.pop_back();
+
+                io_uring_sqe* sqe = &sqes[tail & *sqMask];
+                std::memset( sqe, 0, sizeof( io_uring_sqe ) );
+                sqe->opcode    = IORING_OP_READV;
+                sqe->fd        = file;
+                sqe->addr      = reinterpret_cast<uint64_t>( &vecs[index] );
+                sqe->len       = 1;
+                sqe->off       = offsets[index];
+                sqe->user_data = index;
+
+                sqArray[tail & *sqMask] = tail & *sqMask;
+                ++tail;
+                ++inFlight;
+            }
+            __atomic_store_n( sqTail, tail, __ATOMIC_RELEASE );
+
+            // Submit the queued reads and wait for at least one to complete.
+            const unsigned int toSubmit = tail - __atomic_load_n( sqHead, __ATOMIC_ACQUIRE );
+            const long result = syscall( __NR_io_uring_enter, fd, toSubmit, 1, IORING_ENTER_GETEVENTS, nullptr, 0 );
+            if( result < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY )
+            {
+                // Withdraw the reads the kernel has not consumed (it only consumes them in
+                // io_uring_enter).  Reads already submitted may still write to the buffers, so they
+                // are drained before the error is thrown.
+                if( !error )
+                    error = errno;
+                const unsigned int head = __atomic_load_n( sqHead, __ATOMIC_ACQUIRE );
+                inFlight -= tail - head;
+                __atomic_store_n( sqTail, head, __ATOMIC_RELEASE );
+            }
+
+            // Process the completions.
+            unsigned int       head  = *cqHead;
+            const unsigned int cqEnd = __atomic_load_n( cqTail, __ATOMIC_ACQUIRE );
+            for( ; head != cqEnd; ++head )
+            {
+                const io_uring_cqe& cqe   = cqes[head & *cqMask];
+                const unsigned int  index = static_cast<unsigned int>( cqe.user_data );
+                --inFlight;
+                if( cqe.res == -EINTR || cqe.res == -EAGAIN )
+                    queue.push_back( index );
+                else if( cqe.res < 0 )
+                    error = -cqe.res;
+                else if( cqe.res == 0 )
+                    pastEnd = true;
+                else
+                {
+                    vecs[index].iov_base = static_cast<char*>( vecs[index].iov_base ) + cqe.res;
+                    vecs[index].iov_len -= cqe.res;
+                    offsets[index] += cqe.res;
+                    if( vecs[index].iov_len > 0 )
+                        queue.push_back( index );
+                }
+            }
+            __atomic_store_n( cqHead, head, __ATOMIC_RELEASE );
+        }
+
+        if( error || pastEnd )
+            throwReadError( filename, error );
+    }
+};
+
+#else
+
+struct AsyncFileReader::Ring
+{
+};
+
+#endif
+
+AsyncFileReader::AsyncFileReader( const std::string& filename, bool allowIoUring )
+    : m_filename( filename )
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA( filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr );
+    DEMAND_ASSERT_MSG( file != INVALID_HANDLE_VALUE, "Unable to open " + filename );
+    m_file = file;
+    (void)allowIoUring;
+#else
+    m_file = ::open( filename.c_str(), O_RDONLY | O_CLOEXEC );
+    DEMAND_ASSERT_MSG( m_file >= 0, "Unable to open " + filename );
+
+#if OTK_USE_IO_URING
+    // Fall back to the I/O threads if the system does not support io_uring.
+    if( allowIoUring )
+    {
+        std::unique_ptr<Ring> ring( new Ring );
+        if( ring->init( RING_ENTRIES ) )
+        {
+            m_useIoUring = true;
+            m_rings.push_back( std::move( ring ) );
+        }
+    }
+#else
+    (void)allowIoUring;
+#endif
+#endif
+}
+
+bool AsyncReadBatch::isComplete() const
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    return m_isComplete;
+}
+
+void AsyncReadBatch::wait()
+{
+    std::unique_lock<std::mutex> lock( m_mutex );
+    m_completed.wait( lock, [this] { return m_isComplete; } );
+    if( m_exception )
+        std::rethrow_exception( m_exception );
+}
+
+void AsyncReadBatch::complete( std::exception_ptr exception )
+{
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_isComplete = true;
+        m_exception  = exception;
+    }
+    m_completed.notify_all();
+}
+
+AsyncFileReader::~AsyncFileReader()
+{
+    // The submitted batches refer to the file, so they must complete before it is closed.
+    {
+        std::unique_lock<std::mutex> lock( m_pendingMutex );
+        m_pendingDone.wait( lock, [this] { return m_numPending == 0; } );
+    }
+    m_rings.clear();
+#ifdef _WIN32
+    CloseHandle( m_file );
+#else
+    ::close( m_file );
+#endif
+}
+
+void AsyncFileReader::read( const AsyncReadRequest* requests, unsigned int numRequests )
+{
+#if OTK_USE_IO_URING
+    if( m_useIoUring )
+    {
+        // A ring that fails with an exception is discarded rather than returned to the pool.
+        std::unique_ptr<Ring> ring = acquireRing();
+        if( ring )
+        {
+            ring->read( m_file, requests, numRequests, m_filename );
+            releaseRing( std::move( ring ) );
+            return;
+        }
+    }
+#endif
+    readWithThreads( requests, numRequests );
+}
+
+std::shared_ptr<AsyncReadBatch> AsyncFileReader::submit( const AsyncReadRequest* requests, unsigned int numRequests, AsyncReadCallback callback )
+{
+    std::shared_ptr<AsyncReadBatch> batch( new AsyncReadBatch );
+    {
+        std::unique_lock<std::mutex> lock( m_pendingMutex );
+        ++m_numPending;
+    }
+
+    // The batch is read by one of the I/O threads, which keeps all its reads in flight at once.
+    std::shared_ptr<std::vector<AsyncReadRequest>> batchRequests(
+        new std::vector<AsyncReadRequest>( requests, requests + numRequests ) );
+    getIOThreadPool().run( [this, batch, batchRequests, callback] {
+        std::exception_ptr exception;
+        try
+        {
+            read( batchRequests->data(), static_cast<unsigned int>( batchRequests->size() ) );
+        }
+        catch( ... )
+        {
+            exception = std::current_exception();
+        }
+        if( callback )
+        {
+            try
+            {
+                callback( exception );
+            }
+            catch( ... )
+            {
+            }
+        }
+        batch->complete( exception );
+
+        std::unique_lock<std::mutex> lock( m_pendingMutex );
+        if( --m_numPending == 0 )
+            m_pendingDone.notify_all();
+    } );
+    return batch;
+}
+
+// Get a ring from the pool, or make a new one if the pool is empty.  Returns null if a new ring
+// cannot be created, e.g. because of the limit on locked memory.
+std::unique_ptr<AsyncFileReader::Ring> AsyncFileReader::acquireRing()
+{
+    {
+        std::unique_lock<std::mutex> lock( m_ringsMutex );
+        if( !m_rings.empty() )
+        {
+            std::unique_ptr<Ring> ring = std::move( m_rings.back() );
+            m_rings.pop_back();
+            return ring;
+        }
+    }
+#if OTK_USE_IO_URING
+    std::unique_ptr<Ring> ring( new Ring );
+    if( ring->init( RING_ENTRIES ) )
+        return ring;
+#endif
+    return std::unique_ptr<Ring>();
+}
+
+// Return a ring to the pool.
+void AsyncFileReader::releaseRing( std::unique_ptr<Ring> ring )
+{
+    std::unique_lock<std::mutex> lock( m_ringsMutex );
+    m_rings.push_back( std::move( ring ) );
+}
+
+void AsyncFileReader::readWithThreads( const AsyncReadRequest* requests, unsigned int numRequests )
+{
+    getIOThreadPool().parallelFor( numRequests, [this, requests]( unsigned int i ) { readRange( requests[i] ); } );
+}
+
+// Read a single range, blocking until it is complete.
+void AsyncFileReader::readRange( const AsyncReadRequest& request )
+{
+    char*    dest      = request.dest;
+    uint64_t offset    = request.offset;
+    size_t   remaining = request.size;
+    while( remaining > 0 )
+    {
+#ifdef _WIN32
+        OVERLAPPED overlapped{};
+        overlapped.Offset     = static_cast<DWORD>( offset );
+        overlapped.OffsetHigh = static_cast<DWORD>( offset >> 32 );
+        DWORD bytesRead       = 0;
+        DWORD size            = static_cast<DWORD>( std::min<size_t>( remaining, 1u << 30 ) );
+        if( !ReadFile( m_file, dest, size, &bytesRead, &overlapped ) )
+            throw Exception( ( "Error reading " + m_filename ).c_str() );
+        const size_t result = bytesRead;
+#else
+        const ssize_t result = pread( m_file, dest, remaining, static_cast<off_t>( offset ) );
+        if( result < 0 && errno == EINTR )
+            continue;
+        if( result < 0 )
+            throwReadError( m_filename, errno );
+#endif
+        if( result == 0 )
+            throwReadError( m_filename, 0 );
+        dest += result;
+        offset += result;
+        remaining -= result;
+    }
+}
+
+}  // namespace imageSource
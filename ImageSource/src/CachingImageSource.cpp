@@ -0,0 +1,131 @@
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <OptiXToolkit/ImageSource/CachingImageSource.h>
+#include <OptiXToolkit/ImageSource/TextureInfo.h>
+
+#include <vector>
+
+namespace imageSource {
+
+CachingImageSource::CachingImageSource( std::shared_ptr<ImageSource> imageSource, TileCache* cache )
+    : m_imageSource( std::move( imageSource ) )
+    , m_cache( cache ? cache : &TileCache::getInstance() )
+    , m_imageId( TileCache::newImageId() )
+{
+}
+
+size_t CachingImageSource::getTileSizeInBytes( unsigned int tileWidth, unsigned int tileHeight ) const
+{
+    const TextureInfo& info = m_imageSource->getInfo();
+    return static_cast<size_t>( tileWidth ) * tileHeight * getBytesPerChannel( info.format ) * info.numChannels;
+}
+
+bool CachingImageSource::readTile( char*        dest,
+                                   unsigned int mipLevel,
+                                   unsigned int tileX,
+                                   unsigned int tileY,
+                                   unsigned int tileWidth,
+                                   unsigned int tileHeight,
+                                   CUstream     stream )
+{
+    if( getFillType() != CU_MEMORYTYPE_HOST )
+        return m_imageSource->readTile( dest, mipLevel, tileX, tileY, tileWidth, tileHeight, stream );
+
+    const TileCacheKey key{m_imageId, mipLevel, tileX, tileY};
+    const size_t       tileSize = getTileSizeInBytes( tileWidth, tileHeight );
+    if( m_cache->find( key, dest, tileSize ) )
+    {
+        m_numCacheHits += 1;
+        m_numCacheBytesHit += tileSize;
+        return true;
+    }
+
+    m_numCacheMisses += 1;
+    if( !m_imageSource->readTile( dest, mipLevel, tileX, tileY, tileWidth, tileHeight, stream ) )
+        return false;
+    m_cache->insert( key, dest, tileSize );
+    return true;
+}
+
+bool CachingImageSource::readTiles( TileRequest*       requests,
+                                    unsigned int       numRequests,
+                                    unsigned int       tileWidth,
+                                    unsigned int       tileHeight,
+                                    CUstream           stream )
+{
+    if( getFillType() != CU_MEMORYTYPE_HOST )
+        return m_imageSource->readTiles( requests, numRequests, tileWidth, tileHeight, stream );
+
+    // Copy the cached tiles, and gather the rest.
+    const size_t              tileSize = getTileSizeInBytes( tileWidth, tileHeight );
+    std::vector<TileRequest>  misses;
+    std::vector<unsigned int> missIndices;
+    for( unsigned int i = 0; i < numRequests; ++i )
+    {
+        TileRequest& request = requests[i];
+        request.satisfied    = m_cache->find( TileCacheKey{m_imageId, request.mipLevel, request.tileX, request.tileY}, request.dest, tileSize );
+        if( request.satisfied )
+        {
+            m_numCacheHits += 1;
+            m_numCacheBytesHit += tileSize;
+        }
+        else
+        {
+            misses.push_back( request );
+            missIndices.push_back( i );
+        }
+    }
+    if( misses.empty() )
+        return true;
+
+    // Read the missing tiles as a batch, so only they are counted as read by the wrapped image
+    // source, and cache those that were read.
+    m_numCacheMisses += misses.size();
+    const bool satisfied = m_imageSource->readTiles( misses.data(), static_cast<unsigned int>( misses.size() ), tileWidth, tileHeight, stream );
+    for( size_t i = 0; i < misses.size(); ++i )
+    {
+        const TileRequest& request = misses[i];
+        requests[missIndices[i]].satisfied = request.satisfied;
+        if( request.satisfied )
+            m_cache->insert( TileCacheKey{m_imageId, request.mipLevel, request.tileX, request.tileY}, request.dest, tileSize );
+    }
+    return satisfied;
+}
+
+void CachingImageSource::serialize( std::ostream& stream ) const
+{
+    serializeImageSource( *m_imageSource, stream );
+}
+
+std::shared_ptr<ImageSource> CachingImageSource::deserialize( std::istream& stream )
+{
+    return std::shared_ptr<ImageSource>( new CachingImageSource( deserializeImageSource( stream ) ) );
+}
+
+}  // namespace imageSource
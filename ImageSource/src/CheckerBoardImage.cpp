@@ -28,6 +28,7 @@
 #include <OptiXToolkit/ImageSource/CheckerBoardImage.h>
 
 #include "Exception.h"
+#include "Serialization.h"
 
 #include <algorithm>
 #include <cmath>
@@ -145,4 +146,23 @@ bool CheckerBoardImage::readMipLevel( char* dest, unsigned int mipLevel, unsigne
     return true;
 }
 
+void CheckerBoardImage::serialize( std::ostream& stream ) const
+{
+    writeSerializedValue( stream, m_info.width );
+    writeSerializedValue( stream, m_info.height );
+    writeSerializedValue( stream, m_squaresPerSide );
+    writeSerializedValue( stream, m_info.numMipLevels > 1 );
+    writeSerializedValue( stream, m_info.isTiled );
+}
+
+std::shared_ptr<ImageSource> CheckerBoardImage::deserialize( std::istream& stream )
+{
+    const unsigned int width          = readSerializedValue<unsigned int>( stream );
+    const unsigned int height         = readSerializedValue<unsigned int>( stream );
+    const unsigned int squaresPerSide = readSerializedValue<unsigned int>( stream );
+    const bool         useMipmaps     = readSerializedValue<bool>( stream );
+    const bool         tiled          = readSerializedValue<bool>( stream );
+    return std::shared_ptr<ImageSource>( new CheckerBoardImage( width, height, squaresPerSide, useMipmaps, tiled ) );
+}
+
 }  // namespace imageSource
@@ -29,7 +29,9 @@
 #include <OptiXToolkit/ImageSource/CoreEXRReader.h>
 
 #include "Exception.h"
+#include "Serialization.h"
 #include "Stopwatch.h"
+#include "ThreadPool.h"
 
 #include <half.h>
 #include <openexr.h>
@@ -40,6 +42,25 @@
 
 namespace imageSource {
 
+struct CoreEXRReader::DecodeContext
+{
+    explicit DecodeContext( exr_context_t exrCtx )
+        : exrCtx( exrCtx )
+    {
+    }
+
+    // The pipeline is destroyed with the context, including when decoding throws an exception
+    // before the context is returned to the pool.
+    ~DecodeContext()
+    {
+        if( initialized )
+            exr_decoding_destroy( exrCtx, &decoder );
+    }
+
+    exr_context_t         exrCtx;
+    exr_decode_pipeline_t decoder     = EXR_DECODE_PIPELINE_INITIALIZER;
+    bool                  initialized = false;
+};
 
 CoreEXRReader::CoreEXRReader( const std::string& filename, bool readBaseColor )
     : m_filename( filename )
@@ -147,9 +168,15 @@ void CoreEXRReader::open( TextureInfo* info )
 
         // Need to use internal read methods here, because we are already holding a lock on the mutex.
         if( m_isScanline )
+        {
             readScanlineData( buff );
+        }
         else
-            readActualTile( buff, getBytesPerChannel( m_info.format ) * m_info.numChannels, m_info.numMipLevels - 1, 0, 0 );
+        {
+            std::unique_ptr<DecodeContext> context = acquireDecodeContext();
+            readActualTile( context.get(), buff, getBytesPerChannel( m_info.format ) * m_info.numChannels, m_info.numMipLevels - 1, 0, 0 );
+            releaseDecodeContext( std::move( context ) );
+        }
 
         if( m_info.format == CU_AD_FORMAT_HALF )
         {
@@ -180,12 +207,40 @@ void CoreEXRReader::close()
 {
     if( m_exrCtx != nullptr )
     {
+        destroyDecodeContexts();
         DEMAND_ASSERT( exr_finish( &m_exrCtx ) == EXR_ERR_SUCCESS );
     }
     m_exrCtx = nullptr;
 }
 
-void CoreEXRReader::readActualTile( char* dest, int rowPitch, int mipLevel, int tileX, int tileY )
+// Get a decode pipeline from the pool, or make a new one if the pool is empty.  Reusing decode
+// pipelines avoids reallocating their scratch buffers for every chunk.
+std::unique_ptr<CoreEXRReader::DecodeContext> CoreEXRReader::acquireDecodeContext()
+{
+    std::unique_lock<std::mutex> lock( m_decodeContextsMutex );
+    if( m_decodeContexts.empty() )
+        return std::unique_ptr<DecodeContext>( new DecodeContext( m_exrCtx ) );
+
+    std::unique_ptr<DecodeContext> context = std::move( m_decodeContexts.back() );
+    m_decodeContexts.pop_back();
+    return context;
+}
+
+// Return a decode pipeline to the pool.
+void CoreEXRReader::releaseDecodeContext( std::unique_ptr<DecodeContext> context )
+{
+    std::unique_lock<std::mutex> lock( m_decodeContextsMutex );
+    m_decodeContexts.push_back( std::move( context ) );
+}
+
+// Free the pooled decode pipelines, which must be done before the EXR context is finished.
+void CoreEXRReader::destroyDecodeContexts()
+{
+    std::unique_lock<std::mutex> lock( m_decodeContextsMutex );
+    m_decodeContexts.clear();
+}
+
+void CoreEXRReader::readActualTile( DecodeContext* context, char* dest, int rowPitch, int mipLevel, int tileX, int tileY )
 {
     DEMAND_ASSERT( !m_isScanline );
 
@@ -207,10 +262,20 @@ void CoreEXRReader::readActualTile( char* dest, int rowPitch, int mipLevel, int
     const int  actualTileWidth  = partialX ? m_levelWidths[mipLevel] % sourceTileWidth : sourceTileWidth;
     const int  actualTileHeight = partialY ? m_levelHeights[mipLevel] % sourceTileHeight : sourceTileHeight;
 
-    exr_chunk_info_t      cinfo;
-    exr_decode_pipeline_t decoder;
+    // Initialize the decode pipeline the first time it is used, and update it for the current
+    // chunk thereafter, which retains its scratch buffers.
+    exr_chunk_info_t       cinfo;
+    exr_decode_pipeline_t& decoder = context->decoder;
     DEMAND_ASSERT( exr_read_tile_chunk_info( m_exrCtx, m_partIndex, tileX, tileY, mipLevel, mipLevel, &cinfo ) == EXR_ERR_SUCCESS );
-    DEMAND_ASSERT( exr_decoding_initialize( m_exrCtx, 0, &cinfo, &decoder ) == EXR_ERR_SUCCESS );
+    if( context->initialized )
+    {
+        DEMAND_ASSERT( exr_decoding_update( m_exrCtx, m_partIndex, &cinfo, &decoder ) == EXR_ERR_SUCCESS );
+    }
+    else
+    {
+        DEMAND_ASSERT( exr_decoding_initialize( m_exrCtx, m_partIndex, &cinfo, &decoder ) == EXR_ERR_SUCCESS );
+        context->initialized = true;
+    }
 
     const int bytesPerChannel = decoder.channels[0].bytes_per_element;
 
@@ -239,16 +304,24 @@ void CoreEXRReader::readActualTile( char* dest, int rowPitch, int mipLevel, int
     }
 
     // Run the decoder
-    DEMAND_ASSERT( exr_decoding_choose_default_routines( m_exrCtx, 0, &decoder ) == EXR_ERR_SUCCESS );
-    DEMAND_ASSERT( exr_decoding_run( m_exrCtx, 0, &decoder ) == EXR_ERR_SUCCESS );
-    DEMAND_ASSERT( exr_decoding_destroy( m_exrCtx, &decoder ) == EXR_ERR_SUCCESS );
+    DEMAND_ASSERT( exr_decoding_choose_default_routines( m_exrCtx, m_partIndex, &decoder ) == EXR_ERR_SUCCESS );
+    DEMAND_ASSERT( exr_decoding_run( m_exrCtx, m_partIndex, &decoder ) == EXR_ERR_SUCCESS );
 
     // Stats tracking
-    {
-        std::unique_lock<std::mutex> lock( m_statsMutex );
-        m_numTilesRead += 1;
-        m_numBytesRead += actualTileWidth * actualTileHeight * bytesPerChannel * m_info.numChannels;
-    }
+    m_numTilesRead += 1;
+    m_numBytesRead += actualTileWidth * actualTileHeight * bytesPerChannel * m_info.numChannels;
+}
+
+// Decode the given EXR tiles, in parallel if there is more than one.  Each thread decodes its
+// tiles with a decode pipeline from the pool.
+void CoreEXRReader::readSourceTiles( const std::vector<SourceTile>& tiles )
+{
+    ThreadPool::getInstance().parallelFor( static_cast<unsigned int>( tiles.size() ), [this, &tiles]( unsigned int i ) {
+        const SourceTile&              tile    = tiles[i];
+        std::unique_ptr<DecodeContext> context = acquireDecodeContext();
+        readActualTile( context.get(), tile.dest, tile.rowPitch, tile.mipLevel, tile.tileX, tile.tileY );
+        releaseDecodeContext( std::move( context ) );
+    } );
 }
 
 void CoreEXRReader::readScanlineData( char* dest )
@@ -258,13 +331,24 @@ void CoreEXRReader::readScanlineData( char* dest )
     int scanlinesPerChunk;
     DEMAND_ASSERT( exr_get_scanlines_per_chunk( m_exrCtx, m_partIndex, &scanlinesPerChunk ) == EXR_ERR_SUCCESS );
 
+    // A single decode pipeline is used for all the chunks, which retains its scratch buffers.
+    std::unique_ptr<DecodeContext> context = acquireDecodeContext();
+    exr_decode_pipeline_t&         decoder = context->decoder;
+
     size_t offset = 0;
     for( int y = 0; y < (int)m_info.height; y += scanlinesPerChunk )
     {
-        exr_chunk_info_t      cinfo;
-        exr_decode_pipeline_t decoder;
+        exr_chunk_info_t cinfo;
         DEMAND_ASSERT( exr_read_scanline_chunk_info( m_exrCtx, m_partIndex, y, &cinfo ) == EXR_ERR_SUCCESS );
-        DEMAND_ASSERT( exr_decoding_initialize( m_exrCtx, 0, &cinfo, &decoder ) == EXR_ERR_SUCCESS );
+        if( context->initialized )
+        {
+            DEMAND_ASSERT( exr_decoding_update( m_exrCtx, m_partIndex, &cinfo, &decoder ) == EXR_ERR_SUCCESS );
+        }
+        else
+        {
+            DEMAND_ASSERT( exr_decoding_initialize( m_exrCtx, m_partIndex, &cinfo, &decoder ) == EXR_ERR_SUCCESS );
+            context->initialized = true;
+        }
 
         const int bytesPerElement = decoder.channels[0].bytes_per_element;
 
@@ -293,19 +377,16 @@ void CoreEXRReader::readScanlineData( char* dest )
         }
 
         // Run the decoder
-        DEMAND_ASSERT( exr_decoding_choose_default_routines( m_exrCtx, 0, &decoder ) == EXR_ERR_SUCCESS );
-        DEMAND_ASSERT( exr_decoding_run( m_exrCtx, 0, &decoder ) == EXR_ERR_SUCCESS );
-        DEMAND_ASSERT( exr_decoding_destroy( m_exrCtx, &decoder ) == EXR_ERR_SUCCESS );
+        DEMAND_ASSERT( exr_decoding_choose_default_routines( m_exrCtx, m_partIndex, &decoder ) == EXR_ERR_SUCCESS );
+        DEMAND_ASSERT( exr_decoding_run( m_exrCtx, m_partIndex, &decoder ) == EXR_ERR_SUCCESS );
 
         offset += m_info.width * m_info.numChannels * bytesPerElement * scanlinesPerChunk;
     }
+    releaseDecodeContext( std::move( context ) );
 
     // Stats tracking
-    {
-        std::unique_lock<std::mutex> lock(m_statsMutex);
-        m_numTilesRead += 1;
-        m_numBytesRead += m_info.height * m_info.width * m_info.numChannels * getBytesPerChannel( m_info.format );
-    }
+    m_numTilesRead += 1;
+    m_numBytesRead += m_info.height * m_info.width * m_info.numChannels * getBytesPerChannel( m_info.format );
 }
 
 bool CoreEXRReader::readTile( char*        dest,
@@ -314,7 +395,17 @@ bool CoreEXRReader::readTile( char*        dest,
                               unsigned int tileY,
                               unsigned int destTileWidth,
                               unsigned int destTileHeight,
-                              CUstream     /*stream*/ )
+                              CUstream     stream )
+{
+    TileRequest request{dest, mipLevel, tileX, tileY};
+    return readTiles( &request, 1, destTileWidth, destTileHeight, stream );
+}
+
+bool CoreEXRReader::readTiles( TileRequest*       requests,
+                               unsigned int       numRequests,
+                               unsigned int       destTileWidth,
+                               unsigned int       destTileHeight,
+                               CUstream           /*stream*/ )
 {
     DEMAND_ASSERT_MSG( isOpen(), "Attempting to read from image that isn't open." );
     DEMAND_ASSERT_MSG( !m_isScanline, "Attempting to read tiled data from scanline image." );
@@ -322,35 +413,44 @@ bool CoreEXRReader::readTile( char*        dest,
     // Stats tracking
     Stopwatch stopwatch;
 
-    const int sourceTileWidth  = m_tileWidths[mipLevel];
-    const int sourceTileHeight = m_tileHeights[mipLevel];
-
-    // We require that the requested tile size is an integer multiple of the EXR tile size.
-    if( !( sourceTileWidth <= static_cast<int>( destTileWidth ) && destTileWidth % sourceTileWidth == 0 )
-        || !( sourceTileHeight <= static_cast<int>( destTileHeight ) && destTileHeight % sourceTileHeight == 0 ) )
+    // Gather the EXR tiles that make up each requested tile.
+    std::vector<SourceTile> tiles;
+    for( unsigned int r = 0; r < numRequests; ++r )
     {
-        std::stringstream str;
-        str << "Unsupported EXR tile size (" << sourceTileWidth << "x" << sourceTileHeight << ").  Expected "
-            << destTileWidth << "x" << destTileHeight << " (or a whole fraction thereof) for this pixel format";
-        throw imageSource::Exception( str.str().c_str() );
-    }
+        const TileRequest& request          = requests[r];
+        const int          sourceTileWidth  = m_tileWidths[request.mipLevel];
+        const int          sourceTileHeight = m_tileHeights[request.mipLevel];
 
-    const int actualTileX    = tileX * ( destTileWidth / sourceTileWidth );
-    const int actualTileY    = tileY * ( destTileHeight / sourceTileHeight );
-    const int numTilesX      = destTileWidth / sourceTileWidth;
-    const int numTilesY      = destTileHeight / sourceTileHeight;
-    const int bytesPerPixel  = getBytesPerChannel( m_info.format ) * m_info.numChannels;
-    const int rowPitch       = destTileWidth * bytesPerPixel;
-    const int sourceTileSize = sourceTileWidth * sourceTileHeight * bytesPerPixel;
+        // We require that the requested tile size is an integer multiple of the EXR tile size.
+        if( !( sourceTileWidth <= static_cast<int>( destTileWidth ) && destTileWidth % sourceTileWidth == 0 )
+            || !( sourceTileHeight <= static_cast<int>( destTileHeight ) && destTileHeight % sourceTileHeight == 0 ) )
+        {
+            std::stringstream str;
+            str << "Unsupported EXR tile size (" << sourceTileWidth << "x" << sourceTileHeight << ").  Expected "
+                << destTileWidth << "x" << destTileHeight << " (or a whole fraction thereof) for this pixel format";
+            throw imageSource::Exception( str.str().c_str() );
+        }
 
-    for( int j = 0; j < numTilesY; ++j )
-    {
-        for( int i = 0; i < numTilesX; ++i )
+        const int actualTileX    = request.tileX * ( destTileWidth / sourceTileWidth );
+        const int actualTileY    = request.tileY * ( destTileHeight / sourceTileHeight );
+        const int numTilesX      = destTileWidth / sourceTileWidth;
+        const int numTilesY      = destTileHeight / sourceTileHeight;
+        const int bytesPerPixel  = getBytesPerChannel( m_info.format ) * m_info.numChannels;
+        const int rowPitch       = destTileWidth * bytesPerPixel;
+        const int sourceTileSize = sourceTileWidth * sourceTileHeight * bytesPerPixel;
+
+        for( int j = 0; j < numTilesY; ++j )
         {
-            char* start = dest + j * numTilesX * sourceTileSize + i * sourceTileWidth * bytesPerPixel;
-            readActualTile( start, rowPitch, mipLevel, actualTileX + i, actualTileY + j );
+            for( int i = 0; i < numTilesX; ++i )
+            {
+                char* start = request.dest + j * numTilesX * sourceTileSize + i * sourceTileWidth * bytesPerPixel;
+                tiles.push_back( SourceTile{start, rowPitch, static_cast<int>( request.mipLevel ), actualTileX + i, actualTileY + j} );
+            }
         }
     }
+    readSourceTiles( tiles );
+    for( unsigned int r = 0; r < numRequests; ++r )
+        requests[r].satisfied = true;
 
     // Stats tracking
     {
@@ -380,6 +480,7 @@ bool CoreEXRReader::readMipLevel( char* dest, unsigned int mipLevel, unsigned in
         const int numYTiles     = ( m_levelHeights[mipLevel] + m_tileHeights[mipLevel] - 1 ) / m_tileHeights[mipLevel];
         const int bytesPerPixel = getBytesPerChannel( m_info.format ) * m_info.numChannels;
 
+        std::vector<SourceTile> tiles;
         for( int rowIdx = 0; rowIdx < numYTiles; ++rowIdx )
         {
             const int rowOffset = rowIdx * m_levelWidths[mipLevel] * m_tileHeights[mipLevel];
@@ -387,9 +488,10 @@ bool CoreEXRReader::readMipLevel( char* dest, unsigned int mipLevel, unsigned in
             {
                 const int colOffset = colIdx * m_tileWidths[mipLevel];
                 char*     outPtr    = &dest[( rowOffset + colOffset ) * bytesPerPixel];
-                readActualTile( outPtr, expectedWidth * bytesPerPixel, mipLevel, colIdx, rowIdx );
+                tiles.push_back( SourceTile{outPtr, static_cast<int>( expectedWidth ) * bytesPerPixel, static_cast<int>( mipLevel ), colIdx, rowIdx} );
             }
         }
+        readSourceTiles( tiles );
     }
 
     // Stats tracking
@@ -407,4 +509,17 @@ bool CoreEXRReader::readBaseColor( float4& dest )
     return m_baseColorWasRead;
 }
 
+void CoreEXRReader::serialize( std::ostream& stream ) const
+{
+    writeSerializedString( stream, m_filename );
+    writeSerializedValue( stream, m_readBaseColor );
+}
+
+std::shared_ptr<ImageSource> CoreEXRReader::deserialize( std::istream& stream )
+{
+    const std::string filename      = readSerializedString( stream );
+    const bool        readBaseColor = readSerializedValue<bool>( stream );
+    return std::shared_ptr<ImageSource>( new CoreEXRReader( filename, readBaseColor ) );
+}
+
 }  // namespace demandLoading
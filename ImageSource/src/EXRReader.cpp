@@ -29,6 +29,7 @@
 #include <OptiXToolkit/ImageSource/EXRReader.h>
 
 #include "Exception.h"
+#include "Serialization.h"
 #include "Stopwatch.h"
 
 #include <half.h>
@@ -377,27 +378,19 @@ bool EXRReader::readBaseColor( float4& dest )
 void EXRReader::serialize( std::ostream& stream ) const
 {
     // Serialize the filename, preceded by its length.
-    size_t size = m_filename.size();
-    stream.write( reinterpret_cast<const char*>( &size ), sizeof( size_t ) );
-    stream.write( m_filename.data(), size );
+    writeSerializedString( stream, m_filename );
 
     // Serialize other constructor parameters.
-    stream.write( reinterpret_cast<const char*>( &m_readBaseColor ), sizeof( bool ) );
+    writeSerializedValue( stream, m_readBaseColor );
 }
 
 std::shared_ptr<ImageSource> EXRReader::deserialize( std::istream& stream )
 {
     // Deserialize filename, which is preceded by its length.
-    size_t length;
-    stream.read( reinterpret_cast<char*>( &length ), sizeof( size_t ) );
-
-    std::vector<char> buffer( length );
-    stream.read( buffer.data(), length );
-    std::string filename( buffer.data(), length );
+    const std::string filename = readSerializedString( stream );
 
     // Deserialize other constructor parameters.
-    bool readBaseColor;
-    stream.read( reinterpret_cast<char*>( &readBaseColor ), sizeof( bool ) );
+    const bool readBaseColor = readSerializedValue<bool>( stream );
 
     // Construct the EXRReader.
     return std::shared_ptr<ImageSource>( new EXRReader( filename.c_str(), readBaseColor ) );
@@ -29,18 +29,45 @@
 #include "Config.h"  // for OTK_USE_OIIO
 
 #include <OptiXToolkit/ImageSource/ImageSource.h>
+#include <OptiXToolkit/ImageSource/CachingImageSource.h>
 #include <OptiXToolkit/ImageSource/CheckerBoardImage.h>
 #include <OptiXToolkit/ImageSource/CoreEXRReader.h>
+#include <OptiXToolkit/ImageSource/EXRReader.h>
+#include <OptiXToolkit/ImageSource/TileFileReader.h>
 #if OTK_USE_OIIO
 #include <OptiXToolkit/ImageSource/OIIOReader.h>
 #endif
 
 #include "Exception.h"
+#include "Serialization.h"
 
 #include <cstddef>  // for size_t
+#include <map>
+#include <mutex>
 
 namespace imageSource {
 
+void ImageSource::serialize( std::ostream& /*stream*/ ) const
+{
+    throw Exception( "ImageSource does not support serialization" );
+}
+
+bool ImageSource::readTiles( TileRequest*       requests,
+                             unsigned int       numRequests,
+                             unsigned int       tileWidth,
+                             unsigned int       tileHeight,
+                             CUstream           stream )
+{
+    bool satisfied = true;
+    for( unsigned int i = 0; i < numRequests; ++i )
+    {
+        TileRequest& request = requests[i];
+        request.satisfied    = readTile( request.dest, request.mipLevel, request.tileX, request.tileY, tileWidth, tileHeight, stream );
+        satisfied            = satisfied && request.satisfied;
+    }
+    return satisfied;
+}
+
 bool ImageSourceBase::readMipTail( char*        dest,
                                    unsigned int mipTailFirstLevel,
                                    unsigned int numMipLevels,
@@ -78,6 +105,10 @@ std::shared_ptr<ImageSource> createImageSource( const std::string& filename, con
     {
         return std::shared_ptr<ImageSource>( new CoreEXRReader( path ) );
     }
+    else if( extension == ".tiles" )
+    {
+        return std::shared_ptr<ImageSource>( new TileFileReader( path ) );
+    }
     else
     {
 #if OTK_USE_OIIO        
@@ -89,5 +120,77 @@ std::shared_ptr<ImageSource> createImageSource( const std::string& filename, con
     }
 }
 
+namespace {
+
+// Deserializers keyed by serialization tag, initially holding the built-in image sources.
+class DeserializerRegistry
+{
+  public:
+    DeserializerRegistry()
+        : m_deserializers{
+            {"CachingImageSource", CachingImageSource::deserialize},
+            {"CheckerBoardImage", CheckerBoardImage::deserialize},
+            {"CoreEXRReader", CoreEXRReader::deserialize},
+            {"EXRReader", EXRReader::deserialize},
+#if OTK_USE_OIIO
+            {"OIIOReader", OIIOReader::deserialize},
+#endif
+            {"TileFileReader", TileFileReader::deserialize},
+        }
+    {
+    }
+
+    void add( const std::string& tag, ImageSourceDeserializer deserializer )
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_deserializers[tag] = std::move( deserializer );
+    }
+
+    ImageSourceDeserializer find( const std::string& tag ) const
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        auto it = m_deserializers.find( tag );
+        return it == m_deserializers.end() ? ImageSourceDeserializer() : it->second;
+    }
+
+  private:
+    mutable std::mutex                             m_mutex;
+    std::map<std::string, ImageSourceDeserializer> m_deserializers;
+};
+
+DeserializerRegistry& getDeserializerRegistry()
+{
+    static DeserializerRegistry registry;
+    return registry;
+}
+
+}  // anonymous namespace
+
+void registerImageSourceDeserializer( const std::string& tag, ImageSourceDeserializer deserializer )
+{
+    DEMAND_ASSERT_MSG( deserializer, "Null ImageSource deserializer" );
+    getDeserializerRegistry().add( tag, std::move( deserializer ) );
+}
+
+void serializeImageSource( const ImageSource& imageSource, std::ostream& stream )
+{
+    const char* tag = imageSource.getSerializationTag();
+    if( tag == nullptr )
+        throw Exception( "ImageSource does not support serialization" );
+    writeSerializedString( stream, tag );
+    imageSource.serialize( stream );
+}
+
+std::shared_ptr<ImageSource> deserializeImageSource( std::istream& stream )
+{
+    const std::string tag = readSerializedString( stream );
+
+    // The deserializer is called without holding the registry lock, since it might deserialize a
+    // nested image source (e.g. CachingImageSource).
+    ImageSourceDeserializer deserializer = getDeserializerRegistry().find( tag );
+    if( !deserializer )
+        throw Exception( ( "No deserializer registered for ImageSource type: " + tag ).c_str() );
+    return deserializer( stream );
+}
 
 }  // namespace imageSource
@@ -29,6 +29,7 @@
 #include <OptiXToolkit/ImageSource/OIIOReader.h>
 
 #include "Exception.h"
+#include "Serialization.h"
 
 #include <cuda_runtime.h>
 
@@ -161,6 +162,13 @@ void OIIOReader::open( TextureInfo* info )
 // Close the image.
 void OIIOReader::close()
 {
+    {
+        std::lock_guard<std::mutex> guard( m_inputPoolMutex );
+        for( std::unique_ptr<OIIO::ImageInput>& input : m_inputPool )
+            input->close();
+        m_inputPool.clear();
+    }
+
     std::lock_guard<std::mutex> guard( m_mutex );
     if( m_input )
     {
@@ -169,27 +177,66 @@ void OIIOReader::close()
     }
 }
 
-void OIIOReader::readActualTile( char* dest, unsigned int rowPitch, unsigned int mipLevel, unsigned int tileX, unsigned int tileY )
+// Get a handle to the image from the pool, opening another one if the pool is empty.  An
+// ImageInput serializes its reads, so each thread reads through its own handle.
+std::unique_ptr<OIIO::ImageInput> OIIOReader::acquireInput()
 {
-    std::lock_guard<std::mutex> guard( m_mutex );
-    DEMAND_ASSERT( m_input.get() );
+    {
+        std::lock_guard<std::mutex> guard( m_inputPoolMutex );
+        if( !m_inputPool.empty() )
+        {
+            std::unique_ptr<OIIO::ImageInput> input = std::move( m_inputPool.back() );
+            m_inputPool.pop_back();
+            return input;
+        }
+    }
 
-    OIIO::ImageSpec spec;
-    m_input->seek_subimage( 0, mipLevel, spec );
-    m_input->read_tile( tileX * spec.tile_width, tileY * spec.tile_height, 0, spec.format, dest,
-                        getBytesPerChannel( m_info.format ) * m_info.numChannels, rowPitch );
+    std::unique_ptr<OIIO::ImageInput> input = OIIO::ImageInput::open( m_filename );
+    DEMAND_ASSERT_MSG( input, std::string( "Failed to open image file " ) + m_filename + "." );
+    return input;
 }
 
-bool OIIOReader::readTile( char* dest, unsigned int mipLevel, unsigned int tileX, unsigned int tileY, unsigned int tileWidth, unsigned int tileHeight, CUstream /*stream*/ )
+// Return a handle to the pool.
+void OIIOReader::releaseInput( std::unique_ptr<OIIO::ImageInput> input )
 {
-    DEMAND_ASSERT_MSG( isOpen(), "Attempting to read from image that isn't open." );
+    std::lock_guard<std::mutex> guard( m_inputPoolMutex );
+    m_inputPool.push_back( std::move( input ) );
+}
 
-    OIIO::ImageSpec spec;
+class OIIOReader::PooledInput
+{
+  public:
+    explicit PooledInput( OIIOReader* reader )
+        : m_reader( reader )
+        , m_input( reader->acquireInput() )
     {
-        std::lock_guard<std::mutex> guard( m_mutex );
-        m_input->seek_subimage( 0, mipLevel, spec );
     }
 
+    ~PooledInput() { m_reader->releaseInput( std::move( m_input ) ); }
+
+    OIIO::ImageInput* get() const { return m_input.get(); }
+
+    OIIO::ImageInput* operator->() const { return m_input.get(); }
+
+  private:
+    OIIOReader*                       m_reader;
+    std::unique_ptr<OIIO::ImageInput> m_input;
+};
+
+void OIIOReader::readActualTile( OIIO::ImageInput* input, char* dest, unsigned int rowPitch, unsigned int mipLevel, unsigned int tileX, unsigned int tileY )
+{
+    const OIIO::ImageSpec spec = input->spec( 0, mipLevel );
+    input->read_tile( 0, mipLevel, tileX * spec.tile_width, tileY * spec.tile_height, 0, spec.format, dest,
+                      getBytesPerChannel( m_info.format ) * m_info.numChannels, rowPitch );
+}
+
+bool OIIOReader::readTile( char* dest, unsigned int mipLevel, unsigned int tileX, unsigned int tileY, unsigned int tileWidth, unsigned int tileHeight, CUstream /*stream*/ )
+{
+    DEMAND_ASSERT_MSG( isOpen(), "Attempting to read from image that isn't open." );
+
+    PooledInput           input( this );
+    const OIIO::ImageSpec spec = input->spec( 0, mipLevel );
+
     if( spec.tile_width && spec.tile_height )
     {
         // We require that the requested tile size is an integer multiple of the file's tile size.
@@ -222,7 +269,7 @@ bool OIIOReader::readTile( char* dest, unsigned int mipLevel, unsigned int tileX
             for( unsigned int i = 0; i < numTilesX; ++i )
             {
                 char* start = dest + j * numTilesX * actualTileSize + i * actualTileWidth * bytesPerPixel;
-                readActualTile( start, rowPitch, mipLevel, actualTileX + i, actualTileY + j );
+                readActualTile( input.get(), start, rowPitch, mipLevel, actualTileX + i, actualTileY + j );
             }
         }
     }
@@ -233,23 +280,19 @@ bool OIIOReader::readTile( char* dest, unsigned int mipLevel, unsigned int tileX
         const unsigned int start_y = tileY * tileHeight;
         const unsigned int end_y   = std::min<int>( spec.height, start_y + tileHeight );
 
-        const unsigned int bytesPerPixel    = getBytesPerChannel( m_info.format ) * m_info.numChannels;
-        const unsigned int file_pixel_bytes = spec.pixel_bytes();
-        std::vector<char>  tmp( spec.width * file_pixel_bytes );
+        // Read the scanlines spanned by the tile, with pixels padded to the texture's pixel size,
+        // and copy the part of each row that lies within the tile.
+        const unsigned int bytesPerPixel = getBytesPerChannel( m_info.format ) * m_info.numChannels;
+        const size_t       scanlineBytes = static_cast<size_t>( spec.width ) * bytesPerPixel;
+        const size_t       rowBytes      = ( end_x - start_x ) * bytesPerPixel;
+        std::vector<char>  tmp( ( end_y - start_y ) * scanlineBytes, 0 );
+        input->read_scanlines( 0, mipLevel, start_y, end_y, 0, 0, spec.nchannels, spec.format, tmp.data(),
+                               bytesPerPixel, scanlineBytes );
 
-        char* _dest = dest;
         for( unsigned int y = start_y; y < end_y; ++y )
         {
-            {
-                std::lock_guard<std::mutex> guard( m_mutex );
-                m_input->read_scanline( y, 0, spec.format, tmp.data() );
-            }
-
-            for( unsigned int x = start_x; x < end_x; ++x )
-            {
-                memcpy( _dest, tmp.data() + x * file_pixel_bytes, file_pixel_bytes );
-                _dest += bytesPerPixel;
-            }
+            const char* row = tmp.data() + ( y - start_y ) * scanlineBytes + start_x * bytesPerPixel;
+            memcpy( dest + ( y - start_y ) * rowBytes, row, rowBytes );
         }
     }
 
@@ -283,8 +326,8 @@ bool OIIOReader::readMipLevel( char*        dest,
     OIIO::ImageSpec spec;
     unsigned int    bytesPerPixel;
     {
-        std::lock_guard<std::mutex> guard( m_mutex );
-        m_input->seek_subimage( 0, mipLevel, spec );
+        PooledInput input( this );
+        spec = input->spec( 0, mipLevel );
 
         DEMAND_ASSERT( spec.width == static_cast<int>( expectedWidth ) );
         DEMAND_ASSERT( spec.height == static_cast<int>( expectedHeight ) );
@@ -292,7 +335,7 @@ bool OIIOReader::readMipLevel( char*        dest,
 
         bytesPerPixel = getBytesPerChannel( m_info.format ) * m_info.numChannels;
 
-        m_input->read_image( 0, mipLevel, 0, spec.nchannels, spec.format, dest, bytesPerPixel );
+        input->read_image( 0, mipLevel, 0, spec.nchannels, spec.format, dest, bytesPerPixel );
     }
 
     if( spec.tile_width )
@@ -316,5 +359,17 @@ bool OIIOReader::readMipLevel( char*        dest,
     return true;
 }
 
+void OIIOReader::serialize( std::ostream& stream ) const
+{
+    writeSerializedString( stream, m_filename );
+    writeSerializedValue( stream, m_readBaseColor );
+}
+
+std::shared_ptr<ImageSource> OIIOReader::deserialize( std::istream& stream )
+{
+    const std::string filename      = readSerializedString( stream );
+    const bool        readBaseColor = readSerializedValue<bool>( stream );
+    return std::shared_ptr<ImageSource>( new OIIOReader( filename, readBaseColor ) );
+}
 
 }  // namespace imageSource
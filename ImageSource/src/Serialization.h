@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include "Exception.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace imageSource {
+
+// Helpers used by ImageSource::serialize implementations.  Values are written in native byte
+// order, matching the original EXRReader layout, and strings are preceded by their length.
+
+template <typename T>
+void writeSerializedValue( std::ostream& stream, const T& value )
+{
+    stream.write( reinterpret_cast<const char*>( &value ), sizeof( T ) );
+}
+
+template <typename T>
+T readSerializedValue( std::istream& stream )
+{
+    T value{};
+    stream.read( reinterpret_cast<char*>( &value ), sizeof( T ) );
+    if( !stream )
+        throw Exception( "Unexpected end of serialized ImageSource" );
+    return value;
+}
+
+inline void writeSerializedString( std::ostream& stream, const std::string& str )
+{
+    writeSerializedValue<size_t>( stream, str.size() );
+    stream.write( str.data(), str.size() );
+}
+
+inline std::string readSerializedString( std::istream& stream )
+{
+    const size_t length = readSerializedValue<size_t>( stream );
+
+    // Read in chunks so that a corrupt length fails at end of stream rather than in the allocator.
+    std::string       str;
+    std::vector<char> buffer( 4096 );
+    while( str.size() < length )
+    {
+        const size_t chunk = std::min( buffer.size(), length - str.size() );
+        stream.read( buffer.data(), chunk );
+        if( !stream )
+            throw Exception( "Unexpected end of serialized ImageSource" );
+        str.append( buffer.data(), chunk );
+    }
+    return str;
+}
+
+}  // namespace imageSource
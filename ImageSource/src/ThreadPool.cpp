@@ -0,0 +1,200 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+namespace imageSource {
+
+// A parallel loop.  The job is queued once for each pool thread that may help with it, and
+// threads that dequeue it after all its indices have been claimed simply discard it.
+struct ThreadPool::Job
+{
+    const std::function<void( unsigned int )>* func;
+    unsigned int                               count;
+    std::function<void( unsigned int )>        task;  // The func of a job queued by run(), which owns it.
+    std::atomic<unsigned int>                  next{0};
+
+    std::mutex              mutex;
+    std::condition_variable helpersDone;
+    unsigned int            numHelpers = 0;  // Number of pool threads currently working on the job.
+    std::exception_ptr      exception;
+
+    // Claim and process indices until none remain.
+    void run()
+    {
+        for( unsigned int i = next++; i < count; i = next++ )
+        {
+            try
+            {
+                ( *func )( i );
+            }
+            catch( ... )
+            {
+                std::unique_lock<std::mutex> lock( mutex );
+                if( !exception )
+                    exception = std::current_exception();
+                next = count;
+            }
+        }
+    }
+
+    // Called by a pool thread.  The caller's func is only accessed after an index is claimed,
+    // and the caller does not return until all claimed indices are processed.
+    void help()
+    {
+        {
+            std::unique_lock<std::mutex> lock( mutex );
+            if( next >= count )
+                return;
+            ++numHelpers;
+        }
+        run();
+        std::unique_lock<std::mutex> lock( mutex );
+        if( --numHelpers == 0 )
+            helpersDone.notify_all();
+    }
+};
+
+ThreadPool& ThreadPool::getInstance()
+{
+    static ThreadPool pool( std::max( 1u, std::thread::hardware_concurrency() ) - 1 );
+    return pool;
+}
+
+ThreadPool::ThreadPool( unsigned int numThreads )
+{
+    for( unsigned int i = 0; i < numThreads; ++i )
+        m_threads.emplace_back( &ThreadPool::worker, this );
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_isShutDown = true;
+    }
+    m_jobAvailable.notify_all();
+    for( std::thread& thread : m_threads )
+        thread.join();
+}
+
+void ThreadPool::worker()
+{
+    while( true )
+    {
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock( m_mutex );
+            m_jobAvailable.wait( lock, [this] { return m_isShutDown || !m_jobs.empty(); } );
+            if( m_isShutDown )
+                return;
+            job = m_jobs.front();
+            m_jobs.pop_front();
+        }
+        job->help();
+    }
+}
+
+void ThreadPool::parallelFor( unsigned int count, const std::function<void( unsigned int )>& func )
+{
+    // Each concurrent loop gets an equal share of the threads, counting its caller, so the number
+    // of threads running loops stays within the pool size plus one.
+    struct CallerCount
+    {
+        std::atomic<unsigned int>& numCallers;
+        ~CallerCount() { numCallers.fetch_sub( 1 ); }
+    };
+    const unsigned int numCallers = m_numCallers.fetch_add( 1 ) + 1;
+    CallerCount        callerCount{m_numCallers};
+    const unsigned int numShared  = getNumThreads() + 1 > numCallers ? ( getNumThreads() + 1 - numCallers ) / numCallers : 0;
+
+    // Small loops are run on the calling thread.
+    const unsigned int numHelpers = std::min( numShared, count - std::min( count, 1u ) );
+    if( numHelpers == 0 )
+    {
+        for( unsigned int i = 0; i < count; ++i )
+            func( i );
+        return;
+    }
+
+    std::shared_ptr<Job> job( new Job );
+    job->func  = &func;
+    job->count = count;
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_jobs.insert( m_jobs.end(), numHelpers, job );
+    }
+    if( numHelpers == 1 )
+        m_jobAvailable.notify_one();
+    else
+        m_jobAvailable.notify_all();
+
+    job->run();
+
+    // All indices have been claimed.  Discard queued copies of the job that were not picked up,
+    // and wait for any pool threads that are still working on it.
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_jobs.erase( std::remove( m_jobs.begin(), m_jobs.end(), job ), m_jobs.end() );
+    }
+    std::unique_lock<std::mutex> lock( job->mutex );
+    job->helpersDone.wait( lock, [&job] { return job->numHelpers == 0; } );
+    if( job->exception )
+        std::rethrow_exception( job->exception );
+}
+
+void ThreadPool::run( std::function<void()> task )
+{
+    if( m_threads.empty() )
+    {
+        try
+        {
+            task();
+        }
+        catch( ... )
+        {
+        }
+        return;
+    }
+
+    std::shared_ptr<Job> job( new Job );
+    job->task  = [task]( unsigned int ) { task(); };
+    job->func  = &job->task;
+    job->count = 1;
+    {
+        std::unique_lock<std::mutex> lock( m_mutex );
+        m_jobs.push_back( job );
+    }
+    m_jobAvailable.notify_one();
+}
+
+}  // namespace imageSource
@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace imageSource {
+
+/// A pool of threads used to run loops in parallel (e.g. to decode tiles) and background tasks.  The calling thread
+/// participates in each loop, so a loop completes even when all the pool threads are busy.
+class ThreadPool
+{
+  public:
+    /// Return the process-wide thread pool, which is created on first use with one thread per
+    /// hardware thread besides the caller's.
+    static ThreadPool& getInstance();
+
+    /// Create a pool with the given number of threads.
+    explicit ThreadPool( unsigned int numThreads );
+
+    /// Stop and join the pool threads.
+    ~ThreadPool();
+
+    /// Return the number of pool threads.
+    unsigned int getNumThreads() const { return static_cast<unsigned int>( m_threads.size() ); }
+
+    /// Call func(i) for each i in [0, count), using the pool threads as well as the calling thread.
+    /// Returns when all the calls are complete.  If a call throws an exception, the remaining
+    /// indices are skipped and the first exception is rethrown.  Concurrent loops share the pool
+    /// threads, so that loops issued from many threads at once (e.g. the request processing threads
+    /// of a demand loader) run mostly on their calling threads rather than oversubscribing the CPU.
+    void parallelFor( unsigned int count, const std::function<void( unsigned int )>& func );
+
+    /// Queue a task to be run by one of the pool threads, returning immediately (the task is run on
+    /// the calling thread if the pool has no threads).  Exceptions thrown by the task are discarded,
+    /// and tasks that have not started when the pool is destroyed are not run.
+    void run( std::function<void()> task );
+
+  private:
+    struct Job;
+
+    std::vector<std::thread>         m_threads;
+    std::deque<std::shared_ptr<Job>> m_jobs;
+    std::mutex                       m_mutex;
+    std::condition_variable          m_jobAvailable;
+    bool                             m_isShutDown = false;
+    std::atomic<unsigned int>        m_numCallers{0};  // Number of threads in parallelFor().
+
+    void worker();
+};
+
+}  // namespace imageSource
@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2021, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <OptiXToolkit/ImageSource/TileCache.h>
+
+#include <cstring>
+
+namespace imageSource {
+
+// The default budget for the process-wide cache.
+static const size_t DEFAULT_MAX_BYTES = 1024 * 1024 * 1024;
+
+TileCache& TileCache::getInstance()
+{
+    static TileCache cache( DEFAULT_MAX_BYTES );
+    return cache;
+}
+
+TileCache::TileCache( size_t maxBytes )
+    : m_maxBytes( maxBytes )
+{
+}
+
+unsigned long long TileCache::newImageId()
+{
+    static std::atomic<unsigned long long> nextId( 0 );
+    return nextId++;
+}
+
+size_t TileCache::KeyHash::operator()( const TileCacheKey& key ) const
+{
+    // Mix the fields with multiplicative hashing, so that neighboring tiles fall in different shards.
+    unsigned long long hash = key.imageId * 0x9E3779B97F4A7C15ULL;
+    hash                    = ( hash ^ key.mipLevel ) * 0x9E3779B97F4A7C15ULL;
+    hash                    = ( hash ^ key.tileX ) * 0x9E3779B97F4A7C15ULL;
+    hash                    = ( hash ^ key.tileY ) * 0x9E3779B97F4A7C15ULL;
+    return static_cast<size_t>( hash ^ ( hash >> 32 ) );
+}
+
+void TileCache::Shard::evict( size_t maxBytes )
+{
+    // Mutex acquired in caller
+    while( numBytes > maxBytes && !lru.empty() )
+    {
+        numBytes -= lru.back().data.size();
+        entries.erase( lru.back().key );
+        lru.pop_back();
+    }
+}
+
+void TileCache::setMaxBytes( size_t maxBytes )
+{
+    m_maxBytes = maxBytes;
+    for( Shard& shard : m_shards )
+    {
+        std::unique_lock<std::mutex> lock( shard.mutex );
+        shard.evict( maxBytes / NUM_SHARDS );
+    }
+}
+
+size_t TileCache::getNumBytes() const
+{
+    size_t numBytes = 0;
+    for( const Shard& shard : m_shards )
+    {
+        std::unique_lock<std::mutex> lock( shard.mutex );
+        numBytes += shard.numBytes;
+    }
+    return numBytes;
+}
+
+bool TileCache::find( const TileCacheKey& key, char* dest, size_t numBytes )
+{
+    Shard&                       shard = getShard( key );
+    std::unique_lock<std::mutex> lock( shard.mutex );
+
+    auto it = shard.entries.find( key );
+    if( it == shard.entries.end() || it->second->data.size() != numBytes )
+        return false;
+
+    // Move the entry to the front of the LRU list.
+    shard.lru.splice( shard.lru.begin(), shard.lru, it->second );
+    memcpy( dest, it->second->data.data(), numBytes );
+    return true;
+}
+
+void TileCache::insert( const TileCacheKey& key, const char* data, size_t numBytes )
+{
+    const size_t maxShardBytes = m_maxBytes / NUM_SHARDS;
+    if( numBytes > maxShardBytes )
+        return;
+
+    // Copy the tile before taking the lock.
+    std::vector<char> copy( data, data + numBytes );
+
+    Shard&                       shard = getShard( key );
+    std::unique_lock<std::mutex> lock( shard.mutex );
+
+    auto it = shard.entries.find( key );
+    if( it != shard.entries.end() )
+    {
+        shard.numBytes -= it->second->data.size();
+        shard.lru.erase( it->second );
+        shard.entries.erase( it );
+    }
+
+    shard.lru.push_front( Entry{key, std::move( copy )} );
+    shard.entries[key] = shard.lru.begin();
+    shard.numBytes += numBytes;
+    shard.evict( maxShardBytes );
+}
+
+void TileCache::clear()
+{
+    for( Shard& shard : m_shards )
+    {
+        std::unique_lock<std::mutex> lock( shard.mutex );
+        shard.lru.clear();
+        shard.entries.clear();
+        shard.numBytes = 0;
+    }
+}
+
+}  // namespace imageSource
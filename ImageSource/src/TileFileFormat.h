@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#pragma once
+
+#include <OptiXToolkit/ImageSource/TextureInfo.h>
+
+#include <vector_types.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace imageSource {
+
+// On-disk layout of a tile file (see TileFileReader and writeTileFile).  The file consists of a
+// TileFileHeader, followed (at tilesOffset) by the tiles of each mip level above the mip tail, and
+// then (at mipTailOffset) by the mip tail.  Tiles are stored in row-major order within each level,
+// padded to tileWidth x tileHeight pixels, with a fixed stride of tileWidth * tileHeight *
+// pixelSizeInBytes, so that a tile can be copied to the loader's transfer buffer with a single
+// memcpy.  The mip tail levels are stored one after another, as written by
+// ImageSourceBase::readMipTail.  All values are in host byte order.
+
+const char         TILE_FILE_MAGIC[8]  = {'O', 'T', 'K', 'T', 'I', 'L', 'E', 'S'};
+const unsigned int TILE_FILE_VERSION   = 1;
+const unsigned int TILE_FILE_ALIGNMENT = 4096;  // Alignment of the tile data, to match the page size.
+
+// Tile data compression.  Only uncompressed tiles are currently supported.
+enum TileFileCompression
+{
+    TILE_FILE_UNCOMPRESSED = 0
+};
+
+struct TileFileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t compression;
+    uint32_t width;
+    uint32_t height;
+    uint32_t format;
+    uint32_t numChannels;
+    uint32_t numMipLevels;
+    uint32_t isTiled;
+    uint32_t tileWidth;
+    uint32_t tileHeight;
+    uint32_t mipTailFirstLevel;
+    uint32_t hasBaseColor;
+    float    baseColor[4];
+    uint64_t tilesOffset;
+    uint64_t mipTailOffset;
+    uint64_t mipTailSize;
+};
+static_assert( sizeof( TileFileHeader ) == 96, "Unexpected TileFileHeader size" );
+
+// Offsets of the tiles and mip levels in a tile file, computed from its header.  The mip tail
+// immediately follows the tiles.
+struct TileFileLayout
+{
+    unsigned int              pixelSizeInBytes;
+    uint64_t                  tileSizeInBytes;
+    std::vector<uint2>        levelDims;     // dimensions of each mip level
+    std::vector<unsigned int> levelTilesX;   // number of tiles per row in each level above the mip tail
+    std::vector<unsigned int> levelTilesY;   // number of tile rows in each level above the mip tail
+    std::vector<uint64_t>     levelOffsets;  // offset of the first tile (or pixel, in the mip tail) of each level
+    uint64_t                  mipTailOffset;
+    uint64_t                  mipTailSize;
+
+    explicit TileFileLayout( const TileFileHeader& header )
+    {
+        pixelSizeInBytes = header.numChannels * getBytesPerChannel( static_cast<CUarray_format>( header.format ) );
+        tileSizeInBytes  = static_cast<uint64_t>( header.tileWidth ) * header.tileHeight * pixelSizeInBytes;
+
+        const unsigned int mipTailFirstLevel = std::min( header.mipTailFirstLevel, header.numMipLevels );
+        uint64_t           offset            = header.tilesOffset;
+        for( unsigned int mipLevel = 0; mipLevel < header.numMipLevels; ++mipLevel )
+        {
+            const uint2 dims{std::max( 1u, header.width >> mipLevel ), std::max( 1u, header.height >> mipLevel )};
+            levelDims.push_back( dims );
+            if( mipLevel < mipTailFirstLevel )
+            {
+                levelTilesX.push_back( ( levelDims.back().x + header.tileWidth - 1 ) / header.tileWidth );
+                levelTilesY.push_back( ( levelDims.back().y + header.tileHeight - 1 ) / header.tileHeight );
+                levelOffsets.push_back( offset );
+                offset += levelTilesX.back() * levelTilesY.back() * tileSizeInBytes;
+            }
+        }
+
+        mipTailOffset = offset;
+        for( unsigned int mipLevel = mipTailFirstLevel; mipLevel < header.numMipLevels; ++mipLevel )
+        {
+            levelOffsets.push_back( offset );
+            offset += static_cast<uint64_t>( levelDims[mipLevel].x ) * levelDims[mipLevel].y * pixelSizeInBytes;
+        }
+        mipTailSize = offset - mipTailOffset;
+    }
+
+    // Returns the size of the file.
+    uint64_t getFileSize() const { return mipTailOffset + mipTailSize; }
+};
+
+}  // namespace imageSource
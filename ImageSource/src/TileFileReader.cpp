@@ -0,0 +1,438 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <OptiXToolkit/ImageSource/TileFileReader.h>
+#include <OptiXToolkit/ImageSource/AsyncFileReader.h>
+
+#include "Exception.h"
+#include "Serialization.h"
+#include "Stopwatch.h"
+#include "TileFileFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace imageSource {
+
+TileFileReader::TileFileReader( const std::string& filename, bool useAsyncReads )
+    : m_filename( filename )
+    , m_useAsyncReads( useAsyncReads )
+{
+}
+
+TileFileReader::~TileFileReader()
+{
+    close();
+}
+
+void TileFileReader::open( TextureInfo* info )
+{
+    std::unique_lock<std::mutex> lock( m_initMutex );
+    if( !m_data )
+    {
+        m_info.isValid = false;
+        mapFile();
+
+        TileFileHeader                  header;
+        std::unique_ptr<TileFileLayout> layout;
+        const char*                     error = nullptr;
+        if( m_dataSize < sizeof( TileFileHeader ) )
+            error = "Truncated tile file: ";
+        else
+        {
+            std::memcpy( &header, m_data, sizeof( TileFileHeader ) );
+            if( std::memcmp( header.magic, TILE_FILE_MAGIC, sizeof( TILE_FILE_MAGIC ) ) != 0 )
+                error = "Not a tile file: ";
+            else if( header.version != TILE_FILE_VERSION )
+                error = "Unsupported tile file version: ";
+            else if( header.compression != TILE_FILE_UNCOMPRESSED )
+                error = "Unsupported tile file compression: ";
+            else if( header.numMipLevels == 0 || header.numMipLevels > 32 || header.tileWidth == 0
+                     || header.tileHeight == 0 )
+                error = "Invalid tile file header: ";
+        }
+        if( !error )
+        {
+            layout.reset( new TileFileLayout( header ) );
+            if( header.mipTailOffset != layout->mipTailOffset || header.mipTailSize != layout->mipTailSize
+                || m_dataSize < layout->getFileSize() )
+                error = "Truncated tile file: ";
+        }
+        if( error )
+        {
+            unmapFile();
+            throw Exception( ( error + m_filename ).c_str() );
+        }
+        if( m_useAsyncReads )
+        {
+            try
+            {
+                m_asyncReader.reset( new AsyncFileReader( m_filename ) );
+            }
+            catch( ... )
+            {
+                unmapFile();
+                throw;
+            }
+        }
+
+        m_info.width        = header.width;
+        m_info.height       = header.height;
+        m_info.format       = static_cast<CUarray_format>( header.format );
+        m_info.numChannels  = header.numChannels;
+        m_info.numMipLevels = header.numMipLevels;
+        m_info.isTiled      = header.isTiled != 0;
+        m_info.isValid      = true;
+
+        m_tileWidth         = header.tileWidth;
+        m_tileHeight        = header.tileHeight;
+        m_mipTailFirstLevel = std::min( header.mipTailFirstLevel, header.numMipLevels );
+        m_hasBaseColor      = header.hasBaseColor != 0;
+        m_baseColor = float4{header.baseColor[0], header.baseColor[1], header.baseColor[2], header.baseColor[3]};
+        m_layout            = std::move( layout );
+    }
+
+    if( info != nullptr )
+        *info = m_info;
+}
+
+void TileFileReader::close()
+{
+    std::unique_lock<std::mutex> lock( m_initMutex );
+    unmapFile();
+    m_layout.reset();
+    m_asyncReader.reset();
+}
+
+#ifdef _WIN32
+
+void TileFileReader::mapFile()
+{
+    HANDLE file = CreateFileA( m_filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                               FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr );
+    DEMAND_ASSERT_MSG( file != INVALID_HANDLE_VALUE, "Unable to open tile file " + m_filename );
+
+    LARGE_INTEGER size;
+    HANDLE        mapping = nullptr;
+    const void*   data    = nullptr;
+    if( GetFileSizeEx( file, &size ) && size.QuadPart > 0 )
+        mapping = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr );
+    if( mapping )
+        data = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0 );
+    if( !data )
+    {
+        if( mapping )
+            CloseHandle( mapping );
+        CloseHandle( file );
+        throw Exception( ( "Unable to map tile file " + m_filename ).c_str() );
+    }
+
+    m_fileHandle    = file;
+    m_mappingHandle = mapping;
+    m_data          = static_cast<const char*>( data );
+    m_dataSize      = static_cast<size_t>( size.QuadPart );
+}
+
+void TileFileReader::unmapFile()
+{
+    if( m_data )
+    {
+        UnmapViewOfFile( m_data );
+        CloseHandle( m_mappingHandle );
+        CloseHandle( m_fileHandle );
+    }
+    m_data          = nullptr;
+    m_dataSize      = 0;
+    m_fileHandle    = nullptr;
+    m_mappingHandle = nullptr;
+}
+
+#else
+
+void TileFileReader::mapFile()
+{
+    const int fd = ::open( m_filename.c_str(), O_RDONLY );
+    DEMAND_ASSERT_MSG( fd >= 0, "Unable to open tile file " + m_filename );
+
+    // The mapping remains valid after the file descriptor is closed.
+    struct stat status;
+    void*       data = MAP_FAILED;
+    if( fstat( fd, &status ) == 0 && status.st_size > 0 )
+        data = mmap( nullptr, static_cast<size_t>( status.st_size ), PROT_READ, MAP_SHARED, fd, 0 );
+    ::close( fd );
+    DEMAND_ASSERT_MSG( data != MAP_FAILED, "Unable to map tile file " + m_filename );
+
+    m_data     = static_cast<const char*>( data );
+    m_dataSize = static_cast<size_t>( status.st_size );
+}
+
+void TileFileReader::unmapFile()
+{
+    if( m_data )
+        munmap( const_cast<char*>( m_data ), m_dataSize );
+    m_data     = nullptr;
+    m_dataSize = 0;
+}
+
+#endif
+
+const char* TileFileReader::getTileData( unsigned int mipLevel, unsigned int tileX, unsigned int tileY ) const
+{
+    if( !m_data || mipLevel >= m_mipTailFirstLevel || tileX >= m_layout->levelTilesX[mipLevel]
+        || tileY >= m_layout->levelTilesY[mipLevel] )
+        return nullptr;
+
+    const uint64_t tileIndex = static_cast<uint64_t>( tileY ) * m_layout->levelTilesX[mipLevel] + tileX;
+    return m_data + m_layout->levelOffsets[mipLevel] + tileIndex * m_layout->tileSizeInBytes;
+}
+
+// Copy the specified rectangle of a mip level into dest, whose rows are width pixels long,
+// gathering the pixels from the stored tiles or mip tail.  Pixels outside the mip level are black.
+void TileFileReader::copyRect( char*        dest,
+                               unsigned int mipLevel,
+                               unsigned int x,
+                               unsigned int y,
+                               unsigned int width,
+                               unsigned int height ) const
+{
+    const uint2        levelDims = m_layout->levelDims[mipLevel];
+    const size_t       pixelSize = m_layout->pixelSizeInBytes;
+    const size_t       rowPitch  = width * pixelSize;
+    const unsigned int endX      = std::min( x + width, levelDims.x );
+    const unsigned int endY      = std::min( y + height, levelDims.y );
+
+    if( endX <= x || endY <= y )
+    {
+        std::memset( dest, 0, rowPitch * height );
+        return;
+    }
+    if( endX - x < width || endY - y < height )
+        std::memset( dest, 0, rowPitch * height );
+
+    for( unsigned int row = y; row < endY; ++row )
+    {
+        char* destRow = dest + ( row - y ) * rowPitch;
+        if( mipLevel >= m_mipTailFirstLevel )
+        {
+            const size_t offset = ( static_cast<size_t>( row ) * levelDims.x + x ) * pixelSize;
+            std::memcpy( destRow, m_data + m_layout->levelOffsets[mipLevel] + offset, ( endX - x ) * pixelSize );
+            continue;
+        }
+
+        // Copy the part of the row within each stored tile it spans.
+        for( unsigned int col = x; col < endX; )
+        {
+            const unsigned int tileX   = col / m_tileWidth;
+            const unsigned int spanEnd = std::min( endX, ( tileX + 1 ) * m_tileWidth );
+            const char*        tile    = getTileData( mipLevel, tileX, row / m_tileHeight );
+            const size_t       offset  =
+                ( static_cast<size_t>( row % m_tileHeight ) * m_tileWidth + col % m_tileWidth ) * pixelSize;
+            std::memcpy( destRow + ( col - x ) * pixelSize, tile + offset, ( spanEnd - col ) * pixelSize );
+            col = spanEnd;
+        }
+    }
+}
+
+void TileFileReader::addReadStats( unsigned long long numTiles, unsigned long long numBytes, double readTime )
+{
+    m_numTilesRead += numTiles;
+    m_numBytesRead += numBytes;
+    std::unique_lock<std::mutex> lock( m_statsMutex );
+    m_totalReadTime += readTime;
+}
+
+bool TileFileReader::readTile( char*        dest,
+                               unsigned int mipLevel,
+                               unsigned int tileX,
+                               unsigned int tileY,
+                               unsigned int tileWidth,
+                               unsigned int tileHeight,
+                               CUstream     /*stream*/ )
+{
+    DEMAND_ASSERT_MSG( isOpen(), "Attempt to read from unopened tile file." );
+    DEMAND_ASSERT_MSG( mipLevel < m_info.numMipLevels, "Attempt to read from non-existent mip-level." );
+
+    Stopwatch    stopwatch;
+    const size_t tileSize = static_cast<size_t>( tileWidth ) * tileHeight * m_layout->pixelSizeInBytes;
+    const bool   stored   = tileWidth == m_tileWidth && tileHeight == m_tileHeight;
+    const char*  tile     = stored ? getTileData( mipLevel, tileX, tileY ) : nullptr;
+    if( tile && m_asyncReader )
+    {
+        const AsyncReadRequest request{dest, static_cast<uint64_t>( tile - m_data ), tileSize};
+        m_asyncReader->read( &request, 1 );
+    }
+    else if( tile )
+        std::memcpy( dest, tile, tileSize );
+    else
+        copyRect( dest, mipLevel, tileX * tileWidth, tileY * tileHeight, tileWidth, tileHeight );
+
+    addReadStats( 1, tileSize, stopwatch.elapsed() );
+    return true;
+}
+
+bool TileFileReader::readTiles( TileRequest*       requests,
+                                unsigned int       numRequests,
+                                unsigned int       tileWidth,
+                                unsigned int       tileHeight,
+                                CUstream           stream )
+{
+    if( !m_asyncReader || tileWidth != m_tileWidth || tileHeight != m_tileHeight )
+        return ImageSource::readTiles( requests, numRequests, tileWidth, tileHeight, stream );
+
+    // Submit reads of the stored tiles, and gather any others (e.g. in the mip tail) from the
+    // mapping while the reads are in flight.
+    Stopwatch                     stopwatch;
+    const size_t                  tileSize = static_cast<size_t>( m_layout->tileSizeInBytes );
+    std::vector<AsyncReadRequest> reads;
+    reads.reserve( numRequests );
+    for( unsigned int i = 0; i < numRequests; ++i )
+    {
+        const TileRequest& request = requests[i];
+        DEMAND_ASSERT_MSG( request.mipLevel < m_info.numMipLevels, "Attempt to read from non-existent mip-level." );
+        if( const char* tile = getTileData( request.mipLevel, request.tileX, request.tileY ) )
+            reads.push_back( AsyncReadRequest{request.dest, static_cast<uint64_t>( tile - m_data ), tileSize} );
+    }
+    std::shared_ptr<AsyncReadBatch> batch = m_asyncReader->submit( reads.data(), static_cast<unsigned int>( reads.size() ) );
+
+    // The batch must complete before returning, even if copying throws, since it writes to the
+    // caller's buffers.
+    try
+    {
+        for( unsigned int i = 0; i < numRequests; ++i )
+        {
+            const TileRequest& request = requests[i];
+            if( !getTileData( request.mipLevel, request.tileX, request.tileY ) )
+                copyRect( request.dest, request.mipLevel, request.tileX * tileWidth, request.tileY * tileHeight,
+                          tileWidth, tileHeight );
+        }
+    }
+    catch( ... )
+    {
+        batch->wait();
+        throw;
+    }
+    batch->wait();
+
+    for( unsigned int i = 0; i < numRequests; ++i )
+        requests[i].satisfied = true;
+    addReadStats( numRequests, numRequests * tileSize, stopwatch.elapsed() );
+    return true;
+}
+
+bool TileFileReader::readMipLevel( char*        dest,
+                                   unsigned int mipLevel,
+                                   unsigned int expectedWidth,
+                                   unsigned int expectedHeight,
+                                   CUstream /*stream*/ )
+{
+    DEMAND_ASSERT_MSG( isOpen(), "Attempt to read from unopened tile file." );
+    DEMAND_ASSERT_MSG( mipLevel < m_info.numMipLevels, "Attempt to read from non-existent mip-level." );
+
+    const uint2 levelDims = m_layout->levelDims[mipLevel];
+    DEMAND_ASSERT( expectedWidth == levelDims.x && expectedHeight == levelDims.y );
+
+    Stopwatch    stopwatch;
+    const size_t levelSize = static_cast<size_t>( levelDims.x ) * levelDims.y * m_layout->pixelSizeInBytes;
+    if( mipLevel >= m_mipTailFirstLevel )
+        std::memcpy( dest, m_data + m_layout->levelOffsets[mipLevel], levelSize );
+    else
+        copyRect( dest, mipLevel, 0, 0, levelDims.x, levelDims.y );
+
+    addReadStats( 0, levelSize, stopwatch.elapsed() );
+    return true;
+}
+
+bool TileFileReader::readMipTail( char*        dest,
+                                  unsigned int mipTailFirstLevel,
+                                  unsigned int numMipLevels,
+                                  const uint2* mipLevelDims,
+                                  unsigned int pixelSizeInBytes,
+                                  CUstream     stream )
+{
+    DEMAND_ASSERT_MSG( isOpen(), "Attempt to read from unopened tile file." );
+
+    // The stored mip tail has the same layout as ImageSourceBase::readMipTail, so it can be copied
+    // directly if it starts at the requested level.
+    if( mipTailFirstLevel != m_mipTailFirstLevel || numMipLevels != m_info.numMipLevels
+        || pixelSizeInBytes != m_layout->pixelSizeInBytes || mipTailFirstLevel >= numMipLevels )
+    {
+        return ImageSourceBase::readMipTail( dest, mipTailFirstLevel, numMipLevels, mipLevelDims, pixelSizeInBytes,
+                                             stream );
+    }
+    for( unsigned int mipLevel = mipTailFirstLevel; mipLevel < numMipLevels; ++mipLevel )
+    {
+        const uint2 levelDims = m_layout->levelDims[mipLevel];
+        DEMAND_ASSERT( mipLevelDims[mipLevel].x == levelDims.x && mipLevelDims[mipLevel].y == levelDims.y );
+    }
+
+    Stopwatch stopwatch;
+    if( m_asyncReader )
+    {
+        const AsyncReadRequest request{dest, m_layout->mipTailOffset, static_cast<size_t>( m_layout->mipTailSize )};
+        m_asyncReader->read( &request, 1 );
+    }
+    else
+        std::memcpy( dest, m_data + m_layout->mipTailOffset, m_layout->mipTailSize );
+    addReadStats( 0, m_layout->mipTailSize, stopwatch.elapsed() );
+    return true;
+}
+
+bool TileFileReader::readBaseColor( float4& dest )
+{
+    DEMAND_ASSERT_MSG( isOpen(), "Attempt to read from unopened tile file." );
+    dest = m_baseColor;
+    return m_hasBaseColor;
+}
+
+void TileFileReader::serialize( std::ostream& stream ) const
+{
+    writeSerializedString( stream, m_filename );
+    writeSerializedValue( stream, m_useAsyncReads );
+}
+
+std::shared_ptr<ImageSource> TileFileReader::deserialize( std::istream& stream )
+{
+    const std::string filename      = readSerializedString( stream );
+    const bool        useAsyncReads = readSerializedValue<bool>( stream );
+    return std::shared_ptr<ImageSource>( new TileFileReader( filename, useAsyncReads ) );
+}
+
+}  // namespace imageSource
@@ -0,0 +1,214 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <OptiXToolkit/ImageSource/TileFileWriter.h>
+#include <OptiXToolkit/ImageSource/TextureInfo.h>
+
+#include "Exception.h"
+#include "TileFileFormat.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace imageSource {
+
+uint2 getDefaultTileDimensions( unsigned int pixelSizeInBytes )
+{
+    // CUDA sparse textures use 64 KB tiles, which are square or twice as wide as they are high.
+    switch( pixelSizeInBytes )
+    {
+        case 1:
+            return uint2{256, 256};
+        case 2:
+            return uint2{256, 128};
+        case 4:
+            return uint2{128, 128};
+        case 8:
+            return uint2{128, 64};
+        case 16:
+            return uint2{64, 64};
+        default:
+            throw Exception( "Unsupported pixel size for tile file" );
+    }
+}
+
+namespace {
+
+// Cut the specified tile out of a mip level, padding it with black outside the level.
+void copyTileFromLevel( char*        dest,
+                        const char*  level,
+                        uint2        levelDims,
+                        unsigned int tileX,
+                        unsigned int tileY,
+                        unsigned int tileWidth,
+                        unsigned int tileHeight,
+                        size_t       pixelSize )
+{
+    std::memset( dest, 0, tileWidth * tileHeight * pixelSize );
+    const unsigned int startX = tileX * tileWidth;
+    const unsigned int startY = tileY * tileHeight;
+    const unsigned int width  = std::min( tileWidth, levelDims.x - startX );
+    const unsigned int height = std::min( tileHeight, levelDims.y - startY );
+    for( unsigned int row = 0; row < height; ++row )
+    {
+        const char* src = level + ( static_cast<size_t>( startY + row ) * levelDims.x + startX ) * pixelSize;
+        std::memcpy( dest + row * tileWidth * pixelSize, src, width * pixelSize );
+    }
+}
+
+void writeBytes( std::ofstream& stream, const char* data, size_t size, const std::string& filename )
+{
+    stream.write( data, static_cast<std::streamsize>( size ) );
+    if( !stream )
+        throw Exception( ( "Error writing tile file " + filename ).c_str() );
+}
+
+}  // namespace
+
+void writeTileFile( ImageSource&       image,
+                    const std::string& filename,
+                    unsigned int       tileWidth,
+                    unsigned int       tileHeight,
+                    unsigned int       mipTailFirstLevel )
+{
+    TextureInfo info;
+    image.open( &info );
+    DEMAND_ASSERT_MSG( info.isValid, "Invalid image for tile file " + filename );
+
+    const unsigned int pixelSize = info.numChannels * getBytesPerChannel( info.format );
+    if( tileWidth == 0 || tileHeight == 0 )
+    {
+        const uint2 tileDims = getDefaultTileDimensions( pixelSize );
+        tileWidth            = tileDims.x;
+        tileHeight           = tileDims.y;
+    }
+
+    // By default the mip tail starts with the first level that does not fill a tile.
+    if( mipTailFirstLevel == ~0u )
+    {
+        mipTailFirstLevel = 0;
+        while( mipTailFirstLevel < info.numMipLevels && ( info.width >> mipTailFirstLevel ) >= tileWidth
+               && ( info.height >> mipTailFirstLevel ) >= tileHeight )
+            ++mipTailFirstLevel;
+    }
+    mipTailFirstLevel = std::min( mipTailFirstLevel, info.numMipLevels );
+
+    TileFileHeader header{};
+    std::memcpy( header.magic, TILE_FILE_MAGIC, sizeof( TILE_FILE_MAGIC ) );
+    header.version           = TILE_FILE_VERSION;
+    header.compression       = TILE_FILE_UNCOMPRESSED;
+    header.width             = info.width;
+    header.height            = info.height;
+    header.format            = static_cast<uint32_t>( info.format );
+    header.numChannels       = info.numChannels;
+    header.numMipLevels      = info.numMipLevels;
+    header.isTiled           = info.isTiled ? 1 : 0;
+    header.tileWidth         = tileWidth;
+    header.tileHeight        = tileHeight;
+    header.mipTailFirstLevel = mipTailFirstLevel;
+    header.tilesOffset       = TILE_FILE_ALIGNMENT;
+
+    float4 baseColor;
+    if( image.readBaseColor( baseColor ) )
+    {
+        header.hasBaseColor = 1;
+        header.baseColor[0] = baseColor.x;
+        header.baseColor[1] = baseColor.y;
+        header.baseColor[2] = baseColor.z;
+        header.baseColor[3] = baseColor.w;
+    }
+
+    const TileFileLayout layout( header );
+    header.mipTailOffset = layout.mipTailOffset;
+    header.mipTailSize   = layout.mipTailSize;
+
+    std::ofstream stream( filename, std::ios::out | std::ios::binary | std::ios::trunc );
+    if( !stream )
+        throw Exception( ( "Unable to create tile file " + filename ).c_str() );
+
+    std::vector<char> padding( TILE_FILE_ALIGNMENT - sizeof( TileFileHeader ), 0 );
+    writeBytes( stream, reinterpret_cast<const char*>( &header ), sizeof( TileFileHeader ), filename );
+    writeBytes( stream, padding.data(), padding.size(), filename );
+
+    // Write the tiles one row at a time.  Tiled images are read a row of tiles at a time; other
+    // images are read a whole mip level at a time and then cut into tiles.
+    std::vector<char>        rowOfTiles;
+    std::vector<char>        levelData;
+    std::vector<TileRequest> requests;
+    for( unsigned int mipLevel = 0; mipLevel < mipTailFirstLevel; ++mipLevel )
+    {
+        const uint2        levelDims = layout.levelDims[mipLevel];
+        const unsigned int tilesX    = layout.levelTilesX[mipLevel];
+        rowOfTiles.resize( tilesX * layout.tileSizeInBytes );
+        if( !info.isTiled )
+        {
+            levelData.resize( static_cast<size_t>( levelDims.x ) * levelDims.y * pixelSize );
+            image.readMipLevel( levelData.data(), mipLevel, levelDims.x, levelDims.y, CUstream{} );
+        }
+
+        for( unsigned int tileY = 0; tileY < layout.levelTilesY[mipLevel]; ++tileY )
+        {
+            if( info.isTiled )
+            {
+                requests.clear();
+                for( unsigned int tileX = 0; tileX < tilesX; ++tileX )
+                {
+                    char* dest = &rowOfTiles[tileX * layout.tileSizeInBytes];
+                    requests.push_back( TileRequest{dest, mipLevel, tileX, tileY} );
+                }
+                DEMAND_ASSERT_MSG( image.readTiles( requests.data(), tilesX, tileWidth, tileHeight, CUstream{} ),
+                                   "Unable to read tiles for tile file " + filename );
+            }
+            else
+            {
+                for( unsigned int tileX = 0; tileX < tilesX; ++tileX )
+                    copyTileFromLevel( &rowOfTiles[tileX * layout.tileSizeInBytes], levelData.data(), levelDims, tileX,
+                                       tileY, tileWidth, tileHeight, pixelSize );
+            }
+            writeBytes( stream, rowOfTiles.data(), rowOfTiles.size(), filename );
+        }
+    }
+
+    // Write the mip tail as the loader requests it.
+    if( mipTailFirstLevel < info.numMipLevels )
+    {
+        levelData.resize( layout.mipTailSize );
+        DEMAND_ASSERT_MSG( image.readMipTail( levelData.data(), mipTailFirstLevel, info.numMipLevels,
+                                              layout.levelDims.data(), pixelSize, CUstream{} ),
+                           "Unable to read mip tail for tile file " + filename );
+        writeBytes( stream, levelData.data(), levelData.size(), filename );
+    }
+
+    stream.close();
+    if( !stream )
+        throw Exception( ( "Error writing tile file " + filename ).c_str() );
+}
+
+}  // namespace imageSource
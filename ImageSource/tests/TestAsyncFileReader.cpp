@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <OptiXToolkit/ImageSource/AsyncFileReader.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <vector>
+
+using namespace imageSource;
+
+class TestAsyncFileReader : public testing::TestWithParam<bool>
+{
+  public:
+    const std::string filename = "TestAsyncFileReader.dat";
+    std::vector<char> contents;
+
+    void SetUp() override
+    {
+        contents.resize( 4 * 1024 * 1024 + 123 );
+        for( size_t i = 0; i < contents.size(); ++i )
+            contents[i] = static_cast<char>( i * 7 + ( i >> 12 ) );
+        std::ofstream stream( filename, std::ios::binary );
+        stream.write( contents.data(), contents.size() );
+    }
+
+    void TearDown() override { std::remove( filename.c_str() ); }
+};
+
+TEST_P( TestAsyncFileReader, ReadsRanges )
+{
+    AsyncFileReader reader( filename, /*allowIoUring=*/GetParam() );
+    if( !GetParam() )
+    {
+        EXPECT_FALSE( reader.usesIoUring() );
+    }
+
+    // Read more ranges than an io_uring keeps in flight, including empty ones.
+    const unsigned int                    numRequests = 500;
+    std::mt19937                          rng( 17 );
+    std::uniform_int_distribution<size_t> sizeDist( 0, 64 * 1024 );
+    std::vector<std::vector<char>>        buffers( numRequests );
+    std::vector<AsyncReadRequest>         requests;
+    for( unsigned int i = 0; i < numRequests; ++i )
+    {
+        const size_t size   = sizeDist( rng );
+        const size_t offset = std::uniform_int_distribution<size_t>( 0, contents.size() - size )( rng );
+        buffers[i].resize( size );
+        requests.push_back( AsyncReadRequest{buffers[i].data(), offset, size} );
+    }
+    reader.read( requests.data(), numRequests );
+
+    for( unsigned int i = 0; i < numRequests; ++i )
+    {
+        const std::vector<char> expected( contents.begin() + requests[i].offset,
+                                          contents.begin() + requests[i].offset + requests[i].size );
+        ASSERT_EQ( expected, buffers[i] ) << "request " << i;
+    }
+}
+
+TEST_P( TestAsyncFileReader, ReadPastEndThrows )
+{
+    AsyncFileReader        reader( filename, /*allowIoUring=*/GetParam() );
+    std::vector<char>      buffer( 1024 );
+    const AsyncReadRequest request{buffer.data(), contents.size() - 512, buffer.size()};
+    EXPECT_THROW( reader.read( &request, 1 ), std::exception );
+}
+
+TEST_P( TestAsyncFileReader, SubmitsBatches )
+{
+    AsyncFileReader reader( filename, /*allowIoUring=*/GetParam() );
+
+    // Submit several batches before waiting for any of them.
+    const unsigned int                           numBatches = 8;
+    const size_t                                 rangeSize  = 100 * 1024;
+    std::vector<std::vector<char>>               buffers( numBatches, std::vector<char>( rangeSize ) );
+    std::atomic<unsigned int>                    numCallbacks{0};
+    std::vector<std::shared_ptr<AsyncReadBatch>> batches;
+    for( unsigned int i = 0; i < numBatches; ++i )
+    {
+        const AsyncReadRequest request{buffers[i].data(), i * rangeSize, rangeSize};
+        batches.push_back( reader.submit( &request, 1, [&numCallbacks]( std::exception_ptr exception ) {
+            if( !exception )
+                ++numCallbacks;
+        } ) );
+    }
+
+    for( unsigned int i = 0; i < numBatches; ++i )
+    {
+        batches[i]->wait();
+        EXPECT_TRUE( batches[i]->isComplete() );
+        const std::vector<char> expected( contents.begin() + i * rangeSize, contents.begin() + ( i + 1 ) * rangeSize );
+        ASSERT_EQ( expected, buffers[i] ) << "batch " << i;
+    }
+    EXPECT_EQ( numBatches, numCallbacks.load() );
+}
+
+TEST_P( TestAsyncFileReader, SubmitPastEndThrowsOnWait )
+{
+    AsyncFileReader                 reader( filename, /*allowIoUring=*/GetParam() );
+    std::vector<char>               buffer( 1024 );
+    const AsyncReadRequest          request{buffer.data(), contents.size() - 512, buffer.size()};
+    std::exception_ptr              error;
+    std::shared_ptr<AsyncReadBatch> batch =
+        reader.submit( &request, 1, [&error]( std::exception_ptr exception ) { error = exception; } );
+    EXPECT_THROW( batch->wait(), std::exception );
+    EXPECT_TRUE( error != nullptr );
+}
+
+INSTANTIATE_TEST_SUITE_P( IoUring, TestAsyncFileReader, testing::Bool() );
+
+TEST( TestAsyncFileReaderOpen, MissingFileThrows )
+{
+    EXPECT_THROW( AsyncFileReader( "NoSuchFile.dat" ), std::exception );
+}
@@ -0,0 +1,247 @@
+//
+// Copyright (c) 2022, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <OptiXToolkit/ImageSource/CachingImageSource.h>
+#include <OptiXToolkit/ImageSource/CheckerBoardImage.h>
+#include <OptiXToolkit/ImageSource/TextureInfo.h>
+#include <OptiXToolkit/ImageSource/TileCache.h>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace imageSource;
+
+class TestTileCache : public testing::Test
+{
+};
+
+TEST_F( TestTileCache, FindAfterInsert )
+{
+    TileCache               cache( 1024 * 1024 );
+    const TileCacheKey      key{TileCache::newImageId(), 0, 1, 2};
+    const std::vector<char> tile( 1024, 'a' );
+    std::vector<char>       dest( tile.size() );
+
+    EXPECT_FALSE( cache.find( key, dest.data(), dest.size() ) );
+    cache.insert( key, tile.data(), tile.size() );
+    EXPECT_EQ( tile.size(), cache.getNumBytes() );
+    ASSERT_TRUE( cache.find( key, dest.data(), dest.size() ) );
+    EXPECT_EQ( tile, dest );
+
+    // A different image id does not match.
+    const TileCacheKey otherKey{TileCache::newImageId(), 0, 1, 2};
+    EXPECT_FALSE( cache.find( otherKey, dest.data(), dest.size() ) );
+}
+
+TEST_F( TestTileCache, StaysWithinBudget )
+{
+    const size_t             tileSize = 1024;
+    TileCache                cache( 64 * tileSize );
+    const unsigned long long imageId = TileCache::newImageId();
+    const std::vector<char>  tile( tileSize, 'a' );
+
+    for( unsigned int i = 0; i < 1000; ++i )
+        cache.insert( TileCacheKey{imageId, 0, i, 0}, tile.data(), tile.size() );
+    EXPECT_LE( cache.getNumBytes(), cache.getMaxBytes() );
+    EXPECT_GT( cache.getNumBytes(), 0u );
+
+    cache.setMaxBytes( 0 );
+    EXPECT_EQ( 0u, cache.getNumBytes() );
+}
+
+TEST_F( TestTileCache, EvictsLeastRecentlyUsed )
+{
+    // With a single-tile budget per shard, keys that share a shard evict each other.
+    const size_t             tileSize = 1024;
+    TileCache                cache( 16 * tileSize );
+    const unsigned long long imageId = TileCache::newImageId();
+    const std::vector<char>  tile( tileSize, 'a' );
+    std::vector<char>        dest( tileSize );
+
+    for( unsigned int i = 0; i < 100; ++i )
+        cache.insert( TileCacheKey{imageId, 0, i, 0}, tile.data(), tile.size() );
+
+    // The most recently inserted tile is always present.
+    EXPECT_TRUE( cache.find( TileCacheKey{imageId, 0, 99, 0}, dest.data(), dest.size() ) );
+    EXPECT_LE( cache.getNumBytes(), 16 * tileSize );
+}
+
+class TestCachingImageSource : public testing::Test
+{
+  public:
+    const unsigned int                 tileWidth  = 32;
+    const unsigned int                 tileHeight = 32;
+    TileCache                          cache{64 * 1024 * 1024};
+    std::shared_ptr<CheckerBoardImage> checkerBoard{new CheckerBoardImage( 128, 128, /*squaresPerSide*/ 16 )};
+    CachingImageSource                 image{checkerBoard, &cache};
+    TextureInfo                        info{};
+
+    void SetUp() override { image.open( &info ); }
+
+    size_t getTileSize() const { return tileWidth * tileHeight * getBytesPerChannel( info.format ) * info.numChannels; }
+};
+
+TEST_F( TestCachingImageSource, HitAfterMiss )
+{
+    std::vector<char> expected( getTileSize() );
+    ASSERT_TRUE( checkerBoard->readTile( expected.data(), 1, 1, 0, tileWidth, tileHeight, nullptr ) );
+
+    std::vector<char> first( getTileSize() );
+    ASSERT_TRUE( image.readTile( first.data(), 1, 1, 0, tileWidth, tileHeight, nullptr ) );
+    EXPECT_EQ( 0u, image.getNumCacheHits() );
+    EXPECT_EQ( 1u, image.getNumCacheMisses() );
+
+    std::vector<char> second( getTileSize() );
+    ASSERT_TRUE( image.readTile( second.data(), 1, 1, 0, tileWidth, tileHeight, nullptr ) );
+    EXPECT_EQ( 1u, image.getNumCacheHits() );
+    EXPECT_EQ( 1u, image.getNumCacheMisses() );
+    EXPECT_EQ( getTileSize(), image.getNumCacheBytesHit() );
+
+    EXPECT_EQ( expected, first );
+    EXPECT_EQ( expected, second );
+}
+
+TEST_F( TestCachingImageSource, ReadTilesMixesHitsAndMisses )
+{
+    const size_t      tileSize = getTileSize();
+    std::vector<char> buffer( 4 * tileSize );
+    ASSERT_TRUE( image.readTile( buffer.data(), 0, 0, 0, tileWidth, tileHeight, nullptr ) );
+    ASSERT_TRUE( image.readTile( buffer.data(), 0, 2, 0, tileWidth, tileHeight, nullptr ) );
+
+    TileRequest       requests[] = {{buffer.data(), 0, 0, 0},
+                                    {buffer.data() + tileSize, 0, 1, 0},
+                                    {buffer.data() + 2 * tileSize, 0, 2, 0},
+                                    {buffer.data() + 3 * tileSize, 0, 3, 0}};
+    ASSERT_TRUE( image.readTiles( requests, 4, tileWidth, tileHeight, nullptr ) );
+    EXPECT_EQ( 2u, image.getNumCacheHits() );
+    EXPECT_EQ( 4u, image.getNumCacheMisses() );
+
+    std::vector<char> expected( tileSize );
+    for( const TileRequest& request : requests )
+    {
+        ASSERT_TRUE( checkerBoard->readTile( expected.data(), request.mipLevel, request.tileX, request.tileY, tileWidth, tileHeight, nullptr ) );
+        EXPECT_EQ( 0, memcmp( expected.data(), request.dest, tileSize ) );
+    }
+}
+
+namespace {
+
+// Checkerboard image that counts the tiles read from it, one at a time or in batches.
+class CountingImage : public CheckerBoardImage
+{
+  public:
+    CountingImage()
+        : CheckerBoardImage( 128, 128, /*squaresPerSide*/ 16 )
+    {
+    }
+
+    bool readTile( char* dest, unsigned int mipLevel, unsigned int tileX, unsigned int tileY, unsigned int tileWidth, unsigned int tileHeight, CUstream stream ) override
+    {
+        ++m_numTilesRead;
+        return CheckerBoardImage::readTile( dest, mipLevel, tileX, tileY, tileWidth, tileHeight, stream );
+    }
+
+    unsigned long long getNumTilesRead() const override { return m_numTilesRead; }
+
+  private:
+    unsigned long long m_numTilesRead = 0;
+};
+
+// Counting image that fails to read the tiles in column one.
+class FailingColumnImage : public CountingImage
+{
+  public:
+    bool readTile( char* dest, unsigned int mipLevel, unsigned int tileX, unsigned int tileY, unsigned int tileWidth, unsigned int tileHeight, CUstream stream ) override
+    {
+        return CountingImage::readTile( dest, mipLevel, tileX, tileY, tileWidth, tileHeight, stream ) && tileX != 1;
+    }
+};
+
+}  // namespace
+
+TEST_F( TestCachingImageSource, ReadTilesOnlyReadsMisses )
+{
+    std::shared_ptr<CountingImage> counting( new CountingImage );
+    CachingImageSource             cached( counting, &cache );
+    cached.open( &info );
+
+    const size_t      tileSize = getTileSize();
+    std::vector<char> buffer( 4 * tileSize );
+    TileRequest       requests[] = {{buffer.data(), 0, 0, 0},
+                                    {buffer.data() + tileSize, 0, 1, 0},
+                                    {buffer.data() + 2 * tileSize, 0, 2, 0},
+                                    {buffer.data() + 3 * tileSize, 0, 3, 0}};
+    ASSERT_TRUE( cached.readTiles( requests, 2, tileWidth, tileHeight, nullptr ) );
+    EXPECT_EQ( 2u, cached.getNumTilesRead() );
+
+    // Only the two tiles that are not cached are read from the wrapped image.
+    ASSERT_TRUE( cached.readTiles( requests, 4, tileWidth, tileHeight, nullptr ) );
+    EXPECT_EQ( 4u, cached.getNumTilesRead() );
+    EXPECT_EQ( 2u, cached.getNumCacheHits() );
+    EXPECT_EQ( 4u, cached.getNumCacheMisses() );
+    EXPECT_EQ( 2 * tileSize, cached.getNumCacheBytesHit() );
+}
+
+TEST_F( TestCachingImageSource, ReadTilesCachesSatisfiedTiles )
+{
+    std::shared_ptr<FailingColumnImage> failing( new FailingColumnImage );
+    CachingImageSource                  cached( failing, &cache );
+    cached.open( &info );
+
+    const size_t      tileSize = getTileSize();
+    std::vector<char> buffer( 4 * tileSize );
+    TileRequest       requests[] = {{buffer.data(), 0, 0, 0},
+                                    {buffer.data() + tileSize, 0, 1, 0},
+                                    {buffer.data() + 2 * tileSize, 0, 2, 0},
+                                    {buffer.data() + 3 * tileSize, 0, 3, 0}};
+    EXPECT_FALSE( cached.readTiles( requests, 4, tileWidth, tileHeight, nullptr ) );
+    EXPECT_TRUE( requests[0].satisfied );
+    EXPECT_FALSE( requests[1].satisfied );
+    EXPECT_TRUE( requests[2].satisfied );
+    EXPECT_TRUE( requests[3].satisfied );
+    EXPECT_EQ( 3 * tileSize, cache.getNumBytes() );
+
+    // Only the tile that failed is read again.
+    EXPECT_FALSE( cached.readTiles( requests, 4, tileWidth, tileHeight, nullptr ) );
+    EXPECT_EQ( 5u, cached.getNumTilesRead() );
+    EXPECT_EQ( 3u, cached.getNumCacheHits() );
+    EXPECT_TRUE( requests[0].satisfied );
+    EXPECT_FALSE( requests[1].satisfied );
+}
+
+TEST_F( TestCachingImageSource, ImagesDoNotShareTiles )
+{
+    CachingImageSource other( checkerBoard, &cache );
+    std::vector<char>  tile( getTileSize() );
+    ASSERT_TRUE( image.readTile( tile.data(), 0, 0, 0, tileWidth, tileHeight, nullptr ) );
+    ASSERT_TRUE( other.readTile( tile.data(), 0, 0, 0, tileWidth, tileHeight, nullptr ) );
+    EXPECT_EQ( 0u, other.getNumCacheHits() );
+}
@@ -48,7 +48,12 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <vector>
 
 using namespace imageSource;
@@ -163,6 +168,22 @@ void runReadInfo()
 
 INSTANTIATE_READER_TESTS( ReadInfo )
 
+template <class ReaderType>
+void runSerializeRoundTrip()
+{
+    ReaderType        reader( getSourceDir() + "/Textures/TiledMipMappedFloat.exr" );
+    std::stringstream stream;
+    serializeImageSource( reader, stream );
+
+    std::shared_ptr<ImageSource> copy = deserializeImageSource( stream );
+    ASSERT_TRUE( dynamic_cast<ReaderType*>( copy.get() ) != nullptr );
+    TextureInfo info = {};
+    ASSERT_NO_THROW( copy->open( &info ) );
+    EXPECT_EQ( 128U, info.width );
+}
+
+INSTANTIATE_READER_TESTS( SerializeRoundTrip )
+
 //------------------------------------------------------------------------------
 
 template <class ReaderType>
@@ -452,4 +473,136 @@ TEST_P(TestOIIOReaderFileTypes, ReadTile)
 INSTANTIATE_TEST_SUITE_P( TestOIIOReaderFileTypesInstance, TestOIIOReaderFileTypes, testing::Values( "TiledMipMappedFloat.tif" ) );
 // TODO: reading jpgs and pngs doesn't seem to work:  "level0.jpg", "level0.png"
 
+// Measure how tile reads from one OIIOReader scale with the number of threads.
+TEST_F( TestOIIOReader, DISABLED_ReadTileScalingBenchmark )
+{
+    OIIOReader  reader( getSourceDir() + "/Textures/TiledMipMappedInt8.tif" );
+    TextureInfo info = {};
+    ASSERT_NO_THROW( reader.open( &info ) );
+
+    const unsigned int tileWidth     = reader.getTileWidth() ? reader.getTileWidth() : 32;
+    const unsigned int tileHeight    = reader.getTileHeight() ? reader.getTileHeight() : 32;
+    const unsigned int numTilesX     = ( info.width + tileWidth - 1 ) / tileWidth;
+    const unsigned int numTilesY     = ( info.height + tileHeight - 1 ) / tileHeight;
+    const unsigned int tileSize      = tileWidth * tileHeight * getBytesPerChannel( info.format ) * info.numChannels;
+    const unsigned int numIterations = 50;
+    const unsigned int maxThreads    = std::max( 4u, std::thread::hardware_concurrency() );
+
+    for( unsigned int numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+    {
+        std::vector<std::thread> threads;
+        const auto               start = std::chrono::steady_clock::now();
+        for( unsigned int t = 0; t < numThreads; ++t )
+        {
+            threads.emplace_back( [&] {
+                std::vector<char> tile( tileSize );
+                for( unsigned int iteration = 0; iteration < numIterations; ++iteration )
+                {
+                    for( unsigned int tileY = 0; tileY < numTilesY; ++tileY )
+                    {
+                        for( unsigned int tileX = 0; tileX < numTilesX; ++tileX )
+                            reader.readTile( tile.data(), 0, tileX, tileY, tileWidth, tileHeight, nullptr );
+                    }
+                }
+            } );
+        }
+        for( std::thread& thread : threads )
+            thread.join();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+        const unsigned int numTiles = numThreads * numIterations * numTilesX * numTilesY;
+        std::cout << "[ OIIOReader ] " << numThreads << " threads: " << numTiles / elapsed.count() << " tiles/sec\n";
+    }
+}
+
 #endif // OTK_USE_OIIO
+
+#ifdef OPTIX_SAMPLE_USE_CORE_EXR
+
+//------------------------------------------------------------------------------
+// Batch tile reads
+
+// Make requests for every tile in the image, with destinations in the given buffer.
+static std::vector<TileRequest> makeTileRequests( const TextureInfo& info, unsigned int tileWidth, unsigned int tileHeight, std::vector<char>& buffer )
+{
+    const unsigned int       tileSize = tileWidth * tileHeight * getBytesPerChannel( info.format ) * info.numChannels;
+    std::vector<TileRequest> requests;
+    for( unsigned int mipLevel = 0; mipLevel < info.numMipLevels; ++mipLevel )
+    {
+        const unsigned int levelWidth  = std::max( 1u, info.width >> mipLevel );
+        const unsigned int levelHeight = std::max( 1u, info.height >> mipLevel );
+        for( unsigned int tileY = 0; tileY < ( levelHeight + tileHeight - 1 ) / tileHeight; ++tileY )
+        {
+            for( unsigned int tileX = 0; tileX < ( levelWidth + tileWidth - 1 ) / tileWidth; ++tileX )
+                requests.push_back( TileRequest{nullptr, mipLevel, tileX, tileY} );
+        }
+    }
+    buffer.assign( requests.size() * tileSize, 0 );
+    for( size_t i = 0; i < requests.size(); ++i )
+        requests[i].dest = buffer.data() + i * tileSize;
+    return requests;
+}
+
+TEST_F( TestCoreEXRReader, ReadTilesMatchesReadTile )
+{
+    CoreEXRReader reader( getSourceDir() + "/Textures/TiledMipMappedHalf.exr" );
+    TextureInfo   info = {};
+    ASSERT_NO_THROW( reader.open( &info ) );
+
+    const unsigned int       tileWidth  = reader.getTileWidth();
+    const unsigned int       tileHeight = reader.getTileHeight();
+    std::vector<char>        batchBuffer;
+    std::vector<TileRequest> requests = makeTileRequests( info, tileWidth, tileHeight, batchBuffer );
+    ASSERT_TRUE( reader.readTiles( requests.data(), static_cast<unsigned int>( requests.size() ), tileWidth, tileHeight, nullptr ) );
+
+    const size_t      tileSize = batchBuffer.size() / requests.size();
+    std::vector<char> tile( tileSize );
+    for( size_t i = 0; i < requests.size(); ++i )
+    {
+        std::fill( tile.begin(), tile.end(), 0 );
+        const TileRequest& request = requests[i];
+        ASSERT_TRUE( reader.readTile( tile.data(), request.mipLevel, request.tileX, request.tileY, tileWidth, tileHeight, nullptr ) );
+        EXPECT_EQ( 0, memcmp( tile.data(), request.dest, tileSize ) );
+    }
+}
+
+class TestCoreEXRReaderBenchmark : public testing::TestWithParam<std::string>
+{
+};
+
+// Compare reading every tile of an image one at a time against reading them as a batch.
+TEST_P( TestCoreEXRReaderBenchmark, DISABLED_ReadTilesThroughput )
+{
+    const int     numIterations = 100;
+    CoreEXRReader reader( getSourceDir() + "/Textures/" + GetParam() );
+    TextureInfo   info = {};
+    ASSERT_NO_THROW( reader.open( &info ) );
+
+    const unsigned int       tileWidth  = reader.getTileWidth();
+    const unsigned int       tileHeight = reader.getTileHeight();
+    std::vector<char>        buffer;
+    std::vector<TileRequest> requests = makeTileRequests( info, tileWidth, tileHeight, buffer );
+    const unsigned int       numTiles = static_cast<unsigned int>( requests.size() );
+
+    auto start = std::chrono::steady_clock::now();
+    for( int iteration = 0; iteration < numIterations; ++iteration )
+    {
+        for( const TileRequest& request : requests )
+            reader.readTile( request.dest, request.mipLevel, request.tileX, request.tileY, tileWidth, tileHeight, nullptr );
+    }
+    const std::chrono::duration<double> serialTime = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for( int iteration = 0; iteration < numIterations; ++iteration )
+        reader.readTiles( requests.data(), numTiles, tileWidth, tileHeight, nullptr );
+    const std::chrono::duration<double> batchTime = std::chrono::steady_clock::now() - start;
+
+    std::cout << "[ CoreEXRReader ] " << GetParam() << ": readTile " << numIterations * numTiles / serialTime.count()
+              << " tiles/sec, readTiles " << numIterations * numTiles / batchTime.count() << " tiles/sec\n";
+}
+
+INSTANTIATE_TEST_SUITE_P( TestCoreEXRReaderBenchmarkInstance,
+                          TestCoreEXRReaderBenchmark,
+                          testing::Values( "TiledMipMapped.exr", "TiledMipMappedFloat.exr", "TiledMipMappedHalf.exr" ) );
+
+#endif  // OPTIX_SAMPLE_USE_CORE_EXR
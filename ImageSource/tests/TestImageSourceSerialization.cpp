@@ -0,0 +1,148 @@
+//
+// Copyright (c) 2023, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <OptiXToolkit/ImageSource/CachingImageSource.h>
+#include <OptiXToolkit/ImageSource/CheckerBoardImage.h>
+#include <OptiXToolkit/ImageSource/TextureInfo.h>
+#include <OptiXToolkit/ImageSource/TileFileReader.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+using namespace imageSource;
+
+namespace {
+
+// An image source that is not serializable unless it is given a tag.
+class TaggedImage : public CheckerBoardImage
+{
+  public:
+    TaggedImage( const char* tag, unsigned int width )
+        : CheckerBoardImage( width, width, /*squaresPerSide=*/4, /*useMipmaps=*/false )
+        , m_tag( tag )
+    {
+    }
+
+    const char* getSerializationTag() const override { return m_tag; }
+
+    void serialize( std::ostream& stream ) const override
+    {
+        const unsigned int width = getInfo().width;
+        stream.write( reinterpret_cast<const char*>( &width ), sizeof( width ) );
+    }
+
+    static std::shared_ptr<ImageSource> deserialize( std::istream& stream )
+    {
+        unsigned int width;
+        stream.read( reinterpret_cast<char*>( &width ), sizeof( width ) );
+        return std::shared_ptr<ImageSource>( new TaggedImage( "TaggedImage", width ) );
+    }
+
+  private:
+    const char* m_tag;
+};
+
+std::shared_ptr<ImageSource> roundTrip( const ImageSource& imageSource )
+{
+    std::stringstream stream;
+    serializeImageSource( imageSource, stream );
+    return deserializeImageSource( stream );
+}
+
+}  // anonymous namespace
+
+class TestImageSourceSerialization : public testing::Test
+{
+};
+
+TEST_F( TestImageSourceSerialization, CheckerBoardImage )
+{
+    CheckerBoardImage            image( 256, 128, /*squaresPerSide=*/8, /*useMipmaps=*/false, /*tiled=*/false );
+    std::shared_ptr<ImageSource> copy = roundTrip( image );
+    ASSERT_TRUE( dynamic_cast<CheckerBoardImage*>( copy.get() ) != nullptr );
+
+    TextureInfo info{};
+    copy->open( &info );
+    EXPECT_EQ( 256U, info.width );
+    EXPECT_EQ( 128U, info.height );
+    EXPECT_EQ( 1U, info.numMipLevels );
+    EXPECT_FALSE( info.isTiled );
+}
+
+TEST_F( TestImageSourceSerialization, CachingImageSource )
+{
+    CachingImageSource image( std::make_shared<CheckerBoardImage>( 64, 64, /*squaresPerSide=*/4 ) );
+    std::shared_ptr<ImageSource> copy = roundTrip( image );
+
+    CachingImageSource* caching = dynamic_cast<CachingImageSource*>( copy.get() );
+    ASSERT_TRUE( caching != nullptr );
+    ASSERT_TRUE( dynamic_cast<CheckerBoardImage*>( caching->getImageSource() ) != nullptr );
+    EXPECT_EQ( 64U, caching->getInfo().width );
+    EXPECT_EQ( calculateNumMipLevels( 64, 64 ), caching->getInfo().numMipLevels );
+}
+
+TEST_F( TestImageSourceSerialization, TileFileReader )
+{
+    // The tile file is not opened until it is read, so it need not exist.
+    TileFileReader               reader( "missing.tiles", /*useAsyncReads=*/true );
+    std::shared_ptr<ImageSource> copy = roundTrip( reader );
+    EXPECT_TRUE( dynamic_cast<TileFileReader*>( copy.get() ) != nullptr );
+}
+
+TEST_F( TestImageSourceSerialization, CustomType )
+{
+    TaggedImage image( "TaggedImage", 32 );
+    EXPECT_THROW( roundTrip( image ), std::runtime_error );
+
+    registerImageSourceDeserializer( "TaggedImage", TaggedImage::deserialize );
+    std::shared_ptr<ImageSource> copy = roundTrip( image );
+    ASSERT_TRUE( dynamic_cast<TaggedImage*>( copy.get() ) != nullptr );
+    EXPECT_EQ( 32U, copy->getInfo().width );
+}
+
+TEST_F( TestImageSourceSerialization, NotSerializable )
+{
+    TaggedImage       image( nullptr, 32 );
+    std::stringstream stream;
+    EXPECT_THROW( serializeImageSource( image, stream ), std::runtime_error );
+}
+
+TEST_F( TestImageSourceSerialization, TruncatedStream )
+{
+    CheckerBoardImage image( 64, 64, /*squaresPerSide=*/4 );
+    std::stringstream stream;
+    serializeImageSource( image, stream );
+
+    const std::string  bytes = stream.str();
+    std::istringstream truncated( bytes.substr( 0, bytes.size() - 1 ) );
+    EXPECT_THROW( deserializeImageSource( truncated ), std::runtime_error );
+}
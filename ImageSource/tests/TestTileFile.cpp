@@ -0,0 +1,217 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <OptiXToolkit/ImageSource/CheckerBoardImage.h>
+#include <OptiXToolkit/ImageSource/TextureInfo.h>
+#include <OptiXToolkit/ImageSource/TileFileReader.h>
+#include <OptiXToolkit/ImageSource/TileFileWriter.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace imageSource;
+
+class TestTileFile : public testing::Test
+{
+  public:
+    const unsigned int tileWidth  = 32;
+    const unsigned int tileHeight = 32;
+    const std::string  filename   = "TestTileFile.tiles";
+    CheckerBoardImage  checkerBoard{128, 128, /*squaresPerSide*/ 16};
+    TextureInfo        info{};
+
+    void SetUp() override { checkerBoard.open( &info ); }
+
+    void TearDown() override { std::remove( filename.c_str() ); }
+
+    size_t getPixelSize() const { return getBytesPerChannel( info.format ) * info.numChannels; }
+
+    // Compare tiles of the given size read from the tile file and from the checkerboard.
+    void expectSameTile( TileFileReader& reader,
+                         unsigned int    mipLevel,
+                         unsigned int    tileX,
+                         unsigned int    tileY,
+                         unsigned int    width,
+                         unsigned int    height )
+    {
+        const size_t      tileSize = width * height * getPixelSize();
+        std::vector<char> expected( tileSize );
+        std::vector<char> actual( tileSize );
+        ASSERT_TRUE( checkerBoard.readTile( expected.data(), mipLevel, tileX, tileY, width, height, nullptr ) );
+        ASSERT_TRUE( reader.readTile( actual.data(), mipLevel, tileX, tileY, width, height, nullptr ) );
+        EXPECT_EQ( expected, actual ) << "mipLevel " << mipLevel << " tile " << tileX << "," << tileY;
+    }
+};
+
+TEST_F( TestTileFile, DefaultTileDimensions )
+{
+    EXPECT_EQ( 64u, getDefaultTileDimensions( 16 ).x );
+    EXPECT_EQ( 64u, getDefaultTileDimensions( 16 ).y );
+    EXPECT_EQ( 256u, getDefaultTileDimensions( 2 ).x );
+    EXPECT_EQ( 128u, getDefaultTileDimensions( 2 ).y );
+}
+
+TEST_F( TestTileFile, RoundTrip )
+{
+    writeTileFile( checkerBoard, filename, tileWidth, tileHeight );
+
+    TileFileReader reader( filename );
+    TextureInfo    readerInfo{};
+    reader.open( &readerInfo );
+    EXPECT_TRUE( readerInfo == info );
+    EXPECT_EQ( tileWidth, reader.getTileWidth() );
+    EXPECT_EQ( tileHeight, reader.getTileHeight() );
+    // Level 3 (16x16) is the first level smaller than a tile.
+    EXPECT_EQ( 3u, reader.getMipTailFirstLevel() );
+
+    for( unsigned int mipLevel = 0; mipLevel < reader.getMipTailFirstLevel(); ++mipLevel )
+    {
+        const unsigned int numTiles = ( info.width >> mipLevel ) / tileWidth;
+        for( unsigned int tileY = 0; tileY < numTiles; ++tileY )
+        {
+            for( unsigned int tileX = 0; tileX < numTiles; ++tileX )
+            {
+                expectSameTile( reader, mipLevel, tileX, tileY, tileWidth, tileHeight );
+                EXPECT_NE( nullptr, reader.getTileData( mipLevel, tileX, tileY ) );
+            }
+        }
+    }
+    EXPECT_EQ( nullptr, reader.getTileData( reader.getMipTailFirstLevel(), 0, 0 ) );
+    EXPECT_EQ( 16u + 4u + 1u, reader.getNumTilesRead() );
+}
+
+TEST_F( TestTileFile, AsyncReads )
+{
+    writeTileFile( checkerBoard, filename, tileWidth, tileHeight );
+    TileFileReader reader( filename, /*useAsyncReads=*/true );
+    reader.open( nullptr );
+
+    // Read every tile of level 0 as a batch, along with a tile from the mip tail.
+    const size_t             tileSize = tileWidth * tileHeight * getPixelSize();
+    std::vector<char>        buffer( 17 * tileSize );
+    std::vector<TileRequest> requests;
+    for( unsigned int tile = 0; tile < 16; ++tile )
+        requests.push_back( TileRequest{&buffer[tile * tileSize], 0, tile % 4, tile / 4} );
+    requests.push_back( TileRequest{&buffer[16 * tileSize], 3, 0, 0} );
+    const unsigned int numRequests = static_cast<unsigned int>( requests.size() );
+    ASSERT_TRUE( reader.readTiles( requests.data(), numRequests, tileWidth, tileHeight, nullptr ) );
+
+    // The mip tail tile is gathered from the mapping, which pads it with black.
+    std::vector<char> expected( tileSize );
+    for( unsigned int i = 0; i < 16; ++i )
+    {
+        const TileRequest& request = requests[i];
+        ASSERT_TRUE( checkerBoard.readTile( expected.data(), request.mipLevel, request.tileX, request.tileY, tileWidth,
+                                            tileHeight, nullptr ) );
+        EXPECT_TRUE( request.satisfied );
+        EXPECT_EQ( 0, memcmp( expected.data(), request.dest, tileSize ) );
+    }
+    ASSERT_TRUE( reader.readTile( expected.data(), 3, 0, 0, tileWidth, tileHeight, nullptr ) );
+    EXPECT_EQ( 0, memcmp( expected.data(), requests[16].dest, tileSize ) );
+    EXPECT_EQ( numRequests + 1, reader.getNumTilesRead() );
+    expectSameTile( reader, 1, 1, 1, tileWidth, tileHeight );
+}
+
+TEST_F( TestTileFile, ReadMipTail )
+{
+    writeTileFile( checkerBoard, filename, tileWidth, tileHeight );
+    TileFileReader reader( filename );
+    reader.open( nullptr );
+
+    std::vector<uint2> levelDims;
+    size_t             tailSize = 0;
+    for( unsigned int mipLevel = 0; mipLevel < info.numMipLevels; ++mipLevel )
+    {
+        levelDims.push_back( uint2{info.width >> mipLevel, info.height >> mipLevel} );
+        if( mipLevel >= reader.getMipTailFirstLevel() - 1 )
+            tailSize += levelDims.back().x * levelDims.back().y * getPixelSize();
+    }
+
+    // The stored mip tail is copied directly; a mip tail that starts at another level is assembled.
+    for( unsigned int firstLevel : {reader.getMipTailFirstLevel(), reader.getMipTailFirstLevel() - 1} )
+    {
+        std::vector<char> expected( tailSize );
+        std::vector<char> actual( tailSize );
+        const unsigned int pixelSize = static_cast<unsigned int>( getPixelSize() );
+        ASSERT_TRUE( checkerBoard.readMipTail( expected.data(), firstLevel, info.numMipLevels, levelDims.data(), pixelSize, nullptr ) );
+        ASSERT_TRUE( reader.readMipTail( actual.data(), firstLevel, info.numMipLevels, levelDims.data(), pixelSize, nullptr ) );
+        EXPECT_EQ( expected, actual ) << "first level " << firstLevel;
+    }
+}
+
+TEST_F( TestTileFile, ReadOtherTileSizes )
+{
+    writeTileFile( checkerBoard, filename, tileWidth, tileHeight );
+    TileFileReader reader( filename );
+    reader.open( nullptr );
+
+    // Tiles smaller and larger than the stored tiles are gathered from the stored tiles, and from
+    // the mip tail.
+    expectSameTile( reader, 0, 3, 5, 16, 16 );
+    expectSameTile( reader, 0, 1, 1, 64, 64 );
+    expectSameTile( reader, 3, 0, 0, 16, 16 );
+    expectSameTile( reader, 4, 1, 1, 4, 4 );
+}
+
+TEST_F( TestTileFile, ConvertUntiledImage )
+{
+    CheckerBoardImage untiled( 128, 128, /*squaresPerSide*/ 16, /*useMipmaps*/ true, /*tiled*/ false );
+    writeTileFile( untiled, filename, tileWidth, tileHeight );
+    TileFileReader reader( filename );
+    reader.open( nullptr );
+
+    for( unsigned int mipLevel = 0; mipLevel < info.numMipLevels; ++mipLevel )
+    {
+        const unsigned int width  = info.width >> mipLevel;
+        const unsigned int height = info.height >> mipLevel;
+        std::vector<char>  expected( width * height * getPixelSize() );
+        std::vector<char>  actual( expected.size() );
+        ASSERT_TRUE( checkerBoard.readMipLevel( expected.data(), mipLevel, width, height, nullptr ) );
+        ASSERT_TRUE( reader.readMipLevel( actual.data(), mipLevel, width, height, nullptr ) );
+        EXPECT_EQ( expected, actual ) << "mipLevel " << mipLevel;
+    }
+}
+
+TEST_F( TestTileFile, RejectsOtherFiles )
+{
+    {
+        std::ofstream stream( filename, std::ios::binary );
+        const std::vector<char> garbage( 256, 'x' );
+        stream.write( garbage.data(), garbage.size() );
+    }
+    TileFileReader reader( filename );
+    EXPECT_THROW( reader.open( nullptr ), std::exception );
+    EXPECT_FALSE( reader.isOpen() );
+
+    TileFileReader missing( "NoSuchFile.tiles" );
+    EXPECT_THROW( missing.open( nullptr ), std::exception );
+}
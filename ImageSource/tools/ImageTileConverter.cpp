@@ -0,0 +1,69 @@
+//
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+#include <OptiXToolkit/ImageSource/ImageSource.h>
+#include <OptiXToolkit/ImageSource/TileFileWriter.h>
+
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// Convert an image into a tile file, which TileFileReader can load without decoding.
+//
+// Usage: imageTileConverter <input image> <output.tiles> [tileWidth tileHeight]
+
+int main( int argc, char* argv[] )
+{
+    if( argc != 3 && argc != 5 )
+    {
+        std::cerr << "Usage: " << argv[0] << " <input image> <output.tiles> [tileWidth tileHeight]\n";
+        return EXIT_FAILURE;
+    }
+
+    // createImageSource expects the directory and filename separately.
+    const std::string input( argv[1] );
+    const size_t      slash     = input.find_last_of( "/\\" );
+    const std::string directory = slash == std::string::npos ? "." : input.substr( 0, slash );
+    const std::string filename  = slash == std::string::npos ? input : input.substr( slash + 1 );
+
+    const unsigned int tileWidth  = argc == 5 ? static_cast<unsigned int>( std::atoi( argv[3] ) ) : 0;
+    const unsigned int tileHeight = argc == 5 ? static_cast<unsigned int>( std::atoi( argv[4] ) ) : 0;
+
+    try
+    {
+        std::shared_ptr<imageSource::ImageSource> image = imageSource::createImageSource( filename, directory );
+        imageSource::writeTileFile( *image, argv[2], tileWidth, tileHeight );
+    }
+    catch( const std::exception& e )
+    {
+        std::cerr << "Error converting " << input << ": " << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}